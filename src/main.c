@@ -7,11 +7,21 @@
 //
 
 #include <stdio.h>
+#include <string.h>
 
 // test cases
 #include "../tests/test_cases.h"
+#include "../tests/bench_cases.h"
 
 int main(int argc, const char * argv[]) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        // ruyi bench lexer [options], the same as tests/bench_main.c
+        if (argc > 2 && strcmp(argv[2], "lexer") == 0) {
+            return run_bench_lexer(argc - 3, argv + 3);
+        }
+        run_bench_cases();
+        return 0;
+    }
     run_test_cases();
     //printf("Hello, World, %lu, %lu, %lu, %lu, %lu\n", sizeof(INT64),sizeof(UINT64), sizeof(INT32), sizeof(UINT32), sizeof(BYTE));
     return 0;
@@ -7,115 +7,431 @@
 //
 
 #include "ruyi_ast.h"
-#include "ruyi_mem.h"
+#include "ruyi_ast_walker.h"
+#include <string.h> // for memcpy
 
+#define AST_CHILDREN_INIT_SIZE 4
 
-// momery leak
-void ruyi_ast_destroy(ruyi_ast *ast) {
-    UINT32 i, len;
-    ruyi_value sub_ast_value;
-    ruyi_ast *sub_ast_ptr;
-    ruyi_unicode_string * ustr;
-    if(ast == NULL) {
-        return;
+static void* ruyi_ast_alloc(ruyi_mem_arena *arena, UINT32 size) {
+    if (arena) {
+        return ruyi_mem_arena_alloc(arena, size);
     }
+    return ruyi_mem_alloc(size);
+}
+
+static void ruyi_ast_free_data(ruyi_ast *ast) {
+    ruyi_unicode_string * ustr;
     switch (ast->adt_type) {
-    case Ruyi_adt_unicode_str:
+        case Ruyi_adt_unicode_str:
             ustr = (ruyi_unicode_string *)ast->data.ptr_value;
             if (ustr) {
                 ruyi_unicode_string_destroy(ustr);
                 ast->data.ptr_value = NULL;
             }
-        break;
-    default:
-        break;
-    }
-    if (ast->child_asts) {
-        for ((void)(len = ruyi_vector_length(ast->child_asts)), i = 0; i < len; i++) {
-            ruyi_vector_get(ast->child_asts, i, &sub_ast_value);
-            sub_ast_ptr = (ruyi_ast *)sub_ast_value.data.ptr;
-            if (sub_ast_ptr) {
-                ruyi_ast_destroy(sub_ast_ptr);
-            }
-        }
-        ruyi_vector_destroy(ast->child_asts);
-        ast->child_asts = NULL;
+            break;
+        default:
+            break;
+    }
+}
+
+// a node of a parse is released with all others by the root
+static void ruyi_ast_destroy_arena_node(ruyi_ast *ast) {
+    if (ast->adt_type == Ruyi_adt_arena) {
+        ruyi_mem_arena_destroy(((ruyi_ast_root_data*)ast->data.ptr_value)->arena);
+    }
+}
+
+static ruyi_error* ruyi_ast_destroy_pre(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    (void)walker;
+    (void)child_frame;
+    if (frame->ast->arena) {
+        ruyi_ast_walker_skip_children(frame);
+    }
+    return NULL;
+}
+
+// the children are released before, so the node is not used after this
+static ruyi_error* ruyi_ast_destroy_post(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_ast *ast = frame->ast;
+    (void)walker;
+    (void)child_frame;
+    if (ast->arena) {
+        ruyi_ast_destroy_arena_node(ast);
+        return NULL;
     }
+    ruyi_ast_free_data(ast);
+    ruyi_mem_free(ast->children);
     // destroy self
     ruyi_mem_free(ast);
+    return NULL;
 }
 
-void ruyi_ast_destroy_without_child(ruyi_ast *ast) {
-    ruyi_unicode_string * ustr;
+static const ruyi_ast_visitor ruyi_ast_destroy_visitor = {
+    .pre_default = ruyi_ast_destroy_pre,
+    .post_default = ruyi_ast_destroy_post,
+};
+
+void ruyi_ast_destroy(ruyi_ast *ast) {
+    ruyi_ast_walker *walker;
     if(ast == NULL) {
         return;
     }
-    switch (ast->adt_type) {
-        case Ruyi_adt_unicode_str:
-            ustr = (ruyi_unicode_string *)ast->data.ptr_value;
-            if (ustr) {
-                ruyi_unicode_string_destroy(ustr);
-                ast->data.ptr_value = NULL;
-            }
-            break;
-        default:
-            break;
+    if (ast->arena) {
+        ruyi_ast_destroy_arena_node(ast);
+        return;
     }
-    if (ast->child_asts) {
-        ruyi_vector_destroy(ast->child_asts);
-        ast->child_asts = NULL;
+    walker = ruyi_ast_walker_create(&ruyi_ast_destroy_visitor, NULL);
+    ruyi_ast_walk(walker, ast, NULL);
+    ruyi_ast_walker_destroy(walker);
+}
+
+void ruyi_ast_destroy_without_child(ruyi_ast *ast) {
+    if(ast == NULL || ast->arena) {
+        return;
     }
+    ruyi_ast_free_data(ast);
+    ruyi_mem_free(ast->children);
     // destory self
     ruyi_mem_free(ast);
 }
 
-ruyi_ast * ruyi_ast_create(ruyi_ast_type type) {
-    ruyi_ast *ast = ruyi_mem_alloc(sizeof(ruyi_ast));
+ruyi_ast * ruyi_ast_create(ruyi_mem_arena *arena, ruyi_ast_type type) {
+    ruyi_ast *ast = (ruyi_ast*)ruyi_ast_alloc(arena, sizeof(ruyi_ast));
     ast->type = type;
     ast->adt_type = Ruyi_adt_value;
     ast->data.int64_value = 0;
-    ast->child_asts = NULL;
+    ast->symbol = RUYI_SYMBOL_NONE;
+    ast->child_count = 0;
+    ast->children = NULL;
+    ast->arena = arena;
     return ast;
 }
 
-ruyi_ast * ruyi_ast_create_by_token_type(ruyi_ast_type type, ruyi_token_type token_type) {
-    ruyi_ast *ast = ruyi_ast_create(type);
+ruyi_ast * ruyi_ast_create_by_token_type(ruyi_mem_arena *arena, ruyi_ast_type type, ruyi_token_type token_type) {
+    ruyi_ast *ast = ruyi_ast_create(arena, type);
     ast->data.int64_value = token_type;
     return ast;
 }
 
-ruyi_ast * ruyi_ast_create_with_unicode(ruyi_ast_type type, ruyi_unicode_string *str) {
-    ruyi_ast *ast = ruyi_ast_create(type);
+ruyi_ast * ruyi_ast_create_with_unicode(ruyi_mem_arena *arena, ruyi_ast_type type, ruyi_unicode_string *str) {
+    ruyi_ast *ast = ruyi_ast_create(arena, type);
+    ruyi_unicode_string *copy;
     ast->adt_type = Ruyi_adt_unicode_str;
-    ast->data.ptr_value = ruyi_unicode_string_copy_from(str);
+    if (arena == NULL) {
+        ast->data.ptr_value = ruyi_unicode_string_copy_from(str);
+    } else if (str) {
+        // never destroyed by ruyi_unicode_string_destroy, the arena releases it
+        copy = (ruyi_unicode_string*)ruyi_mem_arena_alloc(arena, sizeof(ruyi_unicode_string));
+        copy->length = str->length;
+        copy->capacity = str->length;
+        copy->data = (WIDE_CHAR*)ruyi_mem_arena_alloc(arena, sizeof(WIDE_CHAR) * (str->length > 0 ? str->length : 1));
+        memcpy(copy->data, str->data, sizeof(WIDE_CHAR) * str->length);
+        ast->data.ptr_value = copy;
+    } else {
+        ast->data.ptr_value = NULL;
+    }
+    return ast;
+}
+
+ruyi_ast * ruyi_ast_create_with_symbol(ruyi_mem_arena *arena, ruyi_ast_type type, ruyi_symbol symbol) {
+    ruyi_ast *ast = ruyi_ast_create(arena, type);
+    ast->adt_type = Ruyi_adt_symbol;
+    ast->symbol = symbol;
+    ast->data.ptr_value = (void*)ruyi_symbol_str(symbol);
     return ast;
 }
 
 void ruyi_ast_add_child(ruyi_ast *ast, ruyi_ast *child) {
+    ruyi_ast **children;
+    UINT32 capacity;
     assert(ast);
-    if (!ast->child_asts) {
-        ast->child_asts = ruyi_vector_create();
+    // full when the count is 0, or a power of 2 not less than the init size
+    if (ast->child_count == 0 ||
+        (ast->child_count >= AST_CHILDREN_INIT_SIZE && (ast->child_count & (ast->child_count - 1)) == 0)) {
+        capacity = ast->child_count == 0 ? AST_CHILDREN_INIT_SIZE : ast->child_count * 2;
+        children = (ruyi_ast**)ruyi_ast_alloc(ast->arena, sizeof(ruyi_ast*) * capacity);
+        if (ast->child_count > 0) {
+            memcpy(children, ast->children, sizeof(ruyi_ast*) * ast->child_count);
+        }
+        // the old array of an arena node is left in the arena
+        if (ast->arena == NULL) {
+            ruyi_mem_free(ast->children);
+        }
+        ast->children = children;
     }
-    ruyi_vector_add(ast->child_asts, ruyi_value_ptr(child));
+    ast->children[ast->child_count++] = child;
 }
 
 ruyi_ast * ruyi_ast_get_child(const ruyi_ast *ast, UINT32 index) {
-    ruyi_value child_ptr;
     assert(ast);
-    if (!ast->child_asts) {
+    if (index >= ast->child_count) {
         return NULL;
     }
-    if (!ruyi_vector_get(ast->child_asts, index, &child_ptr)) {
-        return NULL;
-    }
-    return (ruyi_ast *)child_ptr.data.ptr;
+    return ast->children[index];
 }
 
 
 UINT32 ruyi_ast_child_length(const ruyi_ast *ast) {
     assert(ast);
-    if (ast->child_asts == NULL) {
+    return ast->child_count;
+}
+
+typedef struct {
+    ruyi_ast_tree *tree;
+    UINT32 node_count;
+    UINT32 child_id_count;
+    UINT32 value_count;
+    UINT32 string_count;
+    UINT32 char_count;
+    UINT32 lazy_body_count;
+} ruyi_ast_tree_builder;
+
+// pre of the walk counting the nodes and the data of a tree
+static ruyi_error* ruyi_ast_tree_count(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_ast_tree_builder *builder = (ruyi_ast_tree_builder*)ruyi_ast_walker_context(walker);
+    const ruyi_ast *ast = frame->ast;
+    const ruyi_unicode_string *str;
+    (void)child_frame;
+    builder->node_count++;
+    builder->child_id_count += ast->child_count;
+    switch (ast->adt_type) {
+        case Ruyi_adt_symbol:
+            break;
+        case Ruyi_adt_unicode_str:
+            builder->string_count++;
+            str = (const ruyi_unicode_string*)ast->data.ptr_value;
+            if (str) {
+                builder->char_count += str->length;
+            }
+            break;
+        case Ruyi_adt_arena:
+            break;
+        case Ruyi_adt_lazy_body:
+            builder->lazy_body_count++;
+            break;
+        default:
+            if (ast->data.int64_value != 0) {
+                builder->value_count++;
+            }
+            break;
+    }
+    return NULL;
+}
+
+// pre of the walk adding the nodes in pre-order, the id of the node is the data of its frame
+static ruyi_error* ruyi_ast_tree_add(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_ast_tree_builder *builder = (ruyi_ast_tree_builder*)ruyi_ast_walker_context(walker);
+    const ruyi_ast *ast = frame->ast;
+    ruyi_ast_tree *tree = builder->tree;
+    ruyi_ast_id id = builder->node_count++;
+    ruyi_ast_node *node = &tree->nodes[id];
+    ruyi_unicode_string *copy;
+    const ruyi_unicode_string *str;
+    UINT32 children, i;
+    (void)child_frame;
+    node->type = (UINT16)ast->type;
+    node->adt_type = (UINT16)ast->adt_type;
+    switch (ast->adt_type) {
+        case Ruyi_adt_symbol:
+            node->payload = ast->symbol;
+            break;
+        case Ruyi_adt_unicode_str:
+            node->payload = builder->string_count++;
+            copy = &tree->strings[node->payload];
+            str = (const ruyi_unicode_string*)ast->data.ptr_value;
+            copy->data = tree->chars ? tree->chars + builder->char_count : NULL;
+            copy->length = str ? str->length : 0;
+            copy->capacity = copy->length;
+            if (copy->length > 0) {
+                memcpy(copy->data, str->data, sizeof(WIDE_CHAR) * copy->length);
+                builder->char_count += copy->length;
+            }
+            break;
+        case Ruyi_adt_arena:
+            // the flat tree does not keep the arena of the nodes
+            node->adt_type = Ruyi_adt_value;
+            node->payload = 0;
+            break;
+        case Ruyi_adt_lazy_body:
+            node->payload = builder->lazy_body_count++;
+            tree->lazy_bodies[node->payload] = *(const ruyi_ast_lazy_body*)ast->data.ptr_value;
+            break;
+        default:
+            // most nodes have no value, e.g. types and operators
+            if (ast->data.int64_value != 0) {
+                tree->values[builder->value_count++] = ast->data.int64_value;
+                node->payload = builder->value_count;
+            } else {
+                node->payload = 0;
+            }
+            break;
+    }
+    // the children are kept together, the subtrees of them follow in pre-order
+    children = builder->child_id_count;
+    builder->child_id_count += ast->child_count;
+    node->children = children;
+    node->child_count = ast->child_count;
+    for (i = 0; i < ast->child_count; i++) {
+        // a missing child is not walked
+        tree->child_ids[children + i] = RUYI_AST_NONE;
+    }
+    *(ruyi_ast_id*)frame->data = id;
+    return NULL;
+}
+
+// post of the walk adding the nodes, the node is put to its place in the children of the parent
+static ruyi_error* ruyi_ast_tree_link(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_ast_tree_builder *builder = (ruyi_ast_tree_builder*)ruyi_ast_walker_context(walker);
+    ruyi_ast_walk_frame *parent = ruyi_ast_walker_frame(walker, 1);
+    (void)child_frame;
+    if (parent) {
+        builder->tree->child_ids[builder->tree->nodes[*(ruyi_ast_id*)parent->data].children + parent->child] = *(ruyi_ast_id*)frame->data;
+    }
+    return NULL;
+}
+
+static const ruyi_ast_visitor ruyi_ast_tree_count_visitor = {
+    .pre_default = ruyi_ast_tree_count,
+};
+
+static const ruyi_ast_visitor ruyi_ast_tree_add_visitor = {
+    .pre_default = ruyi_ast_tree_add,
+    .post_default = ruyi_ast_tree_link,
+    .data_size = sizeof(ruyi_ast_id),
+};
+
+ruyi_ast_tree* ruyi_ast_tree_create(const ruyi_ast *ast) {
+    ruyi_ast_tree *tree;
+    ruyi_ast_tree_builder builder;
+    ruyi_ast_walker *walker;
+    assert(ast);
+    memset(&builder, 0, sizeof(builder));
+    // nodes[0] is RUYI_AST_NONE
+    builder.node_count = 1;
+    // the nodes are only read by the walks
+    walker = ruyi_ast_walker_create(&ruyi_ast_tree_count_visitor, &builder);
+    ruyi_ast_walk(walker, (ruyi_ast*)ast, NULL);
+    ruyi_ast_walker_destroy(walker);
+    tree = (ruyi_ast_tree*)ruyi_mem_alloc(sizeof(ruyi_ast_tree));
+    tree->node_count = builder.node_count;
+    tree->child_id_count = builder.child_id_count;
+    tree->value_count = builder.value_count;
+    tree->string_count = builder.string_count;
+    tree->char_count = builder.char_count;
+    tree->lazy_body_count = builder.lazy_body_count;
+    tree->symbols = NULL;
+    tree->image = NULL;
+    tree->nodes = (ruyi_ast_node*)ruyi_mem_alloc(sizeof(ruyi_ast_node) * tree->node_count);
+    tree->child_ids = tree->child_id_count > 0 ? (ruyi_ast_id*)ruyi_mem_alloc(sizeof(ruyi_ast_id) * tree->child_id_count) : NULL;
+    tree->values = tree->value_count > 0 ? (UINT64*)ruyi_mem_alloc(sizeof(UINT64) * tree->value_count) : NULL;
+    tree->strings = tree->string_count > 0 ? (ruyi_unicode_string*)ruyi_mem_alloc(sizeof(ruyi_unicode_string) * tree->string_count) : NULL;
+    tree->chars = tree->char_count > 0 ? (WIDE_CHAR*)ruyi_mem_alloc(sizeof(WIDE_CHAR) * tree->char_count) : NULL;
+    tree->lazy_bodies = tree->lazy_body_count > 0 ? (ruyi_ast_lazy_body*)ruyi_mem_alloc(sizeof(ruyi_ast_lazy_body) * tree->lazy_body_count) : NULL;
+    memset(&tree->nodes[RUYI_AST_NONE], 0, sizeof(ruyi_ast_node));
+    builder.tree = tree;
+    builder.node_count = 1;
+    builder.child_id_count = 0;
+    builder.value_count = 0;
+    builder.string_count = 0;
+    builder.char_count = 0;
+    builder.lazy_body_count = 0;
+    walker = ruyi_ast_walker_create(&ruyi_ast_tree_add_visitor, &builder);
+    ruyi_ast_walk(walker, (ruyi_ast*)ast, NULL);
+    ruyi_ast_walker_destroy(walker);
+    assert(builder.node_count == tree->node_count && builder.char_count == tree->char_count);
+    return tree;
+}
+
+void ruyi_ast_tree_destroy(ruyi_ast_tree *tree) {
+    if (!tree) {
+        return;
+    }
+    if (tree->image) {
+        // the arrays are in the mapped file, only the strings and symbols are allocated
+        ruyi_file_close(tree->image);
+    } else {
+        ruyi_mem_free(tree->nodes);
+        ruyi_mem_free(tree->child_ids);
+        ruyi_mem_free(tree->values);
+        ruyi_mem_free(tree->chars);
+    }
+    ruyi_mem_free(tree->strings);
+    ruyi_mem_free(tree->symbols);
+    ruyi_mem_free(tree->lazy_bodies);
+    ruyi_mem_free(tree);
+}
+
+ruyi_ast_id ruyi_ast_tree_root(const ruyi_ast_tree *tree) {
+    assert(tree);
+    // the first node in pre-order
+    return 1;
+}
+
+ruyi_ast_type ruyi_ast_tree_type(const ruyi_ast_tree *tree, ruyi_ast_id id) {
+    assert(id != RUYI_AST_NONE && id < tree->node_count);
+    return (ruyi_ast_type)tree->nodes[id].type;
+}
+
+ruyi_ast_data_type ruyi_ast_tree_data_type(const ruyi_ast_tree *tree, ruyi_ast_id id) {
+    assert(id != RUYI_AST_NONE && id < tree->node_count);
+    return (ruyi_ast_data_type)tree->nodes[id].adt_type;
+}
+
+UINT32 ruyi_ast_tree_child_length(const ruyi_ast_tree *tree, ruyi_ast_id id) {
+    assert(id != RUYI_AST_NONE && id < tree->node_count);
+    return tree->nodes[id].child_count;
+}
+
+ruyi_ast_id ruyi_ast_tree_get_child(const ruyi_ast_tree *tree, ruyi_ast_id id, UINT32 index) {
+    const ruyi_ast_node *node;
+    assert(id != RUYI_AST_NONE && id < tree->node_count);
+    node = &tree->nodes[id];
+    if (index >= node->child_count) {
+        return RUYI_AST_NONE;
+    }
+    return tree->child_ids[node->children + index];
+}
+
+ruyi_symbol ruyi_ast_tree_symbol(const ruyi_ast_tree *tree, ruyi_ast_id id) {
+    assert(id != RUYI_AST_NONE && id < tree->node_count);
+    if (tree->nodes[id].adt_type != Ruyi_adt_symbol) {
+        return RUYI_SYMBOL_NONE;
+    }
+    if (tree->symbols) {
+        return tree->symbols[tree->nodes[id].payload];
+    }
+    return tree->nodes[id].payload;
+}
+
+UINT64 ruyi_ast_tree_int_value(const ruyi_ast_tree *tree, ruyi_ast_id id) {
+    const ruyi_ast_node *node;
+    assert(id != RUYI_AST_NONE && id < tree->node_count);
+    node = &tree->nodes[id];
+    if (node->adt_type == Ruyi_adt_symbol || node->adt_type == Ruyi_adt_unicode_str || node->payload == 0) {
         return 0;
     }
-    return ast->child_asts->len;
+    return tree->values[node->payload - 1];
+}
+
+double ruyi_ast_tree_float_value(const ruyi_ast_tree *tree, ruyi_ast_id id) {
+    UINT64 bits = ruyi_ast_tree_int_value(tree, id);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+const ruyi_unicode_string* ruyi_ast_tree_string(const ruyi_ast_tree *tree, ruyi_ast_id id) {
+    assert(id != RUYI_AST_NONE && id < tree->node_count);
+    if (tree->nodes[id].adt_type != Ruyi_adt_unicode_str) {
+        return NULL;
+    }
+    return &tree->strings[tree->nodes[id].payload];
+}
+
+const ruyi_ast_lazy_body* ruyi_ast_tree_lazy_body(const ruyi_ast_tree *tree, ruyi_ast_id id) {
+    assert(id != RUYI_AST_NONE && id < tree->node_count);
+    if (tree->nodes[id].adt_type != Ruyi_adt_lazy_body) {
+        return NULL;
+    }
+    return &tree->lazy_bodies[tree->nodes[id].payload];
 }
@@ -12,6 +12,7 @@
 #include "ruyi_basics.h"
 #include "ruyi_vector.h"
 #include "ruyi_lexer.h"
+#include "ruyi_mem.h"
 
 typedef enum {
     Ruyi_at_root,
@@ -128,15 +129,21 @@ typedef enum {
     Ruyi_at_type_list,
     Ruyi_at_expr_list,
 
+    Ruyi_at_COUNT,      // count of the types, e.g. for the tables of a visitor, not a type of node
 } ruyi_ast_type;
 
 
 typedef enum {
     Ruyi_adt_value,
     Ruyi_adt_unicode_str,
-    Ruyi_adt_char_ptr
+    Ruyi_adt_char_ptr,
+    Ruyi_adt_symbol,    // ptr_value is the canonical string of the symbol, not owned by the ast
+    Ruyi_adt_arena,     // ptr_value is the ruyi_ast_root_data of the tree, only for the root made by ruyi_parse_ast
+    Ruyi_adt_lazy_body  // ptr_value is the ruyi_ast_lazy_body of a function body not parsed yet, it has no children
 } ruyi_ast_data_type;
 
+#define AST_ARENA_BLOCK_SIZE (64 * 1024)
+
 struct _ruyi_ast;
 typedef struct _ruyi_ast {
     ruyi_ast_type type;
@@ -148,14 +155,57 @@ typedef struct _ruyi_ast {
         void* ptr_value;
         double float_value;
     } data;
-    ruyi_vector* child_asts;
+    // interned id of the name, only for Ruyi_adt_symbol
+    ruyi_symbol symbol;
+    UINT32 child_count;
+    // the capacity is the next power of 2 of child_count, at least 4
+    struct _ruyi_ast **children;
+    // the node, its children array and its string are allocated from it, NULL for ruyi_mem_alloc
+    ruyi_mem_arena *arena;
 } ruyi_ast;
 
-ruyi_ast * ruyi_ast_create(ruyi_ast_type type);
+/*
+ The data of a root made by ruyi_parse_ast, allocated from its arena.
+ The byte spans of the global declarations let ruyi_reparse_ast parse only the ones an edit touches.
+ */
+typedef struct {
+    // arena of all nodes of the tree, and of this
+    ruyi_mem_arena *arena;
+    // byte offsets of the global declarations in the source, NULL if the bytes of the source were not known
+    UINT32 *declaration_starts;
+    UINT32 declaration_count;
+    // bytes of the source the tree is parsed from
+    UINT32 source_length;
+    // bytes of the arena after the whole source parsed, and bytes added by reparses since then
+    UINT64 tree_size;
+    UINT64 reparsed_size;
+} ruyi_ast_root_data;
+
+/*
+ The tokens of a function body left by Ruyi_po_LAZY_BODIES, allocated from the arena of the tree.
+ The stub is a Ruyi_at_block_statements, ruyi_parse_lazy_body parses the tokens when the body is first needed.
+ */
+typedef struct {
+    const ruyi_token_stream *stream;
+    UINT32 from;            // the token after the '{'
+    UINT32 end;             // the '}' of the body
+    UINT32 options;         // ruyi_parse_option flags of the parse
+} ruyi_ast_lazy_body;
+
+/**
+ * Create an ast node
+ * params:
+ * arena - where the node is allocated, the nodes of an arena are released with it, and ruyi_ast_destroy
+ *         does nothing on them. NULL for a node released by ruyi_ast_destroy
+ * type - type of the node
+ */
+ruyi_ast * ruyi_ast_create(ruyi_mem_arena *arena, ruyi_ast_type type);
 
-ruyi_ast * ruyi_ast_create_by_token_type(ruyi_ast_type type, ruyi_token_type token_type);
+ruyi_ast * ruyi_ast_create_by_token_type(ruyi_mem_arena *arena, ruyi_ast_type type, ruyi_token_type token_type);
 
-ruyi_ast * ruyi_ast_create_with_unicode(ruyi_ast_type type, ruyi_unicode_string *str);
+ruyi_ast * ruyi_ast_create_with_unicode(ruyi_mem_arena *arena, ruyi_ast_type type, ruyi_unicode_string *str);
+
+ruyi_ast * ruyi_ast_create_with_symbol(ruyi_mem_arena *arena, ruyi_ast_type type, ruyi_symbol symbol);
 
 void ruyi_ast_add_child(ruyi_ast *ast, ruyi_ast *child);
 
@@ -163,9 +213,96 @@ UINT32 ruyi_ast_child_length(const ruyi_ast *ast);
 
 ruyi_ast * ruyi_ast_get_child(const ruyi_ast *ast, UINT32 index);
 
+/**
+ * Release a tree. The root made by ruyi_parse_ast releases its arena, the whole tree at once
+ */
 void ruyi_ast_destroy(ruyi_ast *ast);
 
 void ruyi_ast_destroy_without_child(ruyi_ast *ast);
 
+/*
+ A tree flattened from ruyi_ast nodes, for walking without chasing pointers.
+ Nodes are kept in one array by pre-order, a node is named by its index. The children of a node are a range
+ of child_ids, and the payloads of the nodes are kept in arrays of their own types.
+ */
+typedef UINT32 ruyi_ast_id;
+
+// a missing optional part, the same as a NULL child of ruyi_ast. nodes[0] is never used
+#define RUYI_AST_NONE 0
+
+typedef struct {
+    UINT16 type;            // ruyi_ast_type
+    UINT16 adt_type;        // ruyi_ast_data_type
+    UINT32 child_count;
+    UINT32 children;        // index of the first child in child_ids
+    /*
+     Ruyi_adt_symbol: the symbol
+     Ruyi_adt_unicode_str: index in strings
+     Ruyi_adt_lazy_body: index in lazy_bodies
+     others: 1 + index in values, 0 if the data is 0
+     */
+    UINT32 payload;
+} ruyi_ast_node;
+
+typedef struct {
+    ruyi_ast_node *nodes;
+    UINT32 node_count;      // with nodes[0]
+    ruyi_ast_id *child_ids;
+    UINT32 child_id_count;
+    UINT64 *values;         // bits of the data of the nodes, only those not 0
+    UINT32 value_count;
+    ruyi_unicode_string *strings;   // the chars of them are in chars
+    UINT32 string_count;
+    WIDE_CHAR *chars;
+    UINT32 char_count;
+    // copies of the tokens of the lazy bodies, so the tree keeps them after the ast is released
+    ruyi_ast_lazy_body *lazy_bodies;
+    UINT32 lazy_body_count;
+    // the interned symbol of each symbol payload, NULL if the payloads are the symbols
+    ruyi_symbol *symbols;
+    // the cache file the arrays are read from in place, NULL if they are allocated, see ruyi_ast_cache.h
+    ruyi_file *image;
+} ruyi_ast_tree;
+
+/**
+ * Flatten a tree of ruyi_ast nodes, all arrays are allocated in their exact sizes
+ * params:
+ * ast - root of the tree, it is not changed
+ * return:
+ * the tree, the root is ruyi_ast_tree_root(tree)
+ */
+ruyi_ast_tree* ruyi_ast_tree_create(const ruyi_ast *ast);
+
+void ruyi_ast_tree_destroy(ruyi_ast_tree *tree);
+
+ruyi_ast_id ruyi_ast_tree_root(const ruyi_ast_tree *tree);
+
+ruyi_ast_type ruyi_ast_tree_type(const ruyi_ast_tree *tree, ruyi_ast_id id);
+
+ruyi_ast_data_type ruyi_ast_tree_data_type(const ruyi_ast_tree *tree, ruyi_ast_id id);
+
+UINT32 ruyi_ast_tree_child_length(const ruyi_ast_tree *tree, ruyi_ast_id id);
+
+/**
+ * Get a child of a node
+ * return:
+ * id of the child, RUYI_AST_NONE if the child is missing or the index is out of range
+ */
+ruyi_ast_id ruyi_ast_tree_get_child(const ruyi_ast_tree *tree, ruyi_ast_id id, UINT32 index);
+
+ruyi_symbol ruyi_ast_tree_symbol(const ruyi_ast_tree *tree, ruyi_ast_id id);
+
+// data of a Ruyi_adt_value node, the same as data.int64_value of ruyi_ast
+UINT64 ruyi_ast_tree_int_value(const ruyi_ast_tree *tree, ruyi_ast_id id);
+
+// data of a Ruyi_adt_value node, the same as data.float_value of ruyi_ast
+double ruyi_ast_tree_float_value(const ruyi_ast_tree *tree, ruyi_ast_id id);
+
+// data of a Ruyi_adt_unicode_str node, NULL for others
+const ruyi_unicode_string* ruyi_ast_tree_string(const ruyi_ast_tree *tree, ruyi_ast_id id);
+
+// tokens of a Ruyi_adt_lazy_body node, NULL for others
+const ruyi_ast_lazy_body* ruyi_ast_tree_lazy_body(const ruyi_ast_tree *tree, ruyi_ast_id id);
+
 
 #endif /* ruyi_ast_h */
@@ -0,0 +1,389 @@
+//
+//  ruyi_ast_cache.c
+//  ruyi
+//
+
+// for mkstemp, fchmod and fdopen, which -std=c99 does not declare
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ruyi_ast_cache.h"
+#include <stdio.h>
+#include <string.h> // for memcpy, memset, strlen
+#include "ruyi_mem.h"
+#include "ruyi_io.h"
+#include "ruyi_lexer.h"
+#include "ruyi_parser.h"
+#include "ruyi_symbol.h"
+#if defined(_WIN32)
+#include <process.h> // for _getpid
+#else
+#include <stdlib.h> // for mkstemp
+#include <sys/stat.h> // for fchmod
+#include <unistd.h>
+#endif
+
+// "RAST" as a little endian UINT32, a file of the other byte order does not match it
+#define RUYI_AST_CACHE_MAGIC 0x54534152u
+#define RUYI_AST_CACHE_ALIGN 8
+
+typedef struct {
+    UINT32 magic;
+    UINT16 version;
+    UINT16 char_size;           // sizeof(WIDE_CHAR)
+    UINT64 key;
+    UINT32 node_count;
+    UINT32 child_id_count;
+    UINT32 value_count;
+    UINT32 string_count;
+    UINT32 char_count;
+    // names of the symbols, the payload of a symbol node is 1 + index of its name, 0 for RUYI_SYMBOL_NONE
+    UINT32 symbol_count;
+    UINT32 symbol_char_count;
+    UINT32 reserved;
+} ruyi_ast_cache_header;
+
+// the arrays after the header, in the order of the file
+typedef enum {
+    Ruyi_acs_values,
+    Ruyi_acs_nodes,
+    Ruyi_acs_child_ids,
+    Ruyi_acs_string_lengths,
+    Ruyi_acs_chars,
+    Ruyi_acs_symbol_lengths,
+    Ruyi_acs_symbol_chars,
+    Ruyi_acs_COUNT
+} ruyi_ast_cache_section;
+
+static UINT64 ruyi_ast_cache_rotate(UINT64 x, UINT32 bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+static UINT64 ruyi_ast_cache_mix_word(UINT64 word) {
+    word *= 0x87C37B91114253D5ULL;
+    word = ruyi_ast_cache_rotate(word, 31);
+    return word * 0x4CF5AD432745937FULL;
+}
+
+UINT64 ruyi_ast_cache_key(const BYTE *source, UINT32 length) {
+    // the steps of murmur3, one 64 bits lane
+    UINT64 hash = 0x9E3779B97F4A7C15ULL ^ length;
+    UINT64 word;
+    UINT32 i = 0;
+    for (; i + 8 <= length; i += 8) {
+        memcpy(&word, source + i, 8);
+        hash ^= ruyi_ast_cache_mix_word(word);
+        hash = ruyi_ast_cache_rotate(hash, 27) * 5 + 0x52DCE729;
+    }
+    word = 0;
+    memcpy(&word, source + i, length - i);
+    hash ^= ruyi_ast_cache_mix_word(word);
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// the offsets of the arrays, return the size of the file. 64 bits, so a broken header can not overflow it
+static UINT64 ruyi_ast_cache_layout(const ruyi_ast_cache_header *header, UINT64 offsets[Ruyi_acs_COUNT]) {
+    UINT64 sizes[Ruyi_acs_COUNT];
+    UINT64 offset = sizeof(ruyi_ast_cache_header);
+    UINT32 i;
+    sizes[Ruyi_acs_values] = (UINT64)header->value_count * sizeof(UINT64);
+    sizes[Ruyi_acs_nodes] = (UINT64)header->node_count * sizeof(ruyi_ast_node);
+    sizes[Ruyi_acs_child_ids] = (UINT64)header->child_id_count * sizeof(ruyi_ast_id);
+    sizes[Ruyi_acs_string_lengths] = (UINT64)header->string_count * sizeof(UINT32);
+    sizes[Ruyi_acs_chars] = (UINT64)header->char_count * sizeof(WIDE_CHAR);
+    sizes[Ruyi_acs_symbol_lengths] = (UINT64)header->symbol_count * sizeof(UINT32);
+    sizes[Ruyi_acs_symbol_chars] = (UINT64)header->symbol_char_count * sizeof(WIDE_CHAR);
+    for (i = 0; i < Ruyi_acs_COUNT; i++) {
+        offset = (offset + RUYI_AST_CACHE_ALIGN - 1) & ~(UINT64)(RUYI_AST_CACHE_ALIGN - 1);
+        offsets[i] = offset;
+        offset += sizes[i];
+    }
+    return offset;
+}
+
+// create a temp file next to the path, of a name no other writer uses, so two writers never write one file
+static FILE* ruyi_ast_cache_open_tmp(const char *path, char **out_tmp_path) {
+    char *tmp_path = (char*)ruyi_mem_alloc((UINT32)strlen(path) + 32);
+    FILE *fp;
+#if defined(_WIN32)
+    sprintf(tmp_path, "%s.%d.tmp", path, _getpid());
+    fp = fopen(tmp_path, "wb");
+#else
+    int fd;
+    sprintf(tmp_path, "%s.XXXXXX", path);
+    fp = NULL;
+    if ((fd = mkstemp(tmp_path)) >= 0) {
+        // mkstemp makes it for the owner only, the cache is read by others the same as a file by fopen
+        fchmod(fd, 0644);
+        if ((fp = fdopen(fd, "wb")) == NULL) {
+            close(fd);
+            remove(tmp_path);
+        }
+    }
+#endif
+    *out_tmp_path = tmp_path;
+    return fp;
+}
+
+ruyi_error* ruyi_ast_cache_save(const ruyi_ast_tree *tree, UINT64 key, const char *path) {
+    ruyi_ast_cache_header header;
+    UINT64 offsets[Ruyi_acs_COUNT];
+    UINT64 size;
+    // 1 + index of the name of each symbol id, 0 if it is not met yet
+    UINT32 *indexes = (UINT32*)ruyi_mem_alloc(sizeof(UINT32) * (ruyi_symbol_count() + 1));
+    ruyi_symbol *names = (ruyi_symbol*)ruyi_mem_alloc(sizeof(ruyi_symbol) * tree->node_count);
+    const ruyi_unicode_string *str;
+    ruyi_ast_node *nodes;
+    ruyi_symbol symbol;
+    UINT32 *lengths;
+    WIDE_CHAR *chars;
+    BYTE *image = NULL;
+    char *tmp_path = NULL;
+    FILE *fp;
+    BOOL written;
+    UINT32 i;
+    if (tree->lazy_body_count > 0) {
+        // the tokens of the lazy bodies are not saved
+        ruyi_mem_free(indexes);
+        ruyi_mem_free(names);
+        return ruyi_error_misc("the tree has function bodies not parsed, it can not be saved.");
+    }
+    memset(indexes, 0, sizeof(UINT32) * (ruyi_symbol_count() + 1));
+    memset(&header, 0, sizeof(header));
+    header.magic = RUYI_AST_CACHE_MAGIC;
+    header.version = RUYI_AST_CACHE_VERSION;
+    header.char_size = sizeof(WIDE_CHAR);
+    header.key = key;
+    header.node_count = tree->node_count;
+    header.child_id_count = tree->child_id_count;
+    header.value_count = tree->value_count;
+    header.string_count = tree->string_count;
+    header.char_count = tree->char_count;
+    for (i = 1; i < tree->node_count; i++) {
+        symbol = ruyi_ast_tree_symbol(tree, i);
+        if (symbol != RUYI_SYMBOL_NONE && indexes[symbol] == 0) {
+            names[header.symbol_count++] = symbol;
+            indexes[symbol] = header.symbol_count;
+            header.symbol_char_count += ruyi_symbol_str(symbol)->length;
+        }
+    }
+    size = ruyi_ast_cache_layout(&header, offsets);
+    if (size > 0xFFFFFFFFu) {
+        ruyi_mem_free(indexes);
+        ruyi_mem_free(names);
+        return ruyi_error_misc("the ast is too large to cache: %llu bytes", (unsigned long long)size);
+    }
+    // the padding between the arrays is 0
+    image = (BYTE*)ruyi_mem_alloc((UINT32)size);
+    memset(image, 0, (size_t)size);
+    memcpy(image, &header, sizeof(header));
+    if (tree->value_count > 0) {
+        memcpy(image + offsets[Ruyi_acs_values], tree->values, sizeof(UINT64) * tree->value_count);
+    }
+    nodes = (ruyi_ast_node*)(image + offsets[Ruyi_acs_nodes]);
+    memcpy(nodes, tree->nodes, sizeof(ruyi_ast_node) * tree->node_count);
+    for (i = 1; i < tree->node_count; i++) {
+        if (nodes[i].adt_type == Ruyi_adt_symbol) {
+            symbol = ruyi_ast_tree_symbol(tree, i);
+            nodes[i].payload = symbol == RUYI_SYMBOL_NONE ? 0 : indexes[symbol];
+        }
+    }
+    if (tree->child_id_count > 0) {
+        memcpy(image + offsets[Ruyi_acs_child_ids], tree->child_ids, sizeof(ruyi_ast_id) * tree->child_id_count);
+    }
+    lengths = (UINT32*)(image + offsets[Ruyi_acs_string_lengths]);
+    chars = (WIDE_CHAR*)(image + offsets[Ruyi_acs_chars]);
+    for (i = 0; i < tree->string_count; i++) {
+        lengths[i] = tree->strings[i].length;
+        if (lengths[i] > 0) {
+            memcpy(chars, tree->strings[i].data, sizeof(WIDE_CHAR) * lengths[i]);
+            chars += lengths[i];
+        }
+    }
+    lengths = (UINT32*)(image + offsets[Ruyi_acs_symbol_lengths]);
+    chars = (WIDE_CHAR*)(image + offsets[Ruyi_acs_symbol_chars]);
+    for (i = 0; i < header.symbol_count; i++) {
+        str = ruyi_symbol_str(names[i]);
+        lengths[i] = str->length;
+        memcpy(chars, str->data, sizeof(WIDE_CHAR) * str->length);
+        chars += str->length;
+    }
+    ruyi_mem_free(indexes);
+    ruyi_mem_free(names);
+    // a reader maps either the old file or the whole new one
+    written = FALSE;
+    if ((fp = ruyi_ast_cache_open_tmp(path, &tmp_path)) != NULL) {
+        written = fwrite(image, 1, (size_t)size, fp) == size;
+        written = fclose(fp) == 0 && written;
+    }
+    ruyi_mem_free(image);
+    if (written && rename(tmp_path, path) != 0) {
+        // rename does not replace a file on some systems
+        remove(path);
+        written = rename(tmp_path, path) == 0;
+    }
+    if (!written) {
+        if (fp != NULL) {
+            remove(tmp_path);
+        }
+        ruyi_mem_free(tmp_path);
+        return ruyi_error_misc("can not write the ast cache: %s", path);
+    }
+    ruyi_mem_free(tmp_path);
+    return NULL;
+}
+
+// a broken file must not lead a walk out of the arrays. A child follows its parent in pre-order,
+// so a walk always ends
+static BOOL ruyi_ast_cache_check(const ruyi_ast_tree *tree, UINT32 symbol_count) {
+    const ruyi_ast_node *node;
+    ruyi_ast_id child;
+    UINT32 id, i;
+    for (id = 1; id < tree->node_count; id++) {
+        node = &tree->nodes[id];
+        // the type indexes the tables of the visitors, e.g. of the code generator
+        if (node->type >= Ruyi_at_COUNT) {
+            return FALSE;
+        }
+        if ((UINT64)node->children + node->child_count > tree->child_id_count) {
+            return FALSE;
+        }
+        for (i = 0; i < node->child_count; i++) {
+            child = tree->child_ids[node->children + i];
+            if (child != RUYI_AST_NONE && (child <= id || child >= tree->node_count)) {
+                return FALSE;
+            }
+        }
+        switch (node->adt_type) {
+            case Ruyi_adt_symbol:
+                if (node->payload > symbol_count) {
+                    return FALSE;
+                }
+                break;
+            case Ruyi_adt_unicode_str:
+                if (node->payload >= tree->string_count) {
+                    return FALSE;
+                }
+                break;
+            case Ruyi_adt_value:
+            case Ruyi_adt_char_ptr:
+                if (node->payload > tree->value_count) {
+                    return FALSE;
+                }
+                break;
+            default:
+                // the tokens of a lazy body are never saved, and an arena is never flattened
+                return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+ruyi_ast_tree* ruyi_ast_cache_load(const char *path, UINT64 key) {
+    ruyi_ast_cache_header header;
+    UINT64 offsets[Ruyi_acs_COUNT];
+    ruyi_file *image = ruyi_file_open_by_mmap(path);
+    ruyi_ast_tree *tree;
+    const UINT32 *lengths;
+    const WIDE_CHAR *chars;
+    UINT64 char_count;
+    const BYTE *bytes;
+    UINT32 i;
+    if (image == NULL) {
+        return NULL;
+    }
+    bytes = image->dist.buffer;
+    if (image->write_pos < sizeof(header)) {
+        ruyi_file_close(image);
+        return NULL;
+    }
+    memcpy(&header, bytes, sizeof(header));
+    if (header.magic != RUYI_AST_CACHE_MAGIC || header.version != RUYI_AST_CACHE_VERSION ||
+        header.char_size != sizeof(WIDE_CHAR) || header.key != key || header.node_count < 2 ||
+        ruyi_ast_cache_layout(&header, offsets) != image->write_pos) {
+        ruyi_file_close(image);
+        return NULL;
+    }
+    tree = (ruyi_ast_tree*)ruyi_mem_alloc(sizeof(ruyi_ast_tree));
+    tree->image = image;
+    tree->node_count = header.node_count;
+    tree->child_id_count = header.child_id_count;
+    tree->value_count = header.value_count;
+    tree->string_count = header.string_count;
+    tree->char_count = header.char_count;
+    tree->lazy_bodies = NULL;
+    tree->lazy_body_count = 0;
+    tree->nodes = (ruyi_ast_node*)(bytes + offsets[Ruyi_acs_nodes]);
+    tree->child_ids = header.child_id_count > 0 ? (ruyi_ast_id*)(bytes + offsets[Ruyi_acs_child_ids]) : NULL;
+    tree->values = header.value_count > 0 ? (UINT64*)(bytes + offsets[Ruyi_acs_values]) : NULL;
+    tree->chars = header.char_count > 0 ? (WIDE_CHAR*)(bytes + offsets[Ruyi_acs_chars]) : NULL;
+    tree->strings = header.string_count > 0 ? (ruyi_unicode_string*)ruyi_mem_alloc(sizeof(ruyi_unicode_string) * header.string_count) : NULL;
+    tree->symbols = (ruyi_symbol*)ruyi_mem_alloc(sizeof(ruyi_symbol) * (header.symbol_count + 1));
+    // the strings are kept one after another in chars
+    lengths = (const UINT32*)(bytes + offsets[Ruyi_acs_string_lengths]);
+    char_count = 0;
+    for (i = 0; i < header.string_count; i++) {
+        tree->strings[i].data = tree->chars ? tree->chars + char_count : NULL;
+        tree->strings[i].length = lengths[i];
+        tree->strings[i].capacity = lengths[i];
+        char_count += lengths[i];
+    }
+    if (char_count != header.char_count) {
+        ruyi_ast_tree_destroy(tree);
+        return NULL;
+    }
+    lengths = (const UINT32*)(bytes + offsets[Ruyi_acs_symbol_lengths]);
+    chars = (const WIDE_CHAR*)(bytes + offsets[Ruyi_acs_symbol_chars]);
+    char_count = 0;
+    for (i = 0; i < header.symbol_count; i++) {
+        char_count += lengths[i];
+        if (char_count > header.symbol_char_count) {
+            break;
+        }
+    }
+    if (char_count != header.symbol_char_count || !ruyi_ast_cache_check(tree, header.symbol_count)) {
+        ruyi_ast_tree_destroy(tree);
+        return NULL;
+    }
+    tree->symbols[0] = RUYI_SYMBOL_NONE;
+    for (i = 0; i < header.symbol_count; i++) {
+        tree->symbols[i + 1] = ruyi_symbol_intern(chars, lengths[i]);
+        chars += lengths[i];
+    }
+    return tree;
+}
+
+ruyi_error* ruyi_ast_cache_parse(const char *dir, const BYTE *source, UINT32 length, ruyi_ast_tree **out_tree) {
+    UINT64 key = ruyi_ast_cache_key(source, length);
+    char *path = (char*)ruyi_mem_alloc((UINT32)strlen(dir) + 32);
+    ruyi_lexer_reader *reader;
+    ruyi_ast_tree *tree;
+    ruyi_error *err;
+    sprintf(path, "%s/%016llx.ast", dir, (unsigned long long)key);
+    if ((tree = ruyi_ast_cache_load(path, key)) != NULL) {
+        ruyi_mem_free(path);
+        *out_tree = tree;
+        return NULL;
+    }
+    reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_view(source, length), Ruyi_lo_SKIP_COMMENTS);
+    err = ruyi_parse_ast_tree(reader, &tree);
+    ruyi_lexer_reader_close(reader);
+    if (err != NULL) {
+        ruyi_mem_free(path);
+        *out_tree = NULL;
+        return err;
+    }
+    // a file not saved only makes the source parsed again next time
+    if ((err = ruyi_ast_cache_save(tree, key, path)) != NULL) {
+        ruyi_error_destroy(err);
+    }
+    ruyi_mem_free(path);
+    *out_tree = tree;
+    return NULL;
+}
@@ -0,0 +1,67 @@
+//
+//  ruyi_ast_cache.h
+//  ruyi
+//
+
+#ifndef ruyi_ast_cache_h
+#define ruyi_ast_cache_h
+
+#include "ruyi_basics.h"
+#include "ruyi_ast.h"
+#include "ruyi_error.h"
+
+/*
+ Flat trees saved in binary files keyed by a hash of their sources, so a source not changed since it was
+ parsed is never lexed or parsed again.
+ A file is a header and the arrays of ruyi_ast_tree in the byte order of the machine, each starts at a multiple
+ of 8, so a mapped file is read in place. Symbol ids belong to a process, so the names of them are saved, the
+ symbol payloads are indexes of the names, and they are interned again when the file is loaded.
+ */
+
+// bump it when the nodes made by the parser change, the files of other versions are missed
+#define RUYI_AST_CACHE_VERSION 1
+
+/**
+ * Hash a source for the key of its cache file, 8 bytes a step
+ * params:
+ * source - bytes of the source
+ * length - count of bytes
+ * return:
+ * the key, it has the length mixed in
+ */
+UINT64 ruyi_ast_cache_key(const BYTE *source, UINT32 length);
+
+/**
+ * Save a tree to a file, it is written to a temp file of its own first and renamed, so a reader never sees half a file
+ * params:
+ * tree - the tree, e.g. by ruyi_parse_ast_tree or ruyi_ast_tree_create
+ * key - key of the source of the tree
+ * path - the file path
+ * return:
+ * the error, NULL if saved
+ */
+ruyi_error* ruyi_ast_cache_save(const ruyi_ast_tree *tree, UINT64 key, const char *path);
+
+/**
+ * Map a file saved by ruyi_ast_cache_save, the arrays of the tree are read from it in place
+ * params:
+ * path - the file path
+ * key - key of the source expected
+ * return:
+ * the tree, release it by ruyi_ast_tree_destroy. NULL if the file is missing, of another key or version, or broken
+ */
+ruyi_ast_tree* ruyi_ast_cache_load(const char *path, UINT64 key);
+
+/**
+ * Get the tree of a source from its file in a directory, or parse it and save the file
+ * params:
+ * dir - the directory of the files, it must exist
+ * source - utf-8 bytes of the source
+ * length - count of bytes
+ * out_tree - receives the tree, release it by ruyi_ast_tree_destroy
+ * return:
+ * the error of the parse, NULL if the tree is got. A file which can not be saved is not an error
+ */
+ruyi_error* ruyi_ast_cache_parse(const char *dir, const BYTE *source, UINT32 length, ruyi_ast_tree **out_tree);
+
+#endif /* ruyi_ast_cache_h */
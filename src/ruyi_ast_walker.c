@@ -0,0 +1,244 @@
+//
+//  ruyi_ast_walker.c
+//  ruyi
+//
+
+#include "ruyi_ast_walker.h"
+#include "ruyi_mem.h"
+#include <string.h> // for memcpy, memset
+
+#define RUYI_AST_WALK_INIT_BLOCKS 8
+
+typedef struct {
+    ruyi_ast_walk_frame frames[RUYI_AST_WALK_BLOCK_FRAMES];
+    // data of the frames, data_size bytes each
+    BYTE *data;
+} ruyi_ast_walk_block;
+
+struct _ruyi_ast_walker {
+    const ruyi_ast_visitor *visitor;
+    // the tables of the visitor with the defaults put in, so a function is found by one load
+    ruyi_ast_walk_func pre[Ruyi_at_COUNT];
+    ruyi_ast_walk_func child[Ruyi_at_COUNT];
+    ruyi_ast_walk_func post[Ruyi_at_COUNT];
+    void *context;
+    // the tree of the current walk, NULL for ruyi_ast nodes
+    const ruyi_ast_tree *tree;
+    ruyi_ast_walk_block **blocks;
+    UINT32 block_count;
+    UINT32 block_capacity;
+    // count of frames pushed, and the first frame of the current walk
+    UINT32 depth;
+    UINT32 base;
+};
+
+ruyi_ast_walker* ruyi_ast_walker_create(const ruyi_ast_visitor *visitor, void *context) {
+    ruyi_ast_walker *walker = (ruyi_ast_walker*)ruyi_mem_alloc(sizeof(ruyi_ast_walker));
+    UINT32 i;
+    walker->visitor = visitor;
+    for (i = 0; i < Ruyi_at_COUNT; i++) {
+        walker->pre[i] = visitor->pre[i] ? visitor->pre[i] : visitor->pre_default;
+        walker->child[i] = visitor->child[i] ? visitor->child[i] : visitor->child_default;
+        walker->post[i] = visitor->post[i] ? visitor->post[i] : visitor->post_default;
+    }
+    walker->context = context;
+    walker->tree = NULL;
+    walker->block_capacity = RUYI_AST_WALK_INIT_BLOCKS;
+    walker->blocks = (ruyi_ast_walk_block**)ruyi_mem_alloc(sizeof(ruyi_ast_walk_block*) * walker->block_capacity);
+    walker->block_count = 0;
+    walker->depth = 0;
+    walker->base = 0;
+    return walker;
+}
+
+void ruyi_ast_walker_destroy(ruyi_ast_walker *walker) {
+    UINT32 i;
+    if (!walker) {
+        return;
+    }
+    for (i = 0; i < walker->block_count; i++) {
+        ruyi_mem_free(walker->blocks[i]->data);
+        ruyi_mem_free(walker->blocks[i]);
+    }
+    ruyi_mem_free(walker->blocks);
+    ruyi_mem_free(walker);
+}
+
+void* ruyi_ast_walker_context(const ruyi_ast_walker *walker) {
+    return walker->context;
+}
+
+const ruyi_ast_tree* ruyi_ast_walker_tree(const ruyi_ast_walker *walker) {
+    return walker->tree;
+}
+
+static ruyi_ast_walk_frame* ruyi_ast_walker_at(const ruyi_ast_walker *walker, UINT32 index) {
+    return &walker->blocks[index / RUYI_AST_WALK_BLOCK_FRAMES]->frames[index % RUYI_AST_WALK_BLOCK_FRAMES];
+}
+
+ruyi_ast_walk_frame* ruyi_ast_walker_frame(ruyi_ast_walker *walker, UINT32 up) {
+    if (up >= walker->depth - walker->base) {
+        return NULL;
+    }
+    return ruyi_ast_walker_at(walker, walker->depth - 1 - up);
+}
+
+void ruyi_ast_walker_skip_children(ruyi_ast_walk_frame *frame) {
+    frame->child = frame->child_count;
+}
+
+static ruyi_ast_walk_frame* ruyi_ast_walker_push(ruyi_ast_walker *walker) {
+    UINT32 data_size = walker->visitor->data_size;
+    ruyi_ast_walk_block *block;
+    ruyi_ast_walk_block **blocks;
+    ruyi_ast_walk_frame *frame;
+    UINT32 i;
+    if (walker->depth == walker->block_count * RUYI_AST_WALK_BLOCK_FRAMES) {
+        if (walker->block_count == walker->block_capacity) {
+            // only the array of the blocks is moved, the frames stay where they are
+            blocks = (ruyi_ast_walk_block**)ruyi_mem_alloc(sizeof(ruyi_ast_walk_block*) * walker->block_capacity * 2);
+            memcpy(blocks, walker->blocks, sizeof(ruyi_ast_walk_block*) * walker->block_count);
+            ruyi_mem_free(walker->blocks);
+            walker->blocks = blocks;
+            walker->block_capacity *= 2;
+        }
+        block = (ruyi_ast_walk_block*)ruyi_mem_alloc(sizeof(ruyi_ast_walk_block));
+        block->data = data_size > 0 ? (BYTE*)ruyi_mem_alloc(data_size * RUYI_AST_WALK_BLOCK_FRAMES) : NULL;
+        for (i = 0; i < RUYI_AST_WALK_BLOCK_FRAMES; i++) {
+            block->frames[i].data = block->data ? block->data + data_size * i : NULL;
+        }
+        walker->blocks[walker->block_count++] = block;
+    }
+    frame = ruyi_ast_walker_at(walker, walker->depth++);
+    if (data_size > 0) {
+        memset(frame->data, 0, data_size);
+    }
+    return frame;
+}
+
+// set the node of a frame pushed, returns FALSE for a missing node
+static BOOL ruyi_ast_walker_set_node(const ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast *ast, ruyi_ast_id id) {
+    const ruyi_ast_node *node;
+    if (walker->tree) {
+        if (id == RUYI_AST_NONE) {
+            return FALSE;
+        }
+        node = &walker->tree->nodes[id];
+        frame->ast = NULL;
+        frame->id = id;
+        frame->type = (ruyi_ast_type)node->type;
+        frame->child_count = node->child_count;
+    } else {
+        if (ast == NULL) {
+            return FALSE;
+        }
+        frame->ast = ast;
+        frame->id = RUYI_AST_NONE;
+        frame->type = ast->type;
+        frame->child_count = ast->child_count;
+    }
+    assert((UINT32)frame->type < Ruyi_at_COUNT);
+    frame->child = 0;
+    frame->parts = FALSE;
+    return TRUE;
+}
+
+void ruyi_ast_walker_set_parts(ruyi_ast_walk_frame *frame, UINT32 count) {
+    frame->child = 0;
+    frame->child_count = count;
+    frame->parts = TRUE;
+}
+
+void ruyi_ast_walker_set_part(const ruyi_ast_walker *walker, ruyi_ast_walk_frame *child_frame, ruyi_ast *ast, ruyi_ast_id id) {
+    if (!ruyi_ast_walker_set_node(walker, child_frame, ast, id)) {
+        // a missing node is not visited
+        child_frame->type = Ruyi_at_COUNT;
+    }
+}
+
+static ruyi_error* ruyi_ast_walker_run(ruyi_ast_walker *walker, ruyi_ast *ast, ruyi_ast_id id, const void *data) {
+    const ruyi_ast_tree *tree = walker->tree;
+    UINT32 base = walker->base;
+    ruyi_ast_walk_frame *frame, *child_frame;
+    ruyi_ast_walk_func func;
+    ruyi_error *err = NULL;
+    frame = ruyi_ast_walker_push(walker);
+    walker->base = walker->depth - 1;
+    if (!ruyi_ast_walker_set_node(walker, frame, ast, id)) {
+        walker->depth--;
+        walker->base = base;
+        return NULL;
+    }
+    if (data && walker->visitor->data_size > 0) {
+        memcpy(frame->data, data, walker->visitor->data_size);
+    }
+    if ((func = walker->pre[frame->type]) != NULL) {
+        err = func(walker, frame, NULL);
+    }
+    // frame is the node on the top, a function may walk other nodes over it but the frames are not moved
+    while (err == NULL) {
+        if (frame->child < frame->child_count) {
+            child_frame = ruyi_ast_walker_push(walker);
+            if (frame->parts) {
+                // the node is set by the child function, Ruyi_at_COUNT until then
+                child_frame->type = Ruyi_at_COUNT;
+            } else if (!ruyi_ast_walker_set_node(walker, child_frame, frame->ast ? frame->ast->children[frame->child] : NULL,
+                                                 frame->ast ? RUYI_AST_NONE : tree->child_ids[tree->nodes[frame->id].children + frame->child])) {
+                walker->depth--;
+                frame->child++;
+                continue;
+            }
+            if ((func = walker->child[frame->type]) != NULL) {
+                if ((err = func(walker, frame, child_frame)) != NULL) {
+                    break;
+                }
+                if (frame->child >= frame->child_count) {
+                    // skipped by the function
+                    walker->depth--;
+                    continue;
+                }
+            }
+            if (child_frame->type == Ruyi_at_COUNT) {
+                // a part not set
+                walker->depth--;
+                frame->child++;
+                continue;
+            }
+            frame = child_frame;
+            if ((func = walker->pre[frame->type]) != NULL) {
+                err = func(walker, frame, NULL);
+            }
+            continue;
+        }
+        if ((func = walker->post[frame->type]) != NULL) {
+            err = func(walker, frame, NULL);
+        }
+        if (--walker->depth == walker->base) {
+            break;
+        }
+        frame = ruyi_ast_walker_at(walker, walker->depth - 1);
+        frame->child++;
+    }
+    // the frames of the walk are dropped on an error, the ones of the caller are kept
+    walker->depth = walker->base;
+    walker->base = base;
+    return err;
+}
+
+ruyi_error* ruyi_ast_walk(ruyi_ast_walker *walker, ruyi_ast *ast, const void *data) {
+    ruyi_error *err;
+    const ruyi_ast_tree *tree = walker->tree;
+    walker->tree = NULL;
+    err = ruyi_ast_walker_run(walker, ast, RUYI_AST_NONE, data);
+    walker->tree = tree;
+    return err;
+}
+
+ruyi_error* ruyi_ast_walk_tree(ruyi_ast_walker *walker, const ruyi_ast_tree *tree, ruyi_ast_id id, const void *data) {
+    ruyi_error *err;
+    const ruyi_ast_tree *outer_tree = walker->tree;
+    walker->tree = tree;
+    err = ruyi_ast_walker_run(walker, NULL, id, data);
+    walker->tree = outer_tree;
+    return err;
+}
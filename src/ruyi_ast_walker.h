@@ -0,0 +1,132 @@
+//
+//  ruyi_ast_walker.h
+//  ruyi
+//
+
+#ifndef ruyi_ast_walker_h
+#define ruyi_ast_walker_h
+
+#include "ruyi_basics.h"
+#include "ruyi_ast.h"
+#include "ruyi_error.h"
+
+/*
+ Walks of an ast by an explicit stack of frames on the heap, so the depth of a tree is not bounded by the C stack.
+ A visitor has tables of functions by the type of the node: pre is called when a node is entered, child before
+ each of its children is entered, and post after all of them. A missing child is not visited.
+ The frames are allocated in blocks which are never moved, so a frame, and its data, can be pointed to by the
+ frames of its children, e.g. for the types of the operands of an expression.
+ A function may walk another node by the same walker, the frames of it are pushed over the ones of the caller.
+ A node whose parts are not its children in order, e.g. the header and the body of a for, sets the count of its parts
+ in its pre function, and its child function sets the node of each part, so the parts are walked by the frames too.
+ */
+
+#define RUYI_AST_WALK_BLOCK_FRAMES 256
+
+typedef struct {
+    ruyi_ast *ast;          // the node of a walk by ruyi_ast_walk, NULL for a flat tree
+    ruyi_ast_id id;         // the node of a walk by ruyi_ast_walk_tree, RUYI_AST_NONE for a ruyi_ast
+    ruyi_ast_type type;
+    UINT32 child;           // index of the child being visited, child_count when all are visited or skipped
+    UINT32 child_count;
+    BOOL parts;             // the children are replaced by the parts of ruyi_ast_walker_set_parts
+    void *data;             // data_size bytes of the visitor, zeroed when the frame is pushed
+} ruyi_ast_walk_frame;
+
+struct _ruyi_ast_walker;
+
+/**
+ * A function of a visitor
+ * params:
+ * walker - the walker, ruyi_ast_walker_context of it is the object of the walk
+ * frame - the frame of the node
+ * child_frame - the frame of the child about to be entered for a child function, NULL for the others
+ * return:
+ * the error, it stops the walk and is returned by it
+ */
+typedef ruyi_error* (*ruyi_ast_walk_func)(struct _ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame);
+
+typedef struct {
+    // the function of each ruyi_ast_type, the default of the table for a NULL one, nothing is done if both are NULL
+    ruyi_ast_walk_func pre[Ruyi_at_COUNT];
+    ruyi_ast_walk_func child[Ruyi_at_COUNT];
+    ruyi_ast_walk_func post[Ruyi_at_COUNT];
+    ruyi_ast_walk_func pre_default;
+    ruyi_ast_walk_func child_default;
+    ruyi_ast_walk_func post_default;
+    // bytes of the data of a frame
+    UINT32 data_size;
+} ruyi_ast_visitor;
+
+typedef struct _ruyi_ast_walker ruyi_ast_walker;
+
+/**
+ * Create a walker, the blocks of its frames are kept for the next walks
+ * params:
+ * visitor - the tables, it must not be released before the walker
+ * context - the object of the walks, got by ruyi_ast_walker_context
+ */
+ruyi_ast_walker* ruyi_ast_walker_create(const ruyi_ast_visitor *visitor, void *context);
+
+void ruyi_ast_walker_destroy(ruyi_ast_walker *walker);
+
+void* ruyi_ast_walker_context(const ruyi_ast_walker *walker);
+
+/**
+ * Walk a tree of ruyi_ast nodes
+ * params:
+ * walker - target object
+ * ast - the root, the post function may release the nodes, a node is not used after its post
+ * data - copied to the data of the frame of the root, NULL for zeros
+ * return:
+ * the first error of the functions, NULL if all nodes are walked
+ */
+ruyi_error* ruyi_ast_walk(ruyi_ast_walker *walker, ruyi_ast *ast, const void *data);
+
+/**
+ * Walk a node of a flat tree
+ * params:
+ * walker - target object
+ * tree - the tree
+ * id - the root of the walk
+ * data - copied to the data of the frame of the root, NULL for zeros
+ * return:
+ * the first error of the functions, NULL if all nodes are walked
+ */
+ruyi_error* ruyi_ast_walk_tree(ruyi_ast_walker *walker, const ruyi_ast_tree *tree, ruyi_ast_id id, const void *data);
+
+// the tree of the walk by ruyi_ast_walk_tree, NULL for ruyi_ast_walk
+const ruyi_ast_tree* ruyi_ast_walker_tree(const ruyi_ast_walker *walker);
+
+/**
+ * Get the frame of an ancestor of the current node
+ * params:
+ * walker - target object
+ * up - 0 for the current node, 1 for its parent, and so on
+ * return:
+ * the frame, NULL if it is above the root of the current walk
+ */
+ruyi_ast_walk_frame* ruyi_ast_walker_frame(ruyi_ast_walker *walker, UINT32 up);
+
+// the rest children of the frame are not visited, called by a pre or child function of it
+void ruyi_ast_walker_skip_children(ruyi_ast_walk_frame *frame);
+
+/**
+ * Walk some parts instead of the children of a node, called by the pre function of it
+ * params:
+ * frame - the frame of the node
+ * count - count of the parts, the child function is called for each of them with frame->child as the index
+ */
+void ruyi_ast_walker_set_parts(ruyi_ast_walk_frame *frame, UINT32 count);
+
+/**
+ * Set the node of a part, called by the child function of a frame with parts, a part not set is not visited
+ * params:
+ * walker - target object
+ * child_frame - the frame of the part
+ * ast - the node of a walk by ruyi_ast_walk, NULL for a flat tree
+ * id - the node of a walk by ruyi_ast_walk_tree, RUYI_AST_NONE for a ruyi_ast
+ */
+void ruyi_ast_walker_set_part(const ruyi_ast_walker *walker, ruyi_ast_walk_frame *child_frame, ruyi_ast *ast, ruyi_ast_id id);
+
+#endif /* ruyi_ast_walker_h */
@@ -10,9 +10,11 @@
 #include "ruyi_mem.h"
 #include "ruyi_error.h"
 #include "ruyi_ast.h"
+#include "ruyi_ast_walker.h"
 #include "ruyi_vector.h"
 #include "ruyi_symtab.h"
 #include "ruyi_unicode.h"
+#include "ruyi_parser.h"
 #include <string.h> // for memcpy
 
 #define CG_FUNC_WRITE_CAP_INIT 16
@@ -21,7 +23,7 @@
 
 #define PACKAGE_SEPARATE '.'
 
-static ruyi_error* handle_type(ruyi_ast *ast_type, ruyi_symtab_type *out_type);
+static ruyi_error* handle_type(const ruyi_ast_tree *tree, ruyi_ast_id ast_type, ruyi_symtab_type *out_type);
 
 static void function_writer_destroy(ruyi_cg_function_writer *function_writer) {
     if (!function_writer) {
@@ -30,9 +32,6 @@ static void function_writer_destroy(ruyi_cg_function_writer *function_writer) {
     if (function_writer->codes) {
         ruyi_mem_free(function_writer->codes);
     }
-    if (function_writer->name) {
-        ruyi_unicode_string_destroy(function_writer->name);
-    }
     ruyi_mem_free(function_writer);
 }
 
@@ -77,7 +76,7 @@ static ruyi_cg_ir_writer *ir_writer_create(void) {
     ruyi_cg_ir_writer *ir_writer = (ruyi_cg_ir_writer*)ruyi_mem_alloc(sizeof(ruyi_cg_ir_writer));
     // item type: <ruyi_cg_function_writer *>
     ir_writer->function_writers = ruyi_vector_create();
-    // key-value type: <ruyi_unicode_string*, INT32>
+    // key-value type: <ruyi_symbol, INT32>
     ir_writer->named_func_index = ruyi_hashtable_create();
     ir_writer->current_function_writer = NULL;
     return ir_writer;
@@ -125,15 +124,13 @@ static void ir_writer_destroy(ruyi_cg_ir_writer *ir_writer) {
         ruyi_vector_destroy(ir_writer->function_writers);
     }
     if (ir_writer->named_func_index) {
-        // the key of named_func_index is reference to name of item of function_writers,
-        // so it will be released by function_writer_destroy(...);
         ruyi_hashtable_destroy(ir_writer->named_func_index);
     }
     ruyi_mem_free(ir_writer);
 }
 
 static
-ruyi_cg_function_writer * ruyi_cg_define_function(ruyi_cg_ir_writer *ir_writer, const ruyi_unicode_string* name, INT32 index) {
+ruyi_cg_function_writer * ruyi_cg_define_function(ruyi_cg_ir_writer *ir_writer, ruyi_symbol name, INT32 index) {
     ruyi_cg_function_writer *function_writer;
     assert(ir_writer);
     function_writer = (ruyi_cg_function_writer*)ruyi_mem_alloc(sizeof(ruyi_cg_function_writer));
@@ -143,19 +140,19 @@ ruyi_cg_function_writer * ruyi_cg_define_function(ruyi_cg_ir_writer *ir_writer,
     function_writer->codes_length = 0;
     function_writer->codes = (UINT32*)ruyi_mem_alloc(CG_FUNC_WRITE_CAP_INIT * sizeof(UINT32));
     function_writer->locals = 0;
-    function_writer->name = ruyi_unicode_string_copy_from(name);
+    function_writer->name = name;
     function_writer->operand = 0;
     function_writer->return_type = Ruyi_ir_type_Void;
     function_writer->ir_writer = ir_writer;
     ruyi_vector_add(ir_writer->function_writers, ruyi_value_ptr(function_writer));
     function_writer->ir_writer->current_function_writer = function_writer;
-    ruyi_hashtable_put(ir_writer->named_func_index, ruyi_value_unicode_str(function_writer->name), ruyi_value_int32(index));
+    ruyi_hashtable_put(ir_writer->named_func_index, ruyi_value_uint32(function_writer->name), ruyi_value_int32(index));
     return function_writer;
 }
 
 static
-void cg_gen_func_define(ruyi_cg_function_writer *function_writer, ruyi_ast *func_define_ast)  {
-    assert(Ruyi_at_function_declaration == func_define_ast->type);
+void cg_gen_func_define(ruyi_cg_function_writer *function_writer, const ruyi_ast_tree *tree, ruyi_ast_id func_define_ast)  {
+    assert(Ruyi_at_function_declaration == ruyi_ast_tree_type(tree, func_define_ast));
     /*
      ast = ruyi_ast_create(Ruyi_at_function_declaration);
      ruyi_ast_add_child(ast, ast_name);
@@ -212,17 +209,19 @@ static void cp_destroy(ruyi_cg_file_const_pool *cp) {
 
 static UINT32 copy_unicode_to_bytes(const ruyi_unicode_string * s, BYTE **dest, UINT16 *dest_len) {
     ruyi_bytes_string *temp;
+    UINT32 length;
     if (s == NULL) {
         return 0;
     }
     temp = ruyi_unicode_string_encode_utf8(s);
+    length = temp->length;
     if (dest_len) {
-        *dest_len = (UINT16)temp->length;
+        *dest_len = (UINT16)length;
     }
-    *dest = (BYTE *)ruyi_mem_alloc(temp->length);
-    memcpy(*dest, temp->str, temp->length);
+    *dest = (BYTE *)ruyi_mem_alloc(length);
+    memcpy(*dest, temp->str, length);
     ruyi_unicode_bytes_string_destroy(temp);
-    return temp->length;
+    return length;
 }
 
 static ruyi_cg_file_global_var* gv_create(const ruyi_symtab_variable *symtab_var) {
@@ -230,7 +229,7 @@ static ruyi_cg_file_global_var* gv_create(const ruyi_symtab_variable *symtab_var
     gv->index = symtab_var->index;
     gv->type = symtab_var->type.ir_type;
     gv->var_size = symtab_var->type.size;
-    copy_unicode_to_bytes(symtab_var->name, &gv->name, &gv->name_size);
+    copy_unicode_to_bytes(ruyi_symbol_str(symtab_var->name), &gv->name, &gv->name_size);
     return gv;
 }
 
@@ -250,7 +249,7 @@ static ruyi_cg_file_function* func_create(const ruyi_symtab_function_define *sym
     ruyi_ir_type ir_type;
     ruyi_cg_file_function *func = (ruyi_cg_file_function*)ruyi_mem_alloc(sizeof(ruyi_cg_file_function));
     func->index = symtab_func->index;
-    copy_unicode_to_bytes(symtab_func->name, &func->name, &func->name_size);
+    copy_unicode_to_bytes(ruyi_symbol_str(symtab_func->name), &func->name, &func->name_size);
     // return types
     len = ruyi_vector_length(symtab_func->return_types);
     // why the size div by 2 ?
@@ -356,48 +355,48 @@ void ruyi_cg_file_destroy(ruyi_cg_file *ir_file) {
     ruyi_mem_free(ir_file);
 }
 
-static ruyi_error* gen_package(ruyi_symtab *symtab, const ruyi_ast *ast, ruyi_cg_file *ir_file) {
+static ruyi_error* gen_package(ruyi_symtab *symtab, const ruyi_ast_tree *tree, ruyi_ast_id ast, ruyi_cg_file *ir_file) {
     ruyi_error *err;
-    ruyi_ast *ast_name, *ast_sub_name;
+    ruyi_ast_id ast_name, ast_sub_name;
     UINT32 i, len;
     ruyi_unicode_string *package_name = NULL;
     if (!ast) {
         return NULL;
     }
-    if (Ruyi_at_package_declaration != ast->type) {
+    if (Ruyi_at_package_declaration != ruyi_ast_tree_type(tree, ast)) {
         err = ruyi_error_misc("need package declaration ast");
         goto gen_package_on_error;
     }
-    if (1 != ruyi_ast_child_length(ast)) {
+    if (1 != ruyi_ast_tree_child_length(tree, ast)) {
         err = ruyi_error_misc("child length of package declaration ast must be 1");
         goto gen_package_on_error;
     }
-    ast_name = ruyi_ast_get_child(ast, 0);
-    if (Ruyi_at_name != ast_name->type) {
+    ast_name = ruyi_ast_tree_get_child(tree, ast, 0);
+    if (Ruyi_at_name != ruyi_ast_tree_type(tree, ast_name)) {
         err = ruyi_error_misc("child of package declaration ast must be name");
         goto gen_package_on_error;
     }
-    if (Ruyi_adt_unicode_str != ast_name->adt_type) {
-        err = ruyi_error_misc("type of package declaration ast must be unicode string");
+    if (Ruyi_adt_symbol != ruyi_ast_tree_data_type(tree, ast_name)) {
+        err = ruyi_error_misc("type of package declaration ast must be symbol");
         goto gen_package_on_error;
     }
-    package_name = ruyi_unicode_string_copy_from((ruyi_unicode_string*)ast_name->data.ptr_value);
+    package_name = ruyi_unicode_string_copy_from(ruyi_symbol_str(ruyi_ast_tree_symbol(tree, ast_name)));
     /*
      name: part0 child[part1, part2, part3, ...]
      */
-    len = ruyi_ast_child_length(ast_name);
+    len = ruyi_ast_tree_child_length(tree, ast_name);
     for (i = 0; i < len; i++) {
-        ast_sub_name = ruyi_ast_get_child(ast_name, i);
-        if (Ruyi_at_name_part != ast_sub_name->type) {
+        ast_sub_name = ruyi_ast_tree_get_child(tree, ast_name, i);
+        if (Ruyi_at_name_part != ruyi_ast_tree_type(tree, ast_sub_name)) {
             err = ruyi_error_misc("child of package declaration ast must be name");
             goto gen_package_on_error;
         }
-        if (Ruyi_adt_unicode_str != ast_sub_name->adt_type) {
-            err = ruyi_error_misc("type of package declaration ast must be unicode string");
+        if (Ruyi_adt_symbol != ruyi_ast_tree_data_type(tree, ast_sub_name)) {
+            err = ruyi_error_misc("type of package declaration ast must be symbol");
             goto gen_package_on_error;
         }
         ruyi_unicode_string_append_wide_char(package_name, PACKAGE_SEPARATE);
-        ruyi_unicode_string_append_unicode(package_name, (ruyi_unicode_string*)ast_sub_name->data.ptr_value);
+        ruyi_unicode_string_append_unicode(package_name, ruyi_symbol_str(ruyi_ast_tree_symbol(tree, ast_sub_name)));
     }
     set_field_name_data(ir_file, RUYI_OFFSET_OF(ruyi_cg_file, package_size), RUYI_OFFSET_OF(ruyi_cg_file, package), package_name);
     ruyi_unicode_string_destroy(package_name);
@@ -409,7 +408,7 @@ gen_package_on_error:
     return err;
 }
 
-static ruyi_error* gen_import(ruyi_symtab *symtab, const ruyi_ast *ast, ruyi_cg_file *ir_file) {
+static ruyi_error* gen_import(ruyi_symtab *symtab, const ruyi_ast_tree *tree, ruyi_ast_id ast, ruyi_cg_file *ir_file) {
     // TODO
     return NULL;
 }
@@ -419,38 +418,38 @@ static BOOL type_can_assign(const ruyi_symtab_type* dest, const ruyi_symtab_type
     return TRUE;
 }
 
-static ruyi_error* gen_global_var_define(ruyi_symtab *symtab, const ruyi_ast *ast, ruyi_vector *global_vars) {
+static ruyi_error* gen_global_var_define(ruyi_symtab *symtab, const ruyi_ast_tree *tree, ruyi_ast_id ast, ruyi_vector *global_vars) {
     ruyi_error *err;
     ruyi_symtab_variable var;
     BOOL has_init_expr = FALSE;
     ruyi_symtab_type expr_type;
     ruyi_symtab_type var_decleration_type;
     assert(ast);
-    assert(Ruyi_at_var_declaration == ast->type);
-    var.name = (ruyi_unicode_string*)ast->data.ptr_value;
-    if (ruyi_ast_child_length(ast) >= 2) {
+    assert(Ruyi_at_var_declaration == ruyi_ast_tree_type(tree, ast));
+    var.name = ruyi_ast_tree_symbol(tree, ast);
+    if (ruyi_ast_tree_child_length(tree, ast) >= 2) {
         has_init_expr = TRUE;
     }
-    if (Ruyi_at_var_declaration_auto_type == ruyi_ast_get_child(ast, 0)->type) {
+    if (Ruyi_at_var_declaration_auto_type == ruyi_ast_tree_type(tree, ruyi_ast_tree_get_child(tree, ast, 0))) {
         if (!has_init_expr) {
-            err = ruyi_error_misc_unicode_name("miss initialize expression for auto-type when define global var: %s", var.name);
+            err = ruyi_error_misc_unicode_name("miss initialize expression for auto-type when define global var: %s", ruyi_symbol_str(var.name));
             goto gen_global_var_define_on_error;
         }
-        if ((err = handle_type(ruyi_ast_get_child(ast, 1), &expr_type)) != NULL) {
+        if ((err = handle_type(tree, ruyi_ast_tree_get_child(tree, ast, 1), &expr_type)) != NULL) {
             goto gen_global_var_define_on_error;
         }
         // TODO need to generate init code and auto-type-cast ir at <init> func: for ast_init_expr.
         var.type = expr_type;
     } else {
-        if ((err = handle_type(ruyi_ast_get_child(ast, 0), &var_decleration_type)) != NULL) {
+        if ((err = handle_type(tree, ruyi_ast_tree_get_child(tree, ast, 0), &var_decleration_type)) != NULL) {
             goto gen_global_var_define_on_error;
         }
         if (has_init_expr) {
-            if ((err = handle_type(ruyi_ast_get_child(ast, 1), &expr_type)) != NULL) {
+            if ((err = handle_type(tree, ruyi_ast_tree_get_child(tree, ast, 1), &expr_type)) != NULL) {
                 goto gen_global_var_define_on_error;
             }
             if (!type_can_assign(&expr_type, &var_decleration_type)) {
-                err = ruyi_error_misc_unicode_name("var can not be assigned by diference type when define global var: %s", var.name);
+                err = ruyi_error_misc_unicode_name("var can not be assigned by diference type when define global var: %s", ruyi_symbol_str(var.name));
                 goto gen_global_var_define_on_error;
             }
             // TODO need to generate init code and auto-type-cast ir at <init> func: for ast_init_expr.
@@ -469,20 +468,20 @@ gen_global_var_define_on_error:
 }
 
 
-static ruyi_error* handle_type_array(ruyi_ast *ast_type, ruyi_symtab_type *out_type) {
+static ruyi_error* handle_type_array(const ruyi_ast_tree *tree, ruyi_ast_id ast_type, ruyi_symtab_type *out_type) {
     ruyi_error *err;
     ruyi_symtab_type raw_type;
     UINT16 dims = 0;
-    ruyi_ast *temp_type = ast_type;
+    ruyi_ast_id temp_type = ast_type;
     assert(out_type);
-    while (Ruyi_at_type_array == temp_type->type) {
+    while (Ruyi_at_type_array == ruyi_ast_tree_type(tree, temp_type)) {
         dims++;
-        if (0 == ruyi_ast_child_length(temp_type)) {
+        if (0 == ruyi_ast_tree_child_length(tree, temp_type)) {
             break;
         }
-        temp_type = ruyi_ast_get_child(temp_type, 0);
+        temp_type = ruyi_ast_tree_get_child(tree, temp_type, 0);
     }
-    if ((err = handle_type(temp_type, &raw_type)) != NULL) {
+    if ((err = handle_type(tree, temp_type, &raw_type)) != NULL) {
         return err;
     }
     out_type->ir_type = Ruyi_ir_type_Array;
@@ -525,7 +524,7 @@ static UINT32 ir_type_size(ruyi_ir_type type) {
     }
 }
 
-static ruyi_error* handle_type(ruyi_ast *ast_type, ruyi_symtab_type *out_type) {
+static ruyi_error* handle_type(const ruyi_ast_tree *tree, ruyi_ast_id ast_type, ruyi_symtab_type *out_type) {
     ruyi_error *err;
     ruyi_symtab_type_array *array;
     ruyi_symtab_type_array *func;
@@ -539,7 +538,7 @@ static ruyi_error* handle_type(ruyi_ast *ast_type, ruyi_symtab_type *out_type) {
      Ruyi_at_type_func,
      */
     out_type->detail.uniptr = NULL;
-    switch (ast_type->type) {
+    switch (ruyi_ast_tree_type(tree, ast_type)) {
         case Ruyi_at_type_byte:
             out_type->ir_type = Ruyi_ir_type_Int8;
             break;
@@ -567,7 +566,7 @@ static ruyi_error* handle_type(ruyi_ast *ast_type, ruyi_symtab_type *out_type) {
             out_type->ir_type = Ruyi_ir_type_Float64;
             break;
         case Ruyi_at_type_array:
-            err = handle_type_array(ast_type, out_type);
+            err = handle_type_array(tree, ast_type, out_type);
             if (err != NULL) {
                 return err;
             }
@@ -590,8 +589,11 @@ typedef struct {
     ruyi_symtab_function_define *func;
     ruyi_ins_codes              *codes;
     ruyi_symtab                 *symtab;    // reference of global ruyi_symtab
+    const ruyi_ast_tree         *tree;      // the ast being generated
     ruyi_list                   *break_index_stack; // the item value is index-vector
     ruyi_list                   *continue_index_stack; // the item value is index-vector
+    ruyi_ast_walker             *walker;    // walks the nodes of gen_stmt
+    ruyi_vector                 *part_values; // values kept between the parts of statements, e.g. the jumps to the end of an if
 } ruyi_cg_body_context;
 
 static
@@ -616,13 +618,19 @@ void ruyi_ins_codes_destroy(ruyi_ins_codes *codes) {
     ruyi_mem_free(codes);
 }
 
-static ruyi_cg_body_context * ruyi_cg_body_context_create(ruyi_symtab *symtab, ruyi_symtab_function_define *func) {
+// the tables of the walk of a body, see gen_stmt
+static const ruyi_ast_visitor gen_stmt_visitor;
+
+static ruyi_cg_body_context * ruyi_cg_body_context_create(ruyi_symtab *symtab, const ruyi_ast_tree *tree, ruyi_symtab_function_define *func) {
     ruyi_cg_body_context * context = (ruyi_cg_body_context*) ruyi_mem_alloc(sizeof(ruyi_cg_body_context));
     context->symtab = symtab;
+    context->tree = tree;
     context->func = func;
     context->codes = ruyi_ins_codes_create();
     context->break_index_stack = ruyi_list_create();
     context->continue_index_stack = ruyi_list_create();
+    context->walker = ruyi_ast_walker_create(&gen_stmt_visitor, context);
+    context->part_values = ruyi_vector_create();
     return context;
 }
 
@@ -637,6 +645,11 @@ static void ruyi_cg_body_context_destroy(ruyi_cg_body_context *context) {
     if (context->continue_index_stack) {
         ruyi_list_destroy(context->continue_index_stack);
     }
+    ruyi_ast_walker_destroy(context->walker);
+    if (context->part_values) {
+        ruyi_vector_destroy(context->part_values);
+    }
+    ruyi_mem_free(context);
 }
 
 static void ruyi_cg_body_context_push_break_continue(ruyi_cg_body_context *context) {
@@ -704,37 +717,76 @@ void ruyi_ins_codes_set_value(ruyi_ins_codes *codes, UINT32 index, UINT32 val) {
     codes->data[index] = ruyi_ir_make_code(ins, val);
 }
 
-static
-ruyi_error* gen_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type);
+/*
+ The nodes of a body are generated by a walk of ruyi_ast_walker, by the functions of the walk. A statement with parts
+ which are not generated as its children in order, e.g. the condition and the body of a while or the arguments of a
+ call, sets them as the parts of its frame and generates the codes between them in its child function. So each part
+ is walked by a frame on the heap, and a deep tree of statements or expressions does not take the C stack.
+ */
 
+// data of a frame of the walk, the arguments of gen_stmt for the node, the types of its operands or parts, and the
+// state of a statement kept between its parts
+typedef struct {
+    ruyi_symtab_type *out_type;
+    const ruyi_symtab_type *expect_type;
+    ruyi_symtab_type left_type;
+    ruyi_symtab_type right_type;
+    UINT32 index;       // e.g. the start of a loop or the variable assigned
+    UINT32 jump;        // the jump over the body of a while or an if
+    UINT32 base;        // the first of the part_values of the context kept by the frame
+} ruyi_cg_walk_data;
+
+// set the node of a part and the arguments of gen_stmt for it
 static
-ruyi_error* gen_block_statements(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type);
+void gen_walk_set_part(ruyi_ast_walker *walker, ruyi_ast_walk_frame *child_frame, ruyi_ast_id ast, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
+    ruyi_cg_walk_data *child_data = (ruyi_cg_walk_data*)child_frame->data;
+    ruyi_ast_walker_set_part(walker, child_frame, NULL, ast);
+    child_data->out_type = out_type;
+    child_data->expect_type = expect_type;
+}
+
+static void gen_drop_part_values(ruyi_cg_body_context *context, UINT32 base) {
+    while (ruyi_vector_length(context->part_values) > base) {
+        ruyi_vector_remove_last(context->part_values, NULL);
+    }
+}
 
 static void proccess_loop_begin(ruyi_cg_body_context *context);
 
 static void proccess_loop_end(ruyi_cg_body_context *context, UINT32 index_for_loop_start);
 
 static
-ruyi_error* gen_return_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type) {
-    ruyi_error *err;
-    ruyi_ast *return_expr_list_ast;
-    UINT32 len = 0;
-    UINT32 i;
-    if (ruyi_ast_child_length(ast_stmt) > 0) {
-        return_expr_list_ast = ruyi_ast_get_child(ast_stmt, 0);
-        len = ruyi_ast_child_length(return_expr_list_ast);
-        for (i = 0; i < len; i++) {
-            if ((err = gen_stmt(context, ruyi_ast_get_child(return_expr_list_ast, i), out_type, NULL)) != NULL ) {
-                return err;
-            }
-        }
+ruyi_error* gen_walk_return_stmt_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    (void)child_frame;
+    // the parts are the expressions returned
+    if (frame->child_count > 0) {
+        ruyi_ast_walker_set_parts(frame, ruyi_ast_tree_child_length(context->tree, ruyi_ast_tree_get_child(context->tree, frame->id, 0)));
+    } else {
+        ruyi_ast_walker_set_parts(frame, 0);
     }
-    ruyi_ins_codes_add(context->codes, Ruyi_ir_Ret, len);
     return NULL;
 }
 
 static
-ruyi_error* gen_binary_expr_with_cast(const ruyi_symtab_type *left_type, const ruyi_symtab_type *right_type, ruyi_symtab_type *out_type, const ruyi_ast *op,
+ruyi_error* gen_walk_return_stmt_part(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id return_expr_list_ast = ruyi_ast_tree_get_child(context->tree, frame->id, 0);
+    gen_walk_set_part(walker, child_frame, ruyi_ast_tree_get_child(context->tree, return_expr_list_ast, frame->child), data->out_type, NULL);
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_return_stmt_leave(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    (void)child_frame;
+    ruyi_ins_codes_add(context->codes, Ruyi_ir_Ret, frame->child_count);
+    return NULL;
+}
+
+static
+ruyi_error* gen_binary_expr_with_cast(const ruyi_symtab_type *left_type, const ruyi_symtab_type *right_type, ruyi_symtab_type *out_type, const ruyi_ast_tree *tree, ruyi_ast_id op,
                    ruyi_ins_codes *codes, const ruyi_ast_type* ops, const ruyi_ir_ins *int64_ins, const ruyi_ir_ins *double_ins, UINT32 len) {
     int i;
     switch (left_type->ir_type) {
@@ -750,7 +802,7 @@ ruyi_error* gen_binary_expr_with_cast(const ruyi_symtab_type *left_type, const r
                 case Ruyi_ir_type_Rune:
                 case Ruyi_ir_type_Int64:
                     for (i = 0; i < len; i++) {
-                        if (ops[i] == op->type) {
+                        if (ops[i] == ruyi_ast_tree_type(tree, op)) {
                             ruyi_ins_codes_add(codes, int64_ins[i], 0);
                             break;
                         }
@@ -764,7 +816,7 @@ ruyi_error* gen_binary_expr_with_cast(const ruyi_symtab_type *left_type, const r
                 case Ruyi_ir_type_Float64:
                     ruyi_ins_codes_add(codes, Ruyi_ir_I2f_1, 0);
                     for (i = 0; i < len; i++) {
-                        if (ops[i] == op->type) {
+                        if (ops[i] == ruyi_ast_tree_type(tree, op)) {
                             ruyi_ins_codes_add(codes, double_ins[i], 0);
                             break;
                         }
@@ -795,7 +847,7 @@ ruyi_error* gen_binary_expr_with_cast(const ruyi_symtab_type *left_type, const r
                     return ruyi_error_misc("unsupport cast type to float64");
             }
             for (i = 0; i < len; i++) {
-                if (ops[i] == op->type) {
+                if (ops[i] == ruyi_ast_tree_type(tree, op)) {
                     ruyi_ins_codes_add(codes, double_ins[i], 0);
                     break;
                 }
@@ -815,55 +867,7 @@ ruyi_error* gen_binary_expr_with_cast(const ruyi_symtab_type *left_type, const r
 }
 
 static
-ruyi_error* gen_additive_expression(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
-    ruyi_error *err;
-    UINT32 len = ruyi_ast_child_length(ast_stmt);
-    ruyi_ast *left;
-    ruyi_ast *right;
-    ruyi_ast *op;
-    ruyi_symtab_type left_type, right_type;
-    const ruyi_ast_type ops[] = {Ruyi_at_op_add, Ruyi_at_op_sub};
-    const ruyi_ir_ins int64_ins[] = {Ruyi_ir_Iadd, Ruyi_ir_Isub};
-    const ruyi_ir_ins double_ins[] = {Ruyi_ir_Fadd, Ruyi_ir_Fsub};
-    assert(3 == len);
-    left = ruyi_ast_get_child(ast_stmt, 0);
-    op = ruyi_ast_get_child(ast_stmt, 1);
-    right = ruyi_ast_get_child(ast_stmt, 2);
-    if ((err = gen_stmt(context, left, &left_type, expect_type)) != NULL) {
-        return err;
-    }
-    if ((err = gen_stmt(context, right, &right_type, &left_type)) != NULL) {
-        return err;
-    }
-    return gen_binary_expr_with_cast(&left_type, &right_type, out_type, op, context->codes, ops, int64_ins, double_ins, sizeof(ops)/sizeof(ops[0]));
-}
-
-static
-ruyi_error* gen_multiplicative_expression(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
-    ruyi_error *err;
-    UINT32 len = ruyi_ast_child_length(ast_stmt);
-    ruyi_ast *left;
-    ruyi_ast *right;
-    ruyi_ast *op;
-    ruyi_symtab_type left_type, right_type;
-    const ruyi_ast_type ops[] = {Ruyi_at_op_mul, Ruyi_at_op_div, Ruyi_at_op_mod};
-    const ruyi_ir_ins int64_ins[] = {Ruyi_ir_Imul, Ruyi_ir_Idiv, Ruyi_ir_Imod};
-    const ruyi_ir_ins double_ins[] = {Ruyi_ir_Fadd, Ruyi_ir_Fsub, 0};
-    assert(3 == len);
-    left = ruyi_ast_get_child(ast_stmt, 0);
-    op = ruyi_ast_get_child(ast_stmt, 1);
-    right = ruyi_ast_get_child(ast_stmt, 2);
-    if ((err = gen_stmt(context, left, &left_type, NULL)) != NULL) {
-        return err;
-    }
-    if ((err = gen_stmt(context, right, &right_type, &left_type)) != NULL) {
-        return err;
-    }
-    return gen_binary_expr_with_cast(&left_type, &right_type, out_type, op, context->codes, ops, int64_ins, double_ins, sizeof(ops)/sizeof(ops[0]));
-}
-
-static
-ruyi_error* gen_load_from_variable_name(ruyi_cg_body_context *context, const ruyi_unicode_string *name, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
+ruyi_error* gen_load_from_variable_name(ruyi_cg_body_context *context, ruyi_symbol name, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
     UINT32 index;
     ruyi_symtab_variable var;
     if (ruyi_symtab_function_scope_get(context->func->func_symtab_scope, name, &var)) {
@@ -886,7 +890,7 @@ ruyi_error* gen_load_from_variable_name(ruyi_cg_body_context *context, const ruy
         ruyi_ins_codes_add(context->codes, Ruyi_ir_Getglb, index);
         return NULL;
     }
-    return ruyi_error_misc_unicode_name("can not find variable %s", name);
+    return ruyi_error_misc_unicode_name("can not find variable %s", ruyi_symbol_str(name));
 }
 
 static
@@ -964,83 +968,115 @@ ruyi_error* gen_integer(ruyi_cg_body_context *context, UINT64 value, ruyi_symtab
 }
 
 static
-ruyi_error* gen_var_declaration(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
+ruyi_error* gen_walk_var_declaration_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
     ruyi_error* err;
-    const ruyi_unicode_string *name = (const ruyi_unicode_string *)ast_stmt->data.ptr_value;
-    ruyi_ast *ast_type = ruyi_ast_get_child(ast_stmt, 0);
-    ruyi_ast *ast_expr = ruyi_ast_get_child(ast_stmt, 1);
+    ruyi_ast_id ast_type = ruyi_ast_tree_get_child(context->tree, frame->id, 0);
+    ruyi_ast_id ast_expr = ruyi_ast_tree_get_child(context->tree, frame->id, 1);
     ruyi_symtab_variable var;
-    ruyi_symtab_type expr_type;
-    ruyi_symtab_variable* var_ptr;
-    UINT32 index;
-    var.name = name;
+    (void)child_frame;
+    var.name = ruyi_ast_tree_symbol(context->tree, frame->id);
     var.scope_type = Ruyi_sst_Local;
-    if (ast_type->type == Ruyi_at_var_declaration_auto_type) {
+    if (ruyi_ast_tree_type(context->tree, ast_type) == Ruyi_at_var_declaration_auto_type) {
         // get type from expr
         // auto type, later fill by expr...
         var.type.ir_type = 0;
         var.type.size = 0;
         var.type.detail.uniptr = NULL;
     } else {
-        handle_type(ast_type, &var.type);
+        handle_type(context->tree, ast_type, &var.type);
     }
-    if ((err = ruyi_symtab_function_scope_add_var(context->func->func_symtab_scope, &var, &index)) != NULL) {
+    if ((err = ruyi_symtab_function_scope_add_var(context->func->func_symtab_scope, &var, &data->index)) != NULL) {
         return err;
     }
-    if (ast_expr == NULL) {
-        if (ast_type->type == Ruyi_at_var_declaration_auto_type) {
+    // the type expected of the init expression
+    data->right_type = var.type;
+    if (ast_expr == RUYI_AST_NONE) {
+        if (ruyi_ast_tree_type(context->tree, ast_type) == Ruyi_at_var_declaration_auto_type) {
             // must not be here
             assert(0);
         }
         // just define the variable, there was not init expression.
+        ruyi_ast_walker_set_parts(frame, 0);
         return NULL;
     }
-    if (ast_type->type == Ruyi_at_var_declaration_auto_type) {
-        if ((err = gen_stmt(context, ast_expr, &expr_type, NULL)) != NULL) {
-            return err;
-        }
+    ruyi_ast_walker_set_parts(frame, 1);
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_var_declaration_part(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id ast_type = ruyi_ast_tree_get_child(context->tree, frame->id, 0);
+    ruyi_ast_id ast_expr = ruyi_ast_tree_get_child(context->tree, frame->id, 1);
+    if (ruyi_ast_tree_type(context->tree, ast_type) == Ruyi_at_var_declaration_auto_type) {
+        gen_walk_set_part(walker, child_frame, ast_expr, &data->left_type, NULL);
+    } else {
+        gen_walk_set_part(walker, child_frame, ast_expr, &data->left_type, &data->right_type);
+    }
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_var_declaration_leave(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id ast_type = ruyi_ast_tree_get_child(context->tree, frame->id, 0);
+    ruyi_symtab_variable* var_ptr;
+    (void)child_frame;
+    if (frame->child_count == 0) {
+        return NULL;
+    }
+    if (ruyi_ast_tree_type(context->tree, ast_type) == Ruyi_at_var_declaration_auto_type) {
         // fill type back for auto_type
-        var_ptr = ruyi_symtab_function_scope_get_var(context->func->func_symtab_scope, index);
+        var_ptr = ruyi_symtab_function_scope_get_var(context->func->func_symtab_scope, data->index);
         assert(var_ptr);
-        var_ptr->type = expr_type;
-    } else {
-        if ((err = gen_stmt(context, ast_expr, &expr_type, &var.type)) != NULL) {
-            return err;
-        }
-        if (!type_can_assign(&expr_type, &var.type)) {
-            return ruyi_error_misc_unicode_name("var can not be assigned by diference type when define global var: %s", var.name);
-        }
+        var_ptr->type = data->left_type;
+    } else if (!type_can_assign(&data->left_type, &data->right_type)) {
+        return ruyi_error_misc_unicode_name("var can not be assigned by diference type when define global var: %s", ruyi_symbol_str(ruyi_ast_tree_symbol(context->tree, frame->id)));
     }
-    ruyi_ins_codes_add(context->codes, Ruyi_ir_Store, index);
+    ruyi_ins_codes_add(context->codes, Ruyi_ir_Store, data->index);
     return NULL;
 }
 
 static
-ruyi_error* gen_while_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
-    ruyi_error* err;
-    ruyi_ast *ast_expr = ruyi_ast_get_child(ast_stmt, 0);
-    ruyi_ast *ast_body = ruyi_ast_get_child(ast_stmt, 1);
-    ruyi_symtab_type expr_type;
-    UINT32 index_for_loop_start = context->codes->len;
-    UINT32 which_index_will_jump_out;
-    
+ruyi_error* gen_walk_while_stmt_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    (void)child_frame;
+    data->index = context->codes->len;
     proccess_loop_begin(context);
-    
-    // while enter
-    if ((err = gen_stmt(context, ast_expr, &expr_type, NULL)) != NULL) {
-        return err;
-    }
-    which_index_will_jump_out = ruyi_ins_codes_add(context->codes, Ruyi_ir_Jfalse, 0); // will fill later
-    // body
-    if ((err = gen_block_statements(context, ast_body, NULL, NULL)) != NULL) {
-        return err;
+    // while enter and body
+    ruyi_ast_walker_set_parts(frame, 2);
+    return NULL;
+}
+
+// the parts of a while or an else-if: the condition, then the body jumped over when it is false
+static
+ruyi_error* gen_walk_expr_and_body_part(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id ast = ruyi_ast_tree_get_child(context->tree, frame->id, frame->child);
+    if (frame->child == 0) {
+        gen_walk_set_part(walker, child_frame, ast, &data->left_type, NULL);
+    } else {
+        data->jump = ruyi_ins_codes_add(context->codes, Ruyi_ir_Jfalse, 0); // will fill later
+        gen_walk_set_part(walker, child_frame, ast, NULL, NULL);
     }
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_while_stmt_leave(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    (void)child_frame;
     // jump to while enter
-    ruyi_ins_codes_add(context->codes, Ruyi_ir_Jmp, index_for_loop_start);
-    ruyi_ins_codes_set_value(context->codes, which_index_will_jump_out, context->codes->len);
-    
-    proccess_loop_end(context, index_for_loop_start);
-    
+    ruyi_ins_codes_add(context->codes, Ruyi_ir_Jmp, data->index);
+    ruyi_ins_codes_set_value(context->codes, data->jump, context->codes->len);
+    proccess_loop_end(context, data->index);
     return NULL;
 }
 
@@ -1068,188 +1104,108 @@ static BOOL can_be_add_jmp(const ruyi_cg_body_context *context) {
     return TRUE;
 }
 
+// the end of the body of an if or an else-if
 static
-ruyi_error* gen_if_expr_and_body(ruyi_cg_body_context *context, ruyi_ast *ast_expr, ruyi_ast *ast_body, ruyi_vector *end_of_stmt_placeholders) {
-    ruyi_error *err;
-    ruyi_symtab_type expr_type;
-    UINT32 end_of_body_placeholder;
+void gen_if_body_end(ruyi_cg_body_context *context, UINT32 end_of_body_placeholder) {
     UINT32 end_of_stmt_placeholder;
-    // if-expr
-    if ((err = gen_stmt(context, ast_expr, &expr_type, NULL)) != NULL) {
-        return err;
-    }
-    
-    end_of_body_placeholder = ruyi_ins_codes_add(context->codes, Ruyi_ir_Jfalse, 0); // will jump to end of body
-    // if-body
-    if ((err = gen_block_statements(context, ast_body, NULL, NULL)) != NULL) {
-        return err;
-    }
     // jump to endof if-stmt
     // if the body's last ins code is 'ret', must be not add 'jmp'
     if (can_be_add_jmp(context)) {
         end_of_stmt_placeholder = ruyi_ins_codes_add(context->codes, Ruyi_ir_Jmp, 0);  // will jump to end of the stmt
-        ruyi_vector_add(end_of_stmt_placeholders, ruyi_value_uint32(end_of_stmt_placeholder));
+        ruyi_vector_add(context->part_values, ruyi_value_uint32(end_of_stmt_placeholder));
     }
     ruyi_ins_codes_set_value(context->codes, end_of_body_placeholder, context->codes->len);
+}
+
+static
+ruyi_error* gen_walk_if_stmt_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    (void)child_frame;
+    assert(frame->child_count >= 2);
+    // the jumps to the end of the if-stmt are kept from here
+    data->base = ruyi_vector_length(context->part_values);
+    // if-expr, if-body, else-if stmts and the else-stmt
+    ruyi_ast_walker_set_parts(frame, frame->child_count);
     return NULL;
 }
 
 static
-ruyi_error* gen_if_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
-    ruyi_error *err = NULL;
-    ruyi_ast *ast_expr = ruyi_ast_get_child(ast_stmt, 0);
-    ruyi_ast *ast_body = ruyi_ast_get_child(ast_stmt, 1);
-    ruyi_ast *elseif_stmt;
-    ruyi_ast *tail_stmt;
-    UINT32 i, len;
-    ruyi_value value;
-    ruyi_vector *end_of_stmt_placeholders;
-    len = ruyi_ast_child_length(ast_stmt);
-    assert(len >= 2);
-    
-    end_of_stmt_placeholders = ruyi_vector_create();
-    
-    if ((err = gen_if_expr_and_body(context, ast_expr, ast_body, end_of_stmt_placeholders)) != NULL) {
-         goto gen_if_stmt_error;
-    }
-    for (i = 2; i < len - 1; i++) {
+ruyi_error* gen_walk_if_stmt_part(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id ast = ruyi_ast_tree_get_child(context->tree, frame->id, frame->child);
+    ruyi_ast_type type;
+    if (frame->child < 2) {
+        return gen_walk_expr_and_body_part(walker, frame, child_frame);
+    }
+    if (frame->child == 2) {
+        gen_if_body_end(context, data->jump);
+    }
+    type = ruyi_ast_tree_type(context->tree, ast);
+    if (frame->child < frame->child_count - 1) {
         // else-if stmt
-        elseif_stmt = ruyi_ast_get_child(ast_stmt, i);
-        assert(elseif_stmt->type == Ruyi_at_elseif_statement);
-        ast_expr = ruyi_ast_get_child(elseif_stmt, 0);
-        ast_body = ruyi_ast_get_child(elseif_stmt, 1);
-        if ((err = gen_if_expr_and_body(context, ast_expr, ast_body, end_of_stmt_placeholders)) != NULL) {
-            goto gen_if_stmt_error;
-        }
+        assert(type == Ruyi_at_elseif_statement);
+    } else if (type != Ruyi_at_elseif_statement && type != Ruyi_at_else_statement) {
+        // the last if-else-stmt or else-stmt
+        return ruyi_error_misc("unknow if-else stmt type");
     }
-    // the last if-else-stmt or else-stmt
-    if (len > 2) {
-        tail_stmt = ruyi_ast_get_child(ast_stmt, len - 1);
-        if (tail_stmt->type == Ruyi_at_elseif_statement) {
-            ast_expr = ruyi_ast_get_child(tail_stmt, 0);
-            ast_body = ruyi_ast_get_child(tail_stmt, 1);
-            if ((err = gen_if_expr_and_body(context, ast_expr, ast_body, end_of_stmt_placeholders)) != NULL) {
-                goto gen_if_stmt_error;
-            }
-        } else if (tail_stmt->type == Ruyi_at_else_statement) {
-            ast_body = ruyi_ast_get_child(tail_stmt, 0);
-            if ((err = gen_block_statements(context, ast_body, NULL, NULL)) != NULL) {
-                goto gen_if_stmt_error;
-            }
-        } else {
-            err = ruyi_error_misc("unknow if-else stmt type");
-            goto gen_if_stmt_error;
-        }
+    gen_walk_set_part(walker, child_frame, ast, NULL, NULL);
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_if_stmt_leave(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    UINT32 i, len;
+    ruyi_value value;
+    (void)child_frame;
+    if (frame->child_count == 2) {
+        gen_if_body_end(context, data->jump);
     }
-    len = ruyi_vector_length(end_of_stmt_placeholders);
-    for (i = 0; i < len; i++) {
-        ruyi_vector_get(end_of_stmt_placeholders, i, &value);
+    len = ruyi_vector_length(context->part_values);
+    for (i = data->base; i < len; i++) {
+        ruyi_vector_get(context->part_values, i, &value);
         ruyi_ins_codes_set_value(context->codes, value.data.uint32_value, context->codes->len);
     }
-    
-gen_if_stmt_error:
-    if (end_of_stmt_placeholders) {
-        ruyi_vector_destroy(end_of_stmt_placeholders);
-    }
-    return err;
+    gen_drop_part_values(context, data->base);
+    return NULL;
 }
 
 static
-ruyi_error* gen_relational_expression(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
-    ruyi_error *err;
-    UINT32 len = ruyi_ast_child_length(ast_stmt);
-    ruyi_ast *left;
-    ruyi_ast *right;
-    ruyi_ast *op;
-    ruyi_symtab_type left_type, right_type;
-    const ruyi_ast_type ops[] = {Ruyi_at_op_lt, Ruyi_at_op_lte, Ruyi_at_op_gt, Ruyi_at_op_gte};
-    const ruyi_ir_ins int64_ins[] = {Ruyi_ir_Icmp_lt, Ruyi_ir_Icmp_lte, Ruyi_ir_Icmp_gt, Ruyi_ir_Icmp_gte};
-    const ruyi_ir_ins double_ins[] = {Ruyi_ir_Fcmp_lt, Ruyi_ir_Fcmp_lte, Ruyi_ir_Fcmp_gt, Ruyi_ir_Fcmp_gte};
-    assert(3 == len);
-    left = ruyi_ast_get_child(ast_stmt, 0);
-    op = ruyi_ast_get_child(ast_stmt, 1);
-    right = ruyi_ast_get_child(ast_stmt, 2);
-    if ((err = gen_stmt(context, left, &left_type, NULL)) != NULL) {
-        return err;
-    }
-    if ((err = gen_stmt(context, right, &right_type, &left_type)) != NULL) {
-        return err;
-    }
-    if (op->type == Ruyi_at_op_instanceof) {
-        return ruyi_error_misc("unsupport operator 'instanceof' at this version!");
-    } else{
-        return gen_binary_expr_with_cast(&left_type, &right_type, out_type, op, context->codes, ops, int64_ins, double_ins, sizeof(ops)/sizeof(ops[0]));
-    }
+ruyi_error* gen_walk_elseif_stmt_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    (void)walker;
+    (void)child_frame;
+    // else-if-expr and else-if-body
+    ruyi_ast_walker_set_parts(frame, 2);
+    return NULL;
 }
 
 static
-ruyi_error* gen_block_statements(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
-    ruyi_error *err;
-    ruyi_ast *ast_child_stmt;
-    UINT32 i, len;
-    ruyi_symtab_function_scope_enter(context->func->func_symtab_scope);
-    len = ruyi_ast_child_length(ast_stmt);
-    for (i = 0; i < len; i++) {
-        ast_child_stmt = ruyi_ast_get_child(ast_stmt, i);
-        if ((err = gen_stmt(context, ast_child_stmt, out_type, expect_type)) != NULL) {
-            return err;
-        }
-    }
-    ruyi_symtab_function_scope_leave(context->func->func_symtab_scope);
+ruyi_error* gen_walk_elseif_stmt_leave(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    (void)child_frame;
+    gen_if_body_end(context, data->jump);
     return NULL;
 }
 
 static
-ruyi_error* gen_assign_statement(ruyi_cg_body_context *context, const ruyi_ast *left_ast, ruyi_ast *expr_ast, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
-    ruyi_error *err;
-    const ruyi_unicode_string *name;
-    ruyi_symtab_variable var;
-    ruyi_symtab_type expr_type;
-    if (Ruyi_at_name == left_ast->type) {
-        name = (const ruyi_unicode_string *)left_ast->data.ptr_value;
-        if (!ruyi_symtab_function_scope_get(context->func->func_symtab_scope, name, &var)) {
-            return ruyi_error_misc_unicode_name("can not find variable %s", name);
-        }
-        if ((err = gen_stmt(context, expr_ast, &expr_type, &var.type)) != NULL) {
-            return err;
-        }
-        if (expr_type.ir_type != var.type.ir_type) {
-            // TODO type auto cast ...
-            return ruyi_error_misc_unicode_name("assign type not match: %s ", name);
-        }
-        
-        ruyi_ins_codes_add(context->codes, Ruyi_ir_Store, var.index);
-    } else {
-        switch (left_ast->type) {
-            case Ruyi_at_field_dot_access_expression:
-                // TODO
-                return ruyi_error_misc("do not support now...");
-                break;
-            case Ruyi_at_field_bracket_access_expression:
-                // TODO
-                return ruyi_error_misc("do not support now...");
-                break;
-            case Ruyi_at_array_variable_access:
-                // TODO
-                return ruyi_error_misc("do not support now...");
-                break;
-            case Ruyi_at_array_primary_access:
-                // TODO
-                return ruyi_error_misc("do not support now...");
-                break;
-            default:
-                break;
-        }
-    }
+ruyi_error* gen_walk_else_stmt_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    // the else-body is walked as the child of it
+    (void)walker;
+    (void)frame;
+    (void)child_frame;
     return NULL;
 }
 
 static
-ruyi_error* gen_inc_or_dec_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type, BOOL incr) {
+ruyi_error* gen_inc_or_dec_stmt(ruyi_cg_body_context *context, ruyi_ast_id ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type, BOOL incr) {
     ruyi_symtab_variable var;
-    const ruyi_unicode_string *name = (const ruyi_unicode_string *)ast_stmt->data.ptr_value;
+    ruyi_symbol name = ruyi_ast_tree_symbol(context->tree, ast_stmt);
     if (!ruyi_symtab_function_scope_get(context->func->func_symtab_scope, name, &var)) {
-        return ruyi_error_misc_unicode_name("can not find variable %s", name);
+        return ruyi_error_misc_unicode_name("can not find variable %s", ruyi_symbol_str(name));
     }
     switch (var.scope_type) {
         case Ruyi_sst_Local:
@@ -1262,7 +1218,7 @@ ruyi_error* gen_inc_or_dec_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stm
             // TODO
             break;
         default:
-            return ruyi_error_misc_unicode_name("unknown variable %s's scope type", name);
+            return ruyi_error_misc_unicode_name("unknown variable %s's scope type", ruyi_symbol_str(name));
     }
     switch (var.type.ir_type) {
         case Ruyi_ir_type_Int8:
@@ -1285,7 +1241,7 @@ ruyi_error* gen_inc_or_dec_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stm
             }
             break;
         default:
-            return ruyi_error_misc_unicode_name("unknown variable %s's type", name);
+            return ruyi_error_misc_unicode_name("unknown variable %s's type", ruyi_symbol_str(name));
     }
     switch (var.scope_type) {
         case Ruyi_sst_Local:
@@ -1298,25 +1254,59 @@ ruyi_error* gen_inc_or_dec_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stm
             // TODO
             break;
         default:
-            return ruyi_error_misc_unicode_name("unknown variable %s's scope type", name);
+            return ruyi_error_misc_unicode_name("unknown variable %s's scope type", ruyi_symbol_str(name));
     }
     return NULL;
 }
 
 static
-ruyi_error* gen_left_hand_side_expression(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
-    ruyi_ast *left_ast = ruyi_ast_get_child(ast_stmt, 0);
-    ruyi_ast *tail_ast = ruyi_ast_get_child(ast_stmt, 1);
-    
-    switch (tail_ast->type) {
+ruyi_error* gen_walk_left_hand_side_expression_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id left_ast = ruyi_ast_tree_get_child(context->tree, frame->id, 0);
+    ruyi_ast_id tail_ast = ruyi_ast_tree_get_child(context->tree, frame->id, 1);
+    ruyi_symbol name;
+    ruyi_symtab_variable var;
+    (void)child_frame;
+    ruyi_ast_walker_set_parts(frame, 0);
+    switch (ruyi_ast_tree_type(context->tree, tail_ast)) {
         case Ruyi_at_assign_statement:
-            return gen_assign_statement(context, left_ast, ruyi_ast_get_child(tail_ast, 0), out_type, expect_type);
+            if (Ruyi_at_name == ruyi_ast_tree_type(context->tree, left_ast)) {
+                name = ruyi_ast_tree_symbol(context->tree, left_ast);
+                if (!ruyi_symtab_function_scope_get(context->func->func_symtab_scope, name, &var)) {
+                    return ruyi_error_misc_unicode_name("can not find variable %s", ruyi_symbol_str(name));
+                }
+                // the expression assigned is the part, the variable is stored after it
+                data->right_type = var.type;
+                data->index = var.index;
+                ruyi_ast_walker_set_parts(frame, 1);
+                return NULL;
+            }
+            switch (ruyi_ast_tree_type(context->tree, left_ast)) {
+                case Ruyi_at_field_dot_access_expression:
+                    // TODO
+                    return ruyi_error_misc("do not support now...");
+                case Ruyi_at_field_bracket_access_expression:
+                    // TODO
+                    return ruyi_error_misc("do not support now...");
+                case Ruyi_at_array_variable_access:
+                    // TODO
+                    return ruyi_error_misc("do not support now...");
+                case Ruyi_at_array_primary_access:
+                    // TODO
+                    return ruyi_error_misc("do not support now...");
+                default:
+                    break;
+            }
+            break;
         case Ruyi_at_var_declaration:
-            return gen_var_declaration(context, tail_ast, out_type, expect_type);
+            // the declaration is the part
+            ruyi_ast_walker_set_parts(frame, 1);
+            break;
         case Ruyi_at_inc_statement:
-            return gen_inc_or_dec_stmt(context, left_ast, out_type, expect_type, TRUE);
+            return gen_inc_or_dec_stmt(context, left_ast, data->out_type, data->expect_type, TRUE);
         case Ruyi_at_dec_statement:
-            return gen_inc_or_dec_stmt(context, left_ast, out_type, expect_type, FALSE);
+            return gen_inc_or_dec_stmt(context, left_ast, data->out_type, data->expect_type, FALSE);
         case Ruyi_at_function_invocation_statement:
             
             break;
@@ -1326,50 +1316,118 @@ ruyi_error* gen_left_hand_side_expression(ruyi_cg_body_context *context, ruyi_as
     return NULL;
 }
 
+static
+ruyi_error* gen_walk_left_hand_side_expression_part(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id tail_ast = ruyi_ast_tree_get_child(context->tree, frame->id, 1);
+    if (Ruyi_at_assign_statement == ruyi_ast_tree_type(context->tree, tail_ast)) {
+        gen_walk_set_part(walker, child_frame, ruyi_ast_tree_get_child(context->tree, tail_ast, 0), &data->left_type, &data->right_type);
+    } else {
+        gen_walk_set_part(walker, child_frame, tail_ast, data->out_type, data->expect_type);
+    }
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_left_hand_side_expression_leave(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id left_ast = ruyi_ast_tree_get_child(context->tree, frame->id, 0);
+    ruyi_ast_id tail_ast = ruyi_ast_tree_get_child(context->tree, frame->id, 1);
+    (void)child_frame;
+    if (frame->child_count == 0 || Ruyi_at_assign_statement != ruyi_ast_tree_type(context->tree, tail_ast)) {
+        return NULL;
+    }
+    if (data->left_type.ir_type != data->right_type.ir_type) {
+        // TODO type auto cast ...
+        return ruyi_error_misc_unicode_name("assign type not match: %s ", ruyi_symbol_str(ruyi_ast_tree_symbol(context->tree, left_ast)));
+    }
+    ruyi_ins_codes_add(context->codes, Ruyi_ir_Store, data->index);
+    return NULL;
+}
+
 #define NAME_BUF_LENGTH 128
 
 static
-ruyi_error* gen_function_invocation(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
-    ruyi_error* err;
+ruyi_error* gen_walk_function_invocation_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
     UINT32 i, len;
-    const ruyi_unicode_string *name = (const ruyi_unicode_string *)ruyi_ast_get_child(ast_stmt, 0)->data.ptr_value;
-    ruyi_ast *ast_func_invoce_tail = ruyi_ast_get_child(ast_stmt, 1);
-    ruyi_ast *ast_arg_list = ruyi_ast_get_child(ast_func_invoce_tail, 0);
-    ruyi_ast *ast_arg;
+    ruyi_symbol name = ruyi_ast_tree_symbol(context->tree, ruyi_ast_tree_get_child(context->tree, frame->id, 0));
+    ruyi_ast_id ast_func_invoce_tail = ruyi_ast_tree_get_child(context->tree, frame->id, 1);
+    ruyi_ast_id ast_arg_list = ruyi_ast_tree_get_child(context->tree, ast_func_invoce_tail, 0);
     ruyi_symtab_function func;
-    ruyi_symtab_type arg_out;
-    char temp_name[NAME_BUF_LENGTH];
-    assert(ast_arg_list != NULL);
-    assert(ast_arg_list->type == Ruyi_at_argument_list);
+    (void)child_frame;
+    assert(ast_arg_list != RUYI_AST_NONE);
+    assert(ruyi_ast_tree_type(context->tree, ast_arg_list) == Ruyi_at_argument_list);
     
     if (!ruyi_symtab_get_function_by_name(context->symtab, name, &func)) {
-        return ruyi_error_misc_unicode_name("can not found function: %s", name);
+        return ruyi_error_misc_unicode_name("can not found function: %s", ruyi_symbol_str(name));
     }
     
-    len = ruyi_ast_child_length(ast_arg_list);
+    len = ruyi_ast_tree_child_length(context->tree, ast_arg_list);
     
     if (len != func.parameter_count) {
-        return ruyi_error_misc_unicode_name("parameters length is not match when calling function: %s", name);
+        return ruyi_error_misc_unicode_name("parameters length is not match when calling function: %s", ruyi_symbol_str(name));
     }
-    if (out_type != NULL) {
+    if (data->out_type != NULL) {
         if (func.return_count != 1) {
-            return ruyi_error_misc_unicode_name("too many return values when calling function: %s", name);
+            return ruyi_error_misc_unicode_name("too many return values when calling function: %s", ruyi_symbol_str(name));
         }
-        *out_type =  func.return_types[0];
+        *data->out_type =  func.return_types[0];
     }
-    
-    //  the args order is Left to Right
+    data->index = func.index;
+    // the types of the parameters, each argument is checked after it is generated
+    data->base = ruyi_vector_length(context->part_values);
     for (i = 0; i < len; i++) {
-        ast_arg = ruyi_ast_get_child(ast_arg_list, i);
-        if ((err = gen_stmt(context, ast_arg, &arg_out, NULL)) != NULL) {
-            return err;
-        }
-        if (arg_out.ir_type !=  func.parameter_types[i].ir_type) {
-            ruyi_unicode_string_encode_utf8_n(name, temp_name, NAME_BUF_LENGTH-1);
-            return ruyi_error_misc("the argument %d's type was not matched when invoke method: %s", i, temp_name);
-        }
+        ruyi_vector_add(context->part_values, ruyi_value_uint32(func.parameter_types[i].ir_type));
+    }
+    //  the args order is Left to Right
+    ruyi_ast_walker_set_parts(frame, len);
+    return NULL;
+}
+
+static
+ruyi_error* gen_check_argument(ruyi_cg_body_context *context, ruyi_ast_walk_frame *frame, UINT32 i) {
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_symbol name;
+    ruyi_value value;
+    char temp_name[NAME_BUF_LENGTH];
+    ruyi_vector_get(context->part_values, data->base + i, &value);
+    if (data->left_type.ir_type != (ruyi_ir_type)value.data.uint32_value) {
+        name = ruyi_ast_tree_symbol(context->tree, ruyi_ast_tree_get_child(context->tree, frame->id, 0));
+        ruyi_unicode_string_encode_utf8_n(ruyi_symbol_str(name), temp_name, NAME_BUF_LENGTH-1);
+        return ruyi_error_misc("the argument %d's type was not matched when invoke method: %s", i, temp_name);
+    }
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_function_invocation_part(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id ast_func_invoce_tail = ruyi_ast_tree_get_child(context->tree, frame->id, 1);
+    ruyi_ast_id ast_arg_list = ruyi_ast_tree_get_child(context->tree, ast_func_invoce_tail, 0);
+    ruyi_error *err;
+    if (frame->child > 0 && (err = gen_check_argument(context, frame, frame->child - 1)) != NULL) {
+        return err;
     }
-    ruyi_ins_codes_add(context->codes, Ruyi_ir_Invokesp, func.index);
+    gen_walk_set_part(walker, child_frame, ruyi_ast_tree_get_child(context->tree, ast_arg_list, frame->child), &data->left_type, NULL);
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_function_invocation_leave(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_error *err;
+    (void)child_frame;
+    if (frame->child_count > 0 && (err = gen_check_argument(context, frame, frame->child_count - 1)) != NULL) {
+        return err;
+    }
+    gen_drop_part_values(context, data->base);
+    ruyi_ins_codes_add(context->codes, Ruyi_ir_Invokesp, data->index);
     return NULL;
 }
 
@@ -1408,56 +1466,61 @@ static void proccess_loop_end(ruyi_cg_body_context *context, UINT32 index_for_lo
 }
 
 static
-ruyi_error* gen_for_3_parts_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
-    ruyi_error* err;
-    ruyi_ast *ast_for_three_parts = ruyi_ast_get_child(ast_stmt, 0);
-    ruyi_ast *ast_for_body;
-    ruyi_ast *ast_for_init;
-    ruyi_ast *ast_expression;
-    ruyi_ast *ast_for_update;
-    ruyi_ast *ast_temp;
-    UINT32 i, len;
-    UINT32 index_for_loop_start;
-    assert(ast_for_three_parts->type == Ruyi_at_for_3_parts_header);
-    ast_for_init = ruyi_ast_get_child(ast_for_three_parts, 0);
-    ast_expression = ruyi_ast_get_child(ast_for_three_parts, 1);
-    ast_for_update = ruyi_ast_get_child(ast_for_three_parts, 2);
-    ast_for_body = ruyi_ast_get_child(ast_stmt, 1);
+ruyi_error* gen_walk_for_3_parts_stmt_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_ast_id ast_for_three_parts = ruyi_ast_tree_get_child(context->tree, frame->id, 0);
+    ruyi_ast_id ast_for_init;
+    ruyi_ast_id ast_for_update;
+    (void)child_frame;
+    assert(ruyi_ast_tree_type(context->tree, ast_for_three_parts) == Ruyi_at_for_3_parts_header);
+    ast_for_init = ruyi_ast_tree_get_child(context->tree, ast_for_three_parts, 0);
+    ast_for_update = ruyi_ast_tree_get_child(context->tree, ast_for_three_parts, 2);
     
-    assert(ast_for_init->type == Ruyi_at_expr_statement_list);
+    assert(ruyi_ast_tree_type(context->tree, ast_for_init) == Ruyi_at_expr_statement_list);
     
     proccess_loop_begin(context);
     
     // for init part variable define scope can be accessed by body
     ruyi_symtab_function_scope_enter(context->func->func_symtab_scope);
-    // init for
-    len = ruyi_ast_child_length(ast_for_init);
-    for (i = 0; i < len; i++) {
-        ast_temp = ruyi_ast_get_child(ast_for_init, i);
-        if ((err = gen_stmt(context, ast_temp, NULL, NULL)) != NULL) {
-            return err;
-        }
-    }
-    index_for_loop_start = context->codes->len;
-    // body
-    if ((err = gen_stmt(context, ast_for_body, NULL, NULL)) != NULL) {
-        return err;
-    }
-    // for update
-    len = ruyi_ast_child_length(ast_for_update);
-    for (i = 0; i < len; i++) {
-        ast_temp = ruyi_ast_get_child(ast_for_update, i);
-        if ((err = gen_stmt(context, ast_temp, NULL, NULL)) != NULL) {
-            return err;
-        }
-    }
-    // for condition expression
-    if ((err = gen_stmt(context, ast_expression, NULL, NULL)) != NULL) {
-        return err;
+    // init for, body, for update and for condition expression
+    ruyi_ast_walker_set_parts(frame, ruyi_ast_tree_child_length(context->tree, ast_for_init) + 1 +
+                              ruyi_ast_tree_child_length(context->tree, ast_for_update) + 1);
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_for_3_parts_stmt_part(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id ast_for_three_parts = ruyi_ast_tree_get_child(context->tree, frame->id, 0);
+    ruyi_ast_id ast_for_init = ruyi_ast_tree_get_child(context->tree, ast_for_three_parts, 0);
+    ruyi_ast_id ast_for_update = ruyi_ast_tree_get_child(context->tree, ast_for_three_parts, 2);
+    UINT32 init_len = ruyi_ast_tree_child_length(context->tree, ast_for_init);
+    UINT32 i = frame->child;
+    ruyi_ast_id ast_temp;
+    if (i < init_len) {
+        ast_temp = ruyi_ast_tree_get_child(context->tree, ast_for_init, i);
+    } else if (i == init_len) {
+        // body
+        data->index = context->codes->len;
+        ast_temp = ruyi_ast_tree_get_child(context->tree, frame->id, 1);
+    } else if (i < frame->child_count - 1) {
+        ast_temp = ruyi_ast_tree_get_child(context->tree, ast_for_update, i - init_len - 1);
+    } else {
+        ast_temp = ruyi_ast_tree_get_child(context->tree, ast_for_three_parts, 1);
     }
-    ruyi_ins_codes_add(context->codes, Ruyi_ir_Jtrue, index_for_loop_start);
+    gen_walk_set_part(walker, child_frame, ast_temp, NULL, NULL);
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_for_3_parts_stmt_leave(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    (void)child_frame;
+    ruyi_ins_codes_add(context->codes, Ruyi_ir_Jtrue, data->index);
     // end of for
-    proccess_loop_end(context, index_for_loop_start);
+    proccess_loop_end(context, data->index);
     ruyi_symtab_function_scope_leave(context->func->func_symtab_scope);
     return NULL;
 }
@@ -1478,7 +1541,7 @@ ruyi_error* gen_bool(ruyi_cg_body_context *context, BOOL value, ruyi_symtab_type
 
 
 static
-ruyi_error* gen_break_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
+ruyi_error* gen_break_stmt(ruyi_cg_body_context *context, ruyi_ast_id ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
     UINT32 index;
     index = ruyi_ins_codes_add(context->codes, Ruyi_ir_Jmp, 0);
     ruyi_cg_body_context_add_index(context->break_index_stack, index);
@@ -1486,7 +1549,7 @@ ruyi_error* gen_break_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ru
 }
 
 static
-ruyi_error* gen_continue_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
+ruyi_error* gen_continue_stmt(ruyi_cg_body_context *context, ruyi_ast_id ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
     UINT32 index;
     index = ruyi_ins_codes_add(context->codes, Ruyi_ir_Jmp, 0);
     ruyi_cg_body_context_add_index(context->continue_index_stack, index);
@@ -1513,18 +1576,15 @@ static void push_integer(ruyi_cg_body_context *context, INT64 value) {
 }
 
 static
-ruyi_error* gen_array_creation_with_init(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
+ruyi_error* gen_walk_array_creation_with_init_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
     ruyi_error* err;
-    ruyi_ast *array_type = ruyi_ast_get_child(ast_stmt, 0);
-    ruyi_ast *ast_expr;
-    UINT32 ast_child_len = ruyi_ast_child_length(ast_stmt);
-    UINT32 i;
-    // TODO -------
-    ruyi_symtab_type the_type;
-    ruyi_symtab_type array_item_type;
-    UINT32 array_len = ast_child_len - 1;
+    ruyi_ast_id array_type = ruyi_ast_tree_get_child(context->tree, frame->id, 0);
+    UINT32 array_len = frame->child_count - 1;
+    (void)child_frame;
     // TODO in handle() array_item_type may has mem_alloc, please free it when array_item_type destroyed !!!
-    if ((err = handle_type(array_type, &array_item_type)) != NULL) {
+    if ((err = handle_type(context->tree, array_type, &data->right_type)) != NULL) {
         return err;
     }
 
@@ -1541,58 +1601,47 @@ ruyi_error* gen_array_creation_with_init(ruyi_cg_body_context *context, ruyi_ast
     // new array
     
     // init item-values
-    for (i = 1; i < ast_child_len; i++) {
-        ast_expr = ruyi_ast_get_child(ast_stmt, i);
-        // item
-        if ((err = gen_stmt(context, ast_expr, &the_type, &array_item_type)) != NULL) {
-            return err;
-        }
-    }
-    
-    
-    
-    
+    ruyi_ast_walker_set_parts(frame, array_len);
     return NULL;
 }
 
 static
-ruyi_error* gen_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
-    switch (ast_stmt->type) {
-        case Ruyi_at_return_statement:
-            return gen_return_stmt(context, ast_stmt, out_type);
-        case Ruyi_at_additive_expression:
-            return gen_additive_expression(context, ast_stmt, out_type, expect_type);
-        case Ruyi_at_multiplicative_expression:
-            return gen_multiplicative_expression(context, ast_stmt, out_type, expect_type);
+ruyi_error* gen_walk_array_creation_with_init_part(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    // item
+    gen_walk_set_part(walker, child_frame, ruyi_ast_tree_get_child(context->tree, frame->id, frame->child + 1), &data->left_type, &data->right_type);
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_skip(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    // nodes not generated, e.g. the operators of expressions
+    (void)walker;
+    (void)child_frame;
+    ruyi_ast_walker_skip_children(frame);
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_stmt(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id ast_stmt = frame->id;
+    (void)child_frame;
+    ruyi_ast_walker_skip_children(frame);
+    switch (frame->type) {
         case Ruyi_at_name:
             // load from variable name
-            return gen_load_from_variable_name(context, (const ruyi_unicode_string *)ast_stmt->data.ptr_value, out_type, expect_type);
+            return gen_load_from_variable_name(context, ruyi_ast_tree_symbol(context->tree, ast_stmt), data->out_type, data->expect_type);
         case Ruyi_at_integer:
-            return gen_integer(context, ast_stmt->data.int32_value, out_type, expect_type);
-        case Ruyi_at_var_declaration:
-            return gen_var_declaration(context, ast_stmt, out_type, expect_type);
-        case Ruyi_at_while_statement:
-            return gen_while_stmt(context, ast_stmt, out_type, expect_type);
-        case Ruyi_at_if_statement:
-            return gen_if_stmt(context, ast_stmt, out_type, expect_type);
-        case Ruyi_at_relational_expression:
-            return gen_relational_expression(context, ast_stmt, out_type, expect_type);
-        case Ruyi_at_block_statements:
-            return gen_block_statements(context, ast_stmt, out_type, expect_type);
-        case Ruyi_at_left_hand_side_expression:
-            return gen_left_hand_side_expression(context, ast_stmt, out_type, expect_type);
-        case Ruyi_at_function_invocation:
-            return gen_function_invocation(context, ast_stmt, out_type, expect_type);
-        case Ruyi_at_for_3_parts_statement:
-            return gen_for_3_parts_stmt(context, ast_stmt, out_type, expect_type);
+            return gen_integer(context, (UINT32)ruyi_ast_tree_int_value(context->tree, ast_stmt), data->out_type, data->expect_type);
         case Ruyi_at_bool:
-            return gen_bool(context, (BOOL)ast_stmt->data.int32_value, out_type, expect_type);
+            return gen_bool(context, (BOOL)ruyi_ast_tree_int_value(context->tree, ast_stmt), data->out_type, data->expect_type);
         case Ruyi_at_break_statement:
-            return gen_break_stmt(context, ast_stmt, out_type, expect_type);
+            return gen_break_stmt(context, ast_stmt, data->out_type, data->expect_type);
         case Ruyi_at_continue_statement:
-            return gen_continue_stmt(context, ast_stmt, out_type, expect_type);
-        case Ruyi_at_array_creation_with_init:
-            return gen_array_creation_with_init(context, ast_stmt, out_type, expect_type);
+            return gen_continue_stmt(context, ast_stmt, data->out_type, data->expect_type);
         default:
             break;
     }
@@ -1600,15 +1649,172 @@ ruyi_error* gen_stmt(ruyi_cg_body_context *context, ruyi_ast *ast_stmt, ruyi_sym
 }
 
 static
-ruyi_error* gen_func_body(ruyi_cg_body_context *context, ruyi_ast *ast_body) {
+ruyi_error* gen_walk_block_statements_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    (void)frame;
+    (void)child_frame;
+    ruyi_symtab_function_scope_enter(context->func->func_symtab_scope);
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_block_statement(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_cg_walk_data *child_data = (ruyi_cg_walk_data*)child_frame->data;
+    (void)walker;
+    child_data->out_type = data->out_type;
+    child_data->expect_type = data->expect_type;
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_block_statements_leave(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    (void)frame;
+    (void)child_frame;
+    ruyi_symtab_function_scope_leave(context->func->func_symtab_scope);
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_binary_expression_enter(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    (void)walker;
+    (void)child_frame;
+    // left, operator and right
+    assert(3 == frame->child_count);
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_binary_operand(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_cg_walk_data *child_data = (ruyi_cg_walk_data*)child_frame->data;
+    (void)walker;
+    if (frame->child == 0) {
+        child_data->out_type = &data->left_type;
+        // only an additive expression passes the type expected to its left
+        child_data->expect_type = frame->type == Ruyi_at_additive_expression ? data->expect_type : NULL;
+    } else if (frame->child == 2) {
+        child_data->out_type = &data->right_type;
+        child_data->expect_type = &data->left_type;
+    }
+    return NULL;
+}
+
+static
+ruyi_error* gen_walk_additive_expression(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id op = ruyi_ast_tree_get_child(context->tree, frame->id, 1);
+    const ruyi_ast_type ops[] = {Ruyi_at_op_add, Ruyi_at_op_sub};
+    const ruyi_ir_ins int64_ins[] = {Ruyi_ir_Iadd, Ruyi_ir_Isub};
+    const ruyi_ir_ins double_ins[] = {Ruyi_ir_Fadd, Ruyi_ir_Fsub};
+    (void)child_frame;
+    return gen_binary_expr_with_cast(&data->left_type, &data->right_type, data->out_type, context->tree, op, context->codes, ops, int64_ins, double_ins, sizeof(ops)/sizeof(ops[0]));
+}
+
+static
+ruyi_error* gen_walk_multiplicative_expression(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id op = ruyi_ast_tree_get_child(context->tree, frame->id, 1);
+    const ruyi_ast_type ops[] = {Ruyi_at_op_mul, Ruyi_at_op_div, Ruyi_at_op_mod};
+    const ruyi_ir_ins int64_ins[] = {Ruyi_ir_Imul, Ruyi_ir_Idiv, Ruyi_ir_Imod};
+    const ruyi_ir_ins double_ins[] = {Ruyi_ir_Fadd, Ruyi_ir_Fsub, 0};
+    (void)child_frame;
+    return gen_binary_expr_with_cast(&data->left_type, &data->right_type, data->out_type, context->tree, op, context->codes, ops, int64_ins, double_ins, sizeof(ops)/sizeof(ops[0]));
+}
+
+static
+ruyi_error* gen_walk_relational_expression(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    ruyi_cg_body_context *context = (ruyi_cg_body_context*)ruyi_ast_walker_context(walker);
+    ruyi_cg_walk_data *data = (ruyi_cg_walk_data*)frame->data;
+    ruyi_ast_id op = ruyi_ast_tree_get_child(context->tree, frame->id, 1);
+    const ruyi_ast_type ops[] = {Ruyi_at_op_lt, Ruyi_at_op_lte, Ruyi_at_op_gt, Ruyi_at_op_gte};
+    const ruyi_ir_ins int64_ins[] = {Ruyi_ir_Icmp_lt, Ruyi_ir_Icmp_lte, Ruyi_ir_Icmp_gt, Ruyi_ir_Icmp_gte};
+    const ruyi_ir_ins double_ins[] = {Ruyi_ir_Fcmp_lt, Ruyi_ir_Fcmp_lte, Ruyi_ir_Fcmp_gt, Ruyi_ir_Fcmp_gte};
+    (void)child_frame;
+    if (ruyi_ast_tree_type(context->tree, op) == Ruyi_at_op_instanceof) {
+        return ruyi_error_misc("unsupport operator 'instanceof' at this version!");
+    } else{
+        return gen_binary_expr_with_cast(&data->left_type, &data->right_type, data->out_type, context->tree, op, context->codes, ops, int64_ins, double_ins, sizeof(ops)/sizeof(ops[0]));
+    }
+}
+
+static const ruyi_ast_visitor gen_stmt_visitor = {
+    .pre = {
+        [Ruyi_at_return_statement] = gen_walk_return_stmt_enter,
+        [Ruyi_at_additive_expression] = gen_walk_binary_expression_enter,
+        [Ruyi_at_multiplicative_expression] = gen_walk_binary_expression_enter,
+        [Ruyi_at_name] = gen_walk_stmt,
+        [Ruyi_at_integer] = gen_walk_stmt,
+        [Ruyi_at_var_declaration] = gen_walk_var_declaration_enter,
+        [Ruyi_at_while_statement] = gen_walk_while_stmt_enter,
+        [Ruyi_at_if_statement] = gen_walk_if_stmt_enter,
+        [Ruyi_at_elseif_statement] = gen_walk_elseif_stmt_enter,
+        [Ruyi_at_else_statement] = gen_walk_else_stmt_enter,
+        [Ruyi_at_relational_expression] = gen_walk_binary_expression_enter,
+        [Ruyi_at_block_statements] = gen_walk_block_statements_enter,
+        [Ruyi_at_left_hand_side_expression] = gen_walk_left_hand_side_expression_enter,
+        [Ruyi_at_function_invocation] = gen_walk_function_invocation_enter,
+        [Ruyi_at_for_3_parts_statement] = gen_walk_for_3_parts_stmt_enter,
+        [Ruyi_at_bool] = gen_walk_stmt,
+        [Ruyi_at_break_statement] = gen_walk_stmt,
+        [Ruyi_at_continue_statement] = gen_walk_stmt,
+        [Ruyi_at_array_creation_with_init] = gen_walk_array_creation_with_init_enter,
+    },
+    .child = {
+        [Ruyi_at_return_statement] = gen_walk_return_stmt_part,
+        [Ruyi_at_additive_expression] = gen_walk_binary_operand,
+        [Ruyi_at_multiplicative_expression] = gen_walk_binary_operand,
+        [Ruyi_at_relational_expression] = gen_walk_binary_operand,
+        [Ruyi_at_block_statements] = gen_walk_block_statement,
+        [Ruyi_at_var_declaration] = gen_walk_var_declaration_part,
+        [Ruyi_at_while_statement] = gen_walk_expr_and_body_part,
+        [Ruyi_at_if_statement] = gen_walk_if_stmt_part,
+        [Ruyi_at_elseif_statement] = gen_walk_expr_and_body_part,
+        [Ruyi_at_left_hand_side_expression] = gen_walk_left_hand_side_expression_part,
+        [Ruyi_at_function_invocation] = gen_walk_function_invocation_part,
+        [Ruyi_at_for_3_parts_statement] = gen_walk_for_3_parts_stmt_part,
+        [Ruyi_at_array_creation_with_init] = gen_walk_array_creation_with_init_part,
+    },
+    .post = {
+        [Ruyi_at_return_statement] = gen_walk_return_stmt_leave,
+        [Ruyi_at_additive_expression] = gen_walk_additive_expression,
+        [Ruyi_at_multiplicative_expression] = gen_walk_multiplicative_expression,
+        [Ruyi_at_relational_expression] = gen_walk_relational_expression,
+        [Ruyi_at_block_statements] = gen_walk_block_statements_leave,
+        [Ruyi_at_var_declaration] = gen_walk_var_declaration_leave,
+        [Ruyi_at_while_statement] = gen_walk_while_stmt_leave,
+        [Ruyi_at_if_statement] = gen_walk_if_stmt_leave,
+        [Ruyi_at_elseif_statement] = gen_walk_elseif_stmt_leave,
+        [Ruyi_at_left_hand_side_expression] = gen_walk_left_hand_side_expression_leave,
+        [Ruyi_at_function_invocation] = gen_walk_function_invocation_leave,
+        [Ruyi_at_for_3_parts_statement] = gen_walk_for_3_parts_stmt_leave,
+    },
+    .pre_default = gen_walk_skip,
+    .data_size = sizeof(ruyi_cg_walk_data),
+};
+
+static
+ruyi_error* gen_stmt(ruyi_cg_body_context *context, ruyi_ast_id ast_stmt, ruyi_symtab_type *out_type, const ruyi_symtab_type *expect_type) {
+    ruyi_cg_walk_data data;
+    memset(&data, 0, sizeof(data));
+    data.out_type = out_type;
+    data.expect_type = expect_type;
+    return ruyi_ast_walk_tree(context->walker, context->tree, ast_stmt, &data);
+}
+
+static
+ruyi_error* gen_func_body(ruyi_cg_body_context *context, ruyi_ast_id ast_body) {
     ruyi_error* err;
     UINT32 len, i;
-    ruyi_ast *ast_stmt;
+    ruyi_ast_id ast_stmt;
     assert(ast_body);
-    assert(Ruyi_at_block_statements == ast_body->type);
-    len = ruyi_ast_child_length(ast_body);
+    assert(Ruyi_at_block_statements == ruyi_ast_tree_type(context->tree, ast_body));
+    len = ruyi_ast_tree_child_length(context->tree, ast_body);
     for (i = 0; i < len; i++) {
-        ast_stmt = ruyi_ast_get_child(ast_body, i);
+        ast_stmt = ruyi_ast_tree_get_child(context->tree, ast_body, i);
         if ((err = gen_stmt(context, ast_stmt, NULL, NULL)) != NULL) {
             goto gen_func_body_error;
         }
@@ -1619,62 +1825,63 @@ gen_func_body_error:
 }
 
 static
-ruyi_error* gen_global_func_define(ruyi_symtab *symtab, const ruyi_ast *ast, ruyi_vector *global_functions) {
+ruyi_error* gen_global_func_define(ruyi_symtab *symtab, const ruyi_ast_tree *tree, ruyi_ast_id ast, ruyi_vector *global_functions) {
     ruyi_error *err = NULL;
-    ruyi_ast *ast_name = NULL;
-    ruyi_ast *ast_type = NULL;
-    ruyi_ast *ast_formal_params;
-    ruyi_ast *ast_return_type;
-    ruyi_ast *ast_body;
-    ruyi_ast *temp;
+    ruyi_ast_id ast_name = RUYI_AST_NONE;
+    ruyi_ast_id ast_type = RUYI_AST_NONE;
+    ruyi_ast_id ast_formal_params;
+    ruyi_ast_id ast_return_type;
+    ruyi_ast_id ast_body;
+    ruyi_ast_id temp;
     ruyi_symtab_type the_type;
     ruyi_symtab_function_define *func = NULL;
     UINT32 i, parameter_len, return_len;
     ruyi_symtab_variable var;
     ruyi_cg_body_context *context = NULL;
+    ruyi_ast_tree *body_tree = NULL;
     ruyi_symtab_type paramter_types[RUYI_FUNC_MAX_PARAMETER_COUNT];
     ruyi_symtab_type return_types[RUYI_FUNC_MAX_RETURN_COUNT];
 
     assert(ast);
-    if (Ruyi_at_function_declaration == ast->type) {
-        ast_name = ruyi_ast_get_child(ast, 0);
-        ast_formal_params = ruyi_ast_get_child(ast, 1);
-        ast_return_type = ruyi_ast_get_child(ast, 2);
-        ast_body = ruyi_ast_get_child(ast, 3);
-    } else if (Ruyi_at_anonymous_function_declaration == ast->type) {
-        ast_formal_params = ruyi_ast_get_child(ast, 0);
-        ast_return_type = ruyi_ast_get_child(ast, 1);
-        ast_body = ruyi_ast_get_child(ast, 2);
+    if (Ruyi_at_function_declaration == ruyi_ast_tree_type(tree, ast)) {
+        ast_name = ruyi_ast_tree_get_child(tree, ast, 0);
+        ast_formal_params = ruyi_ast_tree_get_child(tree, ast, 1);
+        ast_return_type = ruyi_ast_tree_get_child(tree, ast, 2);
+        ast_body = ruyi_ast_tree_get_child(tree, ast, 3);
+    } else if (Ruyi_at_anonymous_function_declaration == ruyi_ast_tree_type(tree, ast)) {
+        ast_formal_params = ruyi_ast_tree_get_child(tree, ast, 0);
+        ast_return_type = ruyi_ast_tree_get_child(tree, ast, 1);
+        ast_body = ruyi_ast_tree_get_child(tree, ast, 2);
     } else {
         err = ruyi_error_misc("the ast is not a function define.");
         goto gen_global_func_define_on_error;
     }
-    if (ruyi_ast_child_length(ast_formal_params) > RUYI_MAX_UINT16) {
+    if (ruyi_ast_tree_child_length(tree, ast_formal_params) > RUYI_MAX_UINT16) {
         err = ruyi_error_misc("too many function formal params count.");
         goto gen_global_func_define_on_error;
     }
     if (ast_name) {
-        if ((err = ruyi_symtab_function_create(symtab, (ruyi_unicode_string*)ast_name->data.ptr_value, &func)) != NULL) {
+        if ((err = ruyi_symtab_function_create(symtab, ruyi_ast_tree_symbol(tree, ast_name), &func)) != NULL) {
             goto gen_global_func_define_on_error;
         }
     } else {
-        if ((err = ruyi_symtab_function_create(symtab, NULL, &func)) != NULL) {
+        if ((err = ruyi_symtab_function_create(symtab, RUYI_SYMBOL_NONE, &func)) != NULL) {
             goto gen_global_func_define_on_error;
         }
     }
     // return types
-    if (ast_return_type == NULL) {
+    if (ast_return_type == RUYI_AST_NONE) {
         // leave return type is null
         return_len = 0;
     } else {
-        return_len = ruyi_ast_child_length(ast_return_type);
+        return_len = ruyi_ast_tree_child_length(tree, ast_return_type);
         if (return_len > RUYI_FUNC_MAX_RETURN_COUNT) {
             err = ruyi_error_misc("too many function return values.");
             goto gen_global_func_define_on_error;
         }
         for (i = 0; i < return_len; i++) {
-            temp = ruyi_ast_get_child(ast_return_type, i);
-            if ((err = handle_type(temp, &the_type)) != NULL) {
+            temp = ruyi_ast_tree_get_child(tree, ast_return_type, i);
+            if ((err = handle_type(tree, temp, &the_type)) != NULL) {
                 goto gen_global_func_define_on_error;
             }
             return_types[i] = the_type;
@@ -1688,19 +1895,19 @@ ruyi_error* gen_global_func_define(ruyi_symtab *symtab, const ruyi_ast *ast, ruy
     }
     
     // parameters
-    parameter_len = ruyi_ast_child_length(ast_formal_params);
+    parameter_len = ruyi_ast_tree_child_length(tree, ast_formal_params);
     if (parameter_len > RUYI_FUNC_MAX_PARAMETER_COUNT) {
         err = ruyi_error_misc("too many function formal parameters.");
         goto gen_global_func_define_on_error;
     }
     for (i = 0; i < parameter_len; i++) {
-        temp = ruyi_ast_get_child(ast_formal_params, i);
-        ast_name = ruyi_ast_get_child(temp, 0);
-        ast_type = ruyi_ast_get_child(temp, 1);
-        if ((err = handle_type(ast_type, &the_type)) != NULL) {
+        temp = ruyi_ast_tree_get_child(tree, ast_formal_params, i);
+        ast_name = ruyi_ast_tree_get_child(tree, temp, 0);
+        ast_type = ruyi_ast_tree_get_child(tree, temp, 1);
+        if ((err = handle_type(tree, ast_type, &the_type)) != NULL) {
             goto gen_global_func_define_on_error;
         }
-        var.name = (ruyi_unicode_string*)ast_name->data.ptr_value;
+        var.name = ruyi_ast_tree_symbol(tree, ast_name);
         var.type = the_type;
         paramter_types[i] = var.type;
         ruyi_symtab_function_add_arg(func, &var);
@@ -1711,7 +1918,15 @@ ruyi_error* gen_global_func_define(ruyi_symtab *symtab, const ruyi_ast *ast, ruy
         goto gen_global_func_define_on_error;
     }
     // func body
-    context = ruyi_cg_body_context_create(symtab, func);
+    if (ruyi_ast_tree_data_type(tree, ast_body) == Ruyi_adt_lazy_body) {
+        // the body is parsed when it is generated, into a tree of its own
+        if ((err = ruyi_parse_lazy_body_tree(tree, ast_body, &body_tree)) != NULL) {
+            goto gen_global_func_define_on_error;
+        }
+        tree = body_tree;
+        ast_body = ruyi_ast_tree_root(body_tree);
+    }
+    context = ruyi_cg_body_context_create(symtab, tree, func);
     if ((err = gen_func_body(context, ast_body)) != NULL) {
         goto gen_global_func_define_on_error;
     }
@@ -1733,6 +1948,9 @@ gen_global_func_define_on_error:
     if (context) {
         ruyi_cg_body_context_destroy(context);
     }
+    if (body_tree) {
+        ruyi_ast_tree_destroy(body_tree);
+    }
     return err;
 }
 
@@ -1755,10 +1973,10 @@ BYTE* create_bytes_data_from_unicode(const ruyi_unicode_string *str, UINT32 *out
 }
 
 static
-ruyi_error* gen_global(ruyi_symtab *symtab, const ruyi_ast *ast, ruyi_cg_file *ir_file) {
+ruyi_error* gen_global(ruyi_symtab *symtab, const ruyi_ast_tree *tree, ruyi_ast_id ast, ruyi_cg_file *ir_file) {
     ruyi_error *err = NULL;
     UINT32 len, i;
-    ruyi_ast *global_ast;
+    ruyi_ast_id global_ast;
     ruyi_vector *global_vars = NULL;    // the item's type is 'ruyi_cg_file_global_var'
     ruyi_vector *global_functions = NULL;
     ruyi_vector *global_classes = NULL;
@@ -1772,22 +1990,22 @@ ruyi_error* gen_global(ruyi_symtab *symtab, const ruyi_ast *ast, ruyi_cg_file *i
     global_vars = ruyi_vector_create();
     global_functions = ruyi_vector_create();
     global_classes = ruyi_vector_create();
-    len = ruyi_ast_child_length(ast);
+    len = ruyi_ast_tree_child_length(tree, ast);
     do {
         for (i = 0; i < len; i++) {
-            global_ast = ruyi_ast_get_child(ast, i);
+            global_ast = ruyi_ast_tree_get_child(tree, ast, i);
             if (!global_ast) {
                 err = ruyi_error_misc("global define can not be empty");
                 goto gen_global_on_error;
             }
-            switch (global_ast->type) {
+            switch (ruyi_ast_tree_type(tree, global_ast)) {
                 case Ruyi_at_var_declaration:
-                    if ((err = gen_global_var_define(symtab, global_ast, global_vars)) != NULL) {
+                    if ((err = gen_global_var_define(symtab, tree, global_ast, global_vars)) != NULL) {
                         goto gen_global_on_error;
                     }
                     break;
                 case Ruyi_at_function_declaration:
-                    if ((err = gen_global_func_define(symtab, global_ast, global_functions)) != NULL) {
+                    if ((err = gen_global_func_define(symtab, tree, global_ast, global_functions)) != NULL) {
                         goto gen_global_on_error;
                     }
                     break;
@@ -1888,33 +2106,34 @@ gen_global_on_error:
     return err;
 }
 
-ruyi_error* ruyi_cg_generate(const ruyi_ast *ast, ruyi_cg_file **out_ir_file) {
+ruyi_error* ruyi_cg_generate_tree(const ruyi_ast_tree *tree, ruyi_cg_file **out_ir_file) {
     // TODO deal for bytes order
     ruyi_error *err;
     ruyi_cg_file *file = NULL;
     ruyi_unicode_string *name;
     ruyi_symtab *symtab = NULL;
-    ruyi_ast *ast_package, *ast_import, *ast_global;
-    assert(ast);
+    ruyi_ast_id ast, ast_package, ast_import, ast_global;
+    assert(tree);
+    ast = ruyi_ast_tree_root(tree);
     // TODO here use 'test1' name for test !
     name = ruyi_unicode_string_init_from_utf8("test1", 0);
     file = create_ruyi_cg_file(name);
     ruyi_unicode_string_destroy(name);
-    if (Ruyi_at_root != ast->type) {
+    if (Ruyi_at_root != ruyi_ast_tree_type(tree, ast)) {
         err = ruyi_error_misc("need root ast");
         goto ruyi_cg_generate_on_error;
     }
     symtab = ruyi_symtab_create();
-    ast_package = ruyi_ast_get_child(ast, 0);
-    ast_import = ruyi_ast_get_child(ast, 1);
-    ast_global = ruyi_ast_get_child(ast, 2);
-    if ((err = gen_package(symtab, ast_package, file)) != NULL) {
+    ast_package = ruyi_ast_tree_get_child(tree, ast, 0);
+    ast_import = ruyi_ast_tree_get_child(tree, ast, 1);
+    ast_global = ruyi_ast_tree_get_child(tree, ast, 2);
+    if ((err = gen_package(symtab, tree, ast_package, file)) != NULL) {
         goto ruyi_cg_generate_on_error;
     }
-    if ((err = gen_import(symtab, ast_import, file)) != NULL) {
+    if ((err = gen_import(symtab, tree, ast_import, file)) != NULL) {
         goto ruyi_cg_generate_on_error;
     }
-    if ((err = gen_global(symtab, ast_global, file)) != NULL) {
+    if ((err = gen_global(symtab, tree, ast_global, file)) != NULL) {
         goto ruyi_cg_generate_on_error;
     }
     *out_ir_file = file;
@@ -1929,3 +2148,13 @@ ruyi_cg_generate_on_error:
     *out_ir_file = NULL;
     return err;
 }
+
+ruyi_error* ruyi_cg_generate(const ruyi_ast *ast, ruyi_cg_file **out_ir_file) {
+    ruyi_error *err;
+    ruyi_ast_tree *tree;
+    assert(ast);
+    tree = ruyi_ast_tree_create(ast);
+    err = ruyi_cg_generate_tree(tree, out_ir_file);
+    ruyi_ast_tree_destroy(tree);
+    return err;
+}
@@ -20,7 +20,7 @@
 struct ruyi_cg_ir_writer_;
 
 typedef struct {
-    ruyi_unicode_string *name;
+    ruyi_symbol name;
     INT32 index;
     ruyi_ir_type return_type;
     UINT16 operand;
@@ -95,6 +95,14 @@ typedef struct {
 
 ruyi_error* ruyi_cg_generate(const ruyi_ast *ast, ruyi_cg_file **out_ir_file);
 
+/**
+ * Generate the ir of a flat tree, ruyi_cg_generate flattens its tree and calls it
+ * params:
+ * tree - the tree made by ruyi_parse_ast_tree or ruyi_ast_tree_create
+ * out_ir_file - receives the ir, release it by ruyi_cg_file_destroy
+ */
+ruyi_error* ruyi_cg_generate_tree(const ruyi_ast_tree *tree, ruyi_cg_file **out_ir_file);
+
 void ruyi_cg_file_destroy(ruyi_cg_file *ir_file);
 
 
@@ -13,23 +13,45 @@
 #include <string.h>
 #include "ruyi_mem.h"
 #include "ruyi_lexer.h"
+#include "ruyi_line_table.h"
 
 #define RUYI_ERROR_MESSAGE_BUF_SIZE 2048
 #define NAME_BUF_LENGTH 128
 
-ruyi_token_pos ruyi_token_pos_make(struct _ruyi_token* token) {
+ruyi_token_pos ruyi_token_pos_make(struct _ruyi_lexer_reader *reader, struct _ruyi_token* token) {
     ruyi_token_pos pos = {0};
     if (!token) {
         return pos;
     }
-    pos.column = token->column;
-    pos.line = token->line;
+    pos.lines = reader->lines;
+    pos.offset = token->offset;
     pos.width = token->size;
     return pos;
 }
 
-ruyi_error * ruyi_error_make(ruyi_error_type type, const char *message, struct _ruyi_token* token) {
-    return ruyi_error_make_by_pos(type, message, ruyi_token_pos_make(token));
+// the text is found only when an error is made, the reader keeps no text for each token
+static char* ruyi_error_token_text(const struct _ruyi_lexer_reader *reader, UINT32 offset, UINT32 size) {
+    char text[LEXER_TOKEN_TEXT_SIZE * 4 + 1];
+    char *copy;
+    UINT32 len;
+    if (size == 0) {
+        return NULL;
+    }
+    len = ruyi_lexer_reader_token_text(reader, offset, size, text, sizeof(text));
+    if (len == 0) {
+        return NULL;
+    }
+    copy = (char*)ruyi_mem_alloc(len + 1);
+    memcpy(copy, text, len + 1);
+    return copy;
+}
+
+ruyi_error * ruyi_error_make(ruyi_error_type type, const char *message, struct _ruyi_lexer_reader *reader, struct _ruyi_token* token) {
+    ruyi_error *err = ruyi_error_make_by_pos(type, message, ruyi_token_pos_make(reader, token));
+    if (token) {
+        err->text = ruyi_error_token_text(reader, token->offset, token->size);
+    }
+    return err;
 }
 
 
@@ -43,6 +65,7 @@ ruyi_error * ruyi_error_syntax(const char *format, ...) {
     err->line = 0;
     err->type = Ruyi_et_Syntax;
     err->width = 0;
+    err->text = NULL;
     if (format) {
         len = vsnprintf(buf, RUYI_ERROR_MESSAGE_BUF_SIZE, format, vargs);
         if (len < 0) {
@@ -72,6 +95,7 @@ ruyi_error * ruyi_error_misc(const char *format, ...) {
     err->line = 0;
     err->type = Ruyi_et_Misc;
     err->width = 0;
+    err->text = NULL;
     if (format) {
         len = vsnprintf(buf, RUYI_ERROR_MESSAGE_BUF_SIZE, format, vargs);
         if (len < 0) {
@@ -104,10 +128,16 @@ ruyi_error * ruyi_error_by_parser(struct _ruyi_lexer_reader * reader, const char
     char buf[RUYI_ERROR_MESSAGE_BUF_SIZE];
     ruyi_error * err = (ruyi_error *)ruyi_mem_alloc(sizeof(ruyi_error));
     va_start(vargs, format);
-    err->column = ts->column;
-    err->line = ts->line;
+    // the snapshot of no token has no size
+    if (ts->size > 0 && reader->lines) {
+        ruyi_line_table_position(reader->lines, ts->offset, &err->line, &err->column);
+    } else {
+        err->line = 0;
+        err->column = 0;
+    }
     err->type = Ruyi_et_Parser;
     err->width = ts->size;
+    err->text = ruyi_error_token_text(reader, ts->offset, ts->size);
     if (format) {
         len = vsnprintf(buf, RUYI_ERROR_MESSAGE_BUF_SIZE, format, vargs);
         if (len < 0) {
@@ -138,10 +168,15 @@ ruyi_error * ruyi_error_by_parser(struct _ruyi_lexer_reader * reader, const char
 ruyi_error * ruyi_error_make_by_pos(ruyi_error_type type, const char *message, ruyi_token_pos pos) {
     UINT32 len;
     ruyi_error * err = (ruyi_error *)ruyi_mem_alloc(sizeof(ruyi_error));
-    err->column = pos.column;
-    err->line = pos.line;
+    if (pos.lines) {
+        ruyi_line_table_position(pos.lines, pos.offset, &err->line, &err->column);
+    } else {
+        err->line = 0;
+        err->column = 0;
+    }
     err->type = type;
     err->width = pos.width;
+    err->text = NULL;
     if (message) {
         len = (UINT32)(strlen(message)) + 1;
         err->message = ruyi_mem_alloc(len);
@@ -157,5 +192,8 @@ void ruyi_error_destroy(ruyi_error * err) {
     if (err->message) {
         ruyi_mem_free(err->message);
     }
+    if (err->text) {
+        ruyi_mem_free(err->text);
+    }
     ruyi_mem_free(err);
 }
@@ -18,6 +18,7 @@ typedef enum {
 
 struct _ruyi_token;
 struct _ruyi_lexer_reader;
+struct _ruyi_line_table;
 
 typedef struct {
     UINT32 line;
@@ -25,19 +26,21 @@ typedef struct {
     UINT32 width;
     ruyi_error_type type;
     char *message;
+    char *text;     // utf-8 source text of the token of a parser error, NULL if it is not known
 } ruyi_error;
 
+// the line and column are found from the offset only when an error is made by the pos
 typedef struct {
-    UINT32 line;
-    UINT32 column;
+    const struct _ruyi_line_table *lines;  // NULL if there is no position
+    UINT32 offset;
     UINT32 width;
 } ruyi_token_pos;
 
-ruyi_token_pos ruyi_token_pos_make(struct _ruyi_token* token);
+ruyi_token_pos ruyi_token_pos_make(struct _ruyi_lexer_reader *reader, struct _ruyi_token* token);
 
 ruyi_error * ruyi_error_by_parser(struct _ruyi_lexer_reader * reader, const char *format, ...);
 
-ruyi_error * ruyi_error_make(ruyi_error_type type, const char *message, struct _ruyi_token* token);
+ruyi_error * ruyi_error_make(ruyi_error_type type, const char *message, struct _ruyi_lexer_reader *reader, struct _ruyi_token* token);
 
 ruyi_error * ruyi_error_make_by_pos(ruyi_error_type type, const char *message, ruyi_token_pos pos);
 
@@ -6,24 +6,371 @@
 //  Copyright © 2019 Songli Huang. All rights reserved.
 //
 
+// for fileno, pipe and poll, which -std=c99 does not declare
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "ruyi_io.h"
 #include "ruyi_mem.h"
 
 #include "ruyi_unicode.h"
 #include <string.h> // for memcpy
+#if defined(_WIN32)
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <pthread.h>
+#endif
 
-#define UNICODE_FILE_READ_BUF_SIZE 1024
 #define UNICODE_FILE_WRITE_BUF_SIZE 1024
-#define UNICODE_FILE_BUFF_SIZE UNICODE_FILE_READ_BUF_SIZE+6
+// bytes read from a Ruyi_tf_FILE at a time
+#define UNICODE_FILE_BLOCK_SIZE (256 * 1024)
+#define UNICODE_FILE_BLOCK_ALIGN 4096
+// room before a block for the incomplete utf-8 tail of the previous one, a utf-8 char takes 6 bytes at most
+#define UNICODE_FILE_BLOCK_HEAD_ROOM 8
+#define UNICODE_FILE_MAX_CHAR_BYTES 6
+
+typedef struct {
+    BYTE *raw;      // the allocated memory
+    BYTE *data;     // aligned, UNICODE_FILE_BLOCK_HEAD_ROOM bytes before it can be used
+    UINT32 length;
+    BOOL eof;
+    BOOL error;     // the read stopped by an error, not at the end of the file, eof is set too
+    BOOL filled;    // filled by the read ahead thread, not released by the decoder yet
+} ruyi_io_stream_block;
+
+struct ruyi_io_stream {
+    ruyi_file *fp;
+    ruyi_io_stream_block blocks[2];
+    UINT32 current;         // index of the block being decoded
+    const BYTE *cursor;     // next byte to decode
+    const BYTE *limit;
+    BOOL threaded;
+    BOOL error;             // the last block was ended by an error
+#if !defined(_WIN32)
+    int fd;
+    int wake[2];            // a pipe written by ruyi_io_stream_close, so a read waiting for input stops
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;    // a block is filled or released
+    BOOL stop;
+#endif
+};
+
+static void ruyi_io_stream_fill(ruyi_io_stream *stream, ruyi_io_stream_block *block) {
+    // fread only returns less at the end of file or an error, both end the stream
+    block->length = ruyi_file_read(stream->fp, block->data, UNICODE_FILE_BLOCK_SIZE);
+    block->eof = block->length < UNICODE_FILE_BLOCK_SIZE;
+    block->error = block->eof && ferror(stream->fp->dist.file);
+}
+
+#if !defined(_WIN32)
+/*
+ The read ahead thread reads the fd by read(2) instead of fread, and waits for the input by poll(2) with the wake pipe,
+ so it never holds the lock of the FILE and can be stopped by the wake pipe at any time, instead of being cancelled.
+ */
+static void ruyi_io_stream_fill_by_thread(ruyi_io_stream *stream, ruyi_io_stream_block *block) {
+    struct pollfd fds[2];
+    ssize_t read_count;
+    block->length = 0;
+    block->error = FALSE;
+    fds[0].fd = stream->fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = stream->wake[0];
+    fds[1].events = POLLIN;
+    while (block->length < UNICODE_FILE_BLOCK_SIZE) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            block->error = TRUE;
+            break;
+        }
+        if (fds[1].revents != 0) {
+            // closed, the block is never decoded
+            break;
+        }
+        if (fds[0].revents == 0) {
+            continue;
+        }
+        read_count = read(stream->fd, block->data + block->length, UNICODE_FILE_BLOCK_SIZE - block->length);
+        if (read_count > 0) {
+            block->length += (UINT32)read_count;
+        } else if (read_count == 0) {
+            break;
+        } else if (errno != EINTR && errno != EAGAIN) {
+            block->error = TRUE;
+            break;
+        }
+    }
+    block->eof = block->length < UNICODE_FILE_BLOCK_SIZE;
+}
+
+static void* ruyi_io_stream_read_ahead(void *arg) {
+    ruyi_io_stream *stream = (ruyi_io_stream*)arg;
+    ruyi_io_stream_block *block;
+    UINT32 index = 0;
+    for (;;) {
+        block = &stream->blocks[index];
+        pthread_mutex_lock(&stream->mutex);
+        while (block->filled && !stream->stop) {
+            pthread_cond_wait(&stream->cond, &stream->mutex);
+        }
+        if (stream->stop) {
+            pthread_mutex_unlock(&stream->mutex);
+            break;
+        }
+        pthread_mutex_unlock(&stream->mutex);
+
+        ruyi_io_stream_fill_by_thread(stream, block);
+
+        pthread_mutex_lock(&stream->mutex);
+        block->filled = TRUE;
+        pthread_cond_broadcast(&stream->cond);
+        pthread_mutex_unlock(&stream->mutex);
+        if (block->eof) {
+            break;
+        }
+        index = 1 - index;
+    }
+    return NULL;
+}
+#endif
+
+static ruyi_io_stream* ruyi_io_stream_open(ruyi_file *fp) {
+    ruyi_io_stream *stream = (ruyi_io_stream*)ruyi_mem_alloc(sizeof(ruyi_io_stream));
+    ruyi_io_stream_block *block;
+    UINT32 i;
+#if !defined(_WIN32)
+    struct stat st;
+    int fd = fileno(fp->dist.file);
+#endif
+    stream->fp = fp;
+    for (i = 0; i < 2; i++) {
+        block = &stream->blocks[i];
+        block->raw = (BYTE*)ruyi_mem_alloc(UNICODE_FILE_BLOCK_SIZE + UNICODE_FILE_BLOCK_ALIGN + UNICODE_FILE_BLOCK_HEAD_ROOM);
+        block->data = (BYTE*)(((size_t)block->raw + UNICODE_FILE_BLOCK_HEAD_ROOM + UNICODE_FILE_BLOCK_ALIGN - 1) & ~(size_t)(UNICODE_FILE_BLOCK_ALIGN - 1));
+        block->length = 0;
+        block->eof = FALSE;
+        block->error = FALSE;
+        block->filled = FALSE;
+    }
+    // the decoder starts with an empty block 1, so block 0 is the first one to read
+    stream->current = 1;
+    stream->blocks[1].filled = TRUE;
+    stream->cursor = stream->blocks[1].data;
+    stream->limit = stream->blocks[1].data;
+    stream->threaded = FALSE;
+    stream->error = FALSE;
+#if !defined(_WIN32)
+    if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        // the page cache reads ahead for regular files, a larger window is enough
+#if defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        return stream;
+    }
+    // pipes and terminals, read the next block while the current one is decoded,
+    // nothing else reads the FILE of a stream, so its buffer is empty and the fd is read where the FILE is
+    if (fd < 0 || pipe(stream->wake) != 0) {
+        return stream;
+    }
+    stream->fd = fd;
+    stream->stop = FALSE;
+    pthread_mutex_init(&stream->mutex, NULL);
+    pthread_cond_init(&stream->cond, NULL);
+    if (pthread_create(&stream->thread, NULL, ruyi_io_stream_read_ahead, stream) == 0) {
+        stream->threaded = TRUE;
+    } else {
+        pthread_cond_destroy(&stream->cond);
+        pthread_mutex_destroy(&stream->mutex);
+        close(stream->wake[0]);
+        close(stream->wake[1]);
+    }
+#endif
+    return stream;
+}
+
+static void ruyi_io_stream_close(ruyi_io_stream *stream) {
+    UINT32 i;
+#if !defined(_WIN32)
+    if (stream->threaded) {
+        pthread_mutex_lock(&stream->mutex);
+        stream->stop = TRUE;
+        pthread_cond_broadcast(&stream->cond);
+        pthread_mutex_unlock(&stream->mutex);
+        // the thread may be waiting for a pipe nobody writes, the wake pipe ends its poll
+        while (write(stream->wake[1], "", 1) < 0 && errno == EINTR) {
+        }
+        pthread_join(stream->thread, NULL);
+        pthread_cond_destroy(&stream->cond);
+        pthread_mutex_destroy(&stream->mutex);
+        close(stream->wake[0]);
+        close(stream->wake[1]);
+    }
+#endif
+    for (i = 0; i < 2; i++) {
+        ruyi_mem_free(stream->blocks[i].raw);
+    }
+    ruyi_mem_free(stream);
+}
+
+// switch to the other block, the undecoded tail is copied in front of it
+static BOOL ruyi_io_stream_next_block(ruyi_io_stream *stream) {
+    ruyi_io_stream_block *block = &stream->blocks[stream->current];
+    ruyi_io_stream_block *next = &stream->blocks[1 - stream->current];
+    UINT32 tail = (UINT32)(stream->limit - stream->cursor);
+    if (block->eof) {
+        stream->error = block->error;
+        return FALSE;
+    }
+#if !defined(_WIN32)
+    if (stream->threaded) {
+        pthread_mutex_lock(&stream->mutex);
+        while (!next->filled) {
+            pthread_cond_wait(&stream->cond, &stream->mutex);
+        }
+        pthread_mutex_unlock(&stream->mutex);
+    } else {
+        ruyi_io_stream_fill(stream, next);
+    }
+#else
+    ruyi_io_stream_fill(stream, next);
+#endif
+    memcpy(next->data - tail, stream->cursor, tail);
+    stream->cursor = next->data - tail;
+    stream->limit = next->data + next->length;
+    stream->current = 1 - stream->current;
+#if !defined(_WIN32)
+    if (stream->threaded) {
+        // give the old block back to the thread
+        pthread_mutex_lock(&stream->mutex);
+        block->filled = FALSE;
+        pthread_cond_broadcast(&stream->cond);
+        pthread_mutex_unlock(&stream->mutex);
+    }
+#endif
+    return TRUE;
+}
+
+static UINT32 ruyi_io_stream_read_utf8(ruyi_io_stream *stream, WIDE_CHAR* dist_buf, UINT32 buf_length) {
+    UINT32 utf8_count;
+    UINT32 bytes_decoded;
+    UINT32 remain;
+    for (;;) {
+        remain = (UINT32)(stream->limit - stream->cursor);
+        if (remain > 0) {
+            utf8_count = ruyi_unicode_decode_utf8(stream->cursor, remain, &bytes_decoded, dist_buf, buf_length);
+            stream->cursor += bytes_decoded;
+            if (utf8_count > 0) {
+                return utf8_count;
+            }
+            if (remain >= UNICODE_FILE_MAX_CHAR_BYTES) {
+                // not an incomplete char at the end of the block, but broken utf-8
+                return 0;
+            }
+        }
+        if (!ruyi_io_stream_next_block(stream)) {
+            return 0;
+        }
+    }
+}
+
+// add the chars of the bytes to count, and the lines starting in them to the line table
+static void ruyi_io_skip_count_add(ruyi_io_skip_count *count, const BYTE *bytes, UINT32 length) {
+    count->chars += ruyi_line_table_scan_utf8(count->lines, bytes, length, count->offset + count->chars);
+}
+
+/*
+ Scan the bytes for the end of a comment and count what is skipped.
+ Returns the bytes to skip, *found is set if the end is in them.
+ */
+static UINT32 ruyi_io_scan_comment(const BYTE *bytes, UINT32 length, BOOL block_comment, BOOL *after_star, BOOL *found, ruyi_io_skip_count *count) {
+    const BYTE *end = bytes + length;
+    const BYTE *p;
+    UINT32 skipped;
+    *found = FALSE;
+    if (!block_comment) {
+        p = (const BYTE*)memchr(bytes, '\n', length);
+        if (p == NULL) {
+            ruyi_io_skip_count_add(count, bytes, length);
+            return length;
+        }
+        *found = TRUE;
+        skipped = (UINT32)(p - bytes) + 1;
+        ruyi_io_skip_count_add(count, bytes, skipped);
+        return skipped;
+    }
+    p = bytes;
+    if (*after_star && p < end && *p == '/') {
+        p++;
+        *found = TRUE;
+    }
+    while (!*found) {
+        p = (const BYTE*)memchr(p, '*', end - p);
+        if (p == NULL) {
+            *after_star = FALSE;
+            p = end;
+            break;
+        }
+        while (p < end && *p == '*') {
+            p++;
+        }
+        if (p == end) {
+            *after_star = TRUE;
+            break;
+        }
+        if (*p == '/') {
+            p++;
+            *found = TRUE;
+        }
+    }
+    skipped = (UINT32)(p - bytes);
+    ruyi_io_skip_count_add(count, bytes, skipped);
+    return skipped;
+}
+
+BOOL ruyi_io_unicode_file_skip_comment(ruyi_unicode_file* file, BOOL block_comment, BOOL after_star, ruyi_io_skip_count *count) {
+    ruyi_file *fp;
+    ruyi_io_stream *stream;
+    BOOL found;
+    assert(file);
+    if (file->stream == NULL) {
+        fp = file->fp;
+        if (fp->read_pos >= fp->write_pos) {
+            return FALSE;
+        }
+        fp->read_pos += ruyi_io_scan_comment(fp->dist.buffer + fp->read_pos, fp->write_pos - fp->read_pos, block_comment, &after_star, &found, count);
+        return found;
+    }
+    stream = file->stream;
+    for (;;) {
+        stream->cursor += ruyi_io_scan_comment(stream->cursor, (UINT32)(stream->limit - stream->cursor), block_comment, &after_star, &found, count);
+        if (found) {
+            return TRUE;
+        }
+        // the whole block has been skipped, so there is no tail to carry
+        if (!ruyi_io_stream_next_block(stream)) {
+            return FALSE;
+        }
+    }
+}
 
 ruyi_unicode_file* ruyi_io_unicode_file_open(ruyi_file *fp) {
     assert(fp);
     ruyi_unicode_file* file = (ruyi_unicode_file*)ruyi_mem_alloc(sizeof(ruyi_unicode_file));
     file->fp = fp;
-    file->buffer_limit = 0;
-    file->buffer_pos = 0;
-    file->buffer_size = UNICODE_FILE_BUFF_SIZE;
-    file->buffer = ruyi_mem_alloc(UNICODE_FILE_BUFF_SIZE);
+    if (Ruyi_tf_FILE == fp->type) {
+        file->stream = ruyi_io_stream_open(fp);
+    } else {
+        // the whole content is in memory, no need to copy it
+        file->stream = NULL;
+    }
     return file;
 }
 
@@ -31,8 +378,8 @@ void ruyi_io_unicode_file_close(ruyi_unicode_file *file) {
     if (!file) {
         return;
     }
-    if (file->buffer) {
-        ruyi_mem_free(file->buffer);
+    if (file->stream) {
+        ruyi_io_stream_close(file->stream);
     }
     if (file->fp) {
         ruyi_file_close(file->fp);
@@ -40,43 +387,30 @@ void ruyi_io_unicode_file_close(ruyi_unicode_file *file) {
     ruyi_mem_free(file);
 }
 
-UINT32 ruyi_io_unicode_file_read_utf8(ruyi_unicode_file* file, WIDE_CHAR* dist_buf, UINT32 buf_length) {
-    assert(file);
-    BYTE temp[8];
-    UINT32 read_count;
+static UINT32 ruyi_io_unicode_file_read_utf8_in_place(ruyi_file* fp, WIDE_CHAR* dist_buf, UINT32 buf_length) {
     UINT32 utf8_count;
     UINT32 bytes_decoded;
-    UINT32 remain = file->buffer_limit - file->buffer_pos;
-    while (remain < 6) {
-        // move the remain data to the front of the file->buffer
-        if (file->buffer_pos > 0 && remain > 0) {
-            memcpy(temp, file->buffer + file->buffer_pos, remain);
-            memcpy(file->buffer, temp, remain);
-        }
-        file->buffer_pos = 0;
-        file->buffer_limit = remain;
-        
-        read_count = ruyi_file_read(file->fp, file->buffer + remain, UNICODE_FILE_READ_BUF_SIZE);        
-        if (read_count == 0) {
-            break;
-        }
-        file->buffer_limit += read_count;
-        remain = file->buffer_limit;
-    }
-    if (remain == 0) {
-        return 0;
-    }
-    if (file->buffer_pos >= file->buffer_limit) {
-        return 0;
-    }
-    utf8_count = ruyi_unicode_decode_utf8(file->buffer + file->buffer_pos, file->buffer_limit - file->buffer_pos, &bytes_decoded, dist_buf, buf_length);
-    if (utf8_count == 0) {
+    if (fp->read_pos >= fp->write_pos) {
         return 0;
     }
-    file->buffer_pos += bytes_decoded;
+    utf8_count = ruyi_unicode_decode_utf8(fp->dist.buffer + fp->read_pos, fp->write_pos - fp->read_pos, &bytes_decoded, dist_buf, buf_length);
+    fp->read_pos += bytes_decoded;
     return utf8_count;
 }
 
+UINT32 ruyi_io_unicode_file_read_utf8(ruyi_unicode_file* file, WIDE_CHAR* dist_buf, UINT32 buf_length) {
+    assert(file);
+    if (file->stream == NULL) {
+        return ruyi_io_unicode_file_read_utf8_in_place(file->fp, dist_buf, buf_length);
+    }
+    return ruyi_io_stream_read_utf8(file->stream, dist_buf, buf_length);
+}
+
+BOOL ruyi_io_unicode_file_error(const ruyi_unicode_file* file) {
+    assert(file);
+    return file->stream != NULL && file->stream->error;
+}
+
 
 UINT32 ruyi_io_write_utf8(FILE* file, const WIDE_CHAR* src_buf, UINT32 src_length) {
     BYTE buf[UNICODE_FILE_WRITE_BUF_SIZE];
@@ -123,6 +457,9 @@ UINT32 ruyi_file_write(ruyi_file* file, const void* buf, UINT32 buf_length) {
         }
         memcpy(file->dist.buffer + file->write_pos, buf, buf_length);
         file->write_pos += buf_length;
+    } else {
+        // mmap files and views are read-only
+        return 0;
     }
     return buf_length;
 }
@@ -132,7 +469,7 @@ UINT32 ruyi_file_read(ruyi_file* file, void* buf, UINT32 buf_length) {
     UINT32 read_length = 0;
     if (Ruyi_tf_FILE == file->type) {
         return (UINT32)fread(buf, 1, buf_length, file->dist.file);
-    } else if (Ruyi_tf_DATA == file->type) {
+    } else {
         read_length = file->write_pos - file->read_pos;
         if (read_length == 0) {
             return 0;
@@ -180,6 +517,66 @@ ruyi_file* ruyi_file_init_by_capacity(UINT32 init_size) {
     return f;
 }
 
+ruyi_file* ruyi_file_open_by_mmap(const char *path) {
+    ruyi_file* f;
+#if defined(_WIN32)
+    // no mmap here, load the whole file as data instead
+    BYTE buf[4096];
+    UINT32 read_count;
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    f = ruyi_file_init_by_capacity(4096);
+    while ((read_count = (UINT32)fread(buf, 1, sizeof(buf), fp)) > 0) {
+        ruyi_file_write(f, buf, read_count);
+    }
+    fclose(fp);
+    return f;
+#else
+    struct stat st;
+    void *addr = NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size > 0xFFFFFFFF) {
+        close(fd);
+        return NULL;
+    }
+    if (st.st_size > 0) {
+        addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            return NULL;
+        }
+#if defined(MADV_SEQUENTIAL)
+        madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+    }
+    // the mapping stays valid after the descriptor closed
+    close(fd);
+    f = (ruyi_file*)ruyi_mem_alloc(sizeof(ruyi_file));
+    f->capacity = (UINT32)st.st_size;
+    f->read_pos = 0;
+    f->write_pos = (UINT32)st.st_size;
+    f->type = Ruyi_tf_MMAP;
+    f->dist.buffer = (BYTE*)addr;
+    return f;
+#endif
+}
+
+ruyi_file* ruyi_file_init_by_view(const void *data, UINT32 data_length) {
+    ruyi_file* f = (ruyi_file*)ruyi_mem_alloc(sizeof(ruyi_file));
+    f->capacity = data_length;
+    f->read_pos = 0;
+    f->write_pos = data_length;
+    f->type = Ruyi_tf_VIEW;
+    // never written, see ruyi_file_write
+    f->dist.buffer = (BYTE*)data;
+    return f;
+}
+
 void ruyi_file_close(ruyi_file* file) {
     assert(file);
     switch (file->type) {
@@ -191,6 +588,18 @@ void ruyi_file_close(ruyi_file* file) {
             ruyi_mem_free(file->dist.buffer);
             file->dist.buffer = NULL;
             break;
+        case Ruyi_tf_MMAP:
+#if !defined(_WIN32)
+            if (file->dist.buffer) {
+                munmap(file->dist.buffer, file->capacity);
+            }
+#endif
+            file->dist.buffer = NULL;
+            break;
+        case Ruyi_tf_VIEW:
+            // the bytes are owned by the caller
+            file->dist.buffer = NULL;
+            break;
         default:
             break;
     }
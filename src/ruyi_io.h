@@ -11,10 +11,13 @@
 
 #include <stdio.h>
 #include "ruyi_basics.h"
+#include "ruyi_line_table.h"
 
 typedef enum {
     Ruyi_tf_FILE,
-    Ruyi_tf_DATA
+    Ruyi_tf_DATA,
+    Ruyi_tf_MMAP,
+    Ruyi_tf_VIEW
 } ruyi_file_type;
 
 typedef struct {
@@ -29,17 +32,21 @@ typedef struct {
 } ruyi_file;
 
 
+// double buffered blocks of a Ruyi_tf_FILE, see ruyi_io.c
+typedef struct ruyi_io_stream ruyi_io_stream;
+
 typedef struct {
   //  FILE* fp;
     ruyi_file* fp;
-    BYTE* buffer;
-    UINT32 buffer_pos;
-    UINT32 buffer_limit;
-    UINT32 buffer_size;
+    // NULL for data and mmap files, they are decoded in place
+    ruyi_io_stream* stream;
 } ruyi_unicode_file;
 
 /**
  * Open an unicode file
+ * A Ruyi_tf_FILE is read in large aligned blocks, two blocks at most are in memory.
+ * Regular files are read on demand with a sequential access hint,
+ * pipes and others are read ahead by a background thread while the current block is decoded.
  * params:
  * fp - a ruyi_file pointer, it will be closed when call ruyi_io_unicode_file_close
  */
@@ -63,6 +70,35 @@ void ruyi_io_unicode_file_close(ruyi_unicode_file *file);
  */
 UINT32 ruyi_io_unicode_file_read_utf8(ruyi_unicode_file* file, WIDE_CHAR* dist_buf, UINT32 buf_length);
 
+/**
+ * Check if the reading of the file has been stopped by an I/O error instead of the end of the file
+ * params:
+ * file - target object
+ * return:
+ * TRUE if ruyi_io_unicode_file_read_utf8 or ruyi_io_unicode_file_skip_comment stopped by an error
+ */
+BOOL ruyi_io_unicode_file_error(const ruyi_unicode_file* file);
+
+typedef struct {
+    ruyi_line_table *lines; // receives the lines starting in the skipped chars
+    UINT32 offset;          // offset of the first char skipped
+    UINT32 chars;           // all chars skipped
+} ruyi_io_skip_count;
+
+/**
+ * Skip the rest of a comment without decoding it.
+ * An ascii byte is never a part of an utf-8 multibyte char, so the end is searched in the bytes by memchr.
+ * params:
+ * file - target object
+ * block_comment - FALSE to skip through the next '\n', TRUE to skip through the next star and slash
+ * after_star - TRUE if the last char of the block comment before the bytes is a star
+ * count - the line table and offset to start from, receives the chars skipped with the end included,
+ *         chars must be zeroed by the caller
+ * return:
+ * TRUE if the end has been skipped, FALSE if the file ends before it
+ */
+BOOL ruyi_io_unicode_file_skip_comment(ruyi_unicode_file* file, BOOL block_comment, BOOL after_star, ruyi_io_skip_count *count);
+
 /**
  * Write some unicode data to the file with utf-8 encode
  * params:
@@ -79,6 +115,26 @@ ruyi_file* ruyi_file_open_by_file(FILE* file);
 ruyi_file* ruyi_file_init_by_data(const void *data, UINT32 data_length);
 ruyi_file* ruyi_file_init_by_capacity(UINT32 init_size);
 
+/**
+ * Map a whole file read-only into memory
+ * params:
+ * path - the file path
+ * return:
+ * a ruyi_file of type Ruyi_tf_MMAP, or NULL if the file can not be mapped.
+ * it can not be written, and the mapping is released by ruyi_file_close
+ */
+ruyi_file* ruyi_file_open_by_mmap(const char *path);
+
+/**
+ * Read a part of some memory as a file without copying it
+ * params:
+ * data - the bytes, they must live until the file is closed
+ * data_length - count of bytes
+ * return:
+ * a ruyi_file of type Ruyi_tf_VIEW, it can not be written, and ruyi_file_close does not release the bytes
+ */
+ruyi_file* ruyi_file_init_by_view(const void *data, UINT32 data_length);
+
 
 void ruyi_file_close(ruyi_file* file);
 
@@ -0,0 +1,84 @@
+//
+//  ruyi_jobs.c
+//  ruyi
+//
+
+#include "ruyi_jobs.h"
+#include "ruyi_mem.h"
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h> // for sysconf
+#endif
+
+#if !defined(_WIN32)
+
+// jobs [0, count) run by some threads, a thread done with a job takes the next one
+typedef struct {
+    void (*run)(void *data, UINT32 job);
+    void *data;
+    UINT32 count;
+    UINT32 next;
+    pthread_mutex_t mutex;
+} ruyi_jobs;
+
+UINT32 ruyi_jobs_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (UINT32)count : 1;
+}
+
+static void* ruyi_jobs_worker(void *arg) {
+    ruyi_jobs *jobs = (ruyi_jobs*)arg;
+    UINT32 job;
+    for (;;) {
+        pthread_mutex_lock(&jobs->mutex);
+        job = jobs->next++;
+        pthread_mutex_unlock(&jobs->mutex);
+        if (job >= jobs->count) {
+            return NULL;
+        }
+        jobs->run(jobs->data, job);
+    }
+}
+
+void ruyi_jobs_run(void (*run)(void *data, UINT32 job), void *data, UINT32 count, UINT32 threads) {
+    ruyi_jobs jobs;
+    pthread_t *workers;
+    UINT32 i;
+    jobs.run = run;
+    jobs.data = data;
+    jobs.count = count;
+    jobs.next = 0;
+    pthread_mutex_init(&jobs.mutex, NULL);
+    if (threads > count) {
+        threads = count;
+    }
+    // this thread is one of the workers, the jobs are still done if no thread can be made
+    workers = (pthread_t*)ruyi_mem_alloc(sizeof(pthread_t) * (threads + 1));
+    for (i = 1; i < threads; i++) {
+        if (pthread_create(&workers[i], NULL, ruyi_jobs_worker, &jobs) != 0) {
+            break;
+        }
+    }
+    threads = i;
+    ruyi_jobs_worker(&jobs);
+    for (i = 1; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    ruyi_mem_free(workers);
+    pthread_mutex_destroy(&jobs.mutex);
+}
+
+#else
+
+UINT32 ruyi_jobs_cpu_count(void) {
+    return 1;
+}
+
+void ruyi_jobs_run(void (*run)(void *data, UINT32 job), void *data, UINT32 count, UINT32 threads) {
+    UINT32 i;
+    for (i = 0; i < count; i++) {
+        run(data, i);
+    }
+}
+
+#endif
@@ -0,0 +1,25 @@
+//
+//  ruyi_jobs.h
+//  ruyi
+//
+
+#ifndef ruyi_jobs_h
+#define ruyi_jobs_h
+
+#include "ruyi_basics.h"
+
+/**
+ * Run jobs [0, count) on some threads, a thread done with a job takes the next one, this thread is one of them.
+ * The jobs are run on this thread only if threads can not be made.
+ * params:
+ * run - runs a job
+ * data - passed to run
+ * count - count of jobs
+ * threads - count of threads
+ */
+void ruyi_jobs_run(void (*run)(void *data, UINT32 job), void *data, UINT32 count, UINT32 threads);
+
+// count of cpus online, 1 if it is not known
+UINT32 ruyi_jobs_cpu_count(void);
+
+#endif /* ruyi_jobs_h */
@@ -10,14 +10,16 @@
 #include "ruyi_mem.h"
 #include "ruyi_unicode.h"
 #include "ruyi_hashtable.h"
-#include <string.h> // for memcpy
+#include "ruyi_number.h"
+#include "ruyi_jobs.h"
+#include <string.h> // for memcpy, memchr
 
 typedef struct {
     ruyi_token_type type;
     char keyword[64];
 } ruyi_keyword;
 
-ruyi_keyword g_ruyi_keywords[] = {
+static const ruyi_keyword g_ruyi_keywords[] = {
     {Ruyi_tt_KW_IF,     "if"},
     {Ruyi_tt_KW_ELSE,   "else"},
     {Ruyi_tt_KW_ELSEIF, "elseif"},
@@ -64,533 +66,440 @@ ruyi_keyword g_ruyi_keywords[] = {
 };
 
 
+// the perfect hash tables of g_ruyi_keywords, run tools/gen_lexer_keywords.py after the keywords changed
+#include "ruyi_lexer_keywords.inc"
+
 ruyi_token_type ruyi_lexer_keywords_get_type(ruyi_unicode_string * token_value) {
-    static ruyi_hashtable* keywords;
-    UINT32 i;
-    ruyi_value ret_type;
-    if (keywords == NULL) {
-        keywords = ruyi_hashtable_create();
-        for (i = 0; i < sizeof(g_ruyi_keywords)/sizeof(ruyi_keyword); i++) {
-            ruyi_hashtable_put(keywords, ruyi_value_unicode_str(ruyi_unicode_string_init_from_utf8(g_ruyi_keywords[i].keyword, 0)), ruyi_value_int64(g_ruyi_keywords[i].type));
+    const WIDE_CHAR *data = token_value->data;
+    UINT32 len = token_value->length;
+    const WIDE_CHAR *keyword;
+    UINT32 h1, h2, index, i;
+    if (len < RUYI_KEYWORDS_MIN_LENGTH || len > RUYI_KEYWORDS_MAX_LENGTH) {
+        return Ruyi_tt_IDENTITY;
+    }
+    h1 = RUYI_KEYWORDS_HASH1(len, data[0], data[len - 1]);
+    h2 = RUYI_KEYWORDS_HASH2(len, data[0], data[len - 1]);
+    index = g_ruyi_keywords_slots[(h2 + g_ruyi_keywords_disp[h1 % RUYI_KEYWORDS_DISP_SIZE]) % RUYI_KEYWORDS_COUNT];
+    if (g_ruyi_keywords_strs[index].length != len) {
+        return Ruyi_tt_IDENTITY;
+    }
+    keyword = g_ruyi_keywords_strs[index].data;
+    for (i = 0; i < len; i++) {
+        if (keyword[i] != data[i]) {
+            return Ruyi_tt_IDENTITY;
         }
     }
-    if (ruyi_hashtable_get(keywords, ruyi_value_unicode_str(token_value), &ret_type)) {
-        return (ruyi_token_type)ret_type.data.int64_value;
+    return g_ruyi_keywords[index].type;
+}
+
+static INT32 ruyi_lexer_keywords_index(ruyi_token_type type) {
+    if ((UINT32)type >= sizeof(g_ruyi_keywords_by_type) / sizeof(*g_ruyi_keywords_by_type)) {
+        return -1;
     }
-    return Ruyi_tt_IDENTITY;
+    return (INT32)g_ruyi_keywords_by_type[type] - 1;
 }
 
 const ruyi_unicode_string* ruyi_lexer_keywords_get_str(ruyi_token_type type) {
-    static ruyi_hashtable* keywords;
-    UINT32 i;
-    ruyi_value ret_str;
-    if (keywords == NULL) {
-        keywords = ruyi_hashtable_create();
-        for (i = 0; i < sizeof(g_ruyi_keywords)/sizeof(ruyi_keyword); i++) {
-            ruyi_hashtable_put(keywords, ruyi_value_int64(g_ruyi_keywords[i].type), ruyi_value_unicode_str(ruyi_unicode_string_init_from_utf8(g_ruyi_keywords[i].keyword, 0)));
-        }
-    }
-    if (ruyi_hashtable_get(keywords, ruyi_value_int64(type), &ret_str)) {
-        return ret_str.data.unicode_str;
+    INT32 index = ruyi_lexer_keywords_index(type);
+    if (index < 0) {
+        return NULL;
     }
-    return NULL;
+    return &g_ruyi_keywords_strs[index];
 }
 
 const char * ruyi_lexer_keywords_get_bytes_str(ruyi_token_type type, char *buf, UINT32 buf_length) {
-    ruyi_bytes_string *bytes_string;
+    INT32 index = ruyi_lexer_keywords_index(type);
     UINT32 len;
-    const ruyi_unicode_string *ustr_name = ruyi_lexer_keywords_get_str(type);
-    if (ustr_name == NULL) {
+    if (index < 0 || buf_length == 0) {
         return NULL;
     }
-    bytes_string = ruyi_unicode_string_encode_utf8(ustr_name);
-    if (bytes_string == NULL) {
-        return NULL;
+    len = (UINT32)strlen(g_ruyi_keywords[index].keyword);
+    if (len > buf_length - 1) {
+        len = buf_length - 1;
     }
-    len = bytes_string->length < buf_length ? bytes_string->length : buf_length;
-    strncpy(buf, bytes_string->str, len);
-    ruyi_unicode_bytes_string_destroy(bytes_string);
+    memcpy(buf, g_ruyi_keywords[index].keyword, len);
+    buf[len] = '\0';
     return buf;
 }
 
-typedef struct {
-    UINT32 line;
-    UINT32 column;
-    WIDE_CHAR c;
-} ruyi_pos_char;
+ruyi_lexer_reader* ruyi_lexer_reader_open_stream(const ruyi_token_stream *stream) {
+    assert(stream);
+    ruyi_lexer_reader *reader = (ruyi_lexer_reader*)ruyi_mem_alloc(sizeof(ruyi_lexer_reader));
+    reader->file = NULL;
+    reader->lookahead_capacity = LEXER_LOOKAHEAD_INIT_SIZE;
+    reader->lookahead = (ruyi_token*)ruyi_mem_alloc(sizeof(ruyi_token) * reader->lookahead_capacity);
+    reader->lookahead_head = 0;
+    reader->lookahead_count = 0;
+    // no text is lexed, the buffers are only kept for the close
+    reader->text_capacity = 0;
+    reader->text_buffer = NULL;
+    reader->text_length = 0;
+    reader->arena = ruyi_mem_arena_create(LEXER_ARENA_BLOCK_SIZE);
+    reader->chars_head = 0;
+    reader->chars_count = 0;
+    reader->options = Ruyi_lo_NONE;
+    reader->offset = 0;
+    // owned by the stream
+    reader->lines = stream->lines;
+    reader->error_message = NULL;
+    reader->error_offset = 0;
+    reader->open_comment = FALSE;
+    ruyi_token_cursor_init(&reader->cursor, stream);
+    return reader;
+}
+
+ruyi_lexer_reader* ruyi_lexer_reader_open_stream_range(const ruyi_token_stream *stream, UINT32 from, UINT32 end) {
+    ruyi_lexer_reader *reader = ruyi_lexer_reader_open_stream(stream);
+    assert(from <= end && end < stream->count);
+    reader->cursor.index = from;
+    reader->cursor.end = end;
+    return reader;
+}
 
-typedef enum {
-    Ruyi_r_OK,
-    Ruyi_r_END,
-    Ruyi_r_ERROR
-} ruyi_lexer_result;
+UINT32 ruyi_lexer_reader_token_index(const ruyi_lexer_reader *reader) {
+    UINT32 i;
+    assert(reader->cursor.stream);
+    // the cursor stays at the END, so the tokens looked ahead from the END on are all copies of it
+    for (i = 0; i < reader->lookahead_count; i++) {
+        if (reader->lookahead[(reader->lookahead_head + i) & (reader->lookahead_capacity - 1)].type == Ruyi_tt_END) {
+            return reader->cursor.end - i;
+        }
+    }
+    return reader->cursor.index - reader->lookahead_count;
+}
+
+void ruyi_lexer_reader_seek_token(ruyi_lexer_reader *reader, UINT32 index) {
+    assert(reader->cursor.stream && index <= reader->cursor.end);
+    reader->lookahead_head = 0;
+    reader->lookahead_count = 0;
+    reader->cursor.index = index;
+}
 
 ruyi_lexer_reader* ruyi_lexer_reader_open(ruyi_file *file) {
+    return ruyi_lexer_reader_open_with_options(file, Ruyi_lo_NONE);
+}
+
+ruyi_lexer_reader* ruyi_lexer_reader_open_with_options(ruyi_file *file, UINT32 options) {
     assert(file);
     ruyi_lexer_reader *reader = (ruyi_lexer_reader*)ruyi_mem_alloc(sizeof(ruyi_lexer_reader));
     reader->file = ruyi_io_unicode_file_open(file);
-    reader->token_buffer_queue = ruyi_list_create();
-    reader->chars_buffer_queue = ruyi_list_create();
-    reader->line = 1;
-    reader->column = 1;
+    reader->lookahead_capacity = LEXER_LOOKAHEAD_INIT_SIZE;
+    reader->lookahead = (ruyi_token*)ruyi_mem_alloc(sizeof(ruyi_token) * reader->lookahead_capacity);
+    reader->lookahead_head = 0;
+    reader->lookahead_count = 0;
+    reader->text_capacity = LEXER_TEXT_INIT_SIZE;
+    reader->text_buffer = (WIDE_CHAR*)ruyi_mem_alloc(sizeof(WIDE_CHAR) * reader->text_capacity);
+    reader->text_length = 0;
+    reader->arena = ruyi_mem_arena_create(LEXER_ARENA_BLOCK_SIZE);
+    reader->chars_head = 0;
+    reader->chars_count = 0;
+    reader->options = options;
+    reader->offset = 0;
+    reader->lines = ruyi_line_table_create();
+    reader->error_message = NULL;
+    reader->error_offset = 0;
+    reader->open_comment = FALSE;
+    reader->cursor.stream = NULL;
     return reader;
 }
 
-static void ruyi_lexer_error_message(const char* msg, ruyi_pos_char first) {
-    printf("lexer error: %s at line: %d, column: %d\n", msg, first.line, first.column);
+void ruyi_lexer_reader_position(const ruyi_lexer_reader *reader, UINT32 offset, UINT32 *line, UINT32 *column) {
+    assert(reader);
+    ruyi_line_table_position(reader->lines, offset, line, column);
 }
 
-static void ruyi_lexer_copy_last_n_chars(WIDE_CHAR *dest, UINT32 dest_size, const ruyi_unicode_string* src) {
-    UINT32 size = ruyi_unicode_string_length(src);
-    UINT32 copy_pos, copy_len;
-    if (size < dest_size - 1) {
-        copy_pos = 0;
-        copy_len = size;
-    } else {
-        copy_len = dest_size - 1;
-        copy_pos = size - dest_size + 1;
+static void ruyi_lexer_print_error(const ruyi_line_table *lines, const char* msg, UINT32 offset) {
+    UINT32 line, column;
+    ruyi_line_table_position(lines, offset, &line, &column);
+    printf("lexer error: %s at line: %d, column: %d\n", msg, line, column);
+}
+
+static void ruyi_lexer_error_message(ruyi_lexer_reader *reader, const char* msg, ruyi_pos_char first) {
+    reader->error_message = msg;
+    reader->error_offset = first.offset;
+    if ((reader->options & Ruyi_lo_QUIET) == 0) {
+        ruyi_lexer_print_error(reader->lines, msg, first.offset);
     }
-    memcpy(dest, src->data + copy_pos, copy_len * sizeof(WIDE_CHAR));
-    dest[copy_len] = '\0';
 }
 
 static void ruyi_lexer_set_snapshot(ruyi_token_snapshot *token_snapshot, const ruyi_token *token) {
-    const ruyi_unicode_string* keyword;
+    // no text is copied, it is found in the source only if an error needs it
     if (token == NULL) {
-        token_snapshot->column = 0;
-        token_snapshot->line = 0;
+        token_snapshot->offset = 0;
         token_snapshot->size = 0;
-        token_snapshot->value.int_value = 0;
-        token_snapshot->str_snapshot[0] = '\0';
     } else {
-        token_snapshot->column = token->column;
-        token_snapshot->line = token->line;
+        token_snapshot->offset = token->offset;
         token_snapshot->size = token->size;
-        keyword = ruyi_lexer_keywords_get_str(token->type);
-        if (keyword) {
-            ruyi_lexer_copy_last_n_chars(token_snapshot->str_snapshot, LEXER_TOKEN_SNAPSHOT_STR_SIZE, keyword);
-        } else {
-            switch (token->type) {
-                case Ruyi_tt_IDENTITY:
-                case Ruyi_tt_STRING:
-                    ruyi_lexer_copy_last_n_chars(token_snapshot->str_snapshot, LEXER_TOKEN_SNAPSHOT_STR_SIZE, token->value.str_value);
-                    break;
-                default:
-                    break;
+    }
+}
+
+// count of bytes of the first chars of some utf-8
+static UINT32 ruyi_lexer_utf8_bytes(const BYTE *bytes, UINT32 length, UINT32 chars) {
+    UINT32 i;
+    for (i = 0; i < length; i++) {
+        // continuation bytes of an utf-8 char are not counted
+        if ((bytes[i] & 0xC0) != 0x80) {
+            if (chars == 0) {
+                return i;
             }
+            chars--;
         }
     }
+    return length;
 }
 
-void ruyi_lexer_reader_close(ruyi_lexer_reader *reader) {
-    ruyi_value value;
-    ruyi_token *token;
+UINT32 ruyi_lexer_reader_token_text(const ruyi_lexer_reader *reader, UINT32 offset, UINT32 size, char *buf, UINT32 buf_size) {
+    const ruyi_file *fp;
+    UINT32 start, length;
     assert(reader);
-    if (ruyi_list_get_first(reader->token_buffer_queue, &value)) {
-        assert(value.type == Ruyi_value_type_ptr);
-        token = (ruyi_token *)value.data.ptr;
-        if (token) {
-            ruyi_lexer_token_destroy(token);
+    assert(buf && buf_size > 0);
+    buf[0] = '\0';
+    if (reader->file == NULL || reader->file->fp->type == Ruyi_tf_FILE) {
+        return 0;
+    }
+    fp = reader->file->fp;
+    start = ruyi_lexer_utf8_bytes(fp->dist.buffer, fp->write_pos, offset);
+    length = ruyi_lexer_utf8_bytes(fp->dist.buffer + start, fp->write_pos - start, size < LEXER_TOKEN_TEXT_SIZE ? size : LEXER_TOKEN_TEXT_SIZE);
+    if (length >= buf_size) {
+        // do not cut a char
+        length = buf_size - 1;
+        while (length > 0 && (fp->dist.buffer[start + length] & 0xC0) == 0x80) {
+            length--;
         }
     }
-    
-    ruyi_list_destroy(reader->token_buffer_queue);
-    ruyi_list_destroy(reader->chars_buffer_queue);
-    ruyi_io_unicode_file_close(reader->file);
-    ruyi_mem_free(reader);
+    memcpy(buf, fp->dist.buffer + start, length);
+    buf[length] = '\0';
+    return length;
 }
 
-static UINT64 ruyi_make_pos_value(UINT32 line, UINT32 column) {
-    UINT64 v = line;
-    v = (v & 0x00000000FFFFFFFF) << 32;
-    v |= (column & 0x00000000FFFFFFFF);
-    return v;
+void ruyi_lexer_reader_close(ruyi_lexer_reader *reader) {
+    assert(reader);
+    ruyi_mem_free(reader->lookahead);
+    ruyi_mem_free(reader->text_buffer);
+    ruyi_mem_arena_destroy(reader->arena);
+    if (reader->file) {
+        ruyi_io_unicode_file_close(reader->file);
+    }
+    if (reader->cursor.stream == NULL) {
+        ruyi_line_table_destroy(reader->lines);
+    }
+    ruyi_mem_free(reader);
 }
 
-static void ruyi_lexer_reader_push_front_char(ruyi_lexer_reader *reader, ruyi_pos_char pc) {
-    UINT64 v = ruyi_make_pos_value(pc.line, pc.column);
-    ruyi_list_add_first(reader->chars_buffer_queue, ruyi_value_uint64(v));
-    ruyi_list_add_first(reader->chars_buffer_queue, ruyi_value_int32(pc.c));
-}
+#define RUYI_CHARS_RING_MASK (LEXER_CHARS_RING_SIZE - 1)
 
-static BOOL ruyi_lexer_read_next_char(ruyi_lexer_reader *reader, ruyi_pos_char *pos_char) {
-    ruyi_value temp;
-    WIDE_CHAR buffer[256];
+static BOOL ruyi_lexer_fill_chars(ruyi_lexer_reader *reader) {
+    WIDE_CHAR buffer[LEXER_CHARS_DECODE_SIZE];
     UINT32 read_length;
-    UINT32 i;
-    UINT64 v;
-    for (;;) {
-        if (!ruyi_list_empty(reader->chars_buffer_queue)) {
-            ruyi_list_remove_first(reader->chars_buffer_queue, &temp);
-            pos_char->c = temp.data.int32_value;
-            ruyi_list_remove_first(reader->chars_buffer_queue, &temp);
-            v = temp.data.uint64_value;
-            pos_char->line = (v & 0xFFFFFFFF00000000) >> 32;
-            pos_char->column = (v & 0x00000000FFFFFFFF);
-            return TRUE;
-        }
-        read_length = ruyi_io_unicode_file_read_utf8(reader->file, buffer, 256);
-        if (read_length == 0) {
-            pos_char->c = 0;
-            return FALSE;
-        }
-        for (i = 0; i < read_length; i++) {
-            ruyi_list_add_last(reader->chars_buffer_queue, ruyi_value_int32(buffer[i]));
-            v = ruyi_make_pos_value(reader->line, reader->column);
-            ruyi_list_add_last(reader->chars_buffer_queue, ruyi_value_uint64(v));
-            if (buffer[i] == '\n') {
-                reader->line++;
-                reader->column = 1;
-            } else {
-                if (buffer[i] != '\r') {
-                    reader->column++;
-                }
-            }
-        }
+    UINT32 pos;
+    UINT32 first_part;
+    read_length = ruyi_io_unicode_file_read_utf8(reader->file, buffer, LEXER_CHARS_DECODE_SIZE);
+    if (read_length == 0) {
+        return FALSE;
+    }
+    assert(reader->chars_count + read_length <= LEXER_CHARS_RING_SIZE);
+    // no position is tracked per char, the lines are found in the chars at once
+    ruyi_line_table_scan_chars(reader->lines, buffer, read_length, reader->offset);
+    pos = (reader->chars_head + reader->chars_count) & RUYI_CHARS_RING_MASK;
+    first_part = LEXER_CHARS_RING_SIZE - pos;
+    if (first_part >= read_length) {
+        memcpy(reader->chars_ring + pos, buffer, sizeof(WIDE_CHAR) * read_length);
+    } else {
+        memcpy(reader->chars_ring + pos, buffer, sizeof(WIDE_CHAR) * first_part);
+        memcpy(reader->chars_ring, buffer + first_part, sizeof(WIDE_CHAR) * (read_length - first_part));
     }
+    reader->chars_count += read_length;
+    reader->offset += read_length;
+    return TRUE;
 }
 
-static BOOL ruyi_lexer_peek_char(ruyi_lexer_reader *reader, ruyi_pos_char *pos_char)  {
-    BOOL ret = ruyi_lexer_read_next_char(reader, pos_char);
-    ruyi_lexer_reader_push_front_char(reader, *pos_char);
-    return ret;
+static BOOL ruyi_lexer_read_next_char(ruyi_lexer_reader *reader, ruyi_pos_char *pos_char) {
+    if (reader->chars_count == 0 && !ruyi_lexer_fill_chars(reader)) {
+        pos_char->c = 0;
+        pos_char->offset = reader->offset;
+        return FALSE;
+    }
+    pos_char->c = reader->chars_ring[reader->chars_head];
+    pos_char->offset = reader->offset - reader->chars_count;
+    reader->chars_head = (reader->chars_head + 1) & RUYI_CHARS_RING_MASK;
+    reader->chars_count--;
+    return TRUE;
 }
 
-#define RUYI_IS_LETTER(c) \
-((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
-
-#define RUYI_IS_DIGIT(c) \
-((c >= '0' && c <= '9'))
-
-#define RUYI_IS_SPACE(c) \
-((c == ' ' || c == '\t' || c == '\r' || c == '\n'))
-
-static ruyi_token* ruyi_lexer_make_token_with_size(ruyi_token_type token_type, ruyi_pos_char first, UINT32 size) {
-    ruyi_token* token = (ruyi_token*)ruyi_mem_alloc(sizeof(ruyi_token));
+static ruyi_token* ruyi_lexer_make_token_with_size(ruyi_lexer_reader *reader, ruyi_token_type token_type, ruyi_pos_char first, UINT32 size) {
+    ruyi_token* token = &reader->building_token;
     token->type = token_type;
-    token->line = first.line;
-    token->column = first.column;
     token->size = size;
+    token->offset = first.offset;
+    token->symbol = RUYI_SYMBOL_NONE;
     return token;
 }
 
-static ruyi_token* ruyi_lexer_make_token(ruyi_token_type token_type, ruyi_pos_char first) {
-    return ruyi_lexer_make_token_with_size(token_type, first, 1);
+static ruyi_token* ruyi_lexer_make_token(ruyi_lexer_reader *reader, ruyi_token_type token_type, ruyi_pos_char first) {
+    return ruyi_lexer_make_token_with_size(reader, token_type, first, 1);
 }
 
-static ruyi_token * ruyi_lexer_make_number_token(INT64 integer_part, double fraction_part, INT32 exponent_part, BOOL has_dot, ruyi_pos_char first, UINT32 size) {
-    ruyi_token * token = ruyi_lexer_make_token(has_dot ? Ruyi_tt_FLOAT : Ruyi_tt_INTEGER, first);
-    double exponent = 1;
-    while (exponent_part != 0) {
-        if (exponent_part > 0) {
-            exponent *= 10;
-            exponent_part--;
-        } else if (exponent_part < 0) {
-            exponent *= 0.1;
-            exponent_part++;
-        }
-    }
-    if (!has_dot) {
-        token->value.int_value = integer_part;
-        token->value.int_value *= exponent;
-    } else {
-        token->value.float_value = integer_part + fraction_part;
-        token->value.float_value *= exponent;
-    }
-    token->size = size;
-    return token;
+static void ruyi_lexer_text_grow(ruyi_lexer_reader *reader) {
+    WIDE_CHAR *new_buffer = (WIDE_CHAR*)ruyi_mem_alloc(sizeof(WIDE_CHAR) * reader->text_capacity * 2);
+    memcpy(new_buffer, reader->text_buffer, sizeof(WIDE_CHAR) * reader->text_length);
+    ruyi_mem_free(reader->text_buffer);
+    reader->text_buffer = new_buffer;
+    reader->text_capacity *= 2;
 }
 
-static ruyi_lexer_result ruyi_lexer_get_digit(ruyi_pos_char first, ruyi_pos_char ch, INT64 radix, int *out) {
-    switch (radix) {
-        case 2:
-            if (ch.c == '0' || ch.c == '1') {
-                *out = ch.c - '0';
-                return Ruyi_r_OK;
-            } else if (ch.c >= '2' && ch.c <= '9') {
-                ruyi_lexer_error_message("binary number only support digit 0 and 1", first);
-                return Ruyi_r_ERROR;
-            } else {
-                return Ruyi_r_END;
-            }
-        case 8:
-            if (ch.c >= '0' && ch.c <= '7') {
-                *out = ch.c - '0';
-                return Ruyi_r_OK;
-            } else if (ch.c >= '8' && ch.c <= '9') {
-                ruyi_lexer_error_message("octal number only support digit 0 to 7", first);
-                return Ruyi_r_ERROR;
-            } else {
-                return Ruyi_r_END;
-            }
-        case 10:
-            if (ch.c >= '0' && ch.c <= '9') {
-                *out = ch.c - '0';
-                return Ruyi_r_OK;
-            } else {
-                return Ruyi_r_END;
-            }
-        case 16:
-            if (ch.c >= '0' && ch.c <= '9') {
-                *out = ch.c - '0';
-                return Ruyi_r_OK;
-            } else if (ch.c >= 'A' && ch.c <= 'F') {
-                *out = ch.c - 'A' + 10;
-                return Ruyi_r_OK;
-            } else if (ch.c >= 'a' && ch.c <= 'f') {
-                *out = ch.c - 'a' + 10;
-                return Ruyi_r_OK;
-            } else {
-                return Ruyi_r_END;
-            }
-        default:
-            ruyi_lexer_error_message("unsupport number radix", first);
-            return Ruyi_r_ERROR;
-    }
-}
-
-static ruyi_token * ruyi_lexer_get_decimal(ruyi_lexer_reader *reader, ruyi_pos_char first) {
-    ruyi_pos_char ch = first;
-    INT64 integer_part = 0;
-    double fraction_part = 0;
-    double fraction_base = 0.1;
-    UINT32 exponent_part = 0;
-    INT64 radix = 10;
-    UINT32 size = 0;
-    BOOL has_dot = FALSE;
-    // 10-base
-    integer_part = radix * integer_part + first.c - '0';
-    for (;;) {
-        if (!ruyi_lexer_read_next_char(reader, &ch)) {
-            ruyi_lexer_reader_push_front_char(reader, ch);
-            return ruyi_lexer_make_number_token(integer_part, fraction_part, exponent_part, has_dot, first, size);
-        }
-        size++;
-        if (RUYI_IS_DIGIT(ch.c)) {
-            if (has_dot) {
-                fraction_part = fraction_part + (ch.c - '0') * fraction_base;
-                fraction_base *= 0.1;
-            } else {
-                integer_part = radix * integer_part + ch.c - '0';
-            }
-        } else if ('.' == ch.c) {
-            if (has_dot) {
-                ruyi_lexer_reader_push_front_char(reader, ch);
-                return ruyi_lexer_make_number_token(integer_part, fraction_part, exponent_part, TRUE, first, size);
-            } else {
-                has_dot = TRUE;
-            }
-        } else if ('e' == ch.c || 'E' == ch.c) {
-            // exp part
-            ruyi_lexer_peek_char(reader, &ch);
-            if (RUYI_IS_DIGIT(ch.c) || '-' == ch.c) {
-                if ('-' == ch.c) {
-                    ruyi_lexer_read_next_char(reader, &ch);
-                    exponent_part = -1;
-                    ruyi_lexer_peek_char(reader, &ch);
-                    if (!RUYI_IS_DIGIT(ch.c)) {
-                        ruyi_lexer_error_message("exponent miss digit", first);
-                    }
-                }
-                for (;;) {
-                    if (!ruyi_lexer_read_next_char(reader, &ch)) {
-                        ruyi_lexer_reader_push_front_char(reader, ch);
-                        return ruyi_lexer_make_number_token(integer_part, fraction_part, exponent_part, has_dot, first, size);
-                    }
-                    if (!RUYI_IS_DIGIT(ch.c)) {
-                        ruyi_lexer_reader_push_front_char(reader, ch);
-                        return ruyi_lexer_make_number_token(integer_part, fraction_part, exponent_part, has_dot, first, size);
-                    }
-                    size++;
-                    exponent_part = 10 * exponent_part + ch.c - '0';
-                }
-            } else {
-                ruyi_lexer_error_message("exponent miss digit", first);
-                return NULL;
-            }
-        } else {
-            ruyi_lexer_reader_push_front_char(reader, ch);
-            return ruyi_lexer_make_number_token(integer_part, fraction_part, exponent_part, has_dot, first, size);
-        }
+// small enough to be inlined into the DFA loop, the growing is kept out of it
+static void ruyi_lexer_text_append(ruyi_lexer_reader *reader, WIDE_CHAR c) {
+    if (reader->text_length >= reader->text_capacity) {
+        ruyi_lexer_text_grow(reader);
     }
+    reader->text_buffer[reader->text_length++] = c;
 }
 
-static ruyi_token * ruyi_lexer_handle_dot3(ruyi_lexer_reader *reader, ruyi_pos_char first) {
-    ruyi_pos_char ch1 = first;
-    ruyi_pos_char ch2 = first;
-    if (!ruyi_lexer_read_next_char(reader, &ch1)) {
-        return ruyi_lexer_make_token(Ruyi_tt_DOT, first);
-    }
-    if ('.' != ch1.c) {
-        ruyi_lexer_reader_push_front_char(reader, ch1);
-        return ruyi_lexer_make_token(Ruyi_tt_DOT, first);
-    }
-    if (!ruyi_lexer_peek_char(reader, &ch2)) {
-        ruyi_lexer_reader_push_front_char(reader, ch1);
-        return ruyi_lexer_make_token(Ruyi_tt_DOT, first);
-    }
-    if ('.' != ch2.c) {
-        ruyi_lexer_reader_push_front_char(reader, ch1);
-        return ruyi_lexer_make_token(Ruyi_tt_DOT, first);
-    }
-    ruyi_lexer_read_next_char(reader, &ch2);
-    return ruyi_lexer_make_token(Ruyi_tt_DOT3, first);
+// copy the text being lexed to the arena
+static ruyi_unicode_string* ruyi_lexer_text_make_string(ruyi_lexer_reader *reader) {
+    UINT32 length = reader->text_length;
+    ruyi_unicode_string *str = (ruyi_unicode_string*)ruyi_mem_arena_alloc(reader->arena, sizeof(ruyi_unicode_string) + sizeof(WIDE_CHAR) * length);
+    str->data = (WIDE_CHAR*)(str + 1);
+    str->length = length;
+    str->capacity = length;
+    memcpy(str->data, reader->text_buffer, sizeof(WIDE_CHAR) * length);
+    return str;
 }
 
-static ruyi_token * ruyi_lexer_handle_number(ruyi_lexer_reader *reader, ruyi_pos_char first) {
-    assert(reader);
-    ruyi_pos_char ch = first;
-    INT64 integer_part = 0;
-    INT64 radix = 10;
-    UINT32 size = 0;
-    ruyi_lexer_result lr;
-    int out;
-    if ('.' == first.c) {
-        if (!ruyi_lexer_peek_char(reader, &ch)) {
-            return ruyi_lexer_make_token(Ruyi_tt_DOT, first);
-        }
-        if (!RUYI_IS_DIGIT(ch.c)) {
-            // Ruyi_tt_DOT3
-            return ruyi_lexer_handle_dot3(reader, first);
-           // return ruyi_lexer_make_token(Ruyi_tt_DOT, first);
-        }
-        ch.c = '0';
-        ruyi_lexer_reader_push_front_char(reader, first);
-        return ruyi_lexer_get_decimal(reader, ch);
-    } else if (first.c == '0') {
-        if (!ruyi_lexer_read_next_char(reader, &ch)) {
-            return ruyi_lexer_make_number_token(integer_part, 0, 0, FALSE, first, size);
-        }
-        size ++;
-        if (ch.c == 'x' || ch.c == 'X') {
-            radix = 16;
-            
-        } else if ( ch.c >= '0' && ch.c <= '7') {
-            radix = 8;
-            integer_part = integer_part * radix + ch.c - '0';
-        } else if ( ch.c >= '8' && ch.c <= '9') {
-            ruyi_lexer_error_message("unsupport number, the decimal must start with none-zero", first);
+// the text of the number has been checked by the DFA, so only the value need to be computed here
+static ruyi_token * ruyi_lexer_make_number(ruyi_lexer_reader *reader, ruyi_token_type type, ruyi_pos_char first, UINT32 size) {
+    const WIDE_CHAR *text = reader->text_buffer;
+    UINT32 length = reader->text_length;
+    UINT32 radix = 10;
+    UINT32 start = 0;
+    UINT32 end = length;
+    UINT64 value;
+    UINT64 exponent = 0;
+    double float_value;
+    ruyi_token *token;
+    if (type == Ruyi_tt_FLOAT) {
+        if (!ruyi_number_parse_double(text, length, &float_value)) {
+            ruyi_lexer_error_message(reader, "float number is too large", first);
             return NULL;
-        } else if ( ch.c == 'b' || ch.c == 'B') {
-            radix = 2;
-        } else if (ch.c == '.') {
-            ruyi_lexer_reader_push_front_char(reader, ch);
-            return ruyi_lexer_get_decimal(reader, first);
-        } else {
-            // just 0
-            ruyi_lexer_reader_push_front_char(reader, ch);
-            return ruyi_lexer_make_number_token(0, 0, 0, FALSE, first, size);
         }
-        for (;;) {
-            if (!ruyi_lexer_read_next_char(reader, &ch)) {
-                return ruyi_lexer_make_number_token(integer_part, 0, 0, FALSE, first, size);
-            }
-            size++;
-            if ('.' == ch.c) {
-                ruyi_lexer_error_message("unsupport float number for explicit radix number", first);
-                return NULL;
-            }
-            lr = ruyi_lexer_get_digit(first, ch, radix, &out);
-            if (Ruyi_r_ERROR == lr) {
-                return NULL;
-            } else if (Ruyi_r_END == lr) {
-                return ruyi_lexer_make_number_token(integer_part, 0, 0, FALSE, first, size);
-            } else {
-                integer_part = radix * integer_part + out;
-            }
+        token = ruyi_lexer_make_token_with_size(reader, Ruyi_tt_FLOAT, first, size);
+        token->value.float_value = float_value;
+        return token;
+    }
+    if (length > 1 && text[0] == '0') {
+        switch (text[1]) {
+            case 'x':
+            case 'X':
+                radix = 16;
+                start = 2;
+                break;
+            case 'b':
+            case 'B':
+                radix = 2;
+                start = 2;
+                break;
+            default:
+                radix = 8;
+                start = 1;
+                break;
         }
     } else {
-        // 10-base
-        return ruyi_lexer_get_decimal(reader, first);
+        // a decimal integer may have a positive exponent, e.g. 12e3
+        for (end = 0; end < length && text[end] != 'e' && text[end] != 'E'; end++) {
+        }
+        if (end < length && !ruyi_number_parse_uint64(text + end + 1, length - end - 1, 10, &exponent)) {
+            goto make_number_too_large;
+        }
+    }
+    if (!ruyi_number_parse_uint64(text + start, end - start, radix, &value)) {
+        goto make_number_too_large;
     }
+    for (; exponent > 0 && value != 0; exponent--) {
+        if (value > UINT64_MAX / 10) {
+            goto make_number_too_large;
+        }
+        value *= 10;
+    }
+    // a decimal must fit in INT64, other radixes may use all 64 bits, e.g. 0xFFFFFFFFFFFFFFFF is -1
+    if (radix == 10 && value > INT64_MAX) {
+        goto make_number_too_large;
+    }
+    token = ruyi_lexer_make_token_with_size(reader, Ruyi_tt_INTEGER, first, size);
+    token->value.int_value = (INT64)value;
+    return token;
+make_number_too_large:
+    ruyi_lexer_error_message(reader, "integer number is too large", first);
     return NULL;
 }
 
-static ruyi_token * ruyi_lexer_handle_identifier(ruyi_lexer_reader *reader, ruyi_pos_char first) {
-    ruyi_unicode_string* string_value = ruyi_unicode_string_init_with_capacity(64);
-    ruyi_pos_char ch = first;
-    WIDE_CHAR c;
+static ruyi_token * ruyi_lexer_make_identifier(ruyi_lexer_reader *reader, ruyi_pos_char first, UINT32 size) {
+    ruyi_unicode_string text;
     ruyi_token* token;
     ruyi_token_type type;
-    ruyi_unicode_string_append_wide_char(string_value, ch.c);
-    for(;;) {
-        if (!ruyi_lexer_read_next_char(reader, &ch)) {
-            break;
-        }
-        c = ch.c;
-        if (RUYI_IS_LETTER(c) || c == '_' || RUYI_IS_DIGIT(c)) {
-            ruyi_unicode_string_append_wide_char(string_value, c);
-        } else {
-            ruyi_lexer_reader_push_front_char(reader, ch);
-            break;
-        }
-    }
-    
-    type = ruyi_lexer_keywords_get_type(string_value);
+    text.data = reader->text_buffer;
+    text.length = reader->text_length;
+    text.capacity = reader->text_capacity;
+    type = ruyi_lexer_keywords_get_type(&text);
+    token = ruyi_lexer_make_token_with_size(reader, type, first, size);
     if (type == Ruyi_tt_IDENTITY) {
-        token = ruyi_lexer_make_token(Ruyi_tt_IDENTITY, first);
-        token->value.str_value = string_value;
-        token->size = string_value->length;
-    } else {
-        token = ruyi_lexer_make_token(type, first);
-        
-        ruyi_unicode_string_destroy(string_value);
+        token->symbol = ruyi_symbol_intern(reader->text_buffer, reader->text_length);
+        token->value.str_value = (ruyi_unicode_string*)ruyi_symbol_str(token->symbol);
     }
     return token;
 }
 
 static ruyi_token * ruyi_lexer_handle_string(ruyi_lexer_reader *reader, ruyi_pos_char first) {
-    ruyi_unicode_string* string_value = ruyi_unicode_string_init_with_capacity(64);
     ruyi_pos_char ch;
     WIDE_CHAR c;
     ruyi_token* token;
     UINT32 size = 1;
+    reader->text_length = 0;
     for(;;) {
         if (!ruyi_lexer_read_next_char(reader, &ch)) {
-            ruyi_lexer_error_message("miss end \" for string", first);
+            ruyi_lexer_error_message(reader, "miss end \" for string", first);
             return NULL;
         }
         size++;
         c = ch.c;
         if (c == '\\') {
             if (!ruyi_lexer_read_next_char(reader, &ch)) {
-                ruyi_lexer_error_message("miss end \" for string", first);
+                ruyi_lexer_error_message(reader, "miss end \" for string", first);
                 return NULL;
             }
             size++;
             switch (ch.c) {
                 case 'n':
-                    ruyi_unicode_string_append_wide_char(string_value, '\n');
+                    ruyi_lexer_text_append(reader, '\n');
                     break;
                 case '"':
-                    ruyi_unicode_string_append_wide_char(string_value, '\"');
+                    ruyi_lexer_text_append(reader, '\"');
                     break;
                 case 't':
-                    ruyi_unicode_string_append_wide_char(string_value, '\t');
+                    ruyi_lexer_text_append(reader, '\t');
                     break;
                 case 'r':
-                    ruyi_unicode_string_append_wide_char(string_value, '\r');
+                    ruyi_lexer_text_append(reader, '\r');
                     break;
                 case 'b':
-                    ruyi_unicode_string_append_wide_char(string_value, '\b');
+                    ruyi_lexer_text_append(reader, '\b');
                     break;
                 case '\\':
-                    ruyi_unicode_string_append_wide_char(string_value, '\\');
+                    ruyi_lexer_text_append(reader, '\\');
                     break;
                 case '\'':
-                    ruyi_unicode_string_append_wide_char(string_value, '\'');
+                    ruyi_lexer_text_append(reader, '\'');
                     break;
                 default:
-                    ruyi_unicode_string_append_wide_char(string_value, ch.c);
+                    ruyi_lexer_text_append(reader, ch.c);
                     break;
             }
         } else if (c == '\"') {
-            token = ruyi_lexer_make_token(Ruyi_tt_STRING, first);
-            token->value.str_value = string_value;
+            token = ruyi_lexer_make_token(reader, Ruyi_tt_STRING, first);
+            token->value.str_value = ruyi_lexer_text_make_string(reader);
             token->size = size;
             return token;
         } else {
-            ruyi_unicode_string_append_wide_char(string_value, c);
+            ruyi_lexer_text_append(reader, c);
         }
     }
     return NULL;
@@ -602,17 +511,17 @@ static ruyi_token * ruyi_lexer_handle_char(ruyi_lexer_reader *reader, ruyi_pos_c
     UINT32 size = 1;
     WIDE_CHAR content;
     if (!ruyi_lexer_read_next_char(reader, &ch)) {
-        ruyi_lexer_error_message("miss content for char", first);
+        ruyi_lexer_error_message(reader, "miss content for char", first);
         return NULL;
     }
     size++;
     if (ch.c == '\'') {
-        ruyi_lexer_error_message("miss content for char", first);
+        ruyi_lexer_error_message(reader, "miss content for char", first);
         return NULL;
     }
     if (ch.c == '\\') {
         if (!ruyi_lexer_read_next_char(reader, &ch)) {
-            ruyi_lexer_error_message("miss content for char", first);
+            ruyi_lexer_error_message(reader, "miss content for char", first);
             return NULL;
         }
         size++;
@@ -646,253 +555,220 @@ static ruyi_token * ruyi_lexer_handle_char(ruyi_lexer_reader *reader, ruyi_pos_c
         content = ch.c;
     }
     if (!ruyi_lexer_read_next_char(reader, &ch)) {
-        ruyi_lexer_error_message("miss content for char", first);
+        ruyi_lexer_error_message(reader, "miss content for char", first);
         return NULL;
     }
     size++;
     if ('\'' != ch.c) {
-        ruyi_lexer_error_message("need \' for end of char", first);
+        ruyi_lexer_error_message(reader, "need \' for end of char", first);
         return NULL;
     }
-    token = ruyi_lexer_make_token(Ruyi_tt_CHAR, first);
+    token = ruyi_lexer_make_token(reader, Ruyi_tt_CHAR, first);
     token->value.int_value = content;
     token->size = size;
     return token;
 }
 
-typedef struct {
-    WIDE_CHAR c;
-    ruyi_token_type token_type;
-} ruyi_lexer_choose_tt;
+// the DFA tables, run tools/gen_lexer_dfa.py after the tokens in ruyi_lexer.h changed
+#include "ruyi_lexer_dfa.inc"
 
-static ruyi_token * ruyi_lexer_handle_mul_tokens(ruyi_lexer_reader *reader, ruyi_pos_char first, ruyi_lexer_choose_tt* c_tt, UINT32 c_tt_size, ruyi_token_type not_match) {
-    ruyi_pos_char pc;
-    UINT32 i;
-    ruyi_token* token;
-    if (!ruyi_lexer_read_next_char(reader, &pc)) {
-        ruyi_lexer_reader_push_front_char(reader, pc);
-        return ruyi_lexer_make_token(not_match, first);
-    }
-    for (i = 0; i < c_tt_size; i++) {
-        if (c_tt[i].c == pc.c) {
-            token = ruyi_lexer_make_token(c_tt[i].token_type, first);
-            token->size = 2;
-            return token;
-        }
-    }
-    ruyi_lexer_reader_push_front_char(reader, pc);
-    return ruyi_lexer_make_token(not_match, first);
-}
+// chars >= 256 take the slow path, they can only appear in comments, strings and chars
+#define RUYI_LEXER_CHAR_CLASS(c) \
+((c) < 256 ? g_ruyi_lexer_char_class[c] : RUYI_LEXER_DFA_CLASS_NON_ASCII)
 
+static void ruyi_lexer_consume_chars(ruyi_lexer_reader *reader, UINT32 count) {
+    reader->chars_head = (reader->chars_head + count) & RUYI_CHARS_RING_MASK;
+    reader->chars_count -= count;
+}
 
-static ruyi_token * ruyi_lexer_handle_div_or_comments(ruyi_lexer_reader *reader, ruyi_pos_char first) {
-    ruyi_pos_char ch;
-    ruyi_token* token;
-    UINT32 size = 1;
-    ruyi_lexer_choose_tt choose_tt[1];
-    if (!ruyi_lexer_read_next_char(reader, &ch)) {
-        ruyi_lexer_reader_push_front_char(reader, ch);
-        return ruyi_lexer_make_token(Ruyi_tt_DIV, first);
-    }
-    size++;
-    if ('/' == ch.c) {
-        token = ruyi_lexer_make_token(Ruyi_tt_LINE_COMMENTS, first);
-        for (;;) {
-            if (!ruyi_lexer_read_next_char(reader, &ch)) {
-                ruyi_lexer_reader_push_front_char(reader, ch);
-                token->size = size;
-                return token;
-            }
-            size++;
-            if ('\n' == ch.c) {
-                token->size = size;
-                return token;
-            }
-        }
-    } else if ('*' == ch.c) {
-        token = ruyi_lexer_make_token(Ruyi_tt_MLINES_COMMENTS, first);
-        for (;;) {
-            if (!ruyi_lexer_read_next_char(reader, &ch)) {
-                ruyi_lexer_reader_push_front_char(reader, ch);
-                token->size = size;
-                return token;
-            }
-            size ++;
-            if ('*' == ch.c) {
-                if (!ruyi_lexer_read_next_char(reader, &ch)) {
-                    ruyi_lexer_reader_push_front_char(reader, ch);
-                    token->size = size;
-                    return token;
-                }
-                if ('/' == ch.c) {
-                    size ++;
-                    token->size = size;
-                    return token;
-                } else {
-                    ruyi_lexer_reader_push_front_char(reader, ch);
-                }
-            }
+/*
+ Skips a comment if the chars at the head of the ring start one, returns FALSE if they do not.
+ The chars already decoded are checked in the ring, the rest is skipped by the file as bytes.
+ A comment without the end runs to the end of file, the same as the comment tokens.
+ */
+static BOOL ruyi_lexer_skip_comment(ruyi_lexer_reader *reader) {
+    ruyi_io_skip_count count;
+    BOOL block_comment;
+    BOOL after_star = FALSE;
+    WIDE_CHAR c;
+    if (reader->chars_count < 2) {
+        ruyi_lexer_fill_chars(reader);
+        if (reader->chars_count < 2) {
+            return FALSE;
         }
-    } else {
-        ruyi_lexer_reader_push_front_char(reader, ch);
-        choose_tt[0].c = '='; choose_tt[0].token_type = Ruyi_tt_DIV_ASS;
-        return ruyi_lexer_handle_mul_tokens(reader, first, choose_tt, 1, Ruyi_tt_DIV);
     }
-    return NULL;
-}
-
-static ruyi_token* ruyi_lexer_token_lt(ruyi_lexer_reader *reader, ruyi_pos_char first) {
-    ruyi_pos_char pc;
-    UINT32 size = 1;
-    if (!ruyi_lexer_read_next_char(reader, &pc)) {
-        ruyi_lexer_reader_push_front_char(reader, pc);
-        return ruyi_lexer_make_token(Ruyi_tt_LT, first);
+    c = reader->chars_ring[(reader->chars_head + 1) & RUYI_CHARS_RING_MASK];
+    if (c != '/' && c != '*') {
+        return FALSE;
     }
-    size++;
-    switch (pc.c) {
-        case '=':
-            return ruyi_lexer_make_token_with_size(Ruyi_tt_LTE, first, size);
-        case '<':
-            if (!ruyi_lexer_peek_char(reader, &pc)) {
-                return ruyi_lexer_make_token_with_size(Ruyi_tt_SHFT_LEFT, first, size);
-            } else if ('=' == pc.c) {
-                ruyi_lexer_read_next_char(reader, &pc);
-                size++;
-                return ruyi_lexer_make_token_with_size(Ruyi_tt_SHFT_LEFT_ASS, first, size);
-            } else {
-                return ruyi_lexer_make_token_with_size(Ruyi_tt_SHFT_LEFT, first, size);
+    block_comment = (c == '*');
+    ruyi_lexer_consume_chars(reader, 2);
+    while (reader->chars_count > 0) {
+        c = reader->chars_ring[reader->chars_head];
+        ruyi_lexer_consume_chars(reader, 1);
+        if (!block_comment) {
+            if (c == '\n') {
+                return TRUE;
             }
-        default:
-            ruyi_lexer_reader_push_front_char(reader, pc);
-            return ruyi_lexer_make_token(Ruyi_tt_LT, first);
-    }
-    return NULL;
-}
-
-static ruyi_token* ruyi_lexer_token_gt(ruyi_lexer_reader *reader, ruyi_pos_char first) {
-    ruyi_pos_char pc;
-    UINT32 size = 1;
-    if (!ruyi_lexer_read_next_char(reader, &pc)) {
-        ruyi_lexer_reader_push_front_char(reader, pc);
-        return ruyi_lexer_make_token(Ruyi_tt_GT, first);
-    }
-    size++;
-    switch (pc.c) {
-        case '=':
-            return ruyi_lexer_make_token_with_size(Ruyi_tt_GTE, first, size);
-        case '>':
-            if (!ruyi_lexer_peek_char(reader, &pc)) {
-                return ruyi_lexer_make_token_with_size(Ruyi_tt_SHFT_RIGHT, first, size);
-            } else if ('=' == pc.c) {
-                ruyi_lexer_read_next_char(reader, &pc);
-                size++;
-                return ruyi_lexer_make_token_with_size(Ruyi_tt_SHFT_RIGHT_ASS, first, size);
-            } else {
-                return ruyi_lexer_make_token_with_size(Ruyi_tt_SHFT_RIGHT, first, size);
+        } else {
+            if (after_star && c == '/') {
+                return TRUE;
             }
-        default:
-            ruyi_lexer_reader_push_front_char(reader, pc);
-            return ruyi_lexer_make_token(Ruyi_tt_GT, first);
+            after_star = (c == '*');
+        }
     }
-    return NULL;
+    // the ring is empty, reader->offset is where the file is
+    count.lines = reader->lines;
+    count.offset = reader->offset;
+    count.chars = 0;
+    reader->open_comment = !ruyi_io_unicode_file_skip_comment(reader->file, block_comment, after_star, &count);
+    reader->offset += count.chars;
+    return TRUE;
 }
 
+/*
+ Runs the DFA from the first char and keeps the longest match.
+ The chars after the last accepting state are only peeked in the ring, so nothing is ever pushed back.
+ The accepted chars are consumed before the ring is filled, and the DFA never reads more than 2 chars
+ past an accepting state, so the ring can not overflow however long the token is.
+ */
 static ruyi_token* ruyi_lexer_next_token_impl(ruyi_lexer_reader *reader) {
-    ruyi_pos_char pc;
+    ruyi_pos_char first;
     WIDE_CHAR c;
-    ruyi_lexer_choose_tt choose_tt[4];
+    UINT32 state;
+    UINT32 pending;     // chars read by the DFA and not consumed yet
+    UINT32 accepted;    // chars of pending in the longest match
+    UINT32 size;
+    UINT32 text_length;
+    INT32 action;
     for (;;) {
-        if (!ruyi_lexer_read_next_char(reader, &pc)) {
-            return ruyi_lexer_make_token(Ruyi_tt_END, pc);
+        if (reader->chars_count == 0 && !ruyi_lexer_fill_chars(reader)) {
+            first.c = 0;
+            first.offset = reader->offset;
+            if (ruyi_io_unicode_file_error(reader->file)) {
+                ruyi_lexer_error_message(reader, "read error of the source file", first);
+                return NULL;
+            }
+            return ruyi_lexer_make_token(reader, Ruyi_tt_END, first);
         }
-        c = pc.c;
-        if (RUYI_IS_SPACE(c)) {
+        first.c = reader->chars_ring[reader->chars_head];
+        first.offset = reader->offset - reader->chars_count;
+        if (first.c == '/' && (reader->options & Ruyi_lo_SKIP_COMMENTS) && ruyi_lexer_skip_comment(reader)) {
             continue;
         }
-        if (RUYI_IS_LETTER(c) || c == '_') {
-            return ruyi_lexer_handle_identifier(reader, pc);
-        }
-        if (RUYI_IS_DIGIT(c)) {
-            return ruyi_lexer_handle_number(reader, pc);
+        state = RUYI_LEXER_DFA_START;
+        action = 0;
+        size = 0;
+        pending = 0;
+        accepted = 0;
+        text_length = 0;
+        reader->text_length = 0;
+        for (;;) {
+            if (pending == reader->chars_count) {
+                ruyi_lexer_consume_chars(reader, accepted);
+                size += accepted;
+                pending -= accepted;
+                accepted = 0;
+                if (!ruyi_lexer_fill_chars(reader)) {
+                    break;
+                }
+            }
+            c = reader->chars_ring[(reader->chars_head + pending) & RUYI_CHARS_RING_MASK];
+            state = g_ruyi_lexer_dfa_next[state][RUYI_LEXER_CHAR_CLASS(c)];
+            if (state == 0) {
+                break;
+            }
+            pending++;
+            if (g_ruyi_lexer_dfa_keep_text[state]) {
+                ruyi_lexer_text_append(reader, c);
+            }
+            if (g_ruyi_lexer_dfa_accept[state] != 0) {
+                action = g_ruyi_lexer_dfa_accept[state];
+                accepted = pending;
+                text_length = reader->text_length;
+            }
         }
-        switch (c) {
-            case '.':
-                return ruyi_lexer_handle_number(reader, pc);
-            case '"':
-                return ruyi_lexer_handle_string(reader, pc);
-            case '\'':
-                return ruyi_lexer_handle_char(reader, pc);
-            case '+':
-                choose_tt[0].c = '='; choose_tt[0].token_type = Ruyi_tt_ADD_ASS;
-                choose_tt[1].c = '+'; choose_tt[1].token_type = Ruyi_tt_INC;
-                return ruyi_lexer_handle_mul_tokens(reader, pc, choose_tt, 2, Ruyi_tt_ADD);
-            case '-':
-                choose_tt[0].c = '='; choose_tt[0].token_type = Ruyi_tt_SUB_ASS;
-                choose_tt[1].c = '-'; choose_tt[1].token_type = Ruyi_tt_DEC;
-                return ruyi_lexer_handle_mul_tokens(reader, pc, choose_tt, 2, Ruyi_tt_SUB);
-            case '*':
-                choose_tt[0].c = '='; choose_tt[0].token_type = Ruyi_tt_MUL_ASS;
-                return ruyi_lexer_handle_mul_tokens(reader, pc, choose_tt, 1, Ruyi_tt_MUL);
-            case '/':
-                return ruyi_lexer_handle_div_or_comments(reader, pc);
-            case '%':
-                choose_tt[0].c = '='; choose_tt[0].token_type = Ruyi_tt_MOD_ASS;
-                return ruyi_lexer_handle_mul_tokens(reader, pc, choose_tt, 1, Ruyi_tt_MOD);
-            case '(':
-                return ruyi_lexer_make_token(Ruyi_tt_LPAREN, pc);
-            case ')':
-                return ruyi_lexer_make_token(Ruyi_tt_RPAREN, pc);
-            case '[':
-                return ruyi_lexer_make_token(Ruyi_tt_LBRACKET, pc);
-            case ']':
-                return ruyi_lexer_make_token(Ruyi_tt_RBRACKET, pc);
-            case '{':
-                return ruyi_lexer_make_token(Ruyi_tt_LBRACE, pc);
-            case '}':
-                return ruyi_lexer_make_token(Ruyi_tt_RBRACE, pc);
-            case ',':
-                return ruyi_lexer_make_token(Ruyi_tt_COMMA, pc);
-            case ';':
-                return ruyi_lexer_make_token(Ruyi_tt_SEMICOLON, pc);
-            case ':':
-                choose_tt[0].c = '='; choose_tt[0].token_type = Ruyi_tt_COLON_ASSIGN;
-                return ruyi_lexer_handle_mul_tokens(reader, pc, choose_tt, 1, Ruyi_tt_COLON);
-            case '<':
-                return ruyi_lexer_token_lt(reader, pc);
-            case '>':
-                return ruyi_lexer_token_gt(reader, pc);
-            case '=':
-                choose_tt[0].c = '='; choose_tt[0].token_type = Ruyi_tt_EQUALS;
-                return ruyi_lexer_handle_mul_tokens(reader, pc, choose_tt, 1, Ruyi_tt_ASSIGN);
-            case '!':
-                choose_tt[0].c = '='; choose_tt[0].token_type = Ruyi_tt_NOT_EQUALS;
-                return ruyi_lexer_handle_mul_tokens(reader, pc, choose_tt, 1, Ruyi_tt_LOGIC_NOT);
-            case '&':
-                choose_tt[0].c = '&'; choose_tt[0].token_type = Ruyi_tt_LOGIC_AND;
-                choose_tt[1].c = '='; choose_tt[1].token_type = Ruyi_tt_BIT_AND_ASS;
-                return ruyi_lexer_handle_mul_tokens(reader, pc, choose_tt, 2, Ruyi_tt_BIT_AND);
-            case '|':
-                choose_tt[0].c = '|'; choose_tt[0].token_type = Ruyi_tt_LOGIC_OR;
-                choose_tt[1].c = '='; choose_tt[1].token_type = Ruyi_tt_BIT_OR_ASS;
-                return ruyi_lexer_handle_mul_tokens(reader, pc, choose_tt, 2, Ruyi_tt_BIT_OR);
-            case '^':
-                choose_tt[0].c = '='; choose_tt[0].token_type = Ruyi_tt_BIT_XOR_ASS;
-                return ruyi_lexer_handle_mul_tokens(reader, pc, choose_tt, 1, Ruyi_tt_BIT_XOR);
-            case '~':
-                choose_tt[0].c = '='; choose_tt[0].token_type = Ruyi_tt_BIT_INVERSE_ASS;
-                return ruyi_lexer_handle_mul_tokens(reader, pc, choose_tt, 1, Ruyi_tt_BIT_INVERSE);
-            case '?':
-                return ruyi_lexer_make_token(Ruyi_tt_QM, pc);
+        ruyi_lexer_consume_chars(reader, accepted);
+        size += accepted;
+        reader->text_length = text_length;
+        switch (action) {
+            case 0:
+                // unknown char, skip it
+                ruyi_lexer_consume_chars(reader, 1);
+                continue;
+            case RUYI_LEXER_DFA_SKIP:
+                continue;
+            case Ruyi_tt_IDENTITY:
+                return ruyi_lexer_make_identifier(reader, first, size);
+            case Ruyi_tt_INTEGER:
+            case Ruyi_tt_FLOAT:
+                return ruyi_lexer_make_number(reader, (ruyi_token_type)action, first, size);
+            case Ruyi_tt_STRING:
+                return ruyi_lexer_handle_string(reader, first);
+            case Ruyi_tt_CHAR:
+                return ruyi_lexer_handle_char(reader, first);
             default:
-                break;
+                if (action < 0) {
+                    ruyi_lexer_error_message(reader, g_ruyi_lexer_dfa_errors[RUYI_LEXER_DFA_ERROR_INDEX(action)], first);
+                    return NULL;
+                }
+                return ruyi_lexer_make_token_with_size(reader, (ruyi_token_type)action, first, size);
         }
     }
     return NULL;
 }
 
+static void ruyi_lexer_lookahead_grow(ruyi_lexer_reader *reader) {
+    UINT32 i;
+    UINT32 new_capacity = reader->lookahead_capacity * 2;
+    ruyi_token *new_lookahead = (ruyi_token*)ruyi_mem_alloc(sizeof(ruyi_token) * new_capacity);
+    for (i = 0; i < reader->lookahead_count; i++) {
+        new_lookahead[i] = reader->lookahead[(reader->lookahead_head + i) & (reader->lookahead_capacity - 1)];
+    }
+    ruyi_mem_free(reader->lookahead);
+    reader->lookahead = new_lookahead;
+    reader->lookahead_capacity = new_capacity;
+    reader->lookahead_head = 0;
+}
+
+// get the nth token not read yet without reading it, NULL if lexing failed before it
+static ruyi_token* ruyi_lexer_lookahead_at(ruyi_lexer_reader *reader, UINT32 n) {
+    ruyi_token *token;
+    while (reader->lookahead_count <= n) {
+        if (reader->cursor.stream) {
+            token = &reader->building_token;
+            ruyi_token_cursor_get(&reader->cursor, 0, token);
+            ruyi_token_cursor_advance(&reader->cursor, 1);
+        } else {
+            token = ruyi_lexer_next_token_impl(reader);
+        }
+        if (token == NULL) {
+            return NULL;
+        }
+        if (reader->lookahead_count == reader->lookahead_capacity) {
+            ruyi_lexer_lookahead_grow(reader);
+        }
+        reader->lookahead[(reader->lookahead_head + reader->lookahead_count) & (reader->lookahead_capacity - 1)] = *token;
+        reader->lookahead_count++;
+    }
+    return &reader->lookahead[(reader->lookahead_head + n) & (reader->lookahead_capacity - 1)];
+}
+
+// get the next token without reading it, NULL if lexing failed
+static ruyi_token* ruyi_lexer_lookahead_front(ruyi_lexer_reader *reader) {
+    return ruyi_lexer_lookahead_at(reader, 0);
+}
+
+static void ruyi_lexer_lookahead_pop(ruyi_lexer_reader *reader) {
+    assert(reader->lookahead_count > 0);
+    reader->lookahead_head = (reader->lookahead_head + 1) & (reader->lookahead_capacity - 1);
+    reader->lookahead_count--;
+}
+
 BOOL ruyi_lexer_reader_consume_token_if_match(ruyi_lexer_reader *reader, ruyi_token_type type, ruyi_token* out_token) {
     assert(reader);
-    ruyi_token* token = ruyi_lexer_reader_next_token(reader);
+    ruyi_token* token = ruyi_lexer_lookahead_front(reader);
+    ruyi_lexer_set_snapshot(&reader->token_snapshot, token);
     if (token == NULL) {
         return FALSE;
     }
@@ -900,66 +776,652 @@ BOOL ruyi_lexer_reader_consume_token_if_match(ruyi_lexer_reader *reader, ruyi_to
         *out_token = *token;
     }
     if (token->type == type) {
-        ruyi_lexer_token_destroy(token);
+        ruyi_lexer_lookahead_pop(reader);
         return TRUE;
-    } else {
-        ruyi_lexer_reader_push_front(reader, token);
-        return FALSE;
     }
+    return FALSE;
 }
 
 ruyi_token_type ruyi_lexer_reader_peek_token_type(ruyi_lexer_reader *reader) {
     assert(reader);
-    ruyi_token_type type;
-    ruyi_token* token = ruyi_lexer_reader_next_token(reader);
+    ruyi_token* token = ruyi_lexer_lookahead_front(reader);
+    ruyi_lexer_set_snapshot(&reader->token_snapshot, token);
     if (token == NULL) {
         return Ruyi_tt_END;
     }
-    type = token->type;
-    ruyi_lexer_reader_push_front(reader, token);
-    return type;
+    return token->type;
+}
+
+ruyi_token_type ruyi_lexer_reader_peek_nth_token_type(ruyi_lexer_reader *reader, UINT32 n) {
+    assert(reader);
+    ruyi_token* token = ruyi_lexer_lookahead_at(reader, n);
+    if (token == NULL) {
+        return Ruyi_tt_END;
+    }
+    return token->type;
 }
 
 void ruyi_lexer_reader_push_front(ruyi_lexer_reader *reader, ruyi_token *token) {
     assert(reader);
     assert(token);
-    ruyi_list_add_first(reader->token_buffer_queue, ruyi_value_ptr(token));
+    if (reader->lookahead_count == reader->lookahead_capacity) {
+        ruyi_lexer_lookahead_grow(reader);
+    }
+    reader->lookahead_head = (reader->lookahead_head - 1) & (reader->lookahead_capacity - 1);
+    reader->lookahead[reader->lookahead_head] = *token;
+    reader->lookahead_count++;
 }
 
 ruyi_token* ruyi_lexer_reader_next_token(ruyi_lexer_reader *reader) {
     assert(reader);
-    ruyi_value value;
-    ruyi_token* token;
-    if (!ruyi_list_empty(reader->token_buffer_queue)) {
-        assert(ruyi_list_remove_first(reader->token_buffer_queue, &value));
-        token = (ruyi_token*)value.data.ptr;
-    } else {
-        token = ruyi_lexer_next_token_impl(reader);
+    ruyi_token* token = ruyi_lexer_lookahead_front(reader);
+    if (token != NULL) {
+        // the caller may keep it, so move it out of the ring
+        token = (ruyi_token*)ruyi_mem_arena_alloc(reader->arena, sizeof(ruyi_token));
+        *token = reader->lookahead[reader->lookahead_head];
+        ruyi_lexer_lookahead_pop(reader);
     }
     ruyi_lexer_set_snapshot(&reader->token_snapshot, token);
     return token;
 }
 
 void ruyi_lexer_reader_consume_token(ruyi_lexer_reader *reader) {
-    ruyi_token * token = ruyi_lexer_reader_next_token(reader);
+    ruyi_token * token = ruyi_lexer_lookahead_front(reader);
     if (token) {
         ruyi_lexer_set_snapshot(&reader->token_snapshot, token);
-        ruyi_lexer_token_destroy(token);
+        ruyi_lexer_lookahead_pop(reader);
     }
 }
 
 void ruyi_lexer_token_destroy(ruyi_token * token) {
     assert(token);
+}
+
+#define RUYI_TOKEN_STREAM_INIT_SIZE 1024
+
+static ruyi_token_stream* ruyi_token_stream_create(void) {
+    ruyi_token_stream *stream = (ruyi_token_stream*)ruyi_mem_alloc(sizeof(ruyi_token_stream));
+    stream->count = 0;
+    stream->capacity = RUYI_TOKEN_STREAM_INIT_SIZE;
+    stream->types = (BYTE*)ruyi_mem_alloc(sizeof(BYTE) * stream->capacity);
+    stream->offsets = (UINT32*)ruyi_mem_alloc(sizeof(UINT32) * stream->capacity);
+    stream->lengths = (UINT32*)ruyi_mem_alloc(sizeof(UINT32) * stream->capacity);
+    stream->literals = (UINT32*)ruyi_mem_alloc(sizeof(UINT32) * stream->capacity);
+    stream->literal_count = 0;
+    stream->literal_capacity = RUYI_TOKEN_STREAM_INIT_SIZE;
+    stream->literal_table = (ruyi_token_literal*)ruyi_mem_alloc(sizeof(ruyi_token_literal) * stream->literal_capacity);
+    stream->arena = NULL;
+    stream->lines = NULL;
+    return stream;
+}
+
+void ruyi_token_stream_destroy(ruyi_token_stream *stream) {
+    if (!stream) {
+        return;
+    }
+    ruyi_mem_free(stream->types);
+    ruyi_mem_free(stream->offsets);
+    ruyi_mem_free(stream->lengths);
+    ruyi_mem_free(stream->literals);
+    ruyi_mem_free(stream->literal_table);
+    ruyi_mem_arena_destroy(stream->arena);
+    ruyi_line_table_destroy(stream->lines);
+    ruyi_mem_free(stream);
+}
+
+static void* ruyi_token_stream_grow_array(void *array, UINT32 item_size, UINT32 count, UINT32 new_capacity) {
+    void *new_array = ruyi_mem_alloc(item_size * new_capacity);
+    memcpy(new_array, array, item_size * count);
+    ruyi_mem_free(array);
+    return new_array;
+}
+
+// make room for count more tokens and literal_count more literals
+static void ruyi_token_stream_reserve(ruyi_token_stream *stream, UINT32 count, UINT32 literal_count) {
+    UINT32 capacity = stream->capacity;
+    while (stream->count + count > capacity) {
+        capacity *= 2;
+    }
+    if (capacity != stream->capacity) {
+        stream->types = (BYTE*)ruyi_token_stream_grow_array(stream->types, sizeof(BYTE), stream->count, capacity);
+        stream->offsets = (UINT32*)ruyi_token_stream_grow_array(stream->offsets, sizeof(UINT32), stream->count, capacity);
+        stream->lengths = (UINT32*)ruyi_token_stream_grow_array(stream->lengths, sizeof(UINT32), stream->count, capacity);
+        stream->literals = (UINT32*)ruyi_token_stream_grow_array(stream->literals, sizeof(UINT32), stream->count, capacity);
+        stream->capacity = capacity;
+    }
+    capacity = stream->literal_capacity;
+    while (stream->literal_count + literal_count > capacity) {
+        capacity *= 2;
+    }
+    if (capacity != stream->literal_capacity) {
+        stream->literal_table = (ruyi_token_literal*)ruyi_token_stream_grow_array(stream->literal_table, sizeof(ruyi_token_literal), stream->literal_count, capacity);
+        stream->literal_capacity = capacity;
+    }
+}
+
+static void ruyi_token_stream_add(ruyi_token_stream *stream, const ruyi_token *token) {
+    UINT32 index = stream->count;
+    ruyi_token_literal *literal;
+    if (index == stream->capacity) {
+        ruyi_token_stream_reserve(stream, 1, 0);
+    }
+    // all token types fit in a byte
+    assert((UINT32)token->type <= 0xFF);
+    stream->types[index] = (BYTE)token->type;
+    stream->offsets[index] = token->offset;
+    stream->lengths[index] = token->size;
+    stream->literals[index] = RUYI_TOKEN_NO_LITERAL;
     switch (token->type) {
         case Ruyi_tt_IDENTITY:
         case Ruyi_tt_STRING:
-            if (token->value.str_value) {
-                ruyi_unicode_string_destroy(token->value.str_value);
-                token->value.str_value = NULL;
+        case Ruyi_tt_INTEGER:
+        case Ruyi_tt_CHAR:
+        case Ruyi_tt_FLOAT:
+            if (stream->literal_count == stream->literal_capacity) {
+                ruyi_token_stream_reserve(stream, 0, 1);
+            }
+            literal = &stream->literal_table[stream->literal_count];
+            literal->symbol = token->symbol;
+            literal->value.int_value = 0;
+            if (token->type == Ruyi_tt_FLOAT) {
+                literal->value.float_value = token->value.float_value;
+            } else if (token->type == Ruyi_tt_INTEGER || token->type == Ruyi_tt_CHAR) {
+                literal->value.int_value = token->value.int_value;
+            } else {
+                literal->value.str_value = token->value.str_value;
             }
+            stream->literals[index] = stream->literal_count++;
             break;
         default:
             break;
     }
-    ruyi_mem_free(token);
+    stream->count++;
+}
+
+ruyi_token_stream* ruyi_lexer_tokenize_all(ruyi_file *file, UINT32 options) {
+    ruyi_lexer_reader *reader = ruyi_lexer_reader_open_with_options(file, options);
+    ruyi_token_stream *stream = ruyi_token_stream_create();
+    ruyi_token *token;
+    for (;;) {
+        token = ruyi_lexer_next_token_impl(reader);
+        if (token == NULL) {
+            ruyi_token_stream_destroy(stream);
+            stream = NULL;
+            break;
+        }
+        ruyi_token_stream_add(stream, token);
+        if (token->type == Ruyi_tt_END) {
+            break;
+        }
+    }
+    if (stream) {
+        // the strings of the literals are in the arena of the reader, and the lines are of its file
+        stream->arena = reader->arena;
+        reader->arena = NULL;
+        stream->lines = reader->lines;
+        reader->lines = NULL;
+    }
+    ruyi_lexer_reader_close(reader);
+    return stream;
+}
+
+#if !defined(_WIN32)
+
+// a smaller chunk is not worth a thread
+#define RUYI_LEXER_CHUNK_MIN_SIZE (1024 * 1024)
+// more chunks than threads, so a thread done early takes another one
+#define RUYI_LEXER_CHUNKS_PER_THREAD 4
+#define RUYI_LEXER_NO_TOKEN 0xFFFFFFFF
+
+// where the tokens of a chunk may be wrong
+typedef struct {
+    UINT32 token;               // count of tokens before the break
+    UINT32 restart;             // chars before the end of the last token before the break
+} ruyi_lexer_chunk_break;
+
+typedef struct {
+    const BYTE *bytes;
+    UINT32 length;
+    BOOL last;                  // the last chunk ends at the end of file, not after a '\n'
+    UINT32 options;
+    ruyi_token_stream *stream;  // offsets are from the start of the chunk, no END token
+    ruyi_line_table *lines;     // lines of all chars of the chunk, they do not depend on where the tokens are
+    UINT32 chars;               // count of chars of the chunk
+    // after an error the chunk is lexed on from the next line, a break at the end means the tokens
+    // do not reach the end of the chunk, so the next chunk may not start between tokens
+    ruyi_lexer_chunk_break *breaks;
+    UINT32 break_count;
+    UINT32 break_capacity;
+} ruyi_lexer_chunk;
+
+static UINT32 ruyi_lexer_utf8_chars(const BYTE *bytes, UINT32 length) {
+    UINT32 chars = 0;
+    UINT32 i;
+    for (i = 0; i < length; i++) {
+        chars += ((bytes[i] & 0xC0) != 0x80);
+    }
+    return chars;
+}
+
+static void ruyi_lexer_chunk_add_break(ruyi_lexer_chunk *chunk, UINT32 token, UINT32 restart) {
+    ruyi_lexer_chunk_break *breaks;
+    if (chunk->break_count == chunk->break_capacity) {
+        chunk->break_capacity = chunk->break_capacity == 0 ? 4 : chunk->break_capacity * 2;
+        breaks = (ruyi_lexer_chunk_break*)ruyi_mem_alloc(sizeof(ruyi_lexer_chunk_break) * chunk->break_capacity);
+        if (chunk->breaks) {
+            memcpy(breaks, chunk->breaks, sizeof(ruyi_lexer_chunk_break) * chunk->break_count);
+            ruyi_mem_free(chunk->breaks);
+        }
+        chunk->breaks = breaks;
+    }
+    chunk->breaks[chunk->break_count].token = token;
+    chunk->breaks[chunk->break_count].restart = restart;
+    chunk->break_count++;
+}
+
+/*
+ Lex a chunk as if it starts between tokens.
+ A token which runs to the end of a chunk may go on in the next one, e.g. a block comment,
+ so it is dropped and a break is added at the end. An error adds a break and the lexing goes on from
+ the next line, as the chunk may have started in a string or comment and the tokens after are good again.
+ */
+static void ruyi_lexer_lex_chunk(ruyi_lexer_chunk *chunk) {
+    ruyi_lexer_reader *reader;
+    ruyi_token_stream *stream = ruyi_token_stream_create();
+    ruyi_file *fp;
+    ruyi_token *token;
+    const BYTE *next_line;
+    UINT32 start = 0;   // bytes before where the reader starts
+    UINT32 offset = 0;  // chars before where the reader starts
+    UINT32 end;         // chars before the end of the last token
+    UINT32 error;
+    BOOL whole = TRUE;  // the lines of the first reader are of the whole chunk
+    chunk->stream = stream;
+    chunk->lines = NULL;
+    chunk->breaks = NULL;
+    chunk->break_count = 0;
+    chunk->break_capacity = 0;
+    for (;;) {
+        reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_view(chunk->bytes + start, chunk->length - start), chunk->options | Ruyi_lo_QUIET);
+        reader->offset = offset;
+        fp = reader->file->fp;
+        end = offset;
+        for (;;) {
+            token = ruyi_lexer_next_token_impl(reader);
+            if (token == NULL || token->type == Ruyi_tt_END) {
+                break;
+            }
+            ruyi_token_stream_add(stream, token);
+            end = token->offset + token->size;
+        }
+        next_line = NULL;
+        if (token == NULL) {
+            ruyi_lexer_chunk_add_break(chunk, stream->count, end);
+            error = start + ruyi_lexer_utf8_bytes(chunk->bytes + start, chunk->length - start, reader->error_offset - offset);
+            next_line = (const BYTE*)memchr(chunk->bytes + error, '\n', chunk->length - error);
+            whole = FALSE;
+        } else if (fp->read_pos != fp->write_pos) {
+            // decoding stopped at broken utf-8
+            ruyi_lexer_chunk_add_break(chunk, stream->count, end);
+            whole = FALSE;
+        } else if (!chunk->last && reader->open_comment) {
+            ruyi_lexer_chunk_add_break(chunk, stream->count, end);
+        } else if (!chunk->last && stream->count > 0 && end == reader->offset &&
+                   stream->types[stream->count - 1] != Ruyi_tt_LINE_COMMENTS) {
+            // a line comment ends with the '\n' at the end of the chunk, nothing else can
+            stream->count--;
+            if (stream->literals[stream->count] != RUYI_TOKEN_NO_LITERAL) {
+                stream->literal_count--;
+            }
+            ruyi_lexer_chunk_add_break(chunk, stream->count, stream->offsets[stream->count]);
+        }
+        if (whole) {
+            chunk->lines = reader->lines;
+            chunk->chars = reader->offset;
+            reader->lines = NULL;
+        }
+        if (stream->arena) {
+            ruyi_mem_arena_merge(stream->arena, reader->arena);
+        } else {
+            stream->arena = reader->arena;
+        }
+        reader->arena = NULL;
+        ruyi_lexer_reader_close(reader);
+        if (next_line == NULL || next_line + 1 == chunk->bytes + chunk->length) {
+            break;
+        }
+        offset += ruyi_lexer_utf8_chars(chunk->bytes + start, (UINT32)(next_line + 1 - chunk->bytes) - start);
+        start = (UINT32)(next_line + 1 - chunk->bytes);
+    }
+    if (chunk->lines == NULL) {
+        chunk->lines = ruyi_line_table_create();
+        chunk->chars = ruyi_line_table_scan_utf8(chunk->lines, chunk->bytes, chunk->length, 0);
+    }
+}
+
+static void ruyi_lexer_lex_chunk_job(void *data, UINT32 job) {
+    ruyi_lexer_lex_chunk(&((ruyi_lexer_chunk*)data)[job]);
+}
+
+// cut the source after the '\n' next to each even split, returns the count of chunks
+static UINT32 ruyi_lexer_make_chunks(const BYTE *source, UINT32 length, UINT32 count, UINT32 options, ruyi_lexer_chunk *chunks) {
+    UINT32 start = 0;
+    UINT32 made = 0;
+    UINT32 split;
+    UINT32 i;
+    const BYTE *p;
+    for (i = 1; i <= count && start < length; i++) {
+        p = NULL;
+        split = (UINT32)((UINT64)length * i / count);
+        if (i < count && split > start) {
+            p = (const BYTE*)memchr(source + split, '\n', length - split);
+        }
+        chunks[made].bytes = source + start;
+        chunks[made].length = p ? (UINT32)(p + 1 - source) - start : length - start;
+        chunks[made].last = (p == NULL);
+        chunks[made].options = options;
+        start += chunks[made].length;
+        made++;
+    }
+    return made;
+}
+
+// index of the token of a chunk at offset, RUYI_LEXER_NO_TOKEN if there is none
+static UINT32 ruyi_lexer_chunk_find_token(const ruyi_lexer_chunk *chunk, UINT32 offset) {
+    const UINT32 *offsets = chunk->stream->offsets;
+    UINT32 low = 0;
+    UINT32 high = chunk->stream->count;
+    UINT32 middle;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (offsets[middle] < offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return (low < chunk->stream->count && offsets[low] == offset) ? low : RUYI_LEXER_NO_TOKEN;
+}
+
+// a run of good tokens of the joined stream
+typedef struct {
+    ruyi_token_stream *tokens;
+    BOOL owned;                 // tokens are lexed again by the join, not of a chunk
+    UINT32 from;
+    UINT32 to;
+    UINT32 base;                // added to the offsets of the tokens
+    UINT32 literal_from;        // the first literal of the tokens in the literal_table of tokens
+    UINT32 literal_count;
+    UINT32 index;               // where the tokens go in the joined stream
+    UINT32 literal_index;       // where the literals go in the joined stream
+} ruyi_lexer_piece;
+
+typedef struct {
+    ruyi_lexer_piece *pieces;
+    UINT32 count;
+    UINT32 capacity;
+    ruyi_token_stream *stream;
+} ruyi_lexer_join;
+
+static void ruyi_lexer_join_add(ruyi_lexer_join *join, ruyi_token_stream *tokens, BOOL owned, UINT32 from, UINT32 to, UINT32 base) {
+    ruyi_lexer_piece *piece;
+    ruyi_lexer_piece *pieces;
+    UINT32 first = from;
+    UINT32 last = to;
+    if (join->count == join->capacity) {
+        join->capacity *= 2;
+        pieces = (ruyi_lexer_piece*)ruyi_mem_alloc(sizeof(ruyi_lexer_piece) * join->capacity);
+        memcpy(pieces, join->pieces, sizeof(ruyi_lexer_piece) * join->count);
+        ruyi_mem_free(join->pieces);
+        join->pieces = pieces;
+    }
+    piece = &join->pieces[join->count++];
+    piece->tokens = tokens;
+    piece->owned = owned;
+    piece->from = from;
+    piece->to = to;
+    piece->base = base;
+    // the literals of the tokens in order are next to each other in the table
+    while (first < to && tokens->literals[first] == RUYI_TOKEN_NO_LITERAL) {
+        first++;
+    }
+    while (last > first && tokens->literals[last - 1] == RUYI_TOKEN_NO_LITERAL) {
+        last--;
+    }
+    piece->literal_from = first < to ? tokens->literals[first] : 0;
+    piece->literal_count = first < to ? tokens->literals[last - 1] + 1 - piece->literal_from : 0;
+}
+
+static void ruyi_lexer_copy_piece(void *data, UINT32 job) {
+    const ruyi_lexer_join *join = (const ruyi_lexer_join*)data;
+    const ruyi_lexer_piece *piece = &join->pieces[job];
+    const ruyi_token_stream *tokens = piece->tokens;
+    ruyi_token_stream *stream = join->stream;
+    UINT32 count = piece->to - piece->from;
+    UINT32 shift = piece->literal_index - piece->literal_from;
+    UINT32 i, literal;
+    memcpy(stream->types + piece->index, tokens->types + piece->from, sizeof(BYTE) * count);
+    memcpy(stream->lengths + piece->index, tokens->lengths + piece->from, sizeof(UINT32) * count);
+    for (i = 0; i < count; i++) {
+        stream->offsets[piece->index + i] = tokens->offsets[piece->from + i] + piece->base;
+        literal = tokens->literals[piece->from + i];
+        stream->literals[piece->index + i] = (literal == RUYI_TOKEN_NO_LITERAL) ? literal : literal + shift;
+    }
+    memcpy(stream->literal_table + piece->literal_index, tokens->literal_table + piece->literal_from,
+           sizeof(ruyi_token_literal) * piece->literal_count);
+}
+
+/*
+ Join the chunks in order. The first chunk starts the file, so its tokens are good up to its first break.
+ From a break the tokens are lexed again, until one of them is also a token of a chunk: the lexer starts
+ between tokens there, so the tokens of the chunk are good again up to its next break.
+ Only the runs of good tokens are found in order, they are copied to the joined stream by the threads.
+ */
+static ruyi_token_stream* ruyi_lexer_join_chunks(ruyi_lexer_chunk *chunks, UINT32 count, const BYTE *source, UINT32 length, UINT32 options, UINT32 threads) {
+    ruyi_lexer_join join;
+    ruyi_token_stream *stream = ruyi_token_stream_create();
+    ruyi_token_stream *again;
+    UINT32 *bases = (UINT32*)ruyi_mem_alloc(sizeof(UINT32) * (count + 1));
+    ruyi_lexer_reader *reader;
+    ruyi_token *token;
+    ruyi_token end;
+    UINT32 c, j, b, from, to, restart, start, literal_count;
+    BOOL synced = FALSE;    // from is a token found by the lexing again, not the start of a chunk
+    BOOL failed = FALSE;
+    BOOL ended = FALSE;     // the END is lexed again
+    stream->lines = ruyi_line_table_create();
+    stream->arena = ruyi_mem_arena_create(LEXER_ARENA_BLOCK_SIZE);
+    join.capacity = count * 2;
+    join.pieces = (ruyi_lexer_piece*)ruyi_mem_alloc(sizeof(ruyi_lexer_piece) * join.capacity);
+    join.count = 0;
+    join.stream = stream;
+    bases[0] = 0;
+    for (c = 0; c < count; c++) {
+        bases[c + 1] = bases[c] + chunks[c].chars;
+        ruyi_line_table_append(stream->lines, chunks[c].lines, bases[c]);
+        ruyi_mem_arena_merge(stream->arena, chunks[c].stream->arena);
+        chunks[c].stream->arena = NULL;
+    }
+    c = 0;
+    from = 0;
+    for (;;) {
+        // a token found by the lexing again is after the breaks right before it
+        for (b = 0; b < chunks[c].break_count && chunks[c].breaks[b].token < from + synced; b++) {
+        }
+        to = b < chunks[c].break_count ? chunks[c].breaks[b].token : chunks[c].stream->count;
+        ruyi_lexer_join_add(&join, chunks[c].stream, FALSE, from, to, bases[c]);
+        if (b == chunks[c].break_count) {
+            if (++c < count) {
+                from = 0;
+                synced = FALSE;
+                continue;
+            }
+            break;
+        }
+        restart = bases[c] + chunks[c].breaks[b].restart;
+        start = (UINT32)(chunks[c].bytes - source) + ruyi_lexer_utf8_bytes(chunks[c].bytes, chunks[c].length, chunks[c].breaks[b].restart);
+        reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_view(source + start, length - start), options | Ruyi_lo_QUIET);
+        reader->offset = restart;
+        again = ruyi_token_stream_create();
+        j = c;
+        from = RUYI_LEXER_NO_TOKEN;
+        for (;;) {
+            token = ruyi_lexer_next_token_impl(reader);
+            if (token == NULL) {
+                ruyi_lexer_print_error(stream->lines, reader->error_message, reader->error_offset);
+                failed = TRUE;
+                break;
+            }
+            if (token->type == Ruyi_tt_END) {
+                ruyi_token_stream_add(again, token);
+                ended = TRUE;
+                break;
+            }
+            while (j + 1 < count && bases[j + 1] <= token->offset) {
+                j++;
+            }
+            from = ruyi_lexer_chunk_find_token(&chunks[j], token->offset - bases[j]);
+            if (from != RUYI_LEXER_NO_TOKEN) {
+                c = j;
+                synced = TRUE;
+                break;
+            }
+            ruyi_token_stream_add(again, token);
+        }
+        ruyi_lexer_join_add(&join, again, TRUE, 0, again->count, 0);
+        ruyi_mem_arena_merge(stream->arena, reader->arena);
+        reader->arena = NULL;
+        ruyi_lexer_reader_close(reader);
+        if (ended || failed) {
+            break;
+        }
+    }
+    if (!failed) {
+        count = 0;
+        literal_count = 0;
+        for (j = 0; j < join.count; j++) {
+            join.pieces[j].index = count;
+            join.pieces[j].literal_index = literal_count;
+            count += join.pieces[j].to - join.pieces[j].from;
+            literal_count += join.pieces[j].literal_count;
+        }
+        ruyi_token_stream_reserve(stream, count + 1, literal_count);
+        ruyi_jobs_run(ruyi_lexer_copy_piece, &join, join.count, threads);
+        stream->count = count;
+        stream->literal_count = literal_count;
+        if (!ended) {
+            // the same END as the reader makes at the end of file
+            end.type = Ruyi_tt_END;
+            end.size = 1;
+            end.offset = bases[c];
+            end.symbol = RUYI_SYMBOL_NONE;
+            ruyi_token_stream_add(stream, &end);
+        }
+    }
+    for (j = 0; j < join.count; j++) {
+        if (join.pieces[j].owned) {
+            ruyi_token_stream_destroy(join.pieces[j].tokens);
+        }
+    }
+    ruyi_mem_free(join.pieces);
+    ruyi_mem_free(bases);
+    if (failed) {
+        ruyi_token_stream_destroy(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+#endif
+
+ruyi_token_stream* ruyi_lexer_tokenize_parallel(ruyi_file *file, UINT32 options, UINT32 threads) {
+#if defined(_WIN32)
+    return ruyi_lexer_tokenize_all(file, options);
+#else
+    ruyi_lexer_chunk *chunks;
+    ruyi_token_stream *stream;
+    UINT32 length, count, i;
+    assert(file);
+    // a streamed file is not kept, the chunks need the whole source
+    if (file->type == Ruyi_tf_FILE) {
+        return ruyi_lexer_tokenize_all(file, options);
+    }
+    if (threads == 0) {
+        threads = ruyi_jobs_cpu_count();
+    }
+    length = file->write_pos - file->read_pos;
+    count = threads * RUYI_LEXER_CHUNKS_PER_THREAD;
+    if (count > length / RUYI_LEXER_CHUNK_MIN_SIZE) {
+        count = length / RUYI_LEXER_CHUNK_MIN_SIZE;
+    }
+    if (threads < 2 || count < 2) {
+        return ruyi_lexer_tokenize_all(file, options);
+    }
+    chunks = (ruyi_lexer_chunk*)ruyi_mem_alloc(sizeof(ruyi_lexer_chunk) * count);
+    count = ruyi_lexer_make_chunks(file->dist.buffer + file->read_pos, length, count, options, chunks);
+    ruyi_jobs_run(ruyi_lexer_lex_chunk_job, chunks, count, threads);
+    stream = ruyi_lexer_join_chunks(chunks, count, file->dist.buffer + file->read_pos, length, options, threads);
+    for (i = 0; i < count; i++) {
+        ruyi_token_stream_destroy(chunks[i].stream);
+        ruyi_line_table_destroy(chunks[i].lines);
+        ruyi_mem_free(chunks[i].breaks);
+    }
+    ruyi_mem_free(chunks);
+    ruyi_file_close(file);
+    return stream;
+#endif
+}
+
+void ruyi_token_cursor_init(ruyi_token_cursor *cursor, const ruyi_token_stream *stream) {
+    assert(cursor);
+    assert(stream && stream->count > 0);
+    cursor->stream = stream;
+    cursor->index = 0;
+    cursor->end = stream->count - 1;
+}
+
+// index of the token n ahead, the END token past the end
+static UINT32 ruyi_token_cursor_index(const ruyi_token_cursor *cursor, UINT32 n) {
+    if (n >= cursor->end - cursor->index) {
+        return cursor->end;
+    }
+    return cursor->index + n;
+}
+
+ruyi_token_type ruyi_token_cursor_peek(const ruyi_token_cursor *cursor, UINT32 n) {
+    UINT32 index = ruyi_token_cursor_index(cursor, n);
+    // the end of a range is not an END in the stream
+    return index == cursor->end ? Ruyi_tt_END : (ruyi_token_type)cursor->stream->types[index];
+}
+
+void ruyi_token_cursor_get(ruyi_token_cursor *cursor, UINT32 n, ruyi_token *out_token) {
+    const ruyi_token_stream *stream = cursor->stream;
+    UINT32 index = ruyi_token_cursor_index(cursor, n);
+    UINT32 literal = stream->literals[index];
+    out_token->type = (ruyi_token_type)stream->types[index];
+    out_token->offset = stream->offsets[index];
+    out_token->size = stream->lengths[index];
+    if (literal == RUYI_TOKEN_NO_LITERAL) {
+        out_token->symbol = RUYI_SYMBOL_NONE;
+        out_token->value.int_value = 0;
+    } else {
+        out_token->symbol = stream->literal_table[literal].symbol;
+        out_token->value.int_value = stream->literal_table[literal].value.int_value;
+        if (out_token->type == Ruyi_tt_FLOAT) {
+            out_token->value.float_value = stream->literal_table[literal].value.float_value;
+        } else if (out_token->type == Ruyi_tt_IDENTITY || out_token->type == Ruyi_tt_STRING) {
+            out_token->value.str_value = stream->literal_table[literal].value.str_value;
+        }
+    }
+    if (index == cursor->end && out_token->type != Ruyi_tt_END) {
+        // the END of a range is at the token after it
+        out_token->type = Ruyi_tt_END;
+        out_token->size = 1;
+        out_token->symbol = RUYI_SYMBOL_NONE;
+        out_token->value.int_value = 0;
+    }
+}
+
+void ruyi_token_cursor_advance(ruyi_token_cursor *cursor, UINT32 n) {
+    cursor->index = ruyi_token_cursor_index(cursor, n);
 }
@@ -12,8 +12,11 @@
 #include "ruyi_basics.h"
 #include "ruyi_list.h"
 #include "ruyi_io.h"
+#include "ruyi_line_table.h"
 #include "ruyi_hashtable.h"
 #include "ruyi_unicode.h"
+#include "ruyi_mem.h"
+#include "ruyi_symbol.h"
 #include <stdio.h>
 
 typedef enum {
@@ -38,7 +41,7 @@ typedef enum {
     Ruyi_tt_DEC,            // --
     
     Ruyi_tt_LPAREN,         // (
-    Ruyi_tt_RPAREN,         // (
+    Ruyi_tt_RPAREN,         // )
     Ruyi_tt_LBRACKET,       // [
     Ruyi_tt_RBRACKET,       // ]
     Ruyi_tt_LBRACE,         // {
@@ -127,9 +130,11 @@ typedef enum {
 
 typedef struct _ruyi_token {
     ruyi_token_type type;
-    UINT32 line;
-    UINT32 column;
     UINT32 size;
+    // count of chars before the token in the source, ruyi_lexer_reader_position finds its line and column
+    UINT32 offset;
+    // interned id of an identifier, str_value of an identifier is the canonical string of the symbol
+    ruyi_symbol symbol;
     union {
         INT64 int_value;
         double float_value;
@@ -137,38 +142,176 @@ typedef struct _ruyi_token {
     } value;
 } ruyi_token;
 
-#define LEXER_TOKEN_SNAPSHOT_STR_SIZE 128
+// max chars of the text of a token found by ruyi_lexer_reader_token_text
+#define LEXER_TOKEN_TEXT_SIZE 128
 
+// the token last peeked or read for the errors of the parser, only its place is kept
 typedef struct {
-    ruyi_token_type type;
-    UINT32 line;
-    UINT32 column;
-    UINT32 size;
+    UINT32 offset;
+    UINT32 size;        // 0 if there is no token
+} ruyi_token_snapshot;
+
+// must be a power of 2, and larger than LEXER_CHARS_DECODE_SIZE plus the max chars the DFA reads past a match
+#define LEXER_CHARS_RING_SIZE 1024
+#define LEXER_CHARS_DECODE_SIZE 256
+
+typedef struct {
+    UINT32 offset;
+    WIDE_CHAR c;
+} ruyi_pos_char;
+
+// literal index of a token without value
+#define RUYI_TOKEN_NO_LITERAL 0xFFFFFFFF
+
+// value of an identifier, string, char or number in a token stream
+typedef struct {
+    ruyi_symbol symbol;
     union {
         INT64 int_value;
         double float_value;
+        ruyi_unicode_string* str_value;
     } value;
-    WIDE_CHAR str_snapshot[LEXER_TOKEN_SNAPSHOT_STR_SIZE];
-} ruyi_token_snapshot;
+} ruyi_token_literal;
+
+/*
+ All tokens of a file in parallel arrays, made by ruyi_lexer_tokenize_all.
+ The types are scanned by the parser far more often than the rest, so they are packed in bytes.
+ Lines and columns are only needed by errors, they are found from the offsets by the line table of the file.
+ */
+typedef struct {
+    UINT32 count;           // the last token is Ruyi_tt_END
+    UINT32 capacity;
+    BYTE *types;            // ruyi_token_type
+    UINT32 *offsets;        // count of chars before the token
+    UINT32 *lengths;        // size in chars
+    UINT32 *literals;       // index in literal_table, or RUYI_TOKEN_NO_LITERAL
+    ruyi_token_literal *literal_table;
+    UINT32 literal_count;
+    UINT32 literal_capacity;
+    // strings of the literals
+    ruyi_mem_arena *arena;
+    ruyi_line_table *lines;
+} ruyi_token_stream;
+
+// reads a token stream, any token ahead can be looked at in O(1)
+typedef struct {
+    const ruyi_token_stream *stream;
+    UINT32 index;           // the next token
+    UINT32 end;             // the token read as the END, count - 1 unless only a range of the tokens is read
+} ruyi_token_cursor;
+
+// options of a lexer reader, they can be combined by |
+typedef enum {
+    Ruyi_lo_NONE            = 0,
+    // no comment tokens, comments are skipped without being decoded, so broken utf-8 in them is not found
+    Ruyi_lo_SKIP_COMMENTS   = 1,
+    // lexer errors are not printed, the last one is kept in error_message and error_offset of the reader
+    Ruyi_lo_QUIET           = 2,
+} ruyi_lexer_option;
+
+#define LEXER_LOOKAHEAD_INIT_SIZE 16
+#define LEXER_TEXT_INIT_SIZE 64
+#define LEXER_ARENA_BLOCK_SIZE (64 * 1024)
 
 typedef struct _ruyi_lexer_reader {
-    ruyi_list *token_buffer_queue;
+    /*
+     lexed tokens not read yet, a ring which doubles when it is full:
+     lookahead_head: index of the next token to read
+     lookahead_count: count of tokens available from lookahead_head
+     */
+    ruyi_token *lookahead;
+    UINT32 lookahead_head;
+    UINT32 lookahead_count;
+    UINT32 lookahead_capacity;
+    // the token being lexed
+    ruyi_token building_token;
+    // chars of the identifier or string being lexed
+    WIDE_CHAR *text_buffer;
+    UINT32 text_length;
+    UINT32 text_capacity;
+    // tokens returned by ruyi_lexer_reader_next_token and token strings, released when the reader closed
+    ruyi_mem_arena *arena;
     ruyi_unicode_file *file;
     /*
-     2-items as a wide_char:
-     first: char value as type WIDE_CHAR
-     second: char pos as type UINT64(line,column)
+     decoded chars ring buffer:
+     chars_head: index of the next char to read
+     chars_count: count of chars available from chars_head
+     the offset of a char is not kept, it goes along with its index from offset - chars_count
      */
-    ruyi_list *chars_buffer_queue;
-    UINT32 line;
-    UINT32 column;
+    WIDE_CHAR chars_ring[LEXER_CHARS_RING_SIZE];
+    UINT32 chars_head;
+    UINT32 chars_count;
     ruyi_token_snapshot token_snapshot;
+    // ruyi_lexer_option flags
+    UINT32 options;
+    // chars decoded from the file
+    UINT32 offset;
+    // lines of the chars decoded, or of the token stream
+    ruyi_line_table *lines;
+    // the last lexer error, NULL if there is none, and the offset of the token with it
+    const char *error_message;
+    UINT32 error_offset;
+    // a comment skipped by Ruyi_lo_SKIP_COMMENTS runs to the end of file
+    BOOL open_comment;
+    // tokens are read from cursor.stream instead of the file if it is not NULL
+    ruyi_token_cursor cursor;
 } ruyi_lexer_reader;
 
 ruyi_lexer_reader* ruyi_lexer_reader_open(ruyi_file *file);
 
+/**
+ * Open a lexer reader with options
+ * params:
+ * file - the source, it will be closed when call ruyi_lexer_reader_close
+ * options - ruyi_lexer_option flags, e.g. Ruyi_lo_SKIP_COMMENTS for the parser which has no use of comments
+ */
+ruyi_lexer_reader* ruyi_lexer_reader_open_with_options(ruyi_file *file, UINT32 options);
+
+/**
+ * Open a lexer reader over the tokens of ruyi_lexer_tokenize_all, the parser reads it the same as a file
+ * params:
+ * stream - the tokens, it must not be destroyed before the reader closed
+ */
+ruyi_lexer_reader* ruyi_lexer_reader_open_stream(const ruyi_token_stream *stream);
+
+/**
+ * Open a lexer reader over a range of the tokens of a stream, e.g. a global declaration parsed by a worker
+ * params:
+ * stream - the tokens, it must not be destroyed before the reader closed
+ * from - index of the first token
+ * end - index of the token read as the END, so the range is [from, end)
+ */
+ruyi_lexer_reader* ruyi_lexer_reader_open_stream_range(const ruyi_token_stream *stream, UINT32 from, UINT32 end);
+
+/**
+ * Get the index of the next token of a reader opened over a token stream
+ * params:
+ * reader - target object
+ * return:
+ * index of the token in the stream, the END of the reader past the end
+ */
+UINT32 ruyi_lexer_reader_token_index(const ruyi_lexer_reader *reader);
+
+/**
+ * Move a reader opened over a token stream to a token, the tokens looked ahead are dropped
+ * params:
+ * reader - target object
+ * index - index of the token in the stream, not after the END of the reader
+ */
+void ruyi_lexer_reader_seek_token(ruyi_lexer_reader *reader, UINT32 index);
+
 void ruyi_lexer_reader_close(ruyi_lexer_reader *reader);
 
+/**
+ * Find the line and column of an offset, e.g. of a token, only a diagnostic should need it
+ * params:
+ * reader - target object
+ * offset - count of chars before the position, it must have been lexed
+ * line - receives the line, from 1
+ * column - receives the column, from 1
+ */
+void ruyi_lexer_reader_position(const ruyi_lexer_reader *reader, UINT32 offset, UINT32 *line, UINT32 *column);
+
 ruyi_token * ruyi_lexer_reader_next_token(ruyi_lexer_reader *reader);
 
 void ruyi_lexer_reader_consume_token(ruyi_lexer_reader *reader);
@@ -177,10 +320,87 @@ void ruyi_lexer_reader_push_front(ruyi_lexer_reader *reader, ruyi_token *token);
 
 ruyi_token_type ruyi_lexer_reader_peek_token_type(ruyi_lexer_reader *reader);
 
+/**
+ * Get the type of a token ahead without reading any, the tokens before it are lexed and kept in the lookahead ring
+ * params:
+ * reader - target object
+ * n - 0 for the next token, the same as ruyi_lexer_reader_peek_token_type, 1 for the one after it and so on
+ * return:
+ * type of the token, Ruyi_tt_END if the source ends or lexing fails before it
+ */
+ruyi_token_type ruyi_lexer_reader_peek_nth_token_type(ruyi_lexer_reader *reader, UINT32 n);
+
+// tokens are owned by the reader's arena, so this does nothing now
 void ruyi_lexer_token_destroy(ruyi_token * token);
 
 BOOL ruyi_lexer_reader_consume_token_if_match(ruyi_lexer_reader *reader, ruyi_token_type type, ruyi_token* out_token);
 
+/**
+ * Lex a whole file to a token stream
+ * params:
+ * file - the source, it will be closed
+ * options - ruyi_lexer_option flags
+ * return:
+ * the tokens, release it by ruyi_token_stream_destroy. NULL if a lexer error occurs, the error has been printed
+ */
+ruyi_token_stream* ruyi_lexer_tokenize_all(ruyi_file *file, UINT32 options);
+
+/**
+ * Get the source text of a token, e.g. for an error.
+ * The text is found in the bytes of the file from its start, so it is slow and only for the error path.
+ * params:
+ * reader - target object
+ * offset - offset of the token
+ * size - chars of the token, at most LEXER_TOKEN_TEXT_SIZE chars are got
+ * buf - receives the utf-8 text ending with '\0'
+ * buf_size - bytes of buf
+ * return:
+ * bytes of the text, 0 if the source is not kept: a Ruyi_tf_FILE is read as a stream,
+ * and a reader of a token stream has no source
+ */
+UINT32 ruyi_lexer_reader_token_text(const ruyi_lexer_reader *reader, UINT32 offset, UINT32 size, char *buf, UINT32 buf_size);
+
+/**
+ * Lex a whole file to a token stream on some threads, the tokens are the same as ruyi_lexer_tokenize_all.
+ * The source is cut into chunks after '\n', each chunk is lexed by a worker as if it starts between tokens.
+ * The chunks are then joined in order, where a chunk does not start between tokens, e.g. in a string or
+ * a comment, the tokens are lexed again from the end of the last good token until they meet a chunk.
+ * Only data and mmap files of 2 MB or more are lexed in parallel, the others are lexed as ruyi_lexer_tokenize_all.
+ * params:
+ * file - the source, it will be closed
+ * options - ruyi_lexer_option flags
+ * threads - count of threads, 0 for one per cpu
+ * return:
+ * the tokens, release it by ruyi_token_stream_destroy. NULL if a lexer error occurs, the error has been printed
+ */
+ruyi_token_stream* ruyi_lexer_tokenize_parallel(ruyi_file *file, UINT32 options, UINT32 threads);
+
+void ruyi_token_stream_destroy(ruyi_token_stream *stream);
+
+void ruyi_token_cursor_init(ruyi_token_cursor *cursor, const ruyi_token_stream *stream);
+
+/**
+ * Get the type of a token ahead
+ * params:
+ * cursor - target object
+ * n - 0 for the next token, 1 for the one after it, ...
+ * return:
+ * the type, Ruyi_tt_END past the end
+ */
+ruyi_token_type ruyi_token_cursor_peek(const ruyi_token_cursor *cursor, UINT32 n);
+
+/**
+ * Make a token ahead with its value and position
+ * params:
+ * cursor - target object
+ * n - 0 for the next token, 1 for the one after it, ...
+ * out_token - receives the token, the END token past the end
+ */
+void ruyi_token_cursor_get(ruyi_token_cursor *cursor, UINT32 n, ruyi_token *out_token);
+
+// move forward n tokens, it stops at the END token
+void ruyi_token_cursor_advance(ruyi_token_cursor *cursor, UINT32 n);
+
 // keywords
 ruyi_token_type ruyi_lexer_keywords_get_type(ruyi_unicode_string * token_value);
 
@@ -0,0 +1,176 @@
+//
+//  ruyi_line_table.c
+//  ruyi
+//
+
+#include "ruyi_line_table.h"
+#include "ruyi_mem.h"
+#include <string.h> // for memchr, memcpy
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define RUYI_LINE_TABLE_SIMD_X86 1
+#include <emmintrin.h>
+#endif
+
+#define RUYI_LINE_TABLE_INIT_SIZE 256
+#define RUYI_LINE_TABLE_RETURNS_INIT_SIZE 16
+
+ruyi_line_table* ruyi_line_table_create(void) {
+    ruyi_line_table *table = (ruyi_line_table*)ruyi_mem_alloc(sizeof(ruyi_line_table));
+    table->capacity = RUYI_LINE_TABLE_INIT_SIZE;
+    table->starts = (UINT32*)ruyi_mem_alloc(sizeof(UINT32) * table->capacity);
+    table->starts[0] = 0;
+    table->count = 1;
+    table->return_capacity = RUYI_LINE_TABLE_RETURNS_INIT_SIZE;
+    table->returns = (UINT32*)ruyi_mem_alloc(sizeof(UINT32) * table->return_capacity);
+    table->return_count = 0;
+    return table;
+}
+
+void ruyi_line_table_destroy(ruyi_line_table *table) {
+    if (!table) {
+        return;
+    }
+    ruyi_mem_free(table->starts);
+    ruyi_mem_free(table->returns);
+    ruyi_mem_free(table);
+}
+
+static UINT32* ruyi_line_table_grow(UINT32 *array, UINT32 count, UINT32 new_capacity) {
+    UINT32 *new_array = (UINT32*)ruyi_mem_alloc(sizeof(UINT32) * new_capacity);
+    memcpy(new_array, array, sizeof(UINT32) * count);
+    ruyi_mem_free(array);
+    return new_array;
+}
+
+static void ruyi_line_table_add_line(ruyi_line_table *table, UINT32 start) {
+    if (table->count == table->capacity) {
+        table->starts = ruyi_line_table_grow(table->starts, table->count, table->capacity * 2);
+        table->capacity *= 2;
+    }
+    table->starts[table->count++] = start;
+}
+
+static void ruyi_line_table_add_return(ruyi_line_table *table, UINT32 offset) {
+    if (table->return_count == table->return_capacity) {
+        table->returns = ruyi_line_table_grow(table->returns, table->return_count, table->return_capacity * 2);
+        table->return_capacity *= 2;
+    }
+    table->returns[table->return_count++] = offset;
+}
+
+// chars[i] may be '\n' or '\r', a '\r' at the end of the chars is kept as the next char is not known
+static void ruyi_line_table_add_char(ruyi_line_table *table, const WIDE_CHAR *chars, UINT32 i, UINT32 length, UINT32 offset) {
+    if (chars[i] == '\n') {
+        ruyi_line_table_add_line(table, offset + i + 1);
+    } else if (chars[i] == '\r' && (i + 1 == length || chars[i + 1] != '\n')) {
+        ruyi_line_table_add_return(table, offset + i);
+    }
+}
+
+void ruyi_line_table_scan_chars(ruyi_line_table *table, const WIDE_CHAR *chars, UINT32 length, UINT32 offset) {
+    UINT32 i = 0;
+    UINT32 j;
+#if defined(RUYI_LINE_TABLE_SIMD_X86)
+    // 8 chars a step, most steps have neither '\n' nor '\r'
+    __m128i new_line = _mm_set1_epi32('\n');
+    __m128i carriage_return = _mm_set1_epi32('\r');
+    __m128i low, high, hit;
+    for (; i + 8 <= length; i += 8) {
+        low = _mm_loadu_si128((const __m128i*)(chars + i));
+        high = _mm_loadu_si128((const __m128i*)(chars + i + 4));
+        hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(low, new_line), _mm_cmpeq_epi32(low, carriage_return)),
+                           _mm_or_si128(_mm_cmpeq_epi32(high, new_line), _mm_cmpeq_epi32(high, carriage_return)));
+        if (_mm_movemask_epi8(hit) != 0) {
+            for (j = i; j < i + 8; j++) {
+                ruyi_line_table_add_char(table, chars, j, length, offset);
+            }
+        }
+    }
+#endif
+    for (; i < length; i++) {
+        if (chars[i] <= '\r') {
+            ruyi_line_table_add_char(table, chars, i, length, offset);
+        }
+    }
+}
+
+static UINT32 ruyi_line_table_count_chars(const BYTE *bytes, UINT32 length) {
+    UINT32 chars = 0;
+    UINT32 i;
+    for (i = 0; i < length; i++) {
+        // continuation bytes of an utf-8 char are not counted
+        chars += ((bytes[i] & 0xC0) != 0x80);
+    }
+    return chars;
+}
+
+UINT32 ruyi_line_table_scan_utf8(ruyi_line_table *table, const BYTE *bytes, UINT32 length, UINT32 offset) {
+    const BYTE *end = bytes + length;
+    const BYTE *p = bytes;
+    // an ascii byte is never a part of a multibyte char, so they are found by memchr
+    const BYTE *next_line = (const BYTE*)memchr(p, '\n', length);
+    const BYTE *next_return = (const BYTE*)memchr(p, '\r', length);
+    const BYTE *hit;
+    UINT32 chars = 0;
+    for (;;) {
+        hit = next_line;
+        if (hit == NULL || (next_return != NULL && next_return < hit)) {
+            hit = next_return;
+        }
+        if (hit == NULL) {
+            break;
+        }
+        chars += ruyi_line_table_count_chars(p, (UINT32)(hit - p));
+        p = hit + 1;
+        if (*hit == '\n') {
+            ruyi_line_table_add_line(table, offset + chars + 1);
+            next_line = (const BYTE*)memchr(p, '\n', end - p);
+        } else {
+            if (p == end || *p != '\n') {
+                ruyi_line_table_add_return(table, offset + chars);
+            }
+            next_return = (const BYTE*)memchr(p, '\r', end - p);
+        }
+        chars++;
+    }
+    return chars + ruyi_line_table_count_chars(p, (UINT32)(end - p));
+}
+
+void ruyi_line_table_append(ruyi_line_table *table, const ruyi_line_table *part, UINT32 offset) {
+    UINT32 i;
+    // the first line of the part has been added by the '\n' before it
+    assert(offset == 0 || table->starts[table->count - 1] == offset);
+    for (i = 1; i < part->count; i++) {
+        ruyi_line_table_add_line(table, part->starts[i] + offset);
+    }
+    for (i = 0; i < part->return_count; i++) {
+        ruyi_line_table_add_return(table, part->returns[i] + offset);
+    }
+}
+
+// count of the items less than value in a sorted array
+static UINT32 ruyi_line_table_lower_bound(const UINT32 *array, UINT32 count, UINT32 value) {
+    UINT32 low = 0;
+    UINT32 high = count;
+    UINT32 middle;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (array[middle] < value) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+void ruyi_line_table_position(const ruyi_line_table *table, UINT32 offset, UINT32 *line, UINT32 *column) {
+    // the last line starting at or before the offset, starts[0] is 0 so there is always one
+    UINT32 index = ruyi_line_table_lower_bound(table->starts, table->count, offset + 1) - 1;
+    UINT32 start = table->starts[index];
+    UINT32 returns = ruyi_line_table_lower_bound(table->returns, table->return_count, offset) -
+        ruyi_line_table_lower_bound(table->returns, table->return_count, start);
+    *line = index + 1;
+    *column = offset - start + 1 - returns;
+}
@@ -0,0 +1,72 @@
+//
+//  ruyi_line_table.h
+//  ruyi
+//
+
+#ifndef ruyi_line_table_h
+#define ruyi_line_table_h
+
+#include "ruyi_basics.h"
+
+/*
+ Where the lines of a source start, so a char offset can be turned to a line and column.
+ Offsets are counts of chars before a position, a line starts after each '\n'.
+ A '\r' takes no column, so they are kept too. No position is ever at a '\n', so the '\r' right before one
+ can be left out, which keeps the table of a CRLF source as small as the others.
+ The lexer only adds lines, a position is found by binary search when a diagnostic needs it.
+ */
+typedef struct _ruyi_line_table {
+    UINT32 *starts;         // offsets of the first chars of the lines, starts[0] is 0
+    UINT32 count;
+    UINT32 capacity;
+    UINT32 *returns;        // offsets of the '\r' in the lines
+    UINT32 return_count;
+    UINT32 return_capacity;
+} ruyi_line_table;
+
+ruyi_line_table* ruyi_line_table_create(void);
+
+void ruyi_line_table_destroy(ruyi_line_table *table);
+
+/**
+ * Add the lines and '\r' of some decoded chars, the chars must be scanned in order of the source
+ * params:
+ * table - target object
+ * chars - the chars
+ * length - count of chars
+ * offset - offset of the first char
+ */
+void ruyi_line_table_scan_chars(ruyi_line_table *table, const WIDE_CHAR *chars, UINT32 length, UINT32 offset);
+
+/**
+ * Add the lines and '\r' of some utf-8 bytes skipped without decoding
+ * params:
+ * table - target object
+ * bytes - the bytes, they must not end inside a multibyte char
+ * length - count of bytes
+ * offset - offset of the first char
+ * return:
+ * count of chars in the bytes
+ */
+UINT32 ruyi_line_table_scan_utf8(ruyi_line_table *table, const BYTE *bytes, UINT32 length, UINT32 offset);
+
+/**
+ * Add the lines of a table made for a part of the source, e.g. a chunk lexed by a worker
+ * params:
+ * table - target object, it has the lines before the part
+ * part - the lines of the part, from offset 0, the part must start a line
+ * offset - offset of the part in the source
+ */
+void ruyi_line_table_append(ruyi_line_table *table, const ruyi_line_table *part, UINT32 offset);
+
+/**
+ * Find the line and column of a char offset by binary search
+ * params:
+ * table - target object
+ * offset - count of chars before the position
+ * line - receives the line, from 1
+ * column - receives the column, from 1
+ */
+void ruyi_line_table_position(const ruyi_line_table *table, UINT32 offset, UINT32 *line, UINT32 *column);
+
+#endif /* ruyi_line_table_h */
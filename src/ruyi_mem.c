@@ -9,11 +9,28 @@
 #include "ruyi_mem.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h> // for offsetof
 
+#define RUYI_MEM_ARENA_ALIGN 8
+
+struct _ruyi_mem_arena_block {
+    struct _ruyi_mem_arena_block *next;
+    UINT32 used;
+    UINT32 capacity;
+    // data follows, keep the header size aligned
+    UINT64 data[1];
+};
+
+static UINT64 g_ruyi_mem_alloc_count = 0;
 
 void* ruyi_mem_alloc(UINT32 size) {
     void * ptr = malloc(size);
     assert(ptr);
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_add_fetch(&g_ruyi_mem_alloc_count, 1, __ATOMIC_RELAXED);
+#else
+    g_ruyi_mem_alloc_count++;
+#endif
     return ptr;
 }
 
@@ -23,3 +40,99 @@ void ruyi_mem_free(void * pointer) {
     }
     free(pointer);
 }
+
+UINT64 ruyi_mem_alloc_count(void) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(&g_ruyi_mem_alloc_count, __ATOMIC_RELAXED);
+#else
+    return g_ruyi_mem_alloc_count;
+#endif
+}
+
+static ruyi_mem_arena_block* ruyi_mem_arena_block_create(UINT32 capacity) {
+    ruyi_mem_arena_block *block = (ruyi_mem_arena_block*)ruyi_mem_alloc((UINT32)offsetof(ruyi_mem_arena_block, data) + capacity);
+    block->next = NULL;
+    block->used = 0;
+    block->capacity = capacity;
+    return block;
+}
+
+ruyi_mem_arena* ruyi_mem_arena_create(UINT32 block_size) {
+    ruyi_mem_arena *arena = (ruyi_mem_arena*)ruyi_mem_alloc(sizeof(ruyi_mem_arena));
+    arena->blocks = NULL;
+    arena->block_size = block_size;
+    return arena;
+}
+
+void* ruyi_mem_arena_alloc(ruyi_mem_arena *arena, UINT32 size) {
+    ruyi_mem_arena_block *block;
+    void *ptr;
+    assert(arena);
+    size = (size + RUYI_MEM_ARENA_ALIGN - 1) & ~(RUYI_MEM_ARENA_ALIGN - 1);
+    block = arena->blocks;
+    if (block == NULL || block->used + size > block->capacity) {
+        if (size > arena->block_size / 4) {
+            // big one has its own block, keep the current block for the small ones
+            block = ruyi_mem_arena_block_create(size);
+            if (arena->blocks) {
+                block->next = arena->blocks->next;
+                arena->blocks->next = block;
+            } else {
+                arena->blocks = block;
+            }
+        } else {
+            block = ruyi_mem_arena_block_create(arena->block_size);
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
+    }
+    ptr = (BYTE*)block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void ruyi_mem_arena_merge(ruyi_mem_arena *arena, ruyi_mem_arena *other) {
+    ruyi_mem_arena_block *tail;
+    assert(arena);
+    if (!other) {
+        return;
+    }
+    if (other->blocks) {
+        tail = other->blocks;
+        while (tail->next) {
+            tail = tail->next;
+        }
+        // keep the current block of arena first, the others are full or nearly
+        if (arena->blocks) {
+            tail->next = arena->blocks->next;
+            arena->blocks->next = other->blocks;
+        } else {
+            arena->blocks = other->blocks;
+        }
+    }
+    ruyi_mem_free(other);
+}
+
+UINT64 ruyi_mem_arena_size(const ruyi_mem_arena *arena) {
+    const ruyi_mem_arena_block *block;
+    UINT64 size = 0;
+    assert(arena);
+    for (block = arena->blocks; block; block = block->next) {
+        size += block->used;
+    }
+    return size;
+}
+
+void ruyi_mem_arena_destroy(ruyi_mem_arena *arena) {
+    ruyi_mem_arena_block *block, *next;
+    if (!arena) {
+        return;
+    }
+    block = arena->blocks;
+    while (block) {
+        next = block->next;
+        ruyi_mem_free(block);
+        block = next;
+    }
+    ruyi_mem_free(arena);
+}
@@ -15,4 +15,60 @@
 void* ruyi_mem_alloc(UINT32 size);
 void ruyi_mem_free(void * pointer);
 
+/**
+ * Get how many times ruyi_mem_alloc has been called
+ * return:
+ * the allocation count since the process started
+ */
+UINT64 ruyi_mem_alloc_count(void);
+
+typedef struct _ruyi_mem_arena_block ruyi_mem_arena_block;
+
+/**
+ * A bump allocator, all memory of it is released at once by ruyi_mem_arena_destroy
+ */
+typedef struct {
+    ruyi_mem_arena_block *blocks;
+    UINT32 block_size;
+} ruyi_mem_arena;
+
+/**
+ * Create an arena
+ * params:
+ * block_size - the size of each memory block the arena allocated
+ */
+ruyi_mem_arena* ruyi_mem_arena_create(UINT32 block_size);
+
+/**
+ * Allocate memory from an arena, aligned to 8 bytes
+ * params:
+ * arena - target arena
+ * size - the bytes needed
+ */
+void* ruyi_mem_arena_alloc(ruyi_mem_arena *arena, UINT32 size);
+
+/**
+ * Move all memory of an arena into another, e.g. the strings made by a worker thread into the result
+ * params:
+ * arena - target arena
+ * other - it is destroyed, the memory allocated from it is released with arena
+ */
+void ruyi_mem_arena_merge(ruyi_mem_arena *arena, ruyi_mem_arena *other);
+
+/**
+ * Count the bytes allocated from an arena, it walks all blocks
+ * params:
+ * arena - target arena
+ * return:
+ * the bytes, with the padding of the alignment
+ */
+UINT64 ruyi_mem_arena_size(const ruyi_mem_arena *arena);
+
+/**
+ * Release the arena and all memory allocated from it
+ * params:
+ * arena - target arena
+ */
+void ruyi_mem_arena_destroy(ruyi_mem_arena *arena);
+
 #endif /* ruyi_mem_h */
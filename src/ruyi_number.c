@@ -0,0 +1,296 @@
+//
+//  ruyi_number.c
+//  ruyi
+//
+
+#include "ruyi_number.h"
+#include "ruyi_mem.h"
+#include <float.h>  // for FLT_EVAL_METHOD
+#include <stdlib.h> // for strtod
+#include <string.h> // for memcpy
+
+// run tools/gen_number_pow5.py to regenerate it
+#include "ruyi_number_pow5.inc"
+
+// max decimal digits always fit in UINT64
+#define RUYI_NUMBER_MAX_DIGITS 19
+#define RUYI_NUMBER_MANTISSA_BITS 52
+#define RUYI_NUMBER_EXPONENT_BIAS 1023
+#define RUYI_NUMBER_INFINITE_POWER 0x7FF
+// the exponent is clamped to it while scanning, far beyond the range of double
+#define RUYI_NUMBER_EXPONENT_LIMIT 100000
+#define RUYI_NUMBER_STACK_BUFFER_SIZE 128
+
+typedef struct {
+    UINT64 high;
+    UINT64 low;
+} ruyi_number_u128;
+
+static UINT32 ruyi_number_digit_value(WIDE_CHAR c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return 16;
+}
+
+BOOL ruyi_number_parse_uint64(const WIDE_CHAR *text, UINT32 length, UINT32 radix, UINT64 *out) {
+    UINT64 value = 0;
+    UINT64 limit = UINT64_MAX / radix;
+    UINT32 digit;
+    UINT32 i;
+    for (i = 0; i < length; i++) {
+        digit = ruyi_number_digit_value(text[i]);
+        if (digit >= radix) {
+            return FALSE;
+        }
+        if (value > limit || value * radix > UINT64_MAX - digit) {
+            return FALSE;
+        }
+        value = value * radix + digit;
+    }
+    *out = value;
+    return TRUE;
+}
+
+static ruyi_number_u128 ruyi_number_mul64(UINT64 a, UINT64 b) {
+    ruyi_number_u128 result;
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    result.high = (UINT64)(r >> 64);
+    result.low = (UINT64)r;
+#else
+    UINT64 a_lo = (UINT32)a, a_hi = a >> 32;
+    UINT64 b_lo = (UINT32)b, b_hi = b >> 32;
+    UINT64 p0 = a_lo * b_lo;
+    UINT64 p1 = a_lo * b_hi;
+    UINT64 p2 = a_hi * b_lo;
+    UINT64 p3 = a_hi * b_hi;
+    UINT64 middle = p1 + (p0 >> 32) + (UINT32)p2;
+    result.low = (middle << 32) | (UINT32)p0;
+    result.high = p3 + (middle >> 32) + (p2 >> 32);
+#endif
+    return result;
+}
+
+static UINT32 ruyi_number_leading_zeros(UINT64 w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (UINT32)__builtin_clzll(w);
+#else
+    UINT32 n = 0;
+    while ((w & 0x8000000000000000ULL) == 0) {
+        w <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/*
+ Eisel-Lemire: w * 10^q to the bits of the nearest double, w must not be 0.
+ The 128-bit product of w and 5^q decides the result except in rare cases near a halfway point,
+ then it returns FALSE and the caller must use an exact way.
+ See: Daniel Lemire, Number Parsing at a Gigabyte per Second.
+ */
+static BOOL ruyi_number_eisel_lemire(INT32 q, UINT64 w, UINT64 *bits) {
+    ruyi_number_u128 product, second;
+    UINT64 mantissa;
+    INT32 power2;
+    UINT32 lz, upperbit, shift, index;
+    if (q < RUYI_NUMBER_SMALLEST_POWER10) {
+        *bits = 0;
+        return TRUE;
+    }
+    if (q > RUYI_NUMBER_LARGEST_POWER10) {
+        *bits = (UINT64)RUYI_NUMBER_INFINITE_POWER << RUYI_NUMBER_MANTISSA_BITS;
+        return TRUE;
+    }
+    lz = ruyi_number_leading_zeros(w);
+    w <<= lz;
+    index = 2 * (UINT32)(q - RUYI_NUMBER_SMALLEST_POWER10);
+    product = ruyi_number_mul64(w, g_ruyi_number_pow5_128[index]);
+    // the low 9 bits of the high part are dropped, only look at the low half of 5^q if they may carry
+    if ((product.high & 0x1FF) == 0x1FF) {
+        second = ruyi_number_mul64(w, g_ruyi_number_pow5_128[index + 1]);
+        product.low += second.high;
+        if (second.high > product.low) {
+            product.high++;
+        }
+    }
+    if (product.low == 0xFFFFFFFFFFFFFFFFULL && (q < -27 || q > 55)) {
+        // 5^q is not exact in 128 bits, so the product may be off by one
+        return FALSE;
+    }
+    upperbit = (UINT32)(product.high >> 63);
+    shift = upperbit + 64 - RUYI_NUMBER_MANTISSA_BITS - 3;
+    mantissa = product.high >> shift;
+    // floor(log2(10^q)) + 63 = ((217706 * q) >> 16) + 63
+    power2 = (((152170 + 65536) * q) >> 16) + 63 + (INT32)upperbit - (INT32)lz + RUYI_NUMBER_EXPONENT_BIAS;
+    if (power2 <= 0) {
+        // subnormal
+        if (-power2 + 1 >= 64) {
+            *bits = 0;
+            return TRUE;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += (mantissa & 1);
+        mantissa >>= 1;
+        // the rounding may carry to the smallest normal number
+        power2 = (mantissa < (1ULL << RUYI_NUMBER_MANTISSA_BITS)) ? 0 : 1;
+        *bits = mantissa | ((UINT64)power2 << RUYI_NUMBER_MANTISSA_BITS);
+        return TRUE;
+    }
+    // exactly halfway between two doubles, round to even
+    if (product.low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1) {
+        if ((mantissa << shift) == product.high) {
+            mantissa &= ~1ULL;
+        }
+    }
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    if (mantissa >= (2ULL << RUYI_NUMBER_MANTISSA_BITS)) {
+        mantissa = 1ULL << RUYI_NUMBER_MANTISSA_BITS;
+        power2++;
+    }
+    mantissa &= ~(1ULL << RUYI_NUMBER_MANTISSA_BITS);
+    if (power2 >= RUYI_NUMBER_INFINITE_POWER) {
+        power2 = RUYI_NUMBER_INFINITE_POWER;
+        mantissa = 0;
+    }
+    *bits = mantissa | ((UINT64)power2 << RUYI_NUMBER_MANTISSA_BITS);
+    return TRUE;
+}
+
+// exact but slow, used when the fast paths can not decide
+static double ruyi_number_parse_double_slow(const WIDE_CHAR *text, UINT32 length) {
+    char stack_buffer[RUYI_NUMBER_STACK_BUFFER_SIZE];
+    char *buffer = stack_buffer;
+    double value;
+    UINT32 i;
+    if (length >= RUYI_NUMBER_STACK_BUFFER_SIZE) {
+        buffer = (char*)ruyi_mem_alloc(length + 1);
+    }
+    // the text has been checked, all chars are ascii
+    for (i = 0; i < length; i++) {
+        buffer[i] = (char)text[i];
+    }
+    buffer[length] = '\0';
+    value = strtod(buffer, NULL);
+    if (buffer != stack_buffer) {
+        ruyi_mem_free(buffer);
+    }
+    return value;
+}
+
+static const double g_ruyi_number_exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+BOOL ruyi_number_parse_double(const WIDE_CHAR *text, UINT32 length, double *out) {
+    UINT32 i = 0;
+    UINT64 w = 0;           // the first RUYI_NUMBER_MAX_DIGITS significant digits
+    UINT32 digits = 0;      // significant digits in w
+    BOOL truncated = FALSE; // a none-zero digit did not fit in w
+    BOOL has_digit = FALSE;
+    BOOL negative_exponent = FALSE;
+    INT64 exponent = 0;     // the value is w * 10^exponent
+    INT64 exp_number = 0;
+    UINT64 bits, bits_next;
+    double value;
+    UINT32 d;
+    // integer part
+    for (; i < length && text[i] >= '0' && text[i] <= '9'; i++) {
+        has_digit = TRUE;
+        d = text[i] - '0';
+        if (digits < RUYI_NUMBER_MAX_DIGITS) {
+            if (w != 0 || d != 0) {
+                w = w * 10 + d;
+                digits++;
+            }
+        } else {
+            truncated |= (d != 0);
+            exponent++;
+        }
+    }
+    // fraction part
+    if (i < length && text[i] == '.') {
+        for (i++; i < length && text[i] >= '0' && text[i] <= '9'; i++) {
+            has_digit = TRUE;
+            d = text[i] - '0';
+            if (digits < RUYI_NUMBER_MAX_DIGITS) {
+                if (w != 0 || d != 0) {
+                    w = w * 10 + d;
+                    digits++;
+                }
+                exponent--;
+            } else {
+                truncated |= (d != 0);
+            }
+        }
+    }
+    if (!has_digit) {
+        return FALSE;
+    }
+    // exponent part
+    if (i < length && (text[i] == 'e' || text[i] == 'E')) {
+        i++;
+        if (i < length && (text[i] == '-' || text[i] == '+')) {
+            negative_exponent = (text[i] == '-');
+            i++;
+        }
+        if (i >= length) {
+            return FALSE;
+        }
+        for (; i < length && text[i] >= '0' && text[i] <= '9'; i++) {
+            if (exp_number < RUYI_NUMBER_EXPONENT_LIMIT) {
+                exp_number = exp_number * 10 + text[i] - '0';
+            }
+        }
+        exponent += negative_exponent ? -exp_number : exp_number;
+    }
+    if (i != length) {
+        return FALSE;
+    }
+    if (w == 0) {
+        *out = 0.0;
+        return TRUE;
+    }
+    if (exponent < -RUYI_NUMBER_EXPONENT_LIMIT) {
+        exponent = -RUYI_NUMBER_EXPONENT_LIMIT;
+    } else if (exponent > RUYI_NUMBER_EXPONENT_LIMIT) {
+        exponent = RUYI_NUMBER_EXPONENT_LIMIT;
+    }
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    // Clinger: both w and 10^exponent are exact doubles, one rounding gives the nearest double
+    if (!truncated && exponent >= -22 && exponent <= 22 && w <= (1ULL << 53)) {
+        value = (double)w;
+        if (exponent < 0) {
+            value /= g_ruyi_number_exact_pow10[-exponent];
+        } else {
+            value *= g_ruyi_number_exact_pow10[exponent];
+        }
+        *out = value;
+        return TRUE;
+    }
+#endif
+    // when digits were dropped the value is between w and w + 1, both must round to the same double
+    if (ruyi_number_eisel_lemire((INT32)exponent, w, &bits) &&
+        (!truncated || (ruyi_number_eisel_lemire((INT32)exponent, w + 1, &bits_next) && bits == bits_next))) {
+        if ((bits >> RUYI_NUMBER_MANTISSA_BITS) == RUYI_NUMBER_INFINITE_POWER) {
+            return FALSE;
+        }
+        memcpy(&value, &bits, sizeof(value));
+        *out = value;
+        return TRUE;
+    }
+    value = ruyi_number_parse_double_slow(text, length);
+    if (value > DBL_MAX) {
+        return FALSE;
+    }
+    *out = value;
+    return TRUE;
+}
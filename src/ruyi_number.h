@@ -0,0 +1,36 @@
+//
+//  ruyi_number.h
+//  ruyi
+//
+
+#ifndef ruyi_number_h
+#define ruyi_number_h
+
+#include "ruyi_basics.h"
+
+/**
+ * Parse the digits of an integer number exactly
+ * params:
+ * text - the digits, without the radix prefix (e.g. 0x), no digits means 0
+ * length - count of chars
+ * radix - 2, 8, 10 or 16
+ * out - the value
+ * return:
+ * FALSE if a char is not a digit of the radix or the value does not fit in 64 bits
+ */
+BOOL ruyi_number_parse_uint64(const WIDE_CHAR *text, UINT32 length, UINT32 radix, UINT64 *out);
+
+/**
+ * Parse a decimal number to the nearest double, ties to even.
+ * It scans the text once, most numbers are converted by the Clinger or Eisel-Lemire fast path,
+ * the rest fall back to strtod, which is exact.
+ * params:
+ * text - digits, an optional '.' with digits, an optional exponent like e-12, e.g. 12.5 .5 1. 3e8
+ * length - count of chars
+ * out - the value
+ * return:
+ * FALSE if the text is not a decimal number or the value is too large for double
+ */
+BOOL ruyi_number_parse_double(const WIDE_CHAR *text, UINT32 length, double *out);
+
+#endif /* ruyi_number_h */
@@ -9,151 +9,254 @@
 #include "ruyi_parser.h"
 #include "ruyi_basics.h"
 #include "ruyi_lexer.h"
-#include "ruyi_vector.h"
+#include "ruyi_jobs.h"
 #include "ruyi_error.h"
-
-static ruyi_ast* create_ast_string_by_token(ruyi_lexer_reader *reader, ruyi_ast_type type, ruyi_token **out_token) {
+#include "ruyi_io.h"
+#include "ruyi_line_table.h"
+#include "ruyi_stack.h"
+#include <string.h> // for memcpy
+
+#define AST_DECLARATION_STARTS_INIT_SIZE 16
+// the few nodes of a reparse, its blocks join the arena of the tree
+#define AST_REPARSE_ARENA_BLOCK_SIZE (4 * 1024)
+// runs of global declarations per thread of a parallel parse, more runs than threads keep them all busy
+#define AST_PARALLEL_RUNS_PER_THREAD 8
+// the tokens a run has at least, fewer runs are made of a small file
+#define AST_PARALLEL_RUN_MIN_TOKENS 4096
+// the memory of the stack of the rules nested in each other, e.g. parens or statements, a level takes less than 1k
+#define AST_MAX_STACK_BYTES (512 * 1024 * 1024)
+
+// the state of a parse, the reader only gives the tokens
+typedef struct {
+    ruyi_lexer_reader *reader;
+    // nodes of the ast being parsed, the tree owns it
+    ruyi_mem_arena *ast_arena;
+    // ruyi_parse_option flags of the parse
+    UINT32 options;
+    // offsets of the global declarations parsed, in ast_arena, the capacity is the next power of 2 of the count
+    UINT32 *declaration_starts;
+    UINT32 declaration_count;
+    // runs the rules of parse_nested, made by parser_init and released by parser_release
+    ruyi_stack *stack;
+} ruyi_parser;
+
+static void parser_init(ruyi_parser *parser, ruyi_lexer_reader *reader, ruyi_mem_arena *arena, UINT32 options) {
+    parser->reader = reader;
+    parser->ast_arena = arena;
+    parser->options = options;
+    parser->declaration_starts = NULL;
+    parser->declaration_count = 0;
+    parser->stack = ruyi_stack_create(AST_MAX_STACK_BYTES);
+}
+
+static void parser_release(ruyi_parser *parser) {
+    ruyi_stack_destroy(parser->stack);
+    parser->stack = NULL;
+}
+
+static ruyi_ast* create_ast_by_consume_token_string(ruyi_parser *parser, ruyi_ast_type type) {
     ruyi_ast * ret;
-    ruyi_token *token = ruyi_lexer_reader_next_token(reader);
-    ret = ruyi_ast_create_with_unicode(type, token->value.str_value);
-    if (out_token != NULL) {
-        *out_token = token;
-    } else {
-        ruyi_lexer_token_destroy(token);
-    }
+    ruyi_token *token = ruyi_lexer_reader_next_token(parser->reader);
+    assert(token->type == Ruyi_tt_IDENTITY);
+    ret = ruyi_ast_create_with_symbol(parser->ast_arena, type, token->symbol);
+    ruyi_lexer_token_destroy(token);
     return ret;
 }
 
-static ruyi_ast* create_ast_by_consume_token_string(ruyi_lexer_reader *reader, ruyi_ast_type type) {
-    return create_ast_string_by_token(reader, type, NULL);
-}
+/*
+ The parser never reads a token it may have to give back, a choice between rules is made by
+ looking ahead with ruyi_lexer_reader_peek_nth_token_type, so every token is read once.
+ */
 
-static void tokens_push_back_at_front(ruyi_lexer_reader *reader, ruyi_vector *tokens) {
-    UINT32 i, len;
-    ruyi_value temp;
-    ruyi_token *token;
-    len = ruyi_vector_length(tokens);
-    for (i = len; i > 0; i--) {
-        ruyi_vector_get(tokens, i - 1, &temp);
-        token = (ruyi_token*)temp.data.ptr;
-        ruyi_lexer_reader_push_front(reader, token);
+// count of the tokens of the <name> starting at the nth token ahead, 0 if there is no name
+static UINT32 peek_name_length(ruyi_parser *parser, UINT32 n) {
+    UINT32 length;
+    if (ruyi_lexer_reader_peek_nth_token_type(parser->reader, n) != Ruyi_tt_IDENTITY) {
+        return 0;
     }
-    ruyi_vector_destroy(tokens);
+    length = 1;
+    while (ruyi_lexer_reader_peek_nth_token_type(parser->reader, n + length) == Ruyi_tt_DOT &&
+           ruyi_lexer_reader_peek_nth_token_type(parser->reader, n + length + 1) == Ruyi_tt_IDENTITY) {
+        length += 2;
+    }
+    return length;
 }
 
 static BOOL is_keyword(ruyi_token_type type) {
     return NULL != ruyi_lexer_keywords_get_str(type);
 }
 
+// the first tokens of the rules, run tools/gen_parser_tables.py after syntax.txt changed
+#include "ruyi_parser_tables.inc"
+
+/*
+ A choice between rules by the first tokens of syntax.txt, see ruyi_parser_tables.inc: only the alternatives the
+ next token can start are tried, in the order of the table, instead of trying each of them in turn.
+ */
+typedef ruyi_error* (*ruyi_parse_rule)(ruyi_parser *parser, ruyi_ast **out_ast);
+
+typedef struct {
+    UINT32 first;           // RUYI_FIRST_ bit of the rule
+    ruyi_parse_rule parse;
+} ruyi_parse_alternative;
+
+static ruyi_error* parse_choice(ruyi_parser *parser, const ruyi_parse_alternative *alternatives, UINT32 count, ruyi_ast **out_ast) {
+    ruyi_error *err;
+    ruyi_ast *ast = NULL;
+    ruyi_token_type token_type = ruyi_lexer_reader_peek_token_type(parser->reader);
+    UINT32 rules = (UINT32)token_type < RUYI_FIRST_TOKEN_TYPE_COUNT ? g_ruyi_parser_first[token_type] : 0;
+    UINT32 i;
+    for (i = 0; i < count; i++) {
+        if ((rules & alternatives[i].first) == 0) {
+            continue;
+        }
+        if ((err = alternatives[i].parse(parser, &ast)) != NULL) {
+            *out_ast = NULL;
+            return err;
+        }
+        if (ast != NULL) {
+            *out_ast = ast;
+            return NULL;
+        }
+    }
+    *out_ast = NULL;
+    return NULL;
+}
+
+/*
+ A rule which may be nested in itself, e.g. the parens of an expression or the statements of a block, is parsed by
+ calls for each level. The calls are made by the ruyi_stack of the parser, which moves them to segments of the heap
+ before the stack of the thread runs out, so the levels are limited by AST_MAX_STACK_BYTES of memory only.
+ */
+typedef struct {
+    ruyi_parser *parser;
+    ruyi_parse_rule rule;
+    ruyi_ast **out_ast;
+    ruyi_error *err;
+} ruyi_parse_nested_call;
+
+static void parse_nested_call(void *arg) {
+    ruyi_parse_nested_call *call = (ruyi_parse_nested_call*)arg;
+    call->err = call->rule(call->parser, call->out_ast);
+}
+
+static ruyi_error* parse_nested(ruyi_parser *parser, ruyi_parse_rule rule, ruyi_ast **out_ast) {
+    ruyi_parse_nested_call call;
+    call.parser = parser;
+    call.rule = rule;
+    call.out_ast = out_ast;
+    call.err = NULL;
+    if (!ruyi_stack_call(parser->stack, parse_nested_call, &call)) {
+        *out_ast = NULL;
+        return ruyi_error_by_parser(parser->reader, "nested too deeply, the stack is over %u bytes", (UINT32)AST_MAX_STACK_BYTES);
+    }
+    return call.err;
+}
+
 
 static
-ruyi_error* assignment_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* assignment_expression(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* expression(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* field_access_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* field_access_expression(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* array_access(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* array_access(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* array_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* array_type(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* map_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* map_type(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* reference_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* reference_type(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* unary_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* unary_expression(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* not_plus_minus_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* not_plus_minus_expression(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* primitive_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* primitive_type(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* type(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* type(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* unary_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* unary_expression(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* name(ruyi_lexer_reader *reader, ruyi_ast **out_ast, ruyi_vector* out_tokens);
+ruyi_error* name(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* array_creation(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* array_creation(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* map_creation(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* map_creation(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* primary_no_new_collection(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* primary_no_new_collection(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* primary(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* primary(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* block(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* block(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* name(ruyi_lexer_reader *reader, ruyi_ast **out_ast, ruyi_vector* out_tokens);
+ruyi_error* name(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* block_statements(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* block_statements(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* statement(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* function_body(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* function_body(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* anonymous_function_declaration(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* anonymous_function_declaration(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-ruyi_error* func_return_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
+ruyi_error* func_return_type(ruyi_parser *parser, ruyi_ast **out_ast);
 
 static
-void statement_ends(ruyi_lexer_reader *reader) {
+void statement_ends(ruyi_parser *parser) {
     // <statement ends> ::= SEMICOLON *
     for (;;) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_SEMICOLON, NULL)) {
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_SEMICOLON, NULL)) {
             break;
         }
     }
 }
 
 static
-ruyi_error* type_cast(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* type_cast(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <type cast> ::= DOT RPARAN <type> RPARAN
     ruyi_error *err;
     ruyi_ast *type_ast = NULL;
-    ruyi_token *dot_token = NULL;
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_DOT) {
-        *out_ast = NULL;
-        return NULL;
-    }
-    dot_token = ruyi_lexer_reader_next_token(reader);
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
-        ruyi_lexer_reader_push_front(reader, dot_token);
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_DOT ||
+        ruyi_lexer_reader_peek_nth_token_type(parser->reader, 1) != Ruyi_tt_LPAREN) {
         *out_ast = NULL;
         return NULL;
     }
-    ruyi_lexer_token_destroy(dot_token);
-    if ((err = type(reader, &type_ast)) != NULL) {
+    ruyi_lexer_reader_consume_token(parser->reader); // consume Ruyi_tt_DOT
+    ruyi_lexer_reader_consume_token(parser->reader); // consume Ruyi_tt_LPAREN
+    if ((err = type(parser, &type_ast)) != NULL) {
         return err;
     }
     if (type_ast == NULL) {
-        err = ruyi_error_by_parser(reader, "type-cast miss type after '('");
+        err = ruyi_error_by_parser(parser->reader, "type-cast miss type after '('");
         goto type_castion_on_error;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "type-cast miss ')' after type");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "type-cast miss ')' after type");
         goto type_castion_on_error;
     }
     *out_ast = type_ast;
@@ -167,17 +270,17 @@ type_castion_on_error:
 }
 
 static
-ruyi_error* postfix_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* postfix_expression(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <postfix expression> ::= ( <field access expression> | <name> ) (DEC | INC | <type cast>) ?
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *type_cast_ast = NULL;
-    if ((err = primary(reader, &ast)) != NULL) {
+    if ((err = primary(parser, &ast)) != NULL) {
         *out_ast = NULL;
         return err;
     }
     if (ast == NULL) {
-        if ((err = name(reader, &ast, NULL)) != NULL) {
+        if ((err = name(parser, &ast)) != NULL) {
             *out_ast = NULL;
             return err;
         }
@@ -186,16 +289,16 @@ ruyi_error* postfix_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
             return NULL;
         }
     }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_DEC, NULL)) {
-        *out_ast = ruyi_ast_create(Ruyi_at_postfix_dec_expression);
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_DEC, NULL)) {
+        *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_postfix_dec_expression);
         ruyi_ast_add_child(*out_ast, ast);
         return NULL;
-    } else if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_INC, NULL)) {
-        *out_ast = ruyi_ast_create(Ruyi_at_postfix_inc_expression);
+    } else if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_INC, NULL)) {
+        *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_postfix_inc_expression);
         ruyi_ast_add_child(*out_ast, ast);
         return NULL;
     } else {
-        if ((err = type_cast(reader, &type_cast_ast)) != NULL) {
+        if ((err = type_cast(parser, &type_cast_ast)) != NULL) {
             *out_ast = NULL;
             return err;
         }
@@ -203,7 +306,7 @@ ruyi_error* postfix_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
             *out_ast = ast;
             return NULL;
         } else {
-            *out_ast = ruyi_ast_create(Ruyi_at_type_cast_expression);
+            *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_cast_expression);
             ruyi_ast_add_child(*out_ast, ast);
             ruyi_ast_add_child(*out_ast, type_cast_ast);
             return NULL;
@@ -212,79 +315,79 @@ ruyi_error* postfix_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
 }
 
 static
-ruyi_error* not_plus_minus_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* not_plus_minus_expression(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <not plus minus expression> ::= BIT_INVERSE <unary expression> | LOGIC_NOT <unary expression> | <postfix expression>
     ruyi_error *err;
     ruyi_ast *ast;
     ruyi_ast *target_ast;
     ruyi_token_type token_type;
-    token_type = ruyi_lexer_reader_peek_token_type(reader);
+    token_type = ruyi_lexer_reader_peek_token_type(parser->reader);
     if  (token_type == Ruyi_tt_BIT_INVERSE) {
-        ruyi_lexer_reader_consume_token(reader);
-        if ((err = unary_expression(reader, &target_ast)) != NULL) {
+        ruyi_lexer_reader_consume_token(parser->reader);
+        if ((err = unary_expression(parser, &target_ast)) != NULL) {
             return err;
         }
         if (target_ast == NULL) {
-            return ruyi_error_by_parser(reader, "miss expression after '~'");
+            return ruyi_error_by_parser(parser->reader, "miss expression after '~'");
         }
-        ast = ruyi_ast_create(Ruyi_at_bit_inverse_expression);
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_bit_inverse_expression);
         ruyi_ast_add_child(ast, target_ast);
         *out_ast = ast;
         return NULL;
     }
     if (token_type == Ruyi_tt_LOGIC_NOT) {
-        ruyi_lexer_reader_consume_token(reader);
-        if ((err = unary_expression(reader, &target_ast)) != NULL) {
+        ruyi_lexer_reader_consume_token(parser->reader);
+        if ((err = unary_expression(parser, &target_ast)) != NULL) {
             return err;
         }
         if (target_ast == NULL) {
-            return ruyi_error_by_parser(reader, "miss expression after '!'");
+            return ruyi_error_by_parser(parser->reader, "miss expression after '!'");
         }
-        ast = ruyi_ast_create(Ruyi_at_logic_not_expression);
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_logic_not_expression);
         ruyi_ast_add_child(ast, target_ast);
         *out_ast = ast;
         return NULL;
     }
-    return postfix_expression(reader, out_ast);
+    return postfix_expression(parser, out_ast);
 }
 
 static
-ruyi_error* unary_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* unary_expression_rule(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <unary expression> ::= ADD <unary expression> | SUB <unary expression> | <not plus minus expression>
     ruyi_error *err;
     ruyi_ast *ast;
     ruyi_ast *op_ast = NULL;
     ruyi_ast *target_ast = NULL;
     ruyi_token_type token_type;
-    token_type = ruyi_lexer_reader_peek_token_type(reader);
+    token_type = ruyi_lexer_reader_peek_token_type(parser->reader);
     switch (token_type) {
         case Ruyi_tt_ADD:
-            ruyi_lexer_reader_consume_token(reader);
-            op_ast = ruyi_ast_create(Ruyi_at_op_add);
+            ruyi_lexer_reader_consume_token(parser->reader);
+            op_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_op_add);
             break;
         case Ruyi_tt_SUB:
-            ruyi_lexer_reader_consume_token(reader);
-            op_ast = ruyi_ast_create(Ruyi_at_op_sub);
+            ruyi_lexer_reader_consume_token(parser->reader);
+            op_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_op_sub);
             break;
         default:
             op_ast = NULL;
             break;
     }
     if (op_ast != NULL) {
-        if ((err = unary_expression(reader, &target_ast)) != NULL) {
+        if ((err = unary_expression(parser, &target_ast)) != NULL) {
             goto unary_expression_on_error;
         }
         if (target_ast == NULL) {
-            err = ruyi_error_by_parser(reader, "miss expression after '+' or '-'");
+            err = ruyi_error_by_parser(parser->reader, "miss expression after '+' or '-'");
             goto unary_expression_on_error;
         }
-        ast = ruyi_ast_create(Ruyi_at_unary_expression);
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_unary_expression);
         ruyi_ast_add_child(ast, op_ast);
         ruyi_ast_add_child(ast, target_ast);
         *out_ast = ast;
         return NULL;
     }
-    return not_plus_minus_expression(reader, out_ast);
+    return not_plus_minus_expression(parser, out_ast);
 unary_expression_on_error:
     if (op_ast != NULL) {
         ruyi_ast_destroy(op_ast);
@@ -296,64 +399,230 @@ unary_expression_on_error:
 }
 
 static
-ruyi_error* multiplicative_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <multiplicative expression> ::= <unary expression> ((MUL | DIV | MOD) <unary expression>)*
+ruyi_error* unary_expression(ruyi_parser *parser, ruyi_ast **out_ast) {
+    return parse_nested(parser, unary_expression_rule, out_ast);
+}
+
+/*
+ Binary operators by one loop of precedence climbing, instead of a function for each level.
+ Each level makes the shape of ast the code generator expects of it, see ruyi_binary_kind and test_parser_binary_expression.
+ A call only recurses for the operands of a higher level, so the calls are at most Ruyi_bl_COUNT deep for any length of
+ an expression, the parens and the unary operators nested in it are parsed by parse_nested.
+ */
+typedef enum {
+    Ruyi_bl_NONE = 0,
+    Ruyi_bl_LOGIC_OR,
+    Ruyi_bl_LOGIC_AND,
+    Ruyi_bl_BIT_OR,
+    Ruyi_bl_BIT_AND,
+    Ruyi_bl_EQUALITY,
+    Ruyi_bl_RELATIONAL,
+    Ruyi_bl_SHIFT,
+    Ruyi_bl_ADDITIVE,
+    Ruyi_bl_MULTIPLICATIVE,
+    Ruyi_bl_COUNT
+} ruyi_binary_level;
+
+typedef enum {
+    Ruyi_bk_LEFT,       // ((a op b) op c), the operator is a child
+    Ruyi_bk_RIGHT,      // (a op (b op c)), the operator is a child
+    Ruyi_bk_SINGLE,     // (a op b), one operator only, the operator is a child
+    Ruyi_bk_LIST,       // (a b c), all operands of the level in one node
+    Ruyi_bk_NESTED      // (a (b c)), the first operand and the rest
+} ruyi_binary_kind;
+
+typedef struct {
+    ruyi_ast_type expr_type;
+    ruyi_binary_kind kind;
+} ruyi_binary_level_info;
+
+typedef struct {
+    ruyi_binary_level level;
+    ruyi_ast_type op_type;  // only for the levels keeping the operators
+    const char *missing;    // error when the operand after the operator is missing
+} ruyi_binary_operator;
+
+static const ruyi_binary_level_info g_binary_levels[Ruyi_bl_COUNT] = {
+    [Ruyi_bl_LOGIC_OR]          = {Ruyi_at_conditional_or_expression, Ruyi_bk_LIST},
+    [Ruyi_bl_LOGIC_AND]         = {Ruyi_at_conditional_and_expression, Ruyi_bk_NESTED},
+    [Ruyi_bl_BIT_OR]            = {Ruyi_at_bit_or_expression, Ruyi_bk_LIST},
+    [Ruyi_bl_BIT_AND]           = {Ruyi_at_bit_and_expression, Ruyi_bk_LIST},
+    [Ruyi_bl_EQUALITY]          = {Ruyi_at_equality_expression, Ruyi_bk_SINGLE},
+    [Ruyi_bl_RELATIONAL]        = {Ruyi_at_relational_expression, Ruyi_bk_SINGLE},
+    [Ruyi_bl_SHIFT]             = {Ruyi_at_shift_expression, Ruyi_bk_SINGLE},
+    [Ruyi_bl_ADDITIVE]          = {Ruyi_at_additive_expression, Ruyi_bk_LEFT},
+    [Ruyi_bl_MULTIPLICATIVE]    = {Ruyi_at_multiplicative_expression, Ruyi_bk_RIGHT},
+};
+
+// all binary operators are before Ruyi_tt_END but instanceof
+static const ruyi_binary_operator g_binary_operators[Ruyi_tt_END] = {
+    [Ruyi_tt_LOGIC_OR]      = {Ruyi_bl_LOGIC_OR, Ruyi_at_root, "miss expression after '||'"},
+    [Ruyi_tt_LOGIC_AND]     = {Ruyi_bl_LOGIC_AND, Ruyi_at_root, "miss expression after '&&'"},
+    [Ruyi_tt_BIT_OR]        = {Ruyi_bl_BIT_OR, Ruyi_at_root, "miss expression after '|'"},
+    [Ruyi_tt_BIT_AND]       = {Ruyi_bl_BIT_AND, Ruyi_at_root, "miss expression after '&'"},
+    [Ruyi_tt_EQUALS]        = {Ruyi_bl_EQUALITY, Ruyi_at_op_equals, "miss expression after '=='"},
+    [Ruyi_tt_NOT_EQUALS]    = {Ruyi_bl_EQUALITY, Ruyi_at_op_not_equals, "miss expression after '!='"},
+    [Ruyi_tt_LT]            = {Ruyi_bl_RELATIONAL, Ruyi_at_op_lt, "need expression after compare operator"},
+    [Ruyi_tt_GT]            = {Ruyi_bl_RELATIONAL, Ruyi_at_op_gt, "need expression after compare operator"},
+    [Ruyi_tt_LTE]           = {Ruyi_bl_RELATIONAL, Ruyi_at_op_lte, "need expression after compare operator"},
+    [Ruyi_tt_GTE]           = {Ruyi_bl_RELATIONAL, Ruyi_at_op_gte, "need expression after compare operator"},
+    [Ruyi_tt_SHFT_LEFT]     = {Ruyi_bl_SHIFT, Ruyi_at_op_shift_left, "need expression after shift operator"},
+    [Ruyi_tt_SHFT_RIGHT]    = {Ruyi_bl_SHIFT, Ruyi_at_op_shift_right, "need expression after shift operator"},
+    [Ruyi_tt_ADD]           = {Ruyi_bl_ADDITIVE, Ruyi_at_op_add, "need expression after '+' or '-'"},
+    [Ruyi_tt_SUB]           = {Ruyi_bl_ADDITIVE, Ruyi_at_op_sub, "need expression after '+' or '-'"},
+    [Ruyi_tt_MUL]           = {Ruyi_bl_MULTIPLICATIVE, Ruyi_at_op_mul, "need expression after '*', '/' or '%'"},
+    [Ruyi_tt_DIV]           = {Ruyi_bl_MULTIPLICATIVE, Ruyi_at_op_div, "need expression after '*', '/' or '%'"},
+    [Ruyi_tt_MOD]           = {Ruyi_bl_MULTIPLICATIVE, Ruyi_at_op_mod, "need expression after '*', '/' or '%'"},
+};
+
+static const ruyi_binary_operator g_binary_operator_instanceof = {Ruyi_bl_RELATIONAL, Ruyi_at_op_instanceof, "miss type-name after 'instanceof'"};
+
+static const ruyi_binary_operator* binary_operator(ruyi_token_type token_type) {
+    if (token_type == Ruyi_tt_KW_INSTANCEOF) {
+        return &g_binary_operator_instanceof;
+    }
+    if (token_type >= Ruyi_tt_END || g_binary_operators[token_type].level == Ruyi_bl_NONE) {
+        return NULL;
+    }
+    return &g_binary_operators[token_type];
+}
+
+static
+ruyi_error* binary_expression(ruyi_parser *parser, ruyi_binary_level min_level, ruyi_ast **out_ast) {
+    // <unary expression> (<binary operator> <unary expression>)*, the operators of min_level or higher levels
     ruyi_error *err;
-    ruyi_ast *ast;
-    ruyi_ast *left_unary_expr_ast = NULL;
-    ruyi_ast *right_unary_expr_ast = NULL;
+    ruyi_ast *ast = NULL;
+    ruyi_ast *left_ast = NULL;
+    ruyi_ast *right_ast = NULL;
     ruyi_ast *op_ast = NULL;
+    // the first and the last node of a chain of a right or nested level being made
+    ruyi_ast *chain_ast = NULL;
+    ruyi_ast *tail_ast = NULL;
+    const ruyi_binary_operator *op;
+    const ruyi_binary_operator *next_op;
+    const ruyi_binary_level_info *info;
     ruyi_token_type token_type;
-    if ((err = unary_expression(reader, &left_unary_expr_ast)) != NULL) {
+    // operators of this level and higher ones are not taken any more, e.g. the second '==' of 'a == b == c'
+    ruyi_binary_level cap = Ruyi_bl_COUNT;
+    if ((err = unary_expression(parser, &left_ast)) != NULL) {
         return err;
     }
-    if (left_unary_expr_ast == NULL) {
+    if (left_ast == NULL) {
         *out_ast = NULL;
         return NULL;
     }
     while (TRUE) {
-        token_type = ruyi_lexer_reader_peek_token_type(reader);
-        switch (token_type) {
-            case Ruyi_tt_MUL:
-                ruyi_lexer_reader_consume_token(reader);
-                op_ast = ruyi_ast_create(Ruyi_at_op_mul);
+        token_type = ruyi_lexer_reader_peek_token_type(parser->reader);
+        op = binary_operator(token_type);
+        if (op == NULL || op->level < min_level || op->level >= cap) {
+            break;
+        }
+        ruyi_lexer_reader_consume_token(parser->reader);
+        info = &g_binary_levels[op->level];
+        switch (info->kind) {
+            case Ruyi_bk_LEFT:
+            case Ruyi_bk_SINGLE:
+                op_ast = ruyi_ast_create(parser->ast_arena, op->op_type);
+                if (op->op_type == Ruyi_at_op_instanceof) {
+                    err = reference_type(parser, &right_ast);
+                } else {
+                    err = binary_expression(parser, op->level + 1, &right_ast);
+                }
+                if (err != NULL) {
+                    goto binary_expression_on_error;
+                }
+                if (right_ast == NULL) {
+                    err = ruyi_error_by_parser(parser->reader, "%s", op->missing);
+                    goto binary_expression_on_error;
+                }
+                ast = ruyi_ast_create(parser->ast_arena, info->expr_type);
+                ruyi_ast_add_child(ast, left_ast);
+                ruyi_ast_add_child(ast, op_ast);
+                ruyi_ast_add_child(ast, right_ast);
+                op_ast = NULL;
+                right_ast = NULL;
+                left_ast = ast;
+                ast = NULL;
+                cap = info->kind == Ruyi_bk_SINGLE ? op->level : op->level + 1;
                 break;
-            case Ruyi_tt_DIV:
-                ruyi_lexer_reader_consume_token(reader);
-                op_ast = ruyi_ast_create(Ruyi_at_op_div);
+            case Ruyi_bk_RIGHT:
+            case Ruyi_bk_NESTED:
+                // the nodes are made from the top down, each one is the last child of the one before,
+                // so a long chain is a loop instead of a call for each operand
+                while (TRUE) {
+                    ast = ruyi_ast_create(parser->ast_arena, info->expr_type);
+                    ruyi_ast_add_child(ast, left_ast);
+                    left_ast = NULL;
+                    if (info->kind == Ruyi_bk_RIGHT) {
+                        ruyi_ast_add_child(ast, ruyi_ast_create(parser->ast_arena, op->op_type));
+                    }
+                    if (tail_ast == NULL) {
+                        chain_ast = ast;
+                    } else {
+                        ruyi_ast_add_child(tail_ast, ast);
+                    }
+                    tail_ast = ast;
+                    ast = NULL;
+                    if ((err = binary_expression(parser, op->level + 1, &right_ast)) != NULL) {
+                        goto binary_expression_on_error;
+                    }
+                    if (right_ast == NULL) {
+                        err = ruyi_error_by_parser(parser->reader, "%s", op->missing);
+                        goto binary_expression_on_error;
+                    }
+                    next_op = binary_operator(ruyi_lexer_reader_peek_token_type(parser->reader));
+                    if (next_op == NULL || next_op->level != op->level) {
+                        break;
+                    }
+                    ruyi_lexer_reader_consume_token(parser->reader);
+                    op = next_op;
+                    left_ast = right_ast;
+                    right_ast = NULL;
+                }
+                ruyi_ast_add_child(tail_ast, right_ast);
+                right_ast = NULL;
+                left_ast = chain_ast;
+                chain_ast = NULL;
+                tail_ast = NULL;
+                cap = info->kind == Ruyi_bk_NESTED ? op->level : op->level + 1;
                 break;
-            case Ruyi_tt_MOD:
-                ruyi_lexer_reader_consume_token(reader);
-                op_ast = ruyi_ast_create(Ruyi_at_op_mod);
+            case Ruyi_bk_LIST:
+                ast = ruyi_ast_create(parser->ast_arena, info->expr_type);
+                ruyi_ast_add_child(ast, left_ast);
+                left_ast = NULL;
+                do {
+                    if ((err = binary_expression(parser, op->level + 1, &right_ast)) != NULL) {
+                        goto binary_expression_on_error;
+                    }
+                    if (right_ast == NULL) {
+                        err = ruyi_error_by_parser(parser->reader, "%s", op->missing);
+                        goto binary_expression_on_error;
+                    }
+                    ruyi_ast_add_child(ast, right_ast);
+                    right_ast = NULL;
+                } while (ruyi_lexer_reader_consume_token_if_match(parser->reader, token_type, NULL));
+                left_ast = ast;
+                ast = NULL;
+                cap = op->level;
                 break;
             default:
-                op_ast = NULL;
                 break;
         }
-        if (op_ast == NULL) {
-            break;
-        }
-        if ((err = multiplicative_expression(reader, &right_unary_expr_ast)) != NULL) {
-            goto multiplicative_expression_on_error;
-        }
-        if (right_unary_expr_ast == NULL) {
-            err = ruyi_error_by_parser(reader, "need expression after '*', '/' or '%'");
-            goto multiplicative_expression_on_error;
-        }
-        ast = ruyi_ast_create(Ruyi_at_multiplicative_expression);
-        ruyi_ast_add_child(ast, left_unary_expr_ast);
-        ruyi_ast_add_child(ast, op_ast);
-        ruyi_ast_add_child(ast, right_unary_expr_ast);
-        left_unary_expr_ast = ast;
     }
-    *out_ast = left_unary_expr_ast;
+    *out_ast = left_ast;
     return NULL;
-multiplicative_expression_on_error:
-    if (left_unary_expr_ast != NULL) {
-        ruyi_ast_destroy(left_unary_expr_ast);
+binary_expression_on_error:
+    if (chain_ast != NULL) {
+        ruyi_ast_destroy(chain_ast);
+    }
+    if (ast != NULL) {
+        ruyi_ast_destroy(ast);
+    }
+    if (left_ast != NULL) {
+        ruyi_ast_destroy(left_ast);
     }
-    if (right_unary_expr_ast != NULL) {
-        ruyi_ast_destroy(right_unary_expr_ast);
+    if (right_ast != NULL) {
+        ruyi_ast_destroy(right_ast);
     }
     if (op_ast != NULL) {
         ruyi_ast_destroy(op_ast);
@@ -363,697 +632,229 @@ multiplicative_expression_on_error:
 }
 
 static
-ruyi_error* additive_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <additive expression> ::= <multiplicative expression> ((ADD | SUB) <multiplicative expression>)*
+ruyi_error* conditional_expression(ruyi_parser *parser, ruyi_ast **out_ast) {
+    // <conditional or expression> (QM <expression> Ruyi_tt_COLON <conditional expression>)?
     ruyi_error *err;
-    ruyi_ast *ast;
-    ruyi_ast *left_mul_expr_ast = NULL;
-    ruyi_ast *right_mul_expr_ast = NULL;
-    ruyi_ast *op_ast = NULL;
-    ruyi_token_type token_type;
-    if ((err = multiplicative_expression(reader, &left_mul_expr_ast)) != NULL) {
-        return err;
-    }
-    if (left_mul_expr_ast == NULL) {
-        *out_ast = NULL;
-        return NULL;
-    }
+    ruyi_ast *conditon_expr_ast = NULL;
+    ruyi_ast *true_expr_ast = NULL;
+    // the false expression of one is the next, the first and the last of them made so far
+    ruyi_ast *chain_ast = NULL;
+    ruyi_ast *tail_ast = NULL;
+    ruyi_ast * ast;
     while (TRUE) {
-        token_type = ruyi_lexer_reader_peek_token_type(reader);
-        switch (token_type) {
-            case Ruyi_tt_ADD:
-                ruyi_lexer_reader_consume_token(reader);
-                op_ast = ruyi_ast_create(Ruyi_at_op_add);
-                break;
-            case Ruyi_tt_SUB:
-                ruyi_lexer_reader_consume_token(reader);
-                op_ast = ruyi_ast_create(Ruyi_at_op_sub);
-                break;
-            default:
-                op_ast = NULL;
-                break;
+        if ((err = binary_expression(parser, Ruyi_bl_LOGIC_OR, &conditon_expr_ast)) != NULL) {
+            goto conditional_expression_on_error;
         }
-        if (op_ast == NULL) {
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_QM, NULL)) {
             break;
         }
-        if ((err = multiplicative_expression(reader, &right_mul_expr_ast)) != NULL) {
-            goto additive_expression_on_error;
+        if ((err = binary_expression(parser, Ruyi_bl_LOGIC_OR, &true_expr_ast)) != NULL) {
+            goto conditional_expression_on_error;
         }
-        if (right_mul_expr_ast == NULL) {
-            err = ruyi_error_by_parser(reader, "need expression after '+' or '-'");
-            goto additive_expression_on_error;
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COLON, NULL)) {
+            err = ruyi_error_by_parser(parser->reader, "miss ':' in conditional expression");
+            goto conditional_expression_on_error;
         }
-        ast = ruyi_ast_create(Ruyi_at_additive_expression);
-        ruyi_ast_add_child(ast, left_mul_expr_ast);
-        ruyi_ast_add_child(ast, op_ast);
-        ruyi_ast_add_child(ast, right_mul_expr_ast);
-        left_mul_expr_ast = ast;
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_conditional_expression);
+        ruyi_ast_add_child(ast, conditon_expr_ast);
+        ruyi_ast_add_child(ast, true_expr_ast);
+        conditon_expr_ast = NULL;
+        true_expr_ast = NULL;
+        if (tail_ast == NULL) {
+            chain_ast = ast;
+        } else {
+            ruyi_ast_add_child(tail_ast, ast);
+        }
+        tail_ast = ast;
+    }
+    if (tail_ast == NULL) {
+        *out_ast = conditon_expr_ast;
+        return NULL;
     }
-    *out_ast = left_mul_expr_ast;
+    ruyi_ast_add_child(tail_ast, conditon_expr_ast);
+    *out_ast = chain_ast;
     return NULL;
-additive_expression_on_error:
-    if (left_mul_expr_ast != NULL) {
-        ruyi_ast_destroy(left_mul_expr_ast);
+conditional_expression_on_error:
+    if (chain_ast != NULL) {
+        ruyi_ast_destroy(chain_ast);
     }
-    if (right_mul_expr_ast != NULL) {
-        ruyi_ast_destroy(right_mul_expr_ast);
+    if (conditon_expr_ast != NULL) {
+        ruyi_ast_destroy(conditon_expr_ast);
     }
-    if (op_ast != NULL) {
-        ruyi_ast_destroy(op_ast);
+    if (true_expr_ast != NULL) {
+        ruyi_ast_destroy(true_expr_ast);
     }
     *out_ast = NULL;
     return err;
 }
 
 static
-ruyi_error* shift_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <shift expression> ::= <additive expression> ((SHFT_LEFT | SHFT_RIGHT) <additive expression>) ?
+ruyi_error* name(ruyi_parser *parser, ruyi_ast **out_ast) {
+    // <name> ::= IDENTITY (DOT IDENTITY) *
     ruyi_error *err;
-    ruyi_ast *ast;
-    ruyi_ast *add_expr_ast = NULL;
-    ruyi_ast *right_add_expr_ast = NULL;
-    ruyi_ast *op_ast = NULL;
-    ruyi_token_type token_type;
-    if ((err = additive_expression(reader, &add_expr_ast)) != NULL) {
-        return err;
-    }
-    if (add_expr_ast == NULL) {
+    ruyi_ast *name = NULL;
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_IDENTITY) {
         *out_ast = NULL;
         return NULL;
     }
-    token_type = ruyi_lexer_reader_peek_token_type(reader);
-    switch (token_type) {
-        case Ruyi_tt_SHFT_LEFT:
-            ruyi_lexer_reader_consume_token(reader);
-            op_ast = ruyi_ast_create(Ruyi_at_op_shift_left);
-            break;
-        case Ruyi_tt_SHFT_RIGHT:
-            ruyi_lexer_reader_consume_token(reader);
-            op_ast = ruyi_ast_create(Ruyi_at_op_shift_right);
-            break;
-        default:
-            op_ast = NULL;
+    name = create_ast_by_consume_token_string(parser, Ruyi_at_name);
+    for (;;) {
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_DOT, NULL)) {
             break;
+        }
+        if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_IDENTITY) {
+            err = ruyi_error_by_parser(parser->reader, "need an identifier after '.'");
+            goto name_on_error;
+        }
+        ruyi_ast_add_child(name, create_ast_by_consume_token_string(parser, Ruyi_at_name_part));
     }
-    if (op_ast == NULL) {
-        *out_ast = add_expr_ast;
-        return NULL;
-    }
-    if ((err = additive_expression(reader, &right_add_expr_ast)) != NULL) {
-        goto shift_expression_on_error;
-    }
-    if (right_add_expr_ast == NULL) {
-        err = ruyi_error_by_parser(reader, "need expression after shift operator");
-        goto shift_expression_on_error;
-    }
-    ast = ruyi_ast_create(Ruyi_at_shift_expression);
-    ruyi_ast_add_child(ast, add_expr_ast);
-    ruyi_ast_add_child(ast, op_ast);
-    ruyi_ast_add_child(ast, right_add_expr_ast);
-    *out_ast = ast;
+    *out_ast = name;
     return NULL;
-shift_expression_on_error:
-    if (add_expr_ast != NULL) {
-        ruyi_ast_destroy(add_expr_ast);
-    }
-    if (right_add_expr_ast != NULL) {
-        ruyi_ast_destroy(right_add_expr_ast);
-    }
-    if (op_ast != NULL) {
-        ruyi_ast_destroy(op_ast);
+name_on_error:
+    if (name) {
+        ruyi_ast_destroy(name);
     }
     *out_ast = NULL;
     return err;
 }
 
 static
-ruyi_error* relational_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <relational expression> ::= <shift expression> ((KW_INSTANCEOF <reference type>) | ((LT | GT | LTE | GTE) <shift expression>)) ?
-    ruyi_error *err;
-    ruyi_ast *ast;
-    ruyi_ast *shift_expr_ast = NULL;
-    ruyi_ast *right_shift_expr_ast = NULL;
-    ruyi_ast *ref_type_ast = NULL;
-    ruyi_ast *op_ast = NULL;
-    ruyi_token_type token_type;
-    if ((err = shift_expression(reader, &shift_expr_ast)) != NULL) {
-        return err;
-    }
-    if (shift_expr_ast == NULL) {
-        *out_ast = NULL;
-        return NULL;
-    }
-    token_type = ruyi_lexer_reader_peek_token_type(reader);
-    if (token_type == Ruyi_tt_KW_INSTANCEOF) {
-        ruyi_lexer_reader_consume_token(reader); // consume instanceof
-        if ((err = reference_type(reader, &ref_type_ast)) != NULL) {
-            goto relational_expression_on_error;
-        }
-        if (ref_type_ast == NULL) {
-            err = ruyi_error_by_parser(reader, "miss type-name after 'instanceof'");
-            goto relational_expression_on_error;
-        }
-        ast = ruyi_ast_create(Ruyi_at_relational_expression);
-        ruyi_ast_add_child(ast, shift_expr_ast);
-        ruyi_ast_add_child(ast, ruyi_ast_create(Ruyi_at_op_instanceof));
-        ruyi_ast_add_child(ast, ref_type_ast);
-        *out_ast = ast;
-        return NULL;
+ruyi_error* literal(ruyi_parser *parser, ruyi_ast **out_ast) {
+    // <literal> ::= INTEGER | FLOAT | KW_TRUE | KW_FALSE | RUNE | STRING | KW_NULL | <name>
+    ruyi_ast *ast = NULL;
+    ruyi_token *token;
+    switch (ruyi_lexer_reader_peek_token_type(parser->reader)) {
+        case Ruyi_tt_INTEGER:
+        case Ruyi_tt_FLOAT:
+        case Ruyi_tt_KW_TRUE:
+        case Ruyi_tt_KW_FALSE:
+        case Ruyi_tt_CHAR:
+        case Ruyi_tt_STRING:
+        case Ruyi_tt_KW_NULL:
+            break;
+        default:
+            return name(parser, out_ast);
     }
-    switch (token_type) {
-        case Ruyi_tt_LT:
-            ruyi_lexer_reader_consume_token(reader);
-            op_ast = ruyi_ast_create(Ruyi_at_op_lt);
+    token = ruyi_lexer_reader_next_token(parser->reader);
+    switch (token->type) {
+        case Ruyi_tt_INTEGER:
+            ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_integer);
+            ast->data.int64_value = token->value.int_value;
+            break;
+        case Ruyi_tt_FLOAT:
+            ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_float);
+            ast->data.float_value = token->value.float_value;
+            break;
+        case Ruyi_tt_KW_TRUE:
+            ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_bool);
+            ast->data.int64_value = TRUE;
+            break;
+        case Ruyi_tt_KW_FALSE:
+            ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_bool);
+            ast->data.int64_value = FALSE;
             break;
-        case Ruyi_tt_GT:
-            ruyi_lexer_reader_consume_token(reader);
-            op_ast = ruyi_ast_create(Ruyi_at_op_gt);
+        case Ruyi_tt_CHAR:
+            ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_rune);
+            ast->data.int64_value = token->value.int_value;
             break;
-        case Ruyi_tt_LTE:
-            ruyi_lexer_reader_consume_token(reader);
-            op_ast = ruyi_ast_create(Ruyi_at_op_lte);
+        case Ruyi_tt_STRING:
+            ast = ruyi_ast_create_with_unicode(parser->ast_arena, Ruyi_at_string, token->value.str_value);
             break;
-        case Ruyi_tt_GTE:
-            ruyi_lexer_reader_consume_token(reader);
-            op_ast = ruyi_ast_create(Ruyi_at_op_gte);
+        case Ruyi_tt_KW_NULL:
+            ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_null);
             break;
         default:
-            op_ast = NULL;
             break;
     }
-    if (op_ast == NULL) {
-        *out_ast = shift_expr_ast;
-        return NULL;
-    }
-    if ((err = shift_expression(reader, &right_shift_expr_ast)) != NULL) {
-        goto relational_expression_on_error;
-    }
-    if (right_shift_expr_ast == NULL) {
-        err = ruyi_error_by_parser(reader, "need expression after compare operator");
-        goto relational_expression_on_error;
-    }
-    ast = ruyi_ast_create(Ruyi_at_relational_expression);
-    ruyi_ast_add_child(ast, shift_expr_ast);
-    ruyi_ast_add_child(ast, op_ast);
-    ruyi_ast_add_child(ast, right_shift_expr_ast);
+    ruyi_lexer_token_destroy(token);
     *out_ast = ast;
     return NULL;
-relational_expression_on_error:
-    if (shift_expr_ast != NULL) {
-        ruyi_ast_destroy(shift_expr_ast);
-    }
-    if (right_shift_expr_ast != NULL) {
-        ruyi_ast_destroy(right_shift_expr_ast);
-    }
-    if (op_ast != NULL) {
-        ruyi_ast_destroy(op_ast);
-    }
-    *out_ast = NULL;
-    return err;
 }
 
 static
-ruyi_error* equality_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <equality expression> ::= <relational expression> ((EQUALS | NOT_EQUALS) <relational expression>)?
-    ruyi_error *err;
-    ruyi_ast *ast;
-    ruyi_ast *rel_expr_ast = NULL;
-    ruyi_token_type token_type;
-    if ((err = relational_expression(reader, &rel_expr_ast)) != NULL) {
-        return err;
-    }
-    if (rel_expr_ast == NULL) {
-        *out_ast = NULL;
-        return NULL;
-    }
-    token_type = ruyi_lexer_reader_peek_token_type(reader);
-    if (token_type != Ruyi_tt_EQUALS && token_type != Ruyi_tt_NOT_EQUALS) {
-        *out_ast = rel_expr_ast;
-        return NULL;
-    }
-    ruyi_lexer_reader_consume_token(reader); // consume EQUALS or NOT_EQUALS
-    ast = ruyi_ast_create(Ruyi_at_equality_expression);
-    ruyi_ast_add_child(ast, rel_expr_ast);
+ruyi_error* integral_type(ruyi_parser *parser, ruyi_ast **out_ast) {
+    // <integral type> ::= KW_BYTE | KW_SHORT| KW_INT | KW_RUNE | KW_LONG
+    ruyi_token_type token_type = ruyi_lexer_reader_peek_token_type(parser->reader);
     switch (token_type) {
-        case Ruyi_tt_EQUALS:
-            ruyi_ast_add_child(ast, ruyi_ast_create(Ruyi_at_op_equals));
-            break;
-        case Ruyi_tt_NOT_EQUALS:
-            ruyi_ast_add_child(ast, ruyi_ast_create(Ruyi_at_op_not_equals));
-            break;
+        case Ruyi_tt_KW_BYTE:
+            ruyi_lexer_reader_consume_token(parser->reader);
+            *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_byte);
+            return NULL;
+        case Ruyi_tt_KW_SHORT:
+            ruyi_lexer_reader_consume_token(parser->reader);
+            *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_short);
+            return NULL;
+        case Ruyi_tt_KW_INT:
+            ruyi_lexer_reader_consume_token(parser->reader);
+            *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_int);
+            return NULL;
+        case Ruyi_tt_KW_RUNE:
+            ruyi_lexer_reader_consume_token(parser->reader);
+            *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_rune);
+            return NULL;
+        case Ruyi_tt_KW_LONG:
+            ruyi_lexer_reader_consume_token(parser->reader);
+            *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_long);
+            return NULL;
         default:
-            // may not reach here
             break;
     }
-    if ((err = relational_expression(reader, &rel_expr_ast)) != NULL) {
-        goto equality_expression_on_error;
-    }
-    if (rel_expr_ast == NULL) {
-        if (Ruyi_tt_EQUALS == token_type) {
-            err = ruyi_error_by_parser(reader, "miss expression after '=='");
-        } else {
-            err = ruyi_error_by_parser(reader, "miss expression after '!='");
-        }
-        goto equality_expression_on_error;
-    }
-    ruyi_ast_add_child(ast, rel_expr_ast);
-    *out_ast = ast;
-    return NULL;
-equality_expression_on_error:
-    if (ast != NULL) {
-        ruyi_ast_destroy(ast);
-    }
     *out_ast = NULL;
-    return err;
+    return NULL;
 }
 
 static
-ruyi_error* bit_and_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <bit and expression> ::= <equality expression> (BIT_AND <equality expression>)*
-    ruyi_error *err;
-    ruyi_ast *ast = NULL;
-    ruyi_ast *eq_expr_ast = NULL;
-    if ((err = equality_expression(reader, &eq_expr_ast)) != NULL) {
-        return err;
-    }
-    if (eq_expr_ast == NULL) {
-        *out_ast = NULL;
+ruyi_error* floating_point_type(ruyi_parser *parser, ruyi_ast **out_ast) {
+    // <floating-point type> ::= KW_FLOAT | KW_DOUBLE
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_FLOAT, NULL)) {
+        *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_float);
         return NULL;
     }
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_BIT_AND) {
-        *out_ast = eq_expr_ast;
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_DOUBLE, NULL)) {
+        *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_double);
         return NULL;
     }
-    ast = ruyi_ast_create(Ruyi_at_bit_and_expression);
-    ruyi_ast_add_child(ast, eq_expr_ast);
-    
-    while (TRUE) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_BIT_AND, NULL)) {
-            break;
-        }
-        if ((err = equality_expression(reader, &eq_expr_ast)) != NULL) {
-            goto bit_and_expression_on_error;
-        }
-        if (eq_expr_ast == NULL) {
-            err = ruyi_error_by_parser(reader, "miss expression after '&'");
-            goto bit_and_expression_on_error;
-        }
-        ruyi_ast_add_child(ast, eq_expr_ast);
-    }
-    *out_ast = ast;
-    return NULL;
-bit_and_expression_on_error:
-    if (ast != NULL) {
-        ruyi_ast_destroy(ast);
-    }
     *out_ast = NULL;
-    return err;
+    return NULL;
 }
 
 static
-ruyi_error* bit_or_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <bit or expression> ::= <bit and expression> (BIT_OR <bit and expression>)*
+ruyi_error* numeric_type(ruyi_parser *parser, ruyi_ast **out_ast) {
+    // <numeric type> ::= <integral type> | <floating-point type>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
-    ruyi_ast *bit_and_expr_ast = NULL;
-    if ((err = bit_and_expression(reader, &bit_and_expr_ast)) != NULL) {
+    if ((err = integral_type(parser, &ast)) != NULL) {
         return err;
     }
-    if (bit_and_expr_ast == NULL) {
-        *out_ast = NULL;
-        return NULL;
-    }
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_BIT_OR) {
-        *out_ast = bit_and_expr_ast;
+    if (ast != NULL) {
+        *out_ast = ast;
         return NULL;
     }
-    ast = ruyi_ast_create(Ruyi_at_bit_or_expression);
-    ruyi_ast_add_child(ast, bit_and_expr_ast);
-    
-    while (TRUE) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_BIT_OR, NULL)) {
-            break;
-        }
-        if ((err = bit_and_expression(reader, &bit_and_expr_ast)) != NULL) {
-            goto bit_or_expression_on_error;
-        }
-        if (bit_and_expr_ast == NULL) {
-            err = ruyi_error_by_parser(reader, "miss expression after '|'");
-            goto bit_or_expression_on_error;
-        }
-        ruyi_ast_add_child(ast, bit_and_expr_ast);
+    if ((err = floating_point_type(parser, &ast)) != NULL) {
+        return err;
     }
-    *out_ast = ast;
-    return NULL;
-bit_or_expression_on_error:
     if (ast != NULL) {
-        ruyi_ast_destroy(ast);
+        *out_ast = ast;
+        return NULL;
     }
     *out_ast = NULL;
-    return err;
+    return NULL;
 }
 
 static
-ruyi_error* conditional_and_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <conditional and expression> ::= <bit or expression> ( LOGIC_AND <bit or expression>)*
+ruyi_error* primitive_type(ruyi_parser *parser, ruyi_ast **out_ast) {
+    // <primitive type> ::= <numeric type> | bool
     ruyi_error *err;
     ruyi_ast *ast = NULL;
-    ruyi_ast *bit_or_expr_ast = NULL;
-    if ((err = bit_or_expression(reader, &bit_or_expr_ast)) != NULL) {
+    if ((err = numeric_type(parser, &ast)) != NULL) {
         return err;
     }
-    if (bit_or_expr_ast == NULL) {
-        *out_ast = NULL;
+    if (ast != NULL) {
+        *out_ast = ast;
         return NULL;
     }
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_LOGIC_AND) {
-        *out_ast = bit_or_expr_ast;
-        return NULL;
-    }
-    ast = ruyi_ast_create(Ruyi_at_conditional_and_expression);
-    ruyi_ast_add_child(ast, bit_or_expr_ast);
-    
-    while (TRUE) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LOGIC_AND, NULL)) {
-            break;
-        }
-        if ((err = conditional_and_expression(reader, &bit_or_expr_ast)) != NULL) {
-            goto conditional_and_expression_on_error;
-        }
-        if (bit_or_expr_ast == NULL) {
-            err = ruyi_error_by_parser(reader, "miss expression after '&&'");
-            goto conditional_and_expression_on_error;
-        }
-        ruyi_ast_add_child(ast, bit_or_expr_ast);
-    }
-    *out_ast = ast;
-    return NULL;
-conditional_and_expression_on_error:
-    if (ast != NULL) {
-        ruyi_ast_destroy(ast);
-    }
-    *out_ast = NULL;
-    return err;
-}
-
-static
-ruyi_error* conditional_or_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <conditional or expression> ::= <conditional and expression> (LOGIC_OR <conditional and expression>)*
-    ruyi_error *err;
-    ruyi_ast *ast = NULL;
-    ruyi_ast *expr_ast = NULL;
-    if ((err = conditional_and_expression(reader, &expr_ast)) != NULL) {
-        return err;
-    }
-    if (expr_ast == NULL) {
-        *out_ast = NULL;
-        return NULL;
-    }
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_LOGIC_OR) {
-        *out_ast = expr_ast;
-        return NULL;
-    }
-    ast = ruyi_ast_create(Ruyi_at_conditional_or_expression);
-    ruyi_ast_add_child(ast, expr_ast);
-    while (TRUE) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LOGIC_OR, NULL)) {
-            break;
-        }
-        if ((err = conditional_and_expression(reader, &expr_ast)) != NULL) {
-            goto conditional_or_expression_on_error;
-        }
-        if (expr_ast == NULL) {
-            err = ruyi_error_by_parser(reader, "miss expression after '||'");
-            goto conditional_or_expression_on_error;
-        }
-        ruyi_ast_add_child(ast, expr_ast);
-    }
-    *out_ast = ast;
-    return NULL;
-conditional_or_expression_on_error:
-    if (ast != NULL) {
-        ruyi_ast_destroy(ast);
-    }
-    *out_ast = NULL;
-    return err;
-}
-
-static
-ruyi_error* conditional_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <conditional or expression> (QM <expression> Ruyi_tt_COLON <conditional expression>)?
-    ruyi_error *err;
-    ruyi_ast *conditon_expr_ast = NULL;
-    ruyi_ast *true_expr_ast = NULL;
-    ruyi_ast *false_expr_ast = NULL;
-    ruyi_ast * ast;
-    if ((err = conditional_or_expression(reader, &conditon_expr_ast)) != NULL) {
-        return err;
-    }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_QM, NULL)) {
-        *out_ast = conditon_expr_ast;
-        return NULL;
-    }
-    if ((err = conditional_or_expression(reader, &true_expr_ast)) != NULL) {
-        goto conditional_expression_on_error;
-    }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COLON, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ':' in conditional expression");
-        goto conditional_expression_on_error;
-    }
-    if ((err = conditional_expression(reader, &false_expr_ast)) != NULL) {
-        goto conditional_expression_on_error;
-    }
-    ast = ruyi_ast_create(Ruyi_at_conditional_expression);
-    ruyi_ast_add_child(ast, conditon_expr_ast);
-    ruyi_ast_add_child(ast, true_expr_ast);
-    ruyi_ast_add_child(ast, false_expr_ast);
-    *out_ast = ast;
-    return NULL;
-conditional_expression_on_error:
-    if (conditon_expr_ast != NULL) {
-        ruyi_ast_destroy(conditon_expr_ast);
-    }
-    if (true_expr_ast != NULL) {
-        ruyi_ast_destroy(true_expr_ast);
-    }
-    if (false_expr_ast != NULL) {
-        ruyi_ast_destroy(false_expr_ast);
-    }
-    *out_ast = NULL;
-    return err;
-}
-
-static
-ruyi_error* name(ruyi_lexer_reader *reader, ruyi_ast **out_ast, ruyi_vector* out_tokens) {
-    // <name> ::= IDENTITY (DOT IDENTITY) *
-    ruyi_error *err;
-    ruyi_ast *name = NULL;
-    ruyi_token *token;
-    ruyi_value temp_value;
-    ruyi_vector* out_tokens_temp = NULL;
-    UINT32 i, len;
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_IDENTITY) {
-        *out_ast = NULL;
-        return NULL;
-    }
-    if (out_tokens == NULL) {
-        name = create_ast_by_consume_token_string(reader, Ruyi_at_name);
-        for (;;) {
-            if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_DOT, NULL)) {
-                break;
-            }
-            if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_IDENTITY) {
-                err = ruyi_error_by_parser(reader, "need an identifier after '.'");
-                goto name_on_error;
-            }
-            ruyi_ast_add_child(name, create_ast_by_consume_token_string(reader, Ruyi_at_name_part));
-        }
-        *out_ast = name;
-        return NULL;
-    } else {
-        out_tokens_temp = ruyi_vector_create();
-        name = create_ast_string_by_token(reader, Ruyi_at_name, &token);
-        ruyi_vector_add(out_tokens_temp, ruyi_value_ptr(token));
-        for (;;) {
-            if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_DOT) {
-                break;
-            }
-            token = ruyi_lexer_reader_next_token(reader); // token: DOT
-            // add token: DOT
-            ruyi_vector_add(out_tokens_temp, ruyi_value_ptr(token));
-
-            if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_IDENTITY) {
-                err = ruyi_error_by_parser(reader, "need an identifier after '.'");
-                goto name_on_error;
-            }
-            ruyi_ast_add_child(name, create_ast_string_by_token(reader, Ruyi_at_name_part, &token));
-            // add name part
-            ruyi_vector_add(out_tokens_temp, ruyi_value_ptr(token));
-        }
-        *out_ast = name;
-        ruyi_vector_add_all(out_tokens, out_tokens_temp);
-        out_tokens_temp = NULL;
-        return NULL;
-    }
-name_on_error:
-    if (name) {
-        ruyi_ast_destroy(name);
-    }
-    if (out_tokens_temp != NULL) {
-        len = ruyi_vector_length(out_tokens_temp);
-        for (i = 0; i < len; i++) {
-            ruyi_vector_get(out_tokens_temp, i, &temp_value);
-            ruyi_lexer_token_destroy((ruyi_token*)temp_value.data.ptr);
-        }
-        ruyi_vector_destroy(out_tokens_temp);
-    }
-    *out_ast = NULL;
-    return err;
-}
-
-static
-ruyi_error* literal(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <literal> ::= INTEGER | FLOAT | KW_TRUE | KW_FALSE | RUNE | STRING | KW_NULL | <name>
-    ruyi_error *err = NULL;
-    ruyi_ast *ast = NULL;
-    ruyi_token *token = ruyi_lexer_reader_next_token(reader);
-    switch (token->type) {
-        case Ruyi_tt_INTEGER:
-            ast = ruyi_ast_create(Ruyi_at_integer);
-            ast->data.int64_value = token->value.int_value;
-            break;
-        case Ruyi_tt_FLOAT:
-            ast = ruyi_ast_create(Ruyi_at_float);
-            ast->data.float_value = token->value.float_value;
-            break;
-        case Ruyi_tt_KW_TRUE:
-            ast = ruyi_ast_create(Ruyi_at_bool);
-            ast->data.int64_value = TRUE;
-            break;
-        case Ruyi_tt_KW_FALSE:
-            ast = ruyi_ast_create(Ruyi_at_bool);
-            ast->data.int64_value = FALSE;
-            break;
-        case Ruyi_tt_CHAR:
-            ast = ruyi_ast_create(Ruyi_at_rune);
-            ast->data.int64_value = token->value.int_value;
-            break;
-        case Ruyi_tt_STRING:
-            ast = ruyi_ast_create_with_unicode(Ruyi_at_string, token->value.str_value);
-            break;
-        case Ruyi_tt_KW_NULL:
-            ast = ruyi_ast_create(Ruyi_at_null);
-            break;
-        default:
-            ruyi_lexer_reader_push_front(reader, token);
-            if ((err = name(reader, &ast, NULL)) != NULL) {
-                goto literal_on_error;
-            }
-            *out_ast = ast;
-            return NULL;
-            /*
-            if (ast != NULL) {
-                break;
-            }
-          //  ruyi_lexer_reader_push_front(reader, token);
-            *out_ast = NULL;
-            return NULL;
-             */
-    }
-    ruyi_lexer_token_destroy(token);
-    *out_ast = ast;
-    return NULL;
-literal_on_error:
-    if (token) {
-        ruyi_lexer_token_destroy(token);
-    }
-    return err;
-}
-
-static
-ruyi_error* integral_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <integral type> ::= KW_BYTE | KW_SHORT| KW_INT | KW_RUNE | KW_LONG
-    ruyi_token_type token_type = ruyi_lexer_reader_peek_token_type(reader);
-    switch (token_type) {
-        case Ruyi_tt_KW_BYTE:
-            ruyi_lexer_reader_consume_token(reader);
-            *out_ast = ruyi_ast_create(Ruyi_at_type_byte);
-            return NULL;
-        case Ruyi_tt_KW_SHORT:
-            ruyi_lexer_reader_consume_token(reader);
-            *out_ast = ruyi_ast_create(Ruyi_at_type_short);
-            return NULL;
-        case Ruyi_tt_KW_INT:
-            ruyi_lexer_reader_consume_token(reader);
-            *out_ast = ruyi_ast_create(Ruyi_at_type_int);
-            return NULL;
-        case Ruyi_tt_KW_RUNE:
-            ruyi_lexer_reader_consume_token(reader);
-            *out_ast = ruyi_ast_create(Ruyi_at_type_rune);
-            return NULL;
-        case Ruyi_tt_KW_LONG:
-            ruyi_lexer_reader_consume_token(reader);
-            *out_ast = ruyi_ast_create(Ruyi_at_type_long);
-            return NULL;
-        default:
-            break;
-    }
-    *out_ast = NULL;
-    return NULL;
-}
-
-static
-ruyi_error* floating_point_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <floating-point type> ::= KW_FLOAT | KW_DOUBLE
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_FLOAT, NULL)) {
-        *out_ast = ruyi_ast_create(Ruyi_at_type_float);
-        return NULL;
-    }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_DOUBLE, NULL)) {
-        *out_ast = ruyi_ast_create(Ruyi_at_type_double);
-        return NULL;
-    }
-    *out_ast = NULL;
-    return NULL;
-}
-
-static
-ruyi_error* numeric_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <numeric type> ::= <integral type> | <floating-point type>
-    ruyi_error *err;
-    ruyi_ast *ast = NULL;
-    if ((err = integral_type(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = floating_point_type(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    *out_ast = NULL;
-    return NULL;
-}
-
-static
-ruyi_error* primitive_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <primitive type> ::= <numeric type> | bool
-    ruyi_error *err;
-    ruyi_ast *ast = NULL;
-    if ((err = numeric_type(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_BOOL, NULL)) {
-        *out_ast = ruyi_ast_create(Ruyi_at_type_bool);
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_BOOL, NULL)) {
+        *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_bool);
         return NULL;
     }
     *out_ast = NULL;
@@ -1061,30 +862,30 @@ ruyi_error* primitive_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
 }
 
 static
-ruyi_error* parameter_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* parameter_type(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <parameter type> ::= DOT3? <type>
     ruyi_error *err;
     ruyi_ast *ast;
     BOOL var_args = FALSE;
     ruyi_ast *ast_type = NULL;
     ruyi_ast *ast_temp = NULL;
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_DOT3, NULL)) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_DOT3, NULL)) {
         var_args = TRUE;
     }
-    if ((err = type(reader, &ast_temp)) != NULL) {
+    if ((err = type(parser, &ast_temp)) != NULL) {
         *out_ast = NULL;
         return err;
     }
     if (ast_temp == NULL) {
         if (var_args) {
-            return ruyi_error_by_parser(reader, "miss type after '...'");
+            return ruyi_error_by_parser(parser->reader, "miss type after '...'");
         } else {
             *out_ast = NULL;
             return NULL;
         }
     }
     if (var_args) {
-        ast_type = ruyi_ast_create(Ruyi_at_var_args_type);
+        ast_type = ruyi_ast_create(parser->ast_arena, Ruyi_at_var_args_type);
         ruyi_ast_add_child(ast_type, ast_temp);
     } else {
         ast_type = ast_temp;
@@ -1095,29 +896,29 @@ ruyi_error* parameter_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
 }
 
 static
-ruyi_error* parameter_type_list(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* parameter_type_list(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <parameter type list> ::= ( <parameter type> ( COMMA <parameter type>) * ) ?
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *ast_parameter = NULL;
-    if ((err = parameter_type(reader, &ast_parameter)) != NULL) {
+    if ((err = parameter_type(parser, &ast_parameter)) != NULL) {
         goto parameter_type_list_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_parameter_type_list);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_parameter_type_list);
     if (ast_parameter == NULL) {
         *out_ast = ast;
         return NULL;
     }
     ruyi_ast_add_child(ast, ast_parameter);
     for (;;) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
             break;
         }
-        if ((err = parameter_type(reader, &ast_parameter)) != NULL) {
+        if ((err = parameter_type(parser, &ast_parameter)) != NULL) {
             goto parameter_type_list_on_error;
         }
         if (ast_parameter == NULL) {
-            err = ruyi_error_by_parser(reader, "miss paramter type");
+            err = ruyi_error_by_parser(parser->reader, "miss paramter type");
             goto parameter_type_list_on_error;
         }
         ruyi_ast_add_child(ast, ast_parameter);
@@ -1132,32 +933,32 @@ parameter_type_list_on_error:
 }
 
 static
-ruyi_error* func_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* func_type(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <func type> ::= KW_FUNC LPARAN <parameter type list> RPARAN <func return type>?
     // TODO
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *ast_parameter_type_list = NULL;
     ruyi_ast *ast_return_type = NULL;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_FUNC, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_FUNC, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '(' after 'func'");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '(' after 'func'");
         goto func_type_on_error;
     }
-    if ((err = parameter_type_list(reader, &ast_parameter_type_list)) != NULL) {
+    if ((err = parameter_type_list(parser, &ast_parameter_type_list)) != NULL) {
         goto func_type_on_error;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ')' at func type declare");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ')' at func type declare");
         goto func_type_on_error;
     }
-    if ((err = func_return_type(reader, &ast_return_type)) != NULL) {
+    if ((err = func_return_type(parser, &ast_return_type)) != NULL) {
         goto func_type_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_type_func);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_func);
     ruyi_ast_add_child(ast, ast_parameter_type_list);
     ruyi_ast_add_child(ast, ast_return_type);
     *out_ast = ast;
@@ -1174,28 +975,28 @@ func_type_on_error:
 }
 
 static
-ruyi_error* reference_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* reference_type(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <<reference type> ::= IDENTITY | <array type> | <map type> | <func type>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_IDENTITY, NULL)) {
-        ast = create_ast_by_consume_token_string(reader, Ruyi_at_name);
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) == Ruyi_tt_IDENTITY) {
+        ast = create_ast_by_consume_token_string(parser, Ruyi_at_name);
         *out_ast = ast;
         return NULL;
     }
-    if ((err = array_type(reader, out_ast)) != NULL) {
+    if ((err = array_type(parser, out_ast)) != NULL) {
         return err;
     }
     if (*out_ast != NULL) {
         return NULL;
     }
-    if ((err = map_type(reader, out_ast)) != NULL) {
+    if ((err = map_type(parser, out_ast)) != NULL) {
         return err;
     }
     if (*out_ast != NULL) {
         return NULL;
     }
-    if ((err = func_type(reader, out_ast)) != NULL) {
+    if ((err = func_type(parser, out_ast)) != NULL) {
         return err;
     }
     if (*out_ast != NULL) {
@@ -1207,18 +1008,18 @@ ruyi_error* reference_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
 
 
 static
-ruyi_error* type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* type_rule(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <type> ::= <primitive type> | <reference type>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
-    if ((err = primitive_type(reader, &ast)) != NULL) {
+    if ((err = primitive_type(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
         *out_ast = ast;
         return NULL;
     }
-    if ((err = reference_type(reader, &ast)) != NULL) {
+    if ((err = reference_type(parser, &ast)) != NULL) {
         return err;
     }
     *out_ast = ast;
@@ -1226,67 +1027,61 @@ ruyi_error* type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
 }
 
 static
-ruyi_error* array_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* type(ruyi_parser *parser, ruyi_ast **out_ast) {
+    return parse_nested(parser, type_rule, out_ast);
+}
+
+static
+ruyi_error* array_type(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <array type> ::= LBRACKET RBRACKET <type>
     ruyi_error *err;
     ruyi_ast *ast;
-    ruyi_token *lbracket_token;
     ruyi_ast *type_ast = NULL;
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_LBRACKET) {
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_LBRACKET ||
+        ruyi_lexer_reader_peek_nth_token_type(parser->reader, 1) != Ruyi_tt_RBRACKET) {
         *out_ast = NULL;
         return NULL;
     }
-    lbracket_token = ruyi_lexer_reader_next_token(reader);
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RBRACKET, NULL)) {
-        ruyi_lexer_reader_push_front(reader, lbracket_token);
-        *out_ast = NULL;
-        return NULL;
-    }
-    ruyi_lexer_token_destroy(lbracket_token);
-    if ((err = type(reader, &type_ast)) != NULL) {
+    ruyi_lexer_reader_consume_token(parser->reader); // consume Ruyi_tt_LBRACKET
+    ruyi_lexer_reader_consume_token(parser->reader); // consume Ruyi_tt_RBRACKET
+    if ((err = type(parser, &type_ast)) != NULL) {
         return err;
     }
     if (type_ast == NULL) {
-        return ruyi_error_by_parser(reader, "miss type after ']'");
+        return ruyi_error_by_parser(parser->reader, "miss type after ']'");
     }
-    ast = ruyi_ast_create(Ruyi_at_type_array);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_array);
     ruyi_ast_add_child(ast, type_ast);
     *out_ast = ast;
     return NULL;
 }
 
 static
-ruyi_error* map_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* map_type(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <map type> ::= LBRACKET IDENTITY RBRACKET <type>
     ruyi_error *err;
     ruyi_ast *ast;
-    ruyi_token *lbracket_token;
     ruyi_ast *key_ast = NULL;
     ruyi_ast *value_ast = NULL;
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_LBRACKET) {
-        *out_ast = NULL;
-        return NULL;
-    }
-    lbracket_token = ruyi_lexer_reader_next_token(reader);
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_IDENTITY) {
-        ruyi_lexer_reader_push_front(reader, lbracket_token);
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_LBRACKET ||
+        ruyi_lexer_reader_peek_nth_token_type(parser->reader, 1) != Ruyi_tt_IDENTITY) {
         *out_ast = NULL;
         return NULL;
     }
-    ruyi_lexer_token_destroy(lbracket_token);
-    key_ast = create_ast_by_consume_token_string(reader, Ruyi_at_name);
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RBRACKET, NULL)) {
-        err = ruyi_error_by_parser(reader, "need ']' after identifier when define map type");
+    ruyi_lexer_reader_consume_token(parser->reader); // consume Ruyi_tt_LBRACKET
+    key_ast = create_ast_by_consume_token_string(parser, Ruyi_at_name);
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RBRACKET, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "need ']' after identifier when define map type");
         goto map_type_on_error;
     }
-    if ((err = type(reader, &value_ast)) != NULL) {
+    if ((err = type(parser, &value_ast)) != NULL) {
         goto map_type_on_error;
     }
     if (value_ast == NULL) {
-        err = ruyi_error_by_parser(reader, "miss type after ']'");
+        err = ruyi_error_by_parser(parser->reader, "miss type after ']'");
         goto map_type_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_type_map);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_map);
     ruyi_ast_add_child(ast, key_ast);
     ruyi_ast_add_child(ast, value_ast);
     *out_ast = ast;
@@ -1303,21 +1098,21 @@ map_type_on_error:
 }
 
 static
-ruyi_error* argument_list(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* argument_list(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <argument list> ::= <expression> ( COMMA <expression> )*
     ruyi_error *err;
     ruyi_ast *expr_ast = NULL;
     ruyi_ast *ast;
-    if ((err = expression(reader, &expr_ast)) != NULL) {
+    if ((err = expression(parser, &expr_ast)) != NULL) {
         return err;
     }
-    ast = ruyi_ast_create(Ruyi_at_argument_list);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_argument_list);
     while (expr_ast != NULL) {
         ruyi_ast_add_child(ast, expr_ast);
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
             break;
         }
-        if ((err = expression(reader, &expr_ast)) != NULL) {
+        if ((err = expression(parser, &expr_ast)) != NULL) {
             goto argument_list_on_error;
         }
     }
@@ -1332,23 +1127,23 @@ argument_list_on_error:
 }
 
 static
-ruyi_error* function_invocation_tail(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* function_invocation_tail(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <function invocation tail> ::= LPARAN <argument list>? RPARAN
     ruyi_error *err;
     ruyi_ast *ast;
     ruyi_ast *arg_list_ast = NULL;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = argument_list(reader, &arg_list_ast)) != NULL) {
+    if ((err = argument_list(parser, &arg_list_ast)) != NULL) {
         goto function_invocation_on_error;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ')'");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ')'");
         goto function_invocation_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_function_invocation_tail);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_function_invocation_tail);
     ruyi_ast_add_child(ast, arg_list_ast);
     *out_ast = ast;
     return NULL;
@@ -1361,66 +1156,59 @@ function_invocation_on_error:
 }
 
 static
-ruyi_error* instance_creation(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* instance_creation(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <instance creation> ::= IDENTITY LBRACE (IDENTITY COLON <expression> (COMMA IDENTITY COLON <expression>)*)?  RBRACE
     ruyi_error *err;
     ruyi_ast *ast;
     ruyi_ast *name_ast;
-    ruyi_token *name_token;
     ruyi_ast *property_name_ast = NULL;
     ruyi_ast *property_expr_ast;
     ruyi_ast *property_ast;
     
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_IDENTITY) {
-        *out_ast = NULL;
-        return NULL;
-    }
-    name_token = ruyi_lexer_reader_next_token(reader);
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_LBRACE) {
-        ruyi_lexer_reader_push_front(reader, name_token);
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_IDENTITY ||
+        ruyi_lexer_reader_peek_nth_token_type(parser->reader, 1) != Ruyi_tt_LBRACE) {
         *out_ast = NULL;
         return NULL;
     }
     
-    name_ast = ruyi_ast_create_with_unicode(Ruyi_at_name, name_token->value.str_value);
-    ruyi_lexer_token_destroy(name_token);
-    ast = ruyi_ast_create(Ruyi_at_instance_creation);
+    name_ast = create_ast_by_consume_token_string(parser, Ruyi_at_name);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_instance_creation);
     ruyi_ast_add_child(ast, name_ast);
    
-    if (ruyi_lexer_reader_peek_token_type(reader) == Ruyi_tt_IDENTITY) {
-        property_name_ast = create_ast_by_consume_token_string(reader, Ruyi_at_name);
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COLON, NULL)) {
-            err = ruyi_error_by_parser(reader, "need ':' after property name when create instance");
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) == Ruyi_tt_IDENTITY) {
+        property_name_ast = create_ast_by_consume_token_string(parser, Ruyi_at_name);
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COLON, NULL)) {
+            err = ruyi_error_by_parser(parser->reader, "need ':' after property name when create instance");
             goto instance_creation_on_error;
         }
-        if ((err = expression(reader, &property_expr_ast)) != NULL) {
+        if ((err = expression(parser, &property_expr_ast)) != NULL) {
             goto instance_creation_on_error;
         }
-        property_ast = ruyi_ast_create(Ruyi_at_property);
+        property_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_property);
         ruyi_ast_add_child(property_ast, property_name_ast);
         ruyi_ast_add_child(property_ast, property_expr_ast);
         ruyi_ast_add_child(ast, property_ast);
         while (TRUE) {
-            if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
+            if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
                 break;
             }
-            property_name_ast = create_ast_by_consume_token_string(reader, Ruyi_at_name);
-            if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COLON, NULL)) {
-                err = ruyi_error_by_parser(reader, "need ':' after property name when create instance");
+            property_name_ast = create_ast_by_consume_token_string(parser, Ruyi_at_name);
+            if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COLON, NULL)) {
+                err = ruyi_error_by_parser(parser->reader, "need ':' after property name when create instance");
                 goto instance_creation_on_error;
             }
-            if ((err = expression(reader, &property_expr_ast)) != NULL) {
+            if ((err = expression(parser, &property_expr_ast)) != NULL) {
                 goto instance_creation_on_error;
             }
-            property_ast = ruyi_ast_create(Ruyi_at_property);
+            property_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_property);
             ruyi_ast_add_child(property_ast, property_name_ast);
             ruyi_ast_add_child(property_ast, property_expr_ast);
             ruyi_ast_add_child(ast, property_ast);
         }
     }
     
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RBRACE, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '}' when create instance");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RBRACE, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '}' when create instance");
         goto instance_creation_on_error;
     }
     *out_ast = ast;
@@ -1437,23 +1225,23 @@ instance_creation_on_error:
 }
 
 static
-ruyi_error* primary_no_new_collection(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* primary_no_new_collection(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <primary no new collection> ::= <literal> <function invocation tail>? | KW_THIS | LPARAN <expression> RPARAN | <instance creation>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *ast_func_invocation = NULL;
     ruyi_ast *ast_func_invocation_tail = NULL;
-    if ((err = literal(reader, &ast)) != NULL) {
+    if ((err = literal(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
-        if ((err = function_invocation_tail(reader, &ast_func_invocation_tail)) != NULL) {
+        if ((err = function_invocation_tail(parser, &ast_func_invocation_tail)) != NULL) {
             ruyi_ast_destroy(ast);
             return err;
         }
         // for function call
         if (ast_func_invocation_tail != NULL) {
-            ast_func_invocation = ruyi_ast_create(Ruyi_at_function_invocation);
+            ast_func_invocation = ruyi_ast_create(parser->ast_arena, Ruyi_at_function_invocation);
             ruyi_ast_add_child(ast_func_invocation, ast);
             ruyi_ast_add_child(ast_func_invocation, ast_func_invocation_tail);
             *out_ast = ast_func_invocation;
@@ -1465,21 +1253,21 @@ ruyi_error* primary_no_new_collection(ruyi_lexer_reader *reader, ruyi_ast **out_
             return NULL;
         }
     }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_THIS, NULL)) {
-        ast = ruyi_ast_create(Ruyi_at_this);
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_THIS, NULL)) {
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_this);
         *out_ast = ast;
         return NULL;
     }
     
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
-        if ((err = expression(reader, &ast)) != NULL) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
+        if ((err = expression(parser, &ast)) != NULL) {
             return err;
         }
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-            return ruyi_error_by_parser(reader, "miss ')'");
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+            return ruyi_error_by_parser(parser->reader, "miss ')'");
         }
         if (ast == NULL) {
-            return ruyi_error_by_parser(reader, "need expression in '(' and ')'");
+            return ruyi_error_by_parser(parser->reader, "need expression in '(' and ')'");
         }
         *out_ast = ast;
         return NULL;
@@ -1488,7 +1276,7 @@ ruyi_error* primary_no_new_collection(ruyi_lexer_reader *reader, ruyi_ast **out_
         *out_ast = ast;
         return NULL;
     }
-    if ((err = instance_creation(reader, &ast)) != NULL) {
+    if ((err = instance_creation(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
@@ -1501,31 +1289,31 @@ ruyi_error* primary_no_new_collection(ruyi_lexer_reader *reader, ruyi_ast **out_
 }
 
 static
-ruyi_error* map_creation(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* map_creation(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <map creation> ::= KW_MAP LPARAN <map type> RPARAN
     ruyi_error *err;
     ruyi_ast *ast_map_type = NULL;
     ruyi_ast *ast;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_MAP, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_MAP, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '(' after keyword 'map'");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '(' after keyword 'map'");
         goto map_creation_on_error;
     }
-    if ((err = map_type(reader, &ast_map_type)) != NULL) {
+    if ((err = map_type(parser, &ast_map_type)) != NULL) {
         goto map_creation_on_error;
     }
     if (ast_map_type == NULL) {
-        err = ruyi_error_by_parser(reader, "miss map type when create map");
+        err = ruyi_error_by_parser(parser->reader, "miss map type when create map");
         goto map_creation_on_error;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ')' when create map");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ')' when create map");
         goto map_creation_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_map_creation);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_map_creation);
     ruyi_ast_add_child(ast, ast_map_type);
     *out_ast = ast;
     return NULL;
@@ -1538,55 +1326,55 @@ map_creation_on_error:
 }
 
 static
-ruyi_error* array_creation_with_cap(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* array_creation_with_cap(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <array creation with cap> ::= KW_ARRAY LPARAN <array type> COMMA <expression> (COMMA <expression>)? RPARAN
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *ast_array_type = NULL;
     ruyi_ast *expr_len = NULL;
     ruyi_ast *expr_cap = NULL;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_ARRAY, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_ARRAY, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '(' after keyword 'array'");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '(' after keyword 'array'");
         goto array_creation_with_cap_on_err;
     }
-    if ((err = array_type(reader, &ast_array_type)) != NULL) {
+    if ((err = array_type(parser, &ast_array_type)) != NULL) {
         goto array_creation_with_cap_on_err;
     }
     if (ast_array_type == NULL) {
-        err = ruyi_error_by_parser(reader, "miss array type when create array");
+        err = ruyi_error_by_parser(parser->reader, "miss array type when create array");
         goto array_creation_with_cap_on_err;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ',' when create array");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ',' when create array");
         goto array_creation_with_cap_on_err;
     }
-    if ((err = expression(reader, &expr_len)) != NULL) {
+    if ((err = expression(parser, &expr_len)) != NULL) {
         goto array_creation_with_cap_on_err;
     }
     if (expr_len == NULL) {
-        err = ruyi_error_by_parser(reader, "miss length expression after ',' when create array");
+        err = ruyi_error_by_parser(parser->reader, "miss length expression after ',' when create array");
         goto array_creation_with_cap_on_err;
     }
-    ast = ruyi_ast_create(Ruyi_at_array_creation_with_cap);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_array_creation_with_cap);
     ruyi_ast_add_child(ast, ast_array_type);
     ruyi_ast_add_child(ast, expr_len);
     ast_array_type = NULL;
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
-        if ((err = expression(reader, &expr_cap)) != NULL) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
+        if ((err = expression(parser, &expr_cap)) != NULL) {
             goto array_creation_with_cap_on_err;
         }
         if (expr_cap == NULL) {
-            err = ruyi_error_by_parser(reader, "miss capacity expression after ',' when create array");
+            err = ruyi_error_by_parser(parser->reader, "miss capacity expression after ',' when create array");
             goto array_creation_with_cap_on_err;
         }
         ruyi_ast_add_child(ast, expr_cap);
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ')' when create array");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ')' when create array");
         goto array_creation_with_cap_on_err;
     }
     *out_ast = ast;
@@ -1603,47 +1391,47 @@ array_creation_with_cap_on_err:
 }
 
 static
-ruyi_error* array_creation_with_init(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* array_creation_with_init(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <array creation with init> ::= <array type> LBRACKET (<expression> (COMMA <expression>)*)? RBRACKET
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *expr_ast = NULL;
     ruyi_ast *ast_array_type = NULL;
-    if ((err = array_type(reader, &ast_array_type)) != NULL) {
+    if ((err = array_type(parser, &ast_array_type)) != NULL) {
         return err;
     }
     if (ast_array_type == NULL) {
         *out_ast = NULL;
         return NULL;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LBRACKET, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '[' when create array");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LBRACKET, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '[' when create array");
         goto array_creation_with_init_on_error;
     }
-    if ((err = expression(reader, &expr_ast)) != NULL) {
+    if ((err = expression(parser, &expr_ast)) != NULL) {
         goto array_creation_with_init_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_array_creation_with_init);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_array_creation_with_init);
     // first ast is array type
     ruyi_ast_add_child(ast, ast_array_type);
     if (expr_ast != NULL) {
         ruyi_ast_add_child(ast, expr_ast);
         while (TRUE) {
-            if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
+            if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
                 break;
             }
-            if ((err = expression(reader, &expr_ast)) != NULL) {
+            if ((err = expression(parser, &expr_ast)) != NULL) {
                 return err;
             }
             if (expr_ast == NULL) {
-                err = ruyi_error_by_parser(reader, "miss expression after ','");
+                err = ruyi_error_by_parser(parser->reader, "miss expression after ','");
                 goto array_creation_with_init_on_error;
             }
             ruyi_ast_add_child(ast, expr_ast);
         }
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RBRACKET, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ']' when create array");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RBRACKET, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ']' when create array");
         goto array_creation_with_init_on_error;
     }
     *out_ast = ast;
@@ -1657,63 +1445,39 @@ array_creation_with_init_on_error:
 }
 
 static
-ruyi_error* array_creation(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* array_creation(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <array creation> ::= <array creation with cap> | <array creation with init>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
-    if ((err = array_creation_with_cap(reader, &ast)) != NULL) {
+    if ((err = array_creation_with_cap(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
         *out_ast = ast;
         return NULL;
     }
-    if ((err = array_creation_with_init(reader, &ast)) != NULL) {
+    if ((err = array_creation_with_init(parser, &ast)) != NULL) {
         return err;
     }
     *out_ast = ast;
     return NULL;
 }
 
+static const ruyi_parse_alternative g_primary_alternatives[] = {
+    {RUYI_FIRST_PRIMARY_NO_NEW_COLLECTION, primary_no_new_collection},
+    {RUYI_FIRST_ARRAY_CREATION, array_creation},
+    {RUYI_FIRST_MAP_CREATION, map_creation},
+    {RUYI_FIRST_ANONYMOUS_FUNCTION_DECLARATION, anonymous_function_declaration},
+};
+
 static
-ruyi_error* primary(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* primary(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <primary> ::= <array creation> | <map creation> | <anonymous function declaration> | <primary no new collection>
-    ruyi_error *err;
-    ruyi_ast *ast = NULL;
-    if ((err = primary_no_new_collection(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = array_creation(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = map_creation(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = anonymous_function_declaration(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    *out_ast = NULL;
-    return NULL;
+    return parse_choice(parser, g_primary_alternatives, sizeof(g_primary_alternatives) / sizeof(*g_primary_alternatives), out_ast);
 }
 
 static
-ruyi_error* dot_expression_tail(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* dot_expression_tail(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <dot expression tail> ::= IDENTITY (LPARAN <argument list>? RPARAN)?
 
     *out_ast = NULL;
@@ -1721,7 +1485,7 @@ ruyi_error* dot_expression_tail(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
 }
 
 static
-ruyi_error* bracket_expression_tail(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* bracket_expression_tail(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <bracket expression tail> ::= <expression> RBRACKET
 
     *out_ast = NULL;
@@ -1729,13 +1493,13 @@ ruyi_error* bracket_expression_tail(ruyi_lexer_reader *reader, ruyi_ast **out_as
 }
 
 static
-ruyi_error* field_access_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* field_access_expression(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <field access expression> ::= <primary> (DOT <dot expression tail> | LBRACKET <bracket expression tail>) *
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *left_ast = NULL;
     ruyi_ast *expr_ast = NULL;
-    if ((err = primary(reader, &left_ast)) != NULL) {
+    if ((err = primary(parser, &left_ast)) != NULL) {
         return err;
     }
     if (left_ast == NULL) {
@@ -1743,21 +1507,21 @@ ruyi_error* field_access_expression(ruyi_lexer_reader *reader, ruyi_ast **out_as
         return NULL;
     }
     while (TRUE) {
-        if ((err = dot_expression_tail(reader, &expr_ast)) != NULL) {
+        if ((err = dot_expression_tail(parser, &expr_ast)) != NULL) {
             goto field_access_expression_on_error;
         }
         if (expr_ast != NULL) {
-            ast = ruyi_ast_create(Ruyi_at_field_dot_access_expression);
+            ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_field_dot_access_expression);
             ruyi_ast_add_child(ast, left_ast);
             ruyi_ast_add_child(ast, expr_ast);
             left_ast = ast;
             continue;
         }
-        if ((err = bracket_expression_tail(reader, &expr_ast)) != NULL) {
+        if ((err = bracket_expression_tail(parser, &expr_ast)) != NULL) {
             goto field_access_expression_on_error;
         }
         if (expr_ast != NULL) {
-            ast = ruyi_ast_create(Ruyi_at_field_bracket_access_expression);
+            ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_field_bracket_access_expression);
             ruyi_ast_add_child(ast, left_ast);
             ruyi_ast_add_child(ast, expr_ast);
             left_ast = ast;
@@ -1780,40 +1544,40 @@ field_access_expression_on_error:
 
 
 static
-ruyi_error* array_variable_access(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* array_variable_access(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <array variable access> ::= <name> LBRACKET <expression> RBRACKET
     ruyi_error *err;
-    ruyi_vector *name_tokens = ruyi_vector_create();
     ruyi_ast *name_ast = NULL;
     ruyi_ast *expr_ast = NULL;
     ruyi_ast *ast;
-    UINT32 i, len;
-    ruyi_value temp;
-    if ((err = name(reader, &name_ast, name_tokens)) != NULL) {
-        goto array_variable_access_on_error;
-    }
-    if (name_ast == NULL) {
+    ruyi_token_type next_type;
+    UINT32 name_length = peek_name_length(parser, 0);
+    if (name_length == 0) {
         *out_ast = NULL;
-        err = NULL;
-        goto array_variable_access_on_error;
+        return NULL;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LBRACKET, NULL)) {
-        tokens_push_back_at_front(reader, name_tokens);
+    // a '.' without an identifier after it is an error of the name
+    next_type = ruyi_lexer_reader_peek_nth_token_type(parser->reader, name_length);
+    if (next_type != Ruyi_tt_LBRACKET && next_type != Ruyi_tt_DOT) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = expression(reader, &expr_ast)) != NULL) {
+    if ((err = name(parser, &name_ast)) != NULL) {
+        goto array_variable_access_on_error;
+    }
+    ruyi_lexer_reader_consume_token(parser->reader); // consume Ruyi_tt_LBRACKET
+    if ((err = expression(parser, &expr_ast)) != NULL) {
         goto array_variable_access_on_error;
     }
     if (expr_ast == NULL) {
-        err = ruyi_error_by_parser(reader, "miss expression after '[' where access array");
+        err = ruyi_error_by_parser(parser->reader, "miss expression after '[' where access array");
         goto array_variable_access_on_error;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RBRACKET, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ']' where access array");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RBRACKET, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ']' where access array");
         goto array_variable_access_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_array_variable_access);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_array_variable_access);
     ruyi_ast_add_child(ast, name_ast);
     ruyi_ast_add_child(ast, expr_ast);
     *out_ast = ast;
@@ -1825,48 +1589,40 @@ array_variable_access_on_error:
     if (expr_ast != NULL) {
         ruyi_ast_destroy(expr_ast);
     }
-    if (name_tokens != NULL) {
-        len = ruyi_vector_length(name_tokens);
-        for (i = 0; i < len; i++) {
-            ruyi_vector_get(name_tokens, i, &temp);
-            ruyi_lexer_token_destroy((ruyi_token*)temp.data.ptr);
-        }
-        ruyi_vector_destroy(name_tokens);
-    }
     *out_ast = NULL;
     return err;
 }
 
 static
-ruyi_error* variable_primary_access(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* variable_primary_access(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <variable primary access> ::= <primary no new collection> LBRACKET <expression> RBRACKET
     ruyi_error *err;
     ruyi_ast *primary_ast = NULL;
     ruyi_ast *expr_ast = NULL;
     ruyi_ast *ast;
-    if ((err = primary_no_new_collection(reader, &primary_ast)) != NULL) {
+    if ((err = primary_no_new_collection(parser, &primary_ast)) != NULL) {
         return err;
     }
     if (primary_ast == NULL) {
         *out_ast = NULL;
         return NULL;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LBRACKET, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '[' where access array");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LBRACKET, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '[' where access array");
         goto variable_primary_access_on_error;
     }
-    if ((err = expression(reader, &expr_ast)) != NULL) {
+    if ((err = expression(parser, &expr_ast)) != NULL) {
         goto variable_primary_access_on_error;
     }
     if (expr_ast == NULL) {
-        err = ruyi_error_by_parser(reader, "miss expression after '[' where access array");
+        err = ruyi_error_by_parser(parser->reader, "miss expression after '[' where access array");
         goto variable_primary_access_on_error;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RBRACKET, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ']' where access array");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RBRACKET, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ']' where access array");
         goto variable_primary_access_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_array_primary_access);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_array_primary_access);
     ruyi_ast_add_child(ast, primary_ast);
     ruyi_ast_add_child(ast, expr_ast);
     *out_ast = ast;
@@ -1883,18 +1639,18 @@ variable_primary_access_on_error:
 }
 
 static
-ruyi_error* array_access(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* array_access(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <array access> ::= <array variable access> | <variable primary access>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
-    if ((err = array_variable_access(reader, &ast)) != NULL) {
+    if ((err = array_variable_access(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
         *out_ast = ast;
         return NULL;
     }
-    if ((err = variable_primary_access(reader, &ast)) != NULL) {
+    if ((err = variable_primary_access(parser, &ast)) != NULL) {
         return err;
     }
     *out_ast = ast;
@@ -1902,29 +1658,29 @@ ruyi_error* array_access(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
 }
 
 static
-ruyi_error* left_hand_side(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* left_hand_side(ruyi_parser *parser, ruyi_ast **out_ast) {
     //  <left hand side> ::= <name> | <field access expression> | <array access>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
-    if (is_keyword(ruyi_lexer_reader_peek_token_type(reader))) {
+    if (is_keyword(ruyi_lexer_reader_peek_token_type(parser->reader))) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = name(reader, &ast, NULL)) != NULL) {
+    if ((err = name(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
         *out_ast = ast;
         return NULL;
     }
-    if ((err = field_access_expression(reader, &ast)) != NULL) {
+    if ((err = field_access_expression(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
         *out_ast = ast;
         return NULL;
     }
-    if ((err = array_access(reader, &ast)) != NULL) {
+    if ((err = array_access(parser, &ast)) != NULL) {
         return err;
     }
     *out_ast = ast;
@@ -1932,9 +1688,9 @@ ruyi_error* left_hand_side(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
 }
 
 static
-ruyi_error* assignment_operator(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* assignment_operator(ruyi_parser *parser, ruyi_ast **out_ast) {
     //  <assignment operator> ::= ASSIGN | MUL_ASS | DIV_ASS | MOD_ASS | ADD_ASS | SUB_ASS | SHFT_LEFT_ASS | SHFT_RIGHT_ASS | BIT_AND_ASS | BIT_XOR_ASS | BIT_OR_ASS
-    ruyi_token_type token_type = ruyi_lexer_reader_peek_token_type(reader);
+    ruyi_token_type token_type = ruyi_lexer_reader_peek_token_type(parser->reader);
     switch (token_type) {
         case Ruyi_tt_ASSIGN:
         case Ruyi_tt_MUL_ASS:
@@ -1947,8 +1703,8 @@ ruyi_error* assignment_operator(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
         case Ruyi_tt_BIT_AND_ASS:
         case Ruyi_tt_BIT_XOR_ASS:
         case Ruyi_tt_BIT_OR_ASS:
-            ruyi_lexer_reader_consume_token(reader);
-            *out_ast = ruyi_ast_create_by_token_type(Ruyi_at_assign_operator, token_type);
+            ruyi_lexer_reader_consume_token(parser->reader);
+            *out_ast = ruyi_ast_create_by_token_type(parser->ast_arena, Ruyi_at_assign_operator, token_type);
             return NULL;
         default:
             *out_ast = NULL;
@@ -1957,35 +1713,35 @@ ruyi_error* assignment_operator(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
 }
 
 static
-ruyi_error* assignment(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* assignment(ruyi_parser *parser, ruyi_ast **out_ast) {
     //  <assignment> ::= <left hand side> <assignment operator> <assignment expression>
     ruyi_error *err;
     ruyi_ast *left_hand_side_ast = NULL;
     ruyi_ast *ass_oper_ast = NULL;
     ruyi_ast *ass_expr_ast = NULL;
     ruyi_ast *ast;
-    if ((err = left_hand_side(reader, &left_hand_side_ast)) != NULL) {
+    if ((err = left_hand_side(parser, &left_hand_side_ast)) != NULL) {
         return err;
     }
     if (left_hand_side_ast == NULL) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = assignment_operator(reader, &ass_oper_ast)) != NULL) {
+    if ((err = assignment_operator(parser, &ass_oper_ast)) != NULL) {
         goto assignment_on_error;
     }
     if (ass_oper_ast == NULL) {
-        err = ruyi_error_by_parser(reader, "miss assignment operator");
+        err = ruyi_error_by_parser(parser->reader, "miss assignment operator");
         goto assignment_on_error;
     }
-    if ((err = assignment_expression(reader, &ass_expr_ast)) != NULL) {
+    if ((err = assignment_expression(parser, &ass_expr_ast)) != NULL) {
         goto assignment_on_error;
     }
     if (ass_expr_ast == NULL) {
-        err = ruyi_error_by_parser(reader, "miss assignment expression");
+        err = ruyi_error_by_parser(parser->reader, "miss assignment expression");
         goto assignment_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_assignment);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_assignment);
     ruyi_ast_add_child(ast, left_hand_side_ast);
     ruyi_ast_add_child(ast, ass_oper_ast);
     ruyi_ast_add_child(ast, ass_expr_ast);
@@ -2006,18 +1762,18 @@ assignment_on_error:
 }
 
 static
-ruyi_error* assignment_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* assignment_expression(ruyi_parser *parser, ruyi_ast **out_ast) {
     //  <assignment expression> ::= <conditional expression> | <assignment>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
-    if ((err = conditional_expression(reader, &ast)) != NULL) {
+    if ((err = conditional_expression(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
         *out_ast = ast;
         return NULL;
     }
-    if ((err = assignment(reader, &ast)) != NULL) {
+    if ((err = assignment(parser, &ast)) != NULL) {
         return err;
     }
     *out_ast = ast;
@@ -2025,13 +1781,13 @@ ruyi_error* assignment_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast)
 }
 
 static
-ruyi_error* expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* expression(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <expression> ::= <assignment expression>
-    return assignment_expression(reader, out_ast);
+    return assignment_expression(parser, out_ast);
 }
 
 static
-ruyi_error* variable_declaration_tail(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* variable_declaration_tail(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <variable declaration tail> ::= IDENTITY <type>? (ASSIGN <expression>) ?
     ruyi_error* err;
     ruyi_token token1;
@@ -2039,32 +1795,32 @@ ruyi_error* variable_declaration_tail(ruyi_lexer_reader *reader, ruyi_ast **out_
     ruyi_ast *var_declare_ast = NULL;
     ruyi_ast *ast_var_init = NULL;
    
-    if (Ruyi_tt_IDENTITY != ruyi_lexer_reader_peek_token_type(reader)) {
+    if (Ruyi_tt_IDENTITY != ruyi_lexer_reader_peek_token_type(parser->reader)) {
         *out_ast = NULL;
         return NULL;
     }
-    var_declare_ast = create_ast_by_consume_token_string(reader, Ruyi_at_var_declaration);
+    var_declare_ast = create_ast_by_consume_token_string(parser, Ruyi_at_var_declaration);
     
-    if ((err = type(reader, &type_ast)) != NULL) {
+    if ((err = type(parser, &type_ast)) != NULL) {
         goto variable_declaration_tail_on_error;
     }
     
     if (type_ast != NULL) {
         ruyi_ast_add_child(var_declare_ast, type_ast);
     } else {
-        ruyi_ast_add_child(var_declare_ast, ruyi_ast_create(Ruyi_at_var_declaration_auto_type));
+        ruyi_ast_add_child(var_declare_ast, ruyi_ast_create(parser->ast_arena, Ruyi_at_var_declaration_auto_type));
         // ruyi_ast_add_child(var_declare_ast, NULL);
     }
     
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_ASSIGN, &token1)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_ASSIGN, &token1)) {
         *out_ast = var_declare_ast;
         return NULL;
     }
-    if ((err = expression(reader, &ast_var_init)) != NULL) {
+    if ((err = expression(parser, &ast_var_init)) != NULL) {
         goto variable_declaration_tail_on_error;
     }
     if (ast_var_init == NULL) {
-        err = ruyi_error_make(Ruyi_et_Parser, "miss expression after '='", &token1);
+        err = ruyi_error_make(Ruyi_et_Parser, "miss expression after '='", parser->reader, &token1);
         goto variable_declaration_tail_on_error;
     }
     ruyi_ast_add_child(var_declare_ast, ast_var_init);
@@ -2082,33 +1838,26 @@ variable_declaration_tail_on_error:
 }
 
 static
-ruyi_error* variable_auto_infer_type_init(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* variable_auto_infer_type_init(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <variable auto infer type init> ::= IDENTITY COLON_ASSIGN <expression>
     ruyi_error* err;
     ruyi_ast *ast = NULL;
     ruyi_ast *expr_ast = NULL;
-    ruyi_token *id_token;
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_IDENTITY) {
-        *out_ast = NULL;
-        return NULL;
-    }
-    id_token = ruyi_lexer_reader_next_token(reader);
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_COLON_ASSIGN) {
-        ruyi_lexer_reader_push_front(reader, id_token);
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_IDENTITY ||
+        ruyi_lexer_reader_peek_nth_token_type(parser->reader, 1) != Ruyi_tt_COLON_ASSIGN) {
         *out_ast = NULL;
         return NULL;
     }
-    ruyi_lexer_reader_push_front(reader, id_token);
-    ast = create_ast_by_consume_token_string(reader, Ruyi_at_var_declaration);
-    ruyi_lexer_reader_consume_token(reader); // consume Ruyi_tt_COLON_ASSIGN
-    if ((err = expression(reader, &expr_ast)) != NULL) {
+    ast = create_ast_by_consume_token_string(parser, Ruyi_at_var_declaration);
+    ruyi_lexer_reader_consume_token(parser->reader); // consume Ruyi_tt_COLON_ASSIGN
+    if ((err = expression(parser, &expr_ast)) != NULL) {
         goto variable_auto_infer_type_init_on_error;
     }
     if (expr_ast == NULL) {
-        err = ruyi_error_by_parser(reader, "need initialize expression after ':='");
+        err = ruyi_error_by_parser(parser->reader, "need initialize expression after ':='");
         goto variable_auto_infer_type_init_on_error;
     }
-    ruyi_ast_add_child(ast, ruyi_ast_create(Ruyi_at_var_declaration_auto_type));
+    ruyi_ast_add_child(ast, ruyi_ast_create(parser->ast_arena, Ruyi_at_var_declaration_auto_type));
     ruyi_ast_add_child(ast, expr_ast);
     *out_ast = ast;
     return NULL;
@@ -2121,53 +1870,53 @@ variable_auto_infer_type_init_on_error:
 }
 
 static
-ruyi_error* variable_declaration(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* variable_declaration(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <variable declaration> ::= <variable auto infer type init> | (KW_VAR <variable declaration tail>)
     ruyi_error* err;
     ruyi_ast *ast;
     ruyi_ast *var_declare_ast;
-    if ((err = variable_auto_infer_type_init(reader, &ast)) != NULL) {
+    if ((err = variable_auto_infer_type_init(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
         *out_ast = ast;
         return NULL;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_VAR, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_VAR, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = variable_declaration_tail(reader, &var_declare_ast)) != NULL) {
+    if ((err = variable_declaration_tail(parser, &var_declare_ast)) != NULL) {
         return err;
     }
     if (var_declare_ast == NULL) {
-        return ruyi_error_by_parser(reader, "miss (array or map) identifier after 'var'");
+        return ruyi_error_by_parser(parser->reader, "miss (array or map) identifier after 'var'");
     }
     *out_ast = var_declare_ast;
     return NULL;
 }
 
 static
-ruyi_error* formal_parameter(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* formal_parameter(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <formal parameter> ::= IDENTITY DOT3? <type>
     ruyi_error *err;
     ruyi_ast *ast_name = NULL;
     ruyi_ast *ast_type = NULL;
     ruyi_ast *ast_type_temp;
     ruyi_ast *ast;
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_IDENTITY) {
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_IDENTITY) {
         *out_ast = NULL;
         return NULL;
     }
-    ast_name = create_ast_by_consume_token_string(reader, Ruyi_at_name);
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_DOT3, NULL)) {
-        ast_type = ruyi_ast_create(Ruyi_at_var_args_type);
+    ast_name = create_ast_by_consume_token_string(parser, Ruyi_at_name);
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_DOT3, NULL)) {
+        ast_type = ruyi_ast_create(parser->ast_arena, Ruyi_at_var_args_type);
     }
-    if ((err = type(reader, &ast_type_temp)) != NULL) {
+    if ((err = type(parser, &ast_type_temp)) != NULL) {
         goto formal_parameter_on_error;
     }
     if (ast_type_temp == NULL) {
-        err = ruyi_error_by_parser(reader, "miss type after identifier");
+        err = ruyi_error_by_parser(parser->reader, "miss type after identifier");
         goto formal_parameter_on_error;
     }
     if (ast_type == NULL) {
@@ -2175,7 +1924,7 @@ ruyi_error* formal_parameter(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
     } else {
         ruyi_ast_add_child(ast_type, ast_type_temp);
     }
-    ast = ruyi_ast_create(Ruyi_at_formal_parameter);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_formal_parameter);
     ruyi_ast_add_child(ast, ast_name);
     ruyi_ast_add_child(ast, ast_type);
     *out_ast = ast;
@@ -2192,12 +1941,12 @@ formal_parameter_on_error:
 }
 
 static
-ruyi_error* formal_parameter_list(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* formal_parameter_list(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <formal parameter list> ::= ( <formal parameter> ( COMMA <formal parameter>) * ) ?
     ruyi_error *err;
     ruyi_ast *ast_formal_param = NULL;
-    ruyi_ast *ast = ruyi_ast_create(Ruyi_at_formal_parameter_list);
-    if ((err = formal_parameter(reader, &ast_formal_param)) != NULL) {
+    ruyi_ast *ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_formal_parameter_list);
+    if ((err = formal_parameter(parser, &ast_formal_param)) != NULL) {
         goto formal_parameter_list_on_error;
     }
     if (ast_formal_param == NULL) {
@@ -2207,14 +1956,14 @@ ruyi_error* formal_parameter_list(ruyi_lexer_reader *reader, ruyi_ast **out_ast)
     }
     ruyi_ast_add_child(ast, ast_formal_param);
     for (;;) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
             break;
         }
-        if ((err = formal_parameter(reader, &ast_formal_param)) != NULL) {
+        if ((err = formal_parameter(parser, &ast_formal_param)) != NULL) {
             goto formal_parameter_list_on_error;
         }
         if (ast_formal_param == NULL) {
-            err = ruyi_error_by_parser(reader, "miss formal parameter after ','");
+            err = ruyi_error_by_parser(parser->reader, "miss formal parameter after ','");
             goto formal_parameter_list_on_error;
         }
         ruyi_ast_add_child(ast, ast_formal_param);
@@ -2230,18 +1979,18 @@ formal_parameter_list_on_error:
 }
 
 static
-ruyi_error* local_variable_declaration(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* local_variable_declaration(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <local variable declaration> ::= <variable declaration> | <variable auto infer type init>
     ruyi_error *err;
     ruyi_ast *ast;
-    if ((err = variable_declaration(reader, &ast)) != NULL) {
+    if ((err = variable_declaration(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
         *out_ast = ast;
         return NULL;
     }
-    if ((err = variable_auto_infer_type_init(reader, &ast)) != NULL) {
+    if ((err = variable_auto_infer_type_init(parser, &ast)) != NULL) {
         return err;
     }
     *out_ast = ast;
@@ -2250,31 +1999,31 @@ ruyi_error* local_variable_declaration(ruyi_lexer_reader *reader, ruyi_ast **out
 
 
 static
-ruyi_error* elseif_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* elseif_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <elseif statement> ::= KW_ELSEIF <expression> <block>
     ruyi_error *err;
     ruyi_ast *expr_ast = NULL;
     ruyi_ast *block_ast = NULL;
     ruyi_ast *ast;
     BOOL has_paran = FALSE;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_ELSEIF, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_ELSEIF, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
         has_paran = TRUE;
     }
-    if ((err = expression(reader, &expr_ast)) != NULL) {
+    if ((err = expression(parser, &expr_ast)) != NULL) {
         goto elseif_statement_on_error;
     }
-    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss )");
+    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss )");
         goto elseif_statement_on_error;
     }
-    if ((err = block(reader, &block_ast)) != NULL) {
+    if ((err = block(parser, &block_ast)) != NULL) {
         goto elseif_statement_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_elseif_statement);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_elseif_statement);
     ruyi_ast_add_child(ast, expr_ast);
     ruyi_ast_add_child(ast, block_ast);
     *out_ast = ast;
@@ -2291,27 +2040,27 @@ elseif_statement_on_error:
 }
 
 static
-ruyi_error* else_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* else_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <else statement> ::= KW_ELSE <block>
     ruyi_error *err;
     ruyi_ast *block_ast = NULL;
     ruyi_ast *ast;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_ELSE, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_ELSE, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = block(reader, &block_ast)) != NULL) {
+    if ((err = block(parser, &block_ast)) != NULL) {
         *out_ast = NULL;
         return err;
     }
-    ast = ruyi_ast_create(Ruyi_at_else_statement);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_else_statement);
     ruyi_ast_add_child(ast, block_ast);
     *out_ast = ast;
     return NULL;
 }
 
 static
-ruyi_error* if_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* if_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <if statement> ::= KW_IF ( LPARAN <expression> RPARAN ) | <expression> <block> <elseif statement>* <else statement>?
     ruyi_error *err;
     ruyi_ast *expr_ast = NULL;
@@ -2320,30 +2069,30 @@ ruyi_error* if_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
     ruyi_ast *else_ast = NULL;
     ruyi_ast *ast = NULL;
     BOOL has_paran = FALSE;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_IF, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_IF, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
         has_paran = TRUE;
     }
-    if ((err = expression(reader, &expr_ast)) != NULL) {
+    if ((err = expression(parser, &expr_ast)) != NULL) {
         goto if_statement_on_error;
     }
-    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss )");
+    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss )");
         goto if_statement_on_error;
     }
-    if ((err = block(reader, &block_ast)) != NULL) {
+    if ((err = block(parser, &block_ast)) != NULL) {
         goto if_statement_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_if_statement);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_if_statement);
     ruyi_ast_add_child(ast, expr_ast);
     ruyi_ast_add_child(ast, block_ast);
     expr_ast = NULL;
     block_ast = NULL;
     for (;;) {
-        if ((err = elseif_statement(reader, &elseif_ast)) != NULL) {
+        if ((err = elseif_statement(parser, &elseif_ast)) != NULL) {
             goto if_statement_on_error;
         }
         if (elseif_ast == NULL) {
@@ -2351,7 +2100,7 @@ ruyi_error* if_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
         }
         ruyi_ast_add_child(ast, elseif_ast);
     }
-    if ((err = else_statement(reader, &else_ast)) != NULL) {
+    if ((err = else_statement(parser, &else_ast)) != NULL) {
         goto if_statement_on_error;
     }
     if (else_ast != NULL) {
@@ -2375,52 +2124,52 @@ if_statement_on_error:
 
 
 static
-ruyi_error* return_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* return_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <return statement> ::= KW_RETURN ((<expression> (COMMA <expression>) *) | (LPARAN <expression> (COMMA <expression>) *) RPARAN)?
     ruyi_error *err;
     ruyi_ast *expr_ast_list = NULL;
     ruyi_ast *expr_ast = NULL;
     ruyi_ast *ast;
     BOOL has_paran = FALSE;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_RETURN, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_RETURN, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
         has_paran = TRUE;
     }
-    if ((err = expression(reader, &expr_ast)) != NULL) {
+    if ((err = expression(parser, &expr_ast)) != NULL) {
         goto return_statement_on_error;
     }
     if (expr_ast == NULL) {
         if (!has_paran) {
-            *out_ast = ruyi_ast_create(Ruyi_at_return_statement);
+            *out_ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_return_statement);
             return NULL;
         } else {
-            err = ruyi_error_by_parser(reader, "miss expression after '('");
+            err = ruyi_error_by_parser(parser->reader, "miss expression after '('");
             goto return_statement_on_error;
         }
     }
-    expr_ast_list = ruyi_ast_create(Ruyi_at_expr_list);
+    expr_ast_list = ruyi_ast_create(parser->ast_arena, Ruyi_at_expr_list);
     ruyi_ast_add_child(expr_ast_list, expr_ast);
     for (;;) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
             break;
         }
-        if ((err = expression(reader, &expr_ast)) != NULL) {
+        if ((err = expression(parser, &expr_ast)) != NULL) {
             goto return_statement_on_error;
         }
         if (expr_ast == NULL) {
-            err = ruyi_error_by_parser(reader, "miss expression after ','");
+            err = ruyi_error_by_parser(parser->reader, "miss expression after ','");
             goto return_statement_on_error;
         }
         ruyi_ast_add_child(expr_ast_list, expr_ast);
     }
-    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ')'");
+    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ')'");
         goto return_statement_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_return_statement);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_return_statement);
     ruyi_ast_add_child(ast, expr_ast_list);
     *out_ast = ast;
     return NULL;
@@ -2432,31 +2181,31 @@ return_statement_on_error:
 }
 
 static
-ruyi_error* while_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* while_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <while statement> ::= KW_WHILE <expression> | ( LPARAN <expression> RPARAN ) <block>
     ruyi_error *err;
     ruyi_ast *expr_ast = NULL;
     ruyi_ast *ast;
     ruyi_ast *block_ast;
     BOOL has_paran = FALSE;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_WHILE, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_WHILE, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
         has_paran = TRUE;
     }
-    if ((err = expression(reader, &expr_ast)) != NULL) {
+    if ((err = expression(parser, &expr_ast)) != NULL) {
         goto while_statement_on_error;
     }
-    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss )");
+    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss )");
         goto while_statement_on_error;
     }
-    if ((err = block(reader, &block_ast)) != NULL) {
+    if ((err = block(parser, &block_ast)) != NULL) {
         goto while_statement_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_while_statement);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_while_statement);
     ruyi_ast_add_child(ast, expr_ast);
     ruyi_ast_add_child(ast, block_ast);
     *out_ast = ast;
@@ -2470,37 +2219,37 @@ while_statement_on_error:
 }
 
 static
-ruyi_error* func_return_type(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* func_return_type(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <func return type> ::= (<type> ( COMMA <type>) *) | (LPARAN <type> ( COMMA <type>) * RPARAN)
     ruyi_error *err;
     ruyi_ast *ast_return_type = NULL;
     ruyi_ast *ast_temp = NULL;
     BOOL has_paran = FALSE;
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
         has_paran = TRUE;
     }
-    if ((err = type(reader, &ast_temp)) != NULL) {
+    if ((err = type(parser, &ast_temp)) != NULL) {
         goto func_return_type_on_error;
     }
     if (ast_temp != NULL) {
-        ast_return_type = ruyi_ast_create(Ruyi_at_type_list);
+        ast_return_type = ruyi_ast_create(parser->ast_arena, Ruyi_at_type_list);
         ruyi_ast_add_child(ast_return_type, ast_temp);
         for (;;) {
-            if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
+            if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
                 break;
             }
-            if ((err = type(reader, &ast_temp)) != NULL) {
+            if ((err = type(parser, &ast_temp)) != NULL) {
                 goto func_return_type_on_error;
             }
             if (ast_temp == NULL) {
-                err = ruyi_error_by_parser(reader, "miss type after ','");
+                err = ruyi_error_by_parser(parser->reader, "miss type after ','");
                 goto func_return_type_on_error;
             }
             ruyi_ast_add_child(ast_return_type, ast_temp);
         }
     }
-    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ')'");
+    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ')'");
         goto func_return_type_on_error;
     }
     if (ast_return_type == NULL) {
@@ -2518,39 +2267,39 @@ func_return_type_on_error:
 }
 
 static
-ruyi_error* anonymous_function_declaration(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* anonymous_function_declaration(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <anonymous function declaration> ::= KW_FUNC LPARAN <formal parameter list>? RPARAN <func return type>? <function body>
     ruyi_error *err;
     ruyi_ast *ast;
     ruyi_ast *ast_formal_params = NULL;
     ruyi_ast *ast_return_type = NULL;
     ruyi_ast *ast_body = NULL;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_FUNC, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_FUNC, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '(' after identifier when define a function");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '(' after identifier when define a function");
         goto anonymous_function_declaration_on_error;
     }
-    if ((err = formal_parameter_list(reader, &ast_formal_params)) != NULL) {
+    if ((err = formal_parameter_list(parser, &ast_formal_params)) != NULL) {
         goto anonymous_function_declaration_on_error;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ')' when define a function");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ')' when define a function");
         goto anonymous_function_declaration_on_error;
     }
-    if ((err = func_return_type(reader, &ast_return_type)) != NULL) {
+    if ((err = func_return_type(parser, &ast_return_type)) != NULL) {
         goto anonymous_function_declaration_on_error;
     }
-    if ((err = function_body(reader, &ast_body)) != NULL) {
+    if ((err = function_body(parser, &ast_body)) != NULL) {
         goto anonymous_function_declaration_on_error;
     }
     if (ast_body == NULL) {
-        err = ruyi_error_by_parser(reader, "miss function body");
+        err = ruyi_error_by_parser(parser->reader, "miss function body");
         goto anonymous_function_declaration_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_anonymous_function_declaration);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_anonymous_function_declaration);
     ruyi_ast_add_child(ast, ast_formal_params);
     ruyi_ast_add_child(ast, ast_return_type);
     ruyi_ast_add_child(ast, ast_body);
@@ -2571,11 +2320,11 @@ anonymous_function_declaration_on_error:
 }
 
 static
-ruyi_error* instance_creation_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* instance_creation_expression(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <instance creation expression> ::= <map creation> | <array creation> | <instance creation>
     ruyi_error *err;
     ruyi_ast *ast;
-    if ((err = map_creation(reader, &ast)) != NULL) {
+    if ((err = map_creation(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
@@ -2583,7 +2332,7 @@ ruyi_error* instance_creation_expression(ruyi_lexer_reader *reader, ruyi_ast **o
         return NULL;
     }
     
-    if ((err = array_creation(reader, &ast)) != NULL) {
+    if ((err = array_creation(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
@@ -2591,7 +2340,7 @@ ruyi_error* instance_creation_expression(ruyi_lexer_reader *reader, ruyi_ast **o
         return NULL;
     }
     
-    if ((err = instance_creation(reader, &ast)) != NULL) {
+    if ((err = instance_creation(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
@@ -2603,51 +2352,51 @@ ruyi_error* instance_creation_expression(ruyi_lexer_reader *reader, ruyi_ast **o
 }
 
 static
-ruyi_error* left_hand_side_expression_tail(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* left_hand_side_expression_tail(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <left hand side expression tail> ::= (ASSIGN <expression>) | (COLON_ASSIGN <expression>) | INC | DEC | <function invocation tail>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *sub_ast;
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_ASSIGN, NULL)) {
-        if ((err = expression(reader, &sub_ast)) != NULL) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_ASSIGN, NULL)) {
+        if ((err = expression(parser, &sub_ast)) != NULL) {
             return err;
         }
         if (sub_ast == NULL) {
-            return ruyi_error_by_parser(reader, "miss expression after '='");
+            return ruyi_error_by_parser(parser->reader, "miss expression after '='");
         }
-        ast = ruyi_ast_create(Ruyi_at_assign_statement);
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_assign_statement);
         ruyi_ast_add_child(ast, sub_ast);
         *out_ast = ast;
         return NULL;
     }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COLON_ASSIGN, NULL)) {
-        if ((err = expression(reader, &sub_ast)) != NULL) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COLON_ASSIGN, NULL)) {
+        if ((err = expression(parser, &sub_ast)) != NULL) {
             return err;
         }
         if (sub_ast == NULL) {
-            return ruyi_error_by_parser(reader, "miss expression after ':='");
+            return ruyi_error_by_parser(parser->reader, "miss expression after ':='");
         }
-        ast = ruyi_ast_create(Ruyi_at_var_declaration);
-        ruyi_ast_add_child(ast, ruyi_ast_create(Ruyi_at_var_declaration_auto_type));
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_var_declaration);
+        ruyi_ast_add_child(ast, ruyi_ast_create(parser->ast_arena, Ruyi_at_var_declaration_auto_type));
         ruyi_ast_add_child(ast, sub_ast);
         *out_ast = ast;
         return NULL;
     }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_INC, NULL)) {
-        ast = ruyi_ast_create(Ruyi_at_inc_statement);
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_INC, NULL)) {
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_inc_statement);
         *out_ast = ast;
         return NULL;
     }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_DEC, NULL)) {
-        ast = ruyi_ast_create(Ruyi_at_dec_statement);
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_DEC, NULL)) {
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_dec_statement);
         *out_ast = ast;
         return NULL;
     }
-    if ((err = function_invocation_tail(reader, &sub_ast)) != NULL) {
+    if ((err = function_invocation_tail(parser, &sub_ast)) != NULL) {
         return err;
     }
     if (sub_ast != NULL) {
-        ast = ruyi_ast_create(Ruyi_at_function_invocation_statement);
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_function_invocation_statement);
         ruyi_ast_add_child(ast, sub_ast);
         *out_ast = ast;
         return NULL;
@@ -2657,27 +2406,27 @@ ruyi_error* left_hand_side_expression_tail(ruyi_lexer_reader *reader, ruyi_ast *
 }
 
 static
-ruyi_error* left_hand_side_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* left_hand_side_expression(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <left hand side expression> ::= <left hand side> <left hand side expression tail>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *left_ast = NULL;
     ruyi_ast *tail_ast = NULL;
-    if ((err = left_hand_side(reader, &left_ast)) != NULL) {
+    if ((err = left_hand_side(parser, &left_ast)) != NULL) {
         return err;
     }
     if (left_ast == NULL) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = left_hand_side_expression_tail(reader, &tail_ast)) != NULL) {
+    if ((err = left_hand_side_expression_tail(parser, &tail_ast)) != NULL) {
         goto left_hand_side_expression_on_error;
     }
     if (tail_ast == NULL) {
-        err = ruyi_error_by_parser(reader, "only variable access can not be a statement");
+        err = ruyi_error_by_parser(parser->reader, "only variable access can not be a statement");
         goto left_hand_side_expression_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_left_hand_side_expression);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_left_hand_side_expression);
     ruyi_ast_add_child(ast, left_ast);
     ruyi_ast_add_child(ast, tail_ast);
     *out_ast = ast;
@@ -2691,11 +2440,11 @@ left_hand_side_expression_on_error:
 }
 
 static
-ruyi_error* statement_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* statement_expression(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <statement expression> ::= <left hand side expression> | <instance creation expression>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
-    if ((err = left_hand_side_expression(reader, &ast)) != NULL) {
+    if ((err = left_hand_side_expression(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
@@ -2703,7 +2452,7 @@ ruyi_error* statement_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast)
         return NULL;
     }
     
-    if ((err = instance_creation_expression(reader, &ast)) != NULL) {
+    if ((err = instance_creation_expression(parser, &ast)) != NULL) {
         return err;
     }
     if (ast != NULL) {
@@ -2716,11 +2465,11 @@ ruyi_error* statement_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast)
 }
 
 static
-ruyi_error* expression_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* expression_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <expression statement> ::= <statement expression>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
-    if ((err = statement_expression(reader, &ast)) != NULL) {
+    if ((err = statement_expression(parser, &ast)) != NULL) {
         return err;
     }
     if (ast == NULL) {
@@ -2732,26 +2481,26 @@ ruyi_error* expression_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast)
 }
 
 static
-ruyi_error* for_init(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* for_init(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <for init> ::= (<variable auto infer type init> (COMMA  <variable auto infer type init>) * ) ?
     ruyi_error *err;
     ruyi_ast *var_init_expr = NULL;
     ruyi_ast *var_init_expr_list = NULL;
-    if ((err = variable_auto_infer_type_init(reader, &var_init_expr)) != NULL) {
+    if ((err = variable_auto_infer_type_init(parser, &var_init_expr)) != NULL) {
         *out_ast = NULL;
-        return NULL;
+        return err;
     }
-    var_init_expr_list = ruyi_ast_create(Ruyi_at_expr_statement_list);
+    var_init_expr_list = ruyi_ast_create(parser->ast_arena, Ruyi_at_expr_statement_list);
     ruyi_ast_add_child(var_init_expr_list, var_init_expr);
     for (;;) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
             break;
         }
-        if ((err = variable_auto_infer_type_init(reader, &var_init_expr)) != NULL) {
+        if ((err = variable_auto_infer_type_init(parser, &var_init_expr)) != NULL) {
             goto for_init_on_error;
         }
         if (var_init_expr == NULL) {
-            err = ruyi_error_by_parser(reader, "miss expression statement after ','");
+            err = ruyi_error_by_parser(parser->reader, "miss expression statement after ','");
             goto for_init_on_error;
         }
         ruyi_ast_add_child(var_init_expr_list, var_init_expr);
@@ -2766,26 +2515,26 @@ for_init_on_error:
 }
 
 static
-ruyi_error* for_update(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* for_update(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <for update> ::= (<statement expression> (COMMA <statement expression>) * ) ?
     ruyi_error *err;
     ruyi_ast *stmt_expr = NULL;
     ruyi_ast *stmt_expr_list = NULL;
-    if ((err = statement_expression(reader, &stmt_expr)) != NULL) {
+    if ((err = statement_expression(parser, &stmt_expr)) != NULL) {
         *out_ast = NULL;
         return err;
     }
-    stmt_expr_list = ruyi_ast_create(Ruyi_at_stmt_expr_list);
+    stmt_expr_list = ruyi_ast_create(parser->ast_arena, Ruyi_at_stmt_expr_list);
     ruyi_ast_add_child(stmt_expr_list, stmt_expr);
     for (;;) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
             break;
         }
-        if ((err = statement_expression(reader, &stmt_expr)) != NULL) {
+        if ((err = statement_expression(parser, &stmt_expr)) != NULL) {
             goto for_update_on_error;
         }
         if (stmt_expr == NULL) {
-            err = ruyi_error_by_parser(reader, "miss expression after ','");
+            err = ruyi_error_by_parser(parser->reader, "miss expression after ','");
             goto for_update_on_error;
         }
         ruyi_ast_add_child(stmt_expr_list, stmt_expr);
@@ -2800,31 +2549,31 @@ for_update_on_error:
 }
 
 static
-ruyi_error* for_three_parts(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* for_three_parts(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <for three parts> ::= <for init>? SEMICOLON <expression>? SEMICOLON <for update>?
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *ast_for_init = NULL;
     ruyi_ast *ast_expression = NULL;
     ruyi_ast *ast_for_update = NULL;
-    if ((err = for_init(reader, &ast_for_init)) != NULL) {
+    if ((err = for_init(parser, &ast_for_init)) != NULL) {
         goto for_three_parts_on_error;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_SEMICOLON, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ';' in for-statement");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_SEMICOLON, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ';' in for-statement");
         goto for_three_parts_on_error;
     }
-    if ((err = expression(reader, &ast_expression)) != NULL) {
+    if ((err = expression(parser, &ast_expression)) != NULL) {
         goto for_three_parts_on_error;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_SEMICOLON, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ';' in for-statement");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_SEMICOLON, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ';' in for-statement");
         goto for_three_parts_on_error;
     }
-    if ((err = for_update(reader, &ast_for_update)) != NULL) {
+    if ((err = for_update(parser, &ast_for_update)) != NULL) {
         goto for_three_parts_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_for_3_parts_header);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_for_3_parts_header);
     ruyi_ast_add_child(ast, ast_for_init);
     ruyi_ast_add_child(ast, ast_expression);
     ruyi_ast_add_child(ast, ast_for_update);
@@ -2844,75 +2593,57 @@ for_three_parts_on_error:
 }
 
 static
-ruyi_error* for_in(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* for_in(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <for in> ::= IDENTITY (COMMA IDENTITY) * KW_IN <expression>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *ast_var_list = NULL;
-    ruyi_vector *tokens = NULL;
-    ruyi_ast *ast_var_name = NULL;
     ruyi_ast *ast_expr = NULL;
-    ruyi_token *token;
-    ruyi_value temp;
-    UINT32 len, i;
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_IDENTITY) {
+    ruyi_token_type next_type;
+    UINT32 n;
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_IDENTITY) {
         *out_ast = NULL;
         return NULL;
     }
-    tokens = ruyi_vector_create();
-    ast_var_list = ruyi_ast_create(Ruyi_at_var_list);
-    
-    ast_var_name = create_ast_string_by_token(reader, Ruyi_at_name, &token);
-    ruyi_ast_add_child(ast_var_list, ast_var_name);
-    ruyi_vector_add(tokens, ruyi_value_ptr(token));
-    
-    for (;;) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
-            break;
-        }
-        if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_IDENTITY) {
-            err = ruyi_error_by_parser(reader, "need an identifier after ','");
-            goto for_in_on_error;
-        }
-        ast_var_name = create_ast_string_by_token(reader, Ruyi_at_name, &token);
-        ruyi_ast_add_child(ast_var_list, ast_var_name);
-        ruyi_vector_add(tokens, ruyi_value_ptr(token));
+    // not a for-in header if there is no 'in' after the identifiers, but a ',' without an identifier after it is an error
+    n = 1;
+    while (ruyi_lexer_reader_peek_nth_token_type(parser->reader, n) == Ruyi_tt_COMMA &&
+           ruyi_lexer_reader_peek_nth_token_type(parser->reader, n + 1) == Ruyi_tt_IDENTITY) {
+        n += 2;
     }
-    
-    // if there was not contains 'in' keyword, restore status and return NULL.
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_IN, NULL)) {
-        ruyi_ast_destroy(ast_var_list);
-        tokens_push_back_at_front(reader, tokens);
+    next_type = ruyi_lexer_reader_peek_nth_token_type(parser->reader, n);
+    if (next_type != Ruyi_tt_KW_IN && next_type != Ruyi_tt_COMMA) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = expression(reader, &ast_expr)) != NULL) {
+    ast_var_list = ruyi_ast_create(parser->ast_arena, Ruyi_at_var_list);
+    ruyi_ast_add_child(ast_var_list, create_ast_by_consume_token_string(parser, Ruyi_at_name));
+    while (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
+        if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_IDENTITY) {
+            err = ruyi_error_by_parser(parser->reader, "need an identifier after ','");
+            goto for_in_on_error;
+        }
+        ruyi_ast_add_child(ast_var_list, create_ast_by_consume_token_string(parser, Ruyi_at_name));
+    }
+    ruyi_lexer_reader_consume_token(parser->reader); // consume Ruyi_tt_KW_IN
+    if ((err = expression(parser, &ast_expr)) != NULL) {
         goto for_in_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_for_in_header);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_for_in_header);
     ruyi_ast_add_child(ast, ast_var_list);
     ruyi_ast_add_child(ast, ast_expr);
     *out_ast = ast;
-    err = NULL;
-    goto for_in_clear_tokens;
+    return NULL;
 for_in_on_error:
     if (ast_var_list) {
         ruyi_ast_destroy(ast_var_list);
     }
-for_in_clear_tokens:
-    if (tokens != NULL) {
-        len = ruyi_vector_length(tokens);
-        for (i = 0; i < len; i++) {
-            ruyi_vector_get(tokens, i, &temp);
-            ruyi_lexer_token_destroy((ruyi_token*)temp.data.ptr);
-        }
-        ruyi_vector_destroy(tokens);
-    }
+    *out_ast = NULL;
     return err;
 }
 
 static
-ruyi_error* for_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* for_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <for statement> ::= KW_FOR (<for in> | <for three parts>) | ( LPARAN <for in> | <for three parts> RPARAN) <block>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
@@ -2920,43 +2651,43 @@ ruyi_error* for_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
     ruyi_ast *ast_for_in = NULL;
     ruyi_ast *ast_for_3_parts = NULL;
     BOOL has_paran = FALSE;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_FOR, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_FOR, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
         has_paran = TRUE;
     }
     
-    if ((err = for_in(reader, &ast_for_in)) != NULL) {
+    if ((err = for_in(parser, &ast_for_in)) != NULL) {
         goto for_statement_on_error;
     }
     
     if (ast_for_in == NULL) {
-        if ((err = for_three_parts(reader, &ast_for_3_parts)) != NULL) {
+        if ((err = for_three_parts(parser, &ast_for_3_parts)) != NULL) {
             goto for_statement_on_error;
         }
         if (ast_for_3_parts == NULL) {
-            err = ruyi_error_by_parser(reader, "for statment syntax error");
+            err = ruyi_error_by_parser(parser->reader, "for statment syntax error");
             goto for_statement_on_error;
         }
     }
-    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss )");
+    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss )");
         goto for_statement_on_error;
     }
-    if ((err = block(reader, &ast_body)) != NULL) {
+    if ((err = block(parser, &ast_body)) != NULL) {
         goto for_statement_on_error;
     }
     if (ast_body == NULL) {
-        err = ruyi_error_by_parser(reader, "miss for statement body");
+        err = ruyi_error_by_parser(parser->reader, "miss for statement body");
         goto for_statement_on_error;
     }
     if (ast_for_in != NULL) {
-        ast = ruyi_ast_create(Ruyi_at_for_in_statement);
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_for_in_statement);
         ruyi_ast_add_child(ast, ast_for_in);
     } else {
-        ast = ruyi_ast_create(Ruyi_at_for_3_parts_statement);
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_for_3_parts_statement);
         ruyi_ast_add_child(ast, ast_for_3_parts);
     }
     ruyi_ast_add_child(ast, ast_body);
@@ -2977,89 +2708,89 @@ for_statement_on_error:
 }
 
 static
-ruyi_error* switch_default_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* switch_default_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <switch default statement> ::= KW_DEFAULT COLON <block statements>
     ruyi_error *err;
     ruyi_ast *ast;
     ruyi_ast *ast_block = NULL;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_DEFAULT, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_DEFAULT, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COLON, NULL)) {
-        return ruyi_error_by_parser(reader, "miss ':' after 'default'");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COLON, NULL)) {
+        return ruyi_error_by_parser(parser->reader, "miss ':' after 'default'");
     }
-    if ((err = block_statements(reader, &ast_block)) != NULL) {
+    if ((err = block_statements(parser, &ast_block)) != NULL) {
         return err;
     }
     // ast_block may be NULL
-    ast = ruyi_ast_create(Ruyi_at_switch_default_case_statement);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_switch_default_case_statement);
     ruyi_ast_add_child(ast, ast_block);
     *out_ast = ast;
     return NULL;
 }
 
 static
-ruyi_error* constant_expression(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* constant_expression(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <constant expression> ::= <expression>
     ruyi_error *err;
     ruyi_ast *ast;
     ruyi_ast *ast_expr;
-    if ((err = expression(reader, &ast_expr)) != NULL) {
+    if ((err = expression(parser, &ast_expr)) != NULL) {
         return err;
     }
     if (ast_expr == NULL) {
         *out_ast = NULL;
         return NULL;
     }
-    ast = ruyi_ast_create(Ruyi_at_constant_expression);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_constant_expression);
     ruyi_ast_add_child(ast, ast_expr);
     *out_ast = ast;
     return NULL;
 }
 
 static
-ruyi_error* switch_case_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* switch_case_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <switch case statement> ::= KW_CASE <constant expression> (COMMA <constant expression>) * COLON <block statements>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *ast_const_stmt_list = NULL;
     ruyi_ast *ast_const_expr = NULL;
     ruyi_ast *ast_block = NULL;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_CASE, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_CASE, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = constant_expression(reader, &ast_const_expr)) != NULL) {
+    if ((err = constant_expression(parser, &ast_const_expr)) != NULL) {
         goto switch_case_statement_on_error;
     }
     if (ast_const_expr == NULL) {
-        err = ruyi_error_by_parser(reader, "miss constant value in case-statement");
+        err = ruyi_error_by_parser(parser->reader, "miss constant value in case-statement");
         goto switch_case_statement_on_error;
     }
-    ast_const_stmt_list = ruyi_ast_create(Ruyi_at_const_list);
+    ast_const_stmt_list = ruyi_ast_create(parser->ast_arena, Ruyi_at_const_list);
     ruyi_ast_add_child(ast_const_stmt_list, ast_const_expr);
     for (;;) {
-        if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COMMA, NULL)) {
+        if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COMMA, NULL)) {
             break;
         }
-        if ((err = constant_expression(reader, &ast_const_expr)) != NULL) {
+        if ((err = constant_expression(parser, &ast_const_expr)) != NULL) {
             goto switch_case_statement_on_error;
         }
         if (ast_const_expr == NULL) {
-            err = ruyi_error_by_parser(reader, "miss constant value after ',' in case-statement");
+            err = ruyi_error_by_parser(parser->reader, "miss constant value after ',' in case-statement");
             goto switch_case_statement_on_error;
         }
         ruyi_ast_add_child(ast_const_stmt_list, ast_const_expr);
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_COLON, NULL)) {
-        return ruyi_error_by_parser(reader, "miss ':' in case-statement");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_COLON, NULL)) {
+        return ruyi_error_by_parser(parser->reader, "miss ':' in case-statement");
     }
-    if ((err = block_statements(reader, &ast_block)) != NULL) {
+    if ((err = block_statements(parser, &ast_block)) != NULL) {
         goto switch_case_statement_on_error;
     }
     // ast_block can be NULL
-    ast = ruyi_ast_create(Ruyi_at_switch_case_statement);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_switch_case_statement);
     ruyi_ast_add_child(ast, ast_const_stmt_list);
     ruyi_ast_add_child(ast, ast_block);
     *out_ast = ast;
@@ -3073,20 +2804,20 @@ switch_case_statement_on_error:
 }
 
 static
-ruyi_error* switch_statement_body(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* switch_statement_body(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <switch statement body> ::= LBRACE <switch case statement>* <switch default statement>? RBRACE
     ruyi_error *err;
     ruyi_ast *ast;
     ruyi_ast *ast_case_stmt_list = NULL;
     ruyi_ast *ast_default_case_stmt = NULL;
     ruyi_ast *ast_case_stmt = NULL;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LBRACE, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '{' in switch-statement");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LBRACE, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '{' in switch-statement");
         goto switch_statement_body_on_error;
     }
-    ast_case_stmt_list = ruyi_ast_create(Ruyi_at_switch_case_statement_list);
+    ast_case_stmt_list = ruyi_ast_create(parser->ast_arena, Ruyi_at_switch_case_statement_list);
     for (;;) {
-        if ((err = switch_case_statement(reader, &ast_case_stmt)) != NULL) {
+        if ((err = switch_case_statement(parser, &ast_case_stmt)) != NULL) {
             goto switch_statement_body_on_error;
         }
         if (ast_case_stmt == NULL) {
@@ -3094,15 +2825,15 @@ ruyi_error* switch_statement_body(ruyi_lexer_reader *reader, ruyi_ast **out_ast)
         }
         ruyi_ast_add_child(ast_case_stmt_list, ast_case_stmt);
     }
-    if ((err = switch_default_statement(reader, &ast_default_case_stmt)) != NULL) {
+    if ((err = switch_default_statement(parser, &ast_default_case_stmt)) != NULL) {
         goto switch_statement_body_on_error;
     }
     // ast_default_case_stmt can be NULL
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RBRACE, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '}' in switch-statement");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RBRACE, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '}' in switch-statement");
         goto switch_statement_body_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_switch_statement_body);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_switch_statement_body);
     ruyi_ast_add_child(ast, ast_case_stmt_list);
     ruyi_ast_add_child(ast, ast_default_case_stmt);
     *out_ast = ast;
@@ -3116,35 +2847,35 @@ switch_statement_body_on_error:
 }
 
 static
-ruyi_error* switch_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* switch_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <switch statement> ::= KW_SWITCH <expression> | ( LPARAN <expression> RPARAN ) <switch statement body>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *ast_expr = NULL;
     ruyi_ast *ast_body = NULL;
     BOOL has_paran = FALSE;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_SWITCH, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_SWITCH, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
+    if (ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
         has_paran = TRUE;
     }
-    if ((err = expression(reader, &ast_expr)) != NULL) {
+    if ((err = expression(parser, &ast_expr)) != NULL) {
         goto switch_statement_on_error;
     }
-    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss )");
+    if (has_paran && !ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss )");
         goto switch_statement_on_error;
     }
-    if ((err = switch_statement_body(reader, &ast_body)) != NULL) {
+    if ((err = switch_statement_body(parser, &ast_body)) != NULL) {
         goto switch_statement_on_error;
     }
     if (ast_body == NULL) {
-        err = ruyi_error_by_parser(reader, "miss body for switch-statement");
+        err = ruyi_error_by_parser(parser->reader, "miss body for switch-statement");
         goto switch_statement_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_switch_statement);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_switch_statement);
     ruyi_ast_add_child(ast, ast_expr);
     ruyi_ast_add_child(ast, ast_body);
     *out_ast = ast;
@@ -3158,77 +2889,68 @@ switch_statement_on_error:
 }
 
 static
-ruyi_error* break_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* break_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <break statement> ::= KW_BREAK IDENTITY?
     ruyi_ast *ast;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_BREAK, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_BREAK, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (ruyi_lexer_reader_peek_token_type(reader) == Ruyi_tt_IDENTITY) {
-        ast = create_ast_by_consume_token_string(reader, Ruyi_at_break_statement);
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) == Ruyi_tt_IDENTITY) {
+        ast = create_ast_by_consume_token_string(parser, Ruyi_at_break_statement);
     } else {
-        ast = ruyi_ast_create(Ruyi_at_break_statement);
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_break_statement);
     }
     *out_ast = ast;
     return NULL;
 }
 
 static
-ruyi_error* continue_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* continue_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <continue statement> ::= KW_CONTINUE IDENTITY?
     ruyi_ast *ast;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_CONTINUE, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_CONTINUE, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (ruyi_lexer_reader_peek_token_type(reader) == Ruyi_tt_IDENTITY) {
-        ast = create_ast_by_consume_token_string(reader, Ruyi_at_continue_statement);
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) == Ruyi_tt_IDENTITY) {
+        ast = create_ast_by_consume_token_string(parser, Ruyi_at_continue_statement);
     } else {
-        ast = ruyi_ast_create(Ruyi_at_continue_statement);
+        ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_continue_statement);
     }
     *out_ast = ast;
     return NULL;
 }
 
 static
-ruyi_error* labeled_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* labeled_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <labeled statement> ::= IDENTITY COLON <statement>
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *sub_ast = NULL;
     ruyi_token *label_name = NULL;
-    ruyi_token *colon = NULL;
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_IDENTITY) {
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_IDENTITY ||
+        ruyi_lexer_reader_peek_nth_token_type(parser->reader, 1) != Ruyi_tt_COLON) {
         *out_ast = NULL;
         return NULL;
     }
-    label_name = ruyi_lexer_reader_next_token(reader);
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_COLON) {
-        ruyi_lexer_reader_push_front(reader, label_name);
-        *out_ast = NULL;
-        return NULL;
-    }
-    colon = ruyi_lexer_reader_next_token(reader);
-    if ((err = statement(reader, &sub_ast)) != NULL) {
+    label_name = ruyi_lexer_reader_next_token(parser->reader);
+    ruyi_lexer_reader_consume_token(parser->reader); // consume Ruyi_tt_COLON
+    if ((err = statement(parser, &sub_ast)) != NULL) {
         goto labeled_statement_on_error;
     }
     if (sub_ast == NULL) {
-        err = ruyi_error_by_parser(reader, "miss statement after label");
+        err = ruyi_error_by_parser(parser->reader, "miss statement after label");
         goto labeled_statement_on_error;
     }
-    ast = ruyi_ast_create_with_unicode(Ruyi_at_labeled_statement, label_name->value.str_value);
+    ast = ruyi_ast_create_with_symbol(parser->ast_arena, Ruyi_at_labeled_statement, label_name->symbol);
     ruyi_ast_add_child(ast, sub_ast);
     
-    ruyi_lexer_token_destroy(colon);
     ruyi_lexer_token_destroy(label_name);
   
     *out_ast = ast;
     return NULL;
 labeled_statement_on_error:
-    if (colon) {
-        ruyi_lexer_token_destroy(colon);
-    }
     if (label_name) {
         ruyi_lexer_token_destroy(label_name);
     }
@@ -3238,24 +2960,24 @@ labeled_statement_on_error:
 
 
 static
-ruyi_error* sub_block_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* sub_block_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <sub block statement> ::= LBRACE <block statements> RBRACE
     ruyi_error *err;
     ruyi_ast *ast = NULL;
     ruyi_ast *ast_sub_block = NULL;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LBRACE, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LBRACE, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = block_statements(reader, &ast_sub_block)) != NULL) {
+    if ((err = block_statements(parser, &ast_sub_block)) != NULL) {
         return err;
     }
     // ast_sub_block can be NULL
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RBRACE, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '}' at end of block");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RBRACE, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '}' at end of block");
         goto sub_block_statement_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_sub_block_statement);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_sub_block_statement);
     ruyi_ast_add_child(ast, ast_sub_block);
     *out_ast = ast;
     return NULL;
@@ -3267,92 +2989,37 @@ sub_block_statement_on_error:
     return err;
 }
 
+static const ruyi_parse_alternative g_statement_alternatives[] = {
+    {RUYI_FIRST_LABELED_STATEMENT, labeled_statement},
+    {RUYI_FIRST_IF_STATEMENT, if_statement},
+    {RUYI_FIRST_WHILE_STATEMENT, while_statement},
+    {RUYI_FIRST_EXPRESSION_STATEMENT, expression_statement},
+    {RUYI_FIRST_FOR_STATEMENT, for_statement},
+    {RUYI_FIRST_SWITCH_STATEMENT, switch_statement},
+    // TODO <try statement> not implements in this version
+    {RUYI_FIRST_RETURN_STATEMENT, return_statement},
+    {RUYI_FIRST_BREAK_STATEMENT, break_statement},
+    {RUYI_FIRST_CONTINUE_STATEMENT, continue_statement},
+    {RUYI_FIRST_SUB_BLOCK_STATEMENT, sub_block_statement},
+};
+
 static
-ruyi_error* statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* statement_rule(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <statement> ::= <labeled statement> | <if statement> | <while statement> | <expression statement> | <for statement> | <switch statement> | <try statement> | <return statement> | <break statement> | <continue statement> | <sub block statement>
-    ruyi_error *err;
-    ruyi_ast *ast = NULL;
-    if ((err = labeled_statement(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = if_statement(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = while_statement(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = expression_statement(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = for_statement(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = switch_statement(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    // TODO <try statement> not implements in this version
-    if ((err = return_statement(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = break_statement(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = continue_statement(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    if ((err = sub_block_statement(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    
-    return NULL;
+    return parse_choice(parser, g_statement_alternatives, sizeof(g_statement_alternatives) / sizeof(*g_statement_alternatives), out_ast);
 }
 
 static
-ruyi_error* local_variable_declaration_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* statement(ruyi_parser *parser, ruyi_ast **out_ast) {
+    return parse_nested(parser, statement_rule, out_ast);
+}
+
+static
+ruyi_error* local_variable_declaration_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <local variable declaration statement> ::= <local variable declaration>
     ruyi_error *err;
     ruyi_ast *ast;
-    if ((err = local_variable_declaration(reader, &ast)) != NULL) {
+    if ((err = local_variable_declaration(parser, &ast)) != NULL) {
         *out_ast = NULL;
         return err;
     }
@@ -3360,41 +3027,32 @@ ruyi_error* local_variable_declaration_statement(ruyi_lexer_reader *reader, ruyi
     return NULL;
 }
 
+static const ruyi_parse_alternative g_block_statement_alternatives[] = {
+    {RUYI_FIRST_LOCAL_VARIABLE_DECLARATION_STATEMENT, local_variable_declaration_statement},
+    {RUYI_FIRST_STATEMENT, statement},
+};
+
 static
-ruyi_error* block_statement(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* block_statement(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <block statement> ::= ( <local variable declaration statement> | <statement> ) <statement ends>
     ruyi_error *err;
-    ruyi_ast *ast;
-    if ((err = local_variable_declaration_statement(reader, &ast)) != NULL) {
-        *out_ast = NULL;
+    if ((err = parse_choice(parser, g_block_statement_alternatives, sizeof(g_block_statement_alternatives) / sizeof(*g_block_statement_alternatives), out_ast)) != NULL) {
         return err;
     }
-    if (ast != NULL) {
-        *out_ast = ast;
-        statement_ends(reader);
-        return NULL;
-    }
-    if ((err = statement(reader, &ast)) != NULL) {
-        *out_ast = NULL;
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        statement_ends(reader);
-        return NULL;
+    if (*out_ast != NULL) {
+        statement_ends(parser);
     }
-    *out_ast = NULL;
     return NULL;
 }
 
 static
-ruyi_error* block_statements(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* block_statements(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <block statements> ::= <block statement> *
     ruyi_error *err;
-    ruyi_ast *ast = ruyi_ast_create(Ruyi_at_block_statements);
+    ruyi_ast *ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_block_statements);
     ruyi_ast *ast_block_stmt;
     for (;;) {
-        if ((err = block_statement(reader, &ast_block_stmt)) != NULL) {
+        if ((err = block_statement(parser, &ast_block_stmt)) != NULL) {
             goto block_statements_on_error;
         }
         if (ast_block_stmt == NULL) {
@@ -3413,23 +3071,23 @@ block_statements_on_error:
 }
 
 static
-ruyi_error* block(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* block(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <block> ::= LBRACE <block statements>? RBRACE
     ruyi_error *err;
     ruyi_ast *ast = NULL;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LBRACE, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LBRACE, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = block_statements(reader, &ast)) != NULL) {
+    if ((err = block_statements(parser, &ast)) != NULL) {
         goto block_on_error;
     }
     if (ast == NULL) {
-        err = ruyi_error_by_parser(reader, "block can not be empty");
+        err = ruyi_error_by_parser(parser->reader, "block can not be empty");
         goto block_on_error;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RBRACE, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '}'");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RBRACE, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '}'");
         goto block_on_error;
     }
     *out_ast = ast;
@@ -3442,13 +3100,55 @@ block_on_error:
 }
 
 static
-ruyi_error* function_body(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* function_body(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <function body> ::= <block>
-    return block(reader, out_ast);
+    return block(parser, out_ast);
+}
+
+/*
+ The body of a function declaration, with Ruyi_po_LAZY_BODIES it is skipped by brace matching and a stub of its
+ tokens is made. Bodies of anonymous functions are in the ones of declarations, or are the values of global
+ variables which are generated with them, so they are always parsed.
+ */
+static
+ruyi_error* declared_function_body(ruyi_parser *parser, ruyi_ast **out_ast) {
+    const BYTE *types;
+    UINT32 open, close;
+    INT32 depth = 0;
+    ruyi_ast_lazy_body *body;
+    ruyi_ast *ast;
+    if (!(parser->options & Ruyi_po_LAZY_BODIES) || parser->reader->cursor.stream == NULL ||
+        ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_LBRACE) {
+        return function_body(parser, out_ast);
+    }
+    types = parser->reader->cursor.stream->types;
+    open = ruyi_lexer_reader_token_index(parser->reader);
+    for (close = open; close < parser->reader->cursor.end; close++) {
+        if (types[close] == Ruyi_tt_LBRACE) {
+            depth++;
+        } else if (types[close] == Ruyi_tt_RBRACE && --depth == 0) {
+            break;
+        }
+    }
+    if (close >= parser->reader->cursor.end) {
+        // no '}' for it, the parse finds the error
+        return function_body(parser, out_ast);
+    }
+    body = (ruyi_ast_lazy_body*)ruyi_mem_arena_alloc(parser->ast_arena, sizeof(ruyi_ast_lazy_body));
+    body->stream = parser->reader->cursor.stream;
+    body->from = open + 1;
+    body->end = close;
+    body->options = parser->options;
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_block_statements);
+    ast->adt_type = Ruyi_adt_lazy_body;
+    ast->data.ptr_value = body;
+    ruyi_lexer_reader_seek_token(parser->reader, close + 1);
+    *out_ast = ast;
+    return NULL;
 }
 
 static
-ruyi_error* function_declaration(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* function_declaration(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <function declaration> ::= KW_FUNC IDENTITY LPARAN <formal parameter list>? RPARAN <func return type>? <function body>
     ruyi_error *err;
     ruyi_ast *ast;
@@ -3456,37 +3156,37 @@ ruyi_error* function_declaration(ruyi_lexer_reader *reader, ruyi_ast **out_ast)
     ruyi_ast *ast_formal_params = NULL;
     ruyi_ast *ast_return_type = NULL;
     ruyi_ast *ast_body = NULL;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_FUNC, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_FUNC, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if (ruyi_lexer_reader_peek_token_type(reader) != Ruyi_tt_IDENTITY) {
-        err = ruyi_error_by_parser(reader, "miss identifier after 'func'");
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) != Ruyi_tt_IDENTITY) {
+        err = ruyi_error_by_parser(parser->reader, "miss identifier after 'func'");
         goto function_declaration_on_error;
     }
-    ast_name = create_ast_string_by_token(reader, Ruyi_at_name, NULL);
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss '(' after identifier when define a function");
+    ast_name = create_ast_by_consume_token_string(parser, Ruyi_at_name);
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_LPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss '(' after identifier when define a function");
         goto function_declaration_on_error;
     }
-    if ((err = formal_parameter_list(reader, &ast_formal_params)) != NULL) {
+    if ((err = formal_parameter_list(parser, &ast_formal_params)) != NULL) {
         goto function_declaration_on_error;
     }
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL)) {
-        err = ruyi_error_by_parser(reader, "miss ')' when define a function");
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_RPAREN, NULL)) {
+        err = ruyi_error_by_parser(parser->reader, "miss ')' when define a function");
         goto function_declaration_on_error;
     }
-    if ((err = func_return_type(reader, &ast_return_type)) != NULL) {
+    if ((err = func_return_type(parser, &ast_return_type)) != NULL) {
         goto function_declaration_on_error;
     }
-    if ((err = function_body(reader, &ast_body)) != NULL) {
+    if ((err = declared_function_body(parser, &ast_body)) != NULL) {
         goto function_declaration_on_error;
     }
     if (ast_body == NULL) {
-        err = ruyi_error_by_parser(reader, "miss function body");
+        err = ruyi_error_by_parser(parser->reader, "miss function body");
         goto function_declaration_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_function_declaration);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_function_declaration);
     ruyi_ast_add_child(ast, ast_name);
     ruyi_ast_add_child(ast, ast_formal_params);
     ruyi_ast_add_child(ast, ast_return_type);
@@ -3510,49 +3210,60 @@ function_declaration_on_error:
     return err;
 }
 
+static const ruyi_parse_alternative g_global_declaration_alternatives[] = {
+    {RUYI_FIRST_VARIABLE_DECLARATION, variable_declaration},
+    {RUYI_FIRST_FUNCTION_DECLARATION, function_declaration},
+    // TODO <class declaration> | <interface declaration> | <constant declaration>
+};
+
 static
-ruyi_error* global_declaration(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* global_declaration(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <global declaration> ::= <variable declaration> | <function declaration> | <class declaration> | <interface declaration> | <constant declaration>
-    ruyi_ast *ast = NULL;
-    ruyi_error* err;
-    if ((err = variable_declaration(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
-    }
-    
-    if ((err = function_declaration(reader, &ast)) != NULL) {
-        return err;
-    }
-    if (ast != NULL) {
-        *out_ast = ast;
-        return NULL;
+    return parse_choice(parser, g_global_declaration_alternatives, sizeof(g_global_declaration_alternatives) / sizeof(*g_global_declaration_alternatives), out_ast);
+}
+
+static void add_declaration_start(ruyi_parser *parser, UINT32 offset) {
+    UINT32 count = parser->declaration_count;
+    UINT32 *starts;
+    if (count == 0 || (count >= AST_DECLARATION_STARTS_INIT_SIZE && (count & (count - 1)) == 0)) {
+        starts = (UINT32*)ruyi_mem_arena_alloc(parser->ast_arena, sizeof(UINT32) * (count == 0 ? AST_DECLARATION_STARTS_INIT_SIZE : count * 2));
+        if (count > 0) {
+            memcpy(starts, parser->declaration_starts, sizeof(UINT32) * count);
+        }
+        parser->declaration_starts = starts;
     }
-    // TODO
-    
-    *out_ast = NULL;
-    return NULL;
-  //  return ruyi_error_by_parser(reader, "need a variable/function/class/interface/constant declaration.");
+    parser->declaration_starts[parser->declaration_count++] = offset;
 }
 
-static
-ruyi_error* global_declarations(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    // <global declarations> ::= (<global declaration> <statement ends>)*
+// add the global declarations to a Ruyi_at_global_declarations until a token none of them starts with
+static ruyi_error* add_global_declarations(ruyi_parser *parser, ruyi_ast *global_declarations) {
     ruyi_error* err;
-    ruyi_ast *global_declarations;
     ruyi_ast *global_declare_ast = NULL;
-    global_declarations = ruyi_ast_create(Ruyi_at_global_declarations);
+    UINT32 start;
     while (TRUE) {
-        if ((err = global_declaration(reader, &global_declare_ast)) != NULL) {
-            goto global_declarations_on_error;
+        ruyi_lexer_reader_peek_token_type(parser->reader);
+        start = parser->reader->token_snapshot.offset;
+        if ((err = global_declaration(parser, &global_declare_ast)) != NULL) {
+            return err;
         }
         if (global_declare_ast == NULL) {
             break;
         }
-        statement_ends(reader);
+        statement_ends(parser);
         ruyi_ast_add_child(global_declarations, global_declare_ast);
+        add_declaration_start(parser, start);
+    }
+    return NULL;
+}
+
+static
+ruyi_error* global_declarations(ruyi_parser *parser, ruyi_ast **out_ast) {
+    // <global declarations> ::= (<global declaration> <statement ends>)*
+    ruyi_error* err;
+    ruyi_ast *global_declarations;
+    global_declarations = ruyi_ast_create(parser->ast_arena, Ruyi_at_global_declarations);
+    if ((err = add_global_declarations(parser, global_declarations)) != NULL) {
+        goto global_declarations_on_error;
     }
     *out_ast = global_declarations;
     return NULL;
@@ -3563,54 +3274,166 @@ global_declarations_on_error:
     return err;
 }
 
+// a run of global declarations parsed by a worker of ruyi_parse_ast_parallel
+typedef struct {
+    const ruyi_token_stream *stream;
+    UINT32 from;                // the first token
+    UINT32 end;                 // the token after the run, the first of the next run or the END
+    ruyi_mem_arena *arena;      // nodes of the run
+    ruyi_ast *declarations;
+    BOOL failed;                // an error, or a token no declaration starts with, is found in the run
+} ruyi_parse_run;
+
+/*
+ Cut the tokens from first into at most count + 1 runs of about the same size, found by a scan of the brackets.
+ A run starts at a global declaration out of any brackets: a 'var', or a 'func' with a name after a '}' or ';'.
+ A 'func' after other tokens may be taken by an optional type of the declaration before it, e.g. 'var f func(int)',
+ so it is not cut there.
+ */
+static UINT32 make_parse_runs(const ruyi_token_stream *stream, UINT32 first, UINT32 count, ruyi_parse_run *runs) {
+    const BYTE *types = stream->types;
+    UINT32 last = stream->count - 1;
+    UINT32 size = (last - first) / count;
+    UINT32 made = 0;
+    UINT32 i;
+    INT32 depth = 0;
+    BOOL cut;
+    if (size < AST_PARALLEL_RUN_MIN_TOKENS) {
+        size = AST_PARALLEL_RUN_MIN_TOKENS;
+    }
+    runs[0].from = first;
+    for (i = first; i < last; i++) {
+        cut = FALSE;
+        switch (types[i]) {
+            case Ruyi_tt_LPAREN:
+            case Ruyi_tt_LBRACKET:
+            case Ruyi_tt_LBRACE:
+                depth++;
+                break;
+            case Ruyi_tt_RPAREN:
+            case Ruyi_tt_RBRACKET:
+            case Ruyi_tt_RBRACE:
+                depth--;
+                break;
+            case Ruyi_tt_KW_VAR:
+                cut = TRUE;
+                break;
+            case Ruyi_tt_KW_FUNC:
+                cut = types[i + 1] == Ruyi_tt_IDENTITY && i > 0 &&
+                    (types[i - 1] == Ruyi_tt_RBRACE || types[i - 1] == Ruyi_tt_SEMICOLON);
+                break;
+            default:
+                break;
+        }
+        if (cut && depth == 0 && i - runs[made].from >= size) {
+            runs[made].end = i;
+            runs[++made].from = i;
+        }
+    }
+    runs[made].end = last;
+    return made + 1;
+}
+
+static void parse_run_job(void *data, UINT32 job) {
+    ruyi_parse_run *run = &((ruyi_parse_run*)data)[job];
+    ruyi_parser parser;
+    ruyi_error *err;
+    run->arena = ruyi_mem_arena_create(AST_ARENA_BLOCK_SIZE);
+    parser_init(&parser, ruyi_lexer_reader_open_stream_range(run->stream, run->from, run->end), run->arena, Ruyi_po_NONE);
+    run->declarations = ruyi_ast_create(run->arena, Ruyi_at_global_declarations);
+    err = add_global_declarations(&parser, run->declarations);
+    run->failed = (err != NULL || ruyi_lexer_reader_peek_token_type(parser.reader) != Ruyi_tt_END);
+    if (err) {
+        // the parse of the rest finds it again, with the tokens after the run
+        ruyi_error_destroy(err);
+    }
+    ruyi_lexer_reader_close(parser.reader);
+    parser_release(&parser);
+}
+
 static
-ruyi_error* package_declaration(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* parallel_global_declarations(ruyi_parser *parser, UINT32 threads, ruyi_ast **out_ast) {
+    // the same as <global declarations>, the runs are parsed by the workers and joined in order
+    ruyi_error* err;
+    ruyi_ast *global_declarations;
+    ruyi_parse_run *runs = (ruyi_parse_run*)ruyi_mem_alloc(sizeof(ruyi_parse_run) * (threads * AST_PARALLEL_RUNS_PER_THREAD + 1));
+    UINT32 count, i, j;
+    global_declarations = ruyi_ast_create(parser->ast_arena, Ruyi_at_global_declarations);
+    count = make_parse_runs(parser->reader->cursor.stream, ruyi_lexer_reader_token_index(parser->reader), threads * AST_PARALLEL_RUNS_PER_THREAD, runs);
+    if (count > 1) {
+        for (i = 0; i < count; i++) {
+            runs[i].stream = parser->reader->cursor.stream;
+        }
+        ruyi_jobs_run(parse_run_job, runs, count, threads);
+        for (i = 0; i < count && !runs[i].failed; i++) {
+            for (j = 0; j < runs[i].declarations->child_count; j++) {
+                ruyi_ast_add_child(global_declarations, runs[i].declarations->children[j]);
+            }
+            ruyi_mem_arena_merge(parser->ast_arena, runs[i].arena);
+        }
+        // the rest from the first failed run is parsed here, so the error is the one the sequential parse finds
+        ruyi_lexer_reader_seek_token(parser->reader, i < count ? runs[i].from : runs[count - 1].end);
+        for (; i < count; i++) {
+            ruyi_mem_arena_destroy(runs[i].arena);
+        }
+    }
+    ruyi_mem_free(runs);
+    if ((err = add_global_declarations(parser, global_declarations)) != NULL) {
+        ruyi_ast_destroy(global_declarations);
+        return err;
+    }
+    *out_ast = global_declarations;
+    return NULL;
+}
+
+static
+ruyi_error* package_declaration(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <package declaration> ::= KW_PACKAGE <name> <statement ends>
     ruyi_error* err;
     ruyi_ast *ast;
     ruyi_ast *ast_name;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_PACKAGE, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_PACKAGE, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = name(reader, &ast_name, NULL)) != NULL) {
+    if ((err = name(parser, &ast_name)) != NULL) {
         return err;
     }
     if (ast_name == NULL) {
-        return ruyi_error_by_parser(reader, "miss name after 'package'");
+        return ruyi_error_by_parser(parser->reader, "miss name after 'package'");
     }
-    statement_ends(reader);    
-    ast = ruyi_ast_create(Ruyi_at_package_declaration);
+    statement_ends(parser);    
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_package_declaration);
     ruyi_ast_add_child(ast, ast_name);
     *out_ast = ast;
     return NULL;
 }
 
 static
-ruyi_error* import_declaration(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* import_declaration(ruyi_parser *parser, ruyi_ast **out_ast) {
     // <import declaration> ::= KW_IMPORT <name> (IDENTITY)? <statement ends>
     ruyi_error* err;
     ruyi_ast *ast;
     ruyi_ast *ast_name = NULL;
     ruyi_ast *ast_alias = NULL;
-    if (!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_IMPORT, NULL)) {
+    if (!ruyi_lexer_reader_consume_token_if_match(parser->reader, Ruyi_tt_KW_IMPORT, NULL)) {
         *out_ast = NULL;
         return NULL;
     }
-    if ((err = name(reader, &ast_name, NULL)) != NULL) {
+    if ((err = name(parser, &ast_name)) != NULL) {
         goto import_declaration_on_error;
     }
     if (ast_name == NULL) {
-        err = ruyi_error_by_parser(reader, "miss name after 'import'");
+        err = ruyi_error_by_parser(parser->reader, "miss name after 'import'");
         goto import_declaration_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_import_declaration);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_import_declaration);
     ruyi_ast_add_child(ast, ast_name);
-    if (ruyi_lexer_reader_peek_token_type(reader) == Ruyi_tt_IDENTITY) {
-        ast_alias = create_ast_by_consume_token_string(reader, Ruyi_at_name);
+    if (ruyi_lexer_reader_peek_token_type(parser->reader) == Ruyi_tt_IDENTITY) {
+        ast_alias = create_ast_by_consume_token_string(parser, Ruyi_at_name);
         ruyi_ast_add_child(ast, ast_alias);
     }
-    statement_ends(reader);
+    statement_ends(parser);
     *out_ast = ast;
     return NULL;
 import_declaration_on_error:
@@ -3624,13 +3447,13 @@ import_declaration_on_error:
 }
 
 static
-ruyi_error* import_declarations(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* import_declarations(ruyi_parser *parser, ruyi_ast **out_ast) {
     ruyi_error* err;
     ruyi_ast *ast;
     ruyi_ast *ast_import;
-    ast = ruyi_ast_create(Ruyi_at_import_declarations);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_import_declarations);
     for (;;) {
-        if ((err = import_declaration(reader, &ast_import)) != NULL) {
+        if ((err = import_declaration(parser, &ast_import)) != NULL) {
             goto import_declarations_on_error;
         }
         if (ast_import == NULL) {
@@ -3654,30 +3477,45 @@ import_declarations_on_error:
 
 
 
+// the error of a token no global declaration starts with
+static ruyi_error* unexpected_token(ruyi_parser *parser) {
+    char name_buf[128];
+    ruyi_token_type token_type = ruyi_lexer_reader_peek_token_type(parser->reader);
+    const char *name = ruyi_lexer_keywords_get_bytes_str(token_type, name_buf, 128);
+    if (name == NULL) {
+        // not a keyword, the text of the token is the one of the error
+        return ruyi_error_by_parser(parser->reader, "unexpected token");
+    }
+    return ruyi_error_by_parser(parser->reader, "unexpected token: %s", name);
+}
+
 static
-ruyi_error* compilation_unit(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
+ruyi_error* compilation_unit(ruyi_parser *parser, UINT32 threads, ruyi_ast **out_ast) {
     // <root> ::= <package declaration>? <import declarations>? <global declarations>? END
     ruyi_error* err;
     ruyi_ast *ast;
     ruyi_ast *ast_package = NULL;
     ruyi_ast *ast_import = NULL;
     ruyi_ast *ast_global = NULL;
-    ruyi_token_type end_token = 0;
-    char name_buf[128];
-    if ((err = package_declaration(reader, &ast_package)) != NULL) {
+    if ((err = package_declaration(parser, &ast_package)) != NULL) {
         goto compilation_unit_on_error;
     }
-    if ((err = import_declarations(reader, &ast_import)) != NULL) {
+    if ((err = import_declarations(parser, &ast_import)) != NULL) {
         goto compilation_unit_on_error;
     }
-    if ((err = global_declarations(reader, &ast_global)) != NULL) {
+    if (threads > 1 && parser->reader->cursor.stream) {
+        err = parallel_global_declarations(parser, threads, &ast_global);
+    } else {
+        err = global_declarations(parser, &ast_global);
+    }
+    if (err != NULL) {
         goto compilation_unit_on_error;
     }
-    if (Ruyi_tt_END != (end_token = ruyi_lexer_reader_peek_token_type(reader))) {
-        err = ruyi_error_by_parser(reader, "unexpected token: %s", ruyi_lexer_keywords_get_bytes_str(end_token, name_buf, 128));
+    if (Ruyi_tt_END != ruyi_lexer_reader_peek_token_type(parser->reader)) {
+        err = unexpected_token(parser);
         goto compilation_unit_on_error;
     }
-    ast = ruyi_ast_create(Ruyi_at_root);
+    ast = ruyi_ast_create(parser->ast_arena, Ruyi_at_root);
     ruyi_ast_add_child(ast, ast_package);
     ruyi_ast_add_child(ast, ast_import);
     ruyi_ast_add_child(ast, ast_global);
@@ -3696,6 +3534,319 @@ compilation_unit_on_error:
     return err;
 }
 
+// the byte position after some utf-8 chars from pos
+static UINT32 utf8_skip_chars(const BYTE *bytes, UINT32 length, UINT32 pos, UINT32 chars) {
+    for (; chars > 0 && pos < length; chars--) {
+        pos++;
+        while (pos < length && (bytes[pos] & 0xC0) == 0x80) {
+            pos++;
+        }
+    }
+    return pos;
+}
+
+// the char offsets of the declarations are turned to byte offsets, NULL if the bytes of the source are not kept
+static UINT32* declaration_starts_to_bytes(ruyi_parser *parser, UINT32 *out_length) {
+    const ruyi_file *fp;
+    UINT32 *starts = parser->declaration_starts;
+    UINT32 i, pos = 0, chars = 0;
+    *out_length = 0;
+    if (starts == NULL || parser->reader->cursor.stream || parser->reader->file == NULL || parser->reader->file->fp->type == Ruyi_tf_FILE) {
+        return NULL;
+    }
+    fp = parser->reader->file->fp;
+    for (i = 0; i < parser->declaration_count; i++) {
+        pos = utf8_skip_chars(fp->dist.buffer, fp->write_pos, pos, starts[i] - chars);
+        chars = starts[i];
+        starts[i] = pos;
+    }
+    *out_length = fp->write_pos;
+    return starts;
+}
+
+// the threads parse the global declarations of a token stream, 1 for the sequential parse
+static ruyi_error* parse_root(ruyi_lexer_reader *reader, UINT32 options, UINT32 threads, ruyi_ast **out_ast) {
+    ruyi_error *err;
+    ruyi_ast *ast = NULL;
+    ruyi_ast_root_data *data;
+    ruyi_parser parser;
+    ruyi_mem_arena *arena = ruyi_mem_arena_create(AST_ARENA_BLOCK_SIZE);
+    parser_init(&parser, reader, arena, options);
+    err = compilation_unit(&parser, threads, &ast);
+    parser_release(&parser);
+    if (err != NULL) {
+        // the nodes made before the error, all in the arena
+        ruyi_mem_arena_destroy(arena);
+        *out_ast = NULL;
+        return err;
+    }
+    // the root has no data, so it holds the arena and releases it with the tree
+    data = (ruyi_ast_root_data*)ruyi_mem_arena_alloc(arena, sizeof(ruyi_ast_root_data));
+    data->arena = arena;
+    data->declaration_starts = declaration_starts_to_bytes(&parser, &data->source_length);
+    data->declaration_count = parser.declaration_count;
+    data->tree_size = ruyi_mem_arena_size(arena);
+    data->reparsed_size = 0;
+    ast->adt_type = Ruyi_adt_arena;
+    ast->data.ptr_value = data;
+    *out_ast = ast;
+    return NULL;
+}
+
 ruyi_error* ruyi_parse_ast(ruyi_lexer_reader *reader, ruyi_ast **out_ast) {
-    return compilation_unit(reader, out_ast);
+    return ruyi_parse_ast_with_options(reader, Ruyi_po_NONE, out_ast);
+}
+
+ruyi_error* ruyi_parse_ast_with_options(ruyi_lexer_reader *reader, UINT32 options, ruyi_ast **out_ast) {
+    return parse_root(reader, options, 1, out_ast);
+}
+
+ruyi_error* ruyi_parse_ast_parallel(const ruyi_token_stream *stream, UINT32 threads, ruyi_ast **out_ast) {
+    ruyi_error *err;
+    ruyi_lexer_reader *reader = ruyi_lexer_reader_open_stream(stream);
+    if (threads == 0) {
+        threads = ruyi_jobs_cpu_count();
+    }
+    err = parse_root(reader, Ruyi_po_NONE, threads, out_ast);
+    ruyi_lexer_reader_close(reader);
+    return err;
+}
+
+ruyi_error* ruyi_parse_ast_tree(ruyi_lexer_reader *reader, ruyi_ast_tree **out_tree) {
+    ruyi_error *err;
+    ruyi_ast *ast = NULL;
+    if ((err = ruyi_parse_ast(reader, &ast)) != NULL) {
+        *out_tree = NULL;
+        return err;
+    }
+    *out_tree = ruyi_ast_tree_create(ast);
+    // the arena of the nodes is released here
+    ruyi_ast_destroy(ast);
+    return NULL;
+}
+
+// parse the tokens of a lazy body into an arena, the error is the one the parse of the whole file finds
+static ruyi_error* parse_lazy_body(const ruyi_ast_lazy_body *body, ruyi_mem_arena *arena, ruyi_ast **out_ast) {
+    ruyi_error *err;
+    ruyi_ast *ast = NULL;
+    ruyi_parser parser;
+    // the '}' of the body is read as the END
+    parser_init(&parser, ruyi_lexer_reader_open_stream_range(body->stream, body->from, body->end), arena, body->options);
+    err = block_statements(&parser, &ast);
+    if (err == NULL && ruyi_lexer_reader_peek_token_type(parser.reader) != Ruyi_tt_END) {
+        err = ruyi_error_by_parser(parser.reader, "miss '}'");
+    }
+    ruyi_lexer_reader_close(parser.reader);
+    parser_release(&parser);
+    *out_ast = err == NULL ? ast : NULL;
+    return err;
+}
+
+ruyi_error* ruyi_parse_lazy_body(ruyi_ast *body) {
+    ruyi_error *err;
+    ruyi_ast *ast;
+    if (body->adt_type != Ruyi_adt_lazy_body) {
+        return NULL;
+    }
+    if ((err = parse_lazy_body((const ruyi_ast_lazy_body*)body->data.ptr_value, body->arena, &ast)) != NULL) {
+        return err;
+    }
+    // the stub takes the statements, the node parsed is left in the arena
+    body->adt_type = Ruyi_adt_value;
+    body->data.int64_value = 0;
+    body->child_count = ast->child_count;
+    body->children = ast->children;
+    return NULL;
+}
+
+ruyi_error* ruyi_parse_lazy_body_tree(const ruyi_ast_tree *tree, ruyi_ast_id id, ruyi_ast_tree **out_tree) {
+    ruyi_error *err;
+    ruyi_ast *ast;
+    ruyi_mem_arena *arena;
+    const ruyi_ast_lazy_body *body = ruyi_ast_tree_lazy_body(tree, id);
+    if (body == NULL) {
+        *out_tree = NULL;
+        return ruyi_error_misc("the ast is not a function body not parsed.");
+    }
+    arena = ruyi_mem_arena_create(AST_ARENA_BLOCK_SIZE);
+    if ((err = parse_lazy_body(body, arena, &ast)) != NULL) {
+        ruyi_mem_arena_destroy(arena);
+        *out_tree = NULL;
+        return err;
+    }
+    *out_tree = ruyi_ast_tree_create(ast);
+    ruyi_mem_arena_destroy(arena);
+    return NULL;
+}
+
+// count of the items less than value in a sorted array
+static UINT32 lower_bound(const UINT32 *array, UINT32 count, UINT32 value) {
+    UINT32 low = 0;
+    UINT32 high = count;
+    UINT32 middle;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (array[middle] < value) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static ruyi_error* reparse_source(ruyi_ast **ast, const BYTE *source, UINT32 length) {
+    ruyi_error *err;
+    ruyi_ast *new_ast = NULL;
+    ruyi_lexer_reader *reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_view(source, length), Ruyi_lo_SKIP_COMMENTS | Ruyi_lo_QUIET);
+    err = ruyi_parse_ast(reader, &new_ast);
+    ruyi_lexer_reader_close(reader);
+    if (err != NULL) {
+        return err;
+    }
+    ruyi_ast_destroy(*ast);
+    *ast = new_ast;
+    return NULL;
+}
+
+// the position of an error in a part of the source starting at start is moved to the one in the source
+static void error_move_position(ruyi_error *err, const BYTE *source, UINT32 start) {
+    ruyi_line_table *lines;
+    UINT32 chars, line, column;
+    if (err->line == 0) {
+        return;
+    }
+    lines = ruyi_line_table_create();
+    chars = ruyi_line_table_scan_utf8(lines, source, start, 0);
+    ruyi_line_table_position(lines, chars, &line, &column);
+    ruyi_line_table_destroy(lines);
+    if (err->line == 1) {
+        err->column += column - 1;
+    }
+    err->line += line - 1;
+}
+
+// the declarations from lo are parsed again until one starts after the edits at the same text as before
+static ruyi_error* reparse_declarations(ruyi_ast *root, const BYTE *source, UINT32 length, UINT32 lo, UINT32 edit_end, INT64 delta) {
+    ruyi_ast_root_data *data = (ruyi_ast_root_data*)root->data.ptr_value;
+    UINT32 *old_starts = data->declaration_starts;
+    UINT32 old_count = data->declaration_count;
+    UINT32 region = old_starts[lo];
+    UINT32 new_edit_end = (UINT32)(edit_end + delta);
+    // the old declarations from resume on are kept
+    UINT32 resume = old_count;
+    UINT32 pos = region, chars = 0;
+    UINT32 i, j, count, new_count;
+    UINT32 *starts;
+    UINT32 *declaration_starts;
+    ruyi_error *err = NULL;
+    ruyi_ast *declarations;
+    ruyi_ast *declaration;
+    ruyi_ast *globals = ruyi_ast_get_child(root, 2);
+    ruyi_mem_arena *arena = ruyi_mem_arena_create(AST_REPARSE_ARENA_BLOCK_SIZE);
+    ruyi_parser parser;
+    parser_init(&parser, ruyi_lexer_reader_open_with_options(ruyi_file_init_by_view(source + region, length - region), Ruyi_lo_SKIP_COMMENTS | Ruyi_lo_QUIET),
+                arena, Ruyi_po_NONE);
+    declarations = ruyi_ast_create(arena, Ruyi_at_global_declarations);
+    for (;;) {
+        if (ruyi_lexer_reader_peek_token_type(parser.reader) == Ruyi_tt_END) {
+            break;
+        }
+        pos = utf8_skip_chars(source, length, pos, parser.reader->token_snapshot.offset - chars);
+        chars = parser.reader->token_snapshot.offset;
+        if (pos >= new_edit_end) {
+            // the source from here is not edited, a declaration of the tree starting here parses the same again
+            j = lower_bound(old_starts, old_count, (UINT32)(pos - delta));
+            if (j < old_count && old_starts[j] == (UINT32)(pos - delta)) {
+                resume = j;
+                break;
+            }
+        }
+        if ((err = global_declaration(&parser, &declaration)) != NULL) {
+            break;
+        }
+        if (declaration == NULL) {
+            err = unexpected_token(&parser);
+            break;
+        }
+        statement_ends(&parser);
+        ruyi_ast_add_child(declarations, declaration);
+        add_declaration_start(&parser, pos);
+    }
+    count = parser.declaration_count;
+    starts = parser.declaration_starts;
+    ruyi_lexer_reader_close(parser.reader);
+    parser_release(&parser);
+    if (err != NULL) {
+        ruyi_mem_arena_destroy(arena);
+        error_move_position(err, source, region);
+        return err;
+    }
+    new_count = lo + count + (old_count - resume);
+    if (new_count == old_count) {
+        // most edits keep the count, the declarations are replaced in place
+        for (i = 0; i < count; i++) {
+            globals->children[lo + i] = declarations->children[i];
+            old_starts[lo + i] = starts[i];
+        }
+        starts = old_starts;
+    } else {
+        root->children[2] = ruyi_ast_create(arena, Ruyi_at_global_declarations);
+        for (i = 0; i < lo; i++) {
+            ruyi_ast_add_child(root->children[2], globals->children[i]);
+        }
+        for (i = 0; i < count; i++) {
+            ruyi_ast_add_child(root->children[2], declarations->children[i]);
+        }
+        for (i = resume; i < old_count; i++) {
+            ruyi_ast_add_child(root->children[2], globals->children[i]);
+        }
+        declaration_starts = (UINT32*)ruyi_mem_arena_alloc(arena, sizeof(UINT32) * (new_count > 0 ? new_count : 1));
+        memcpy(declaration_starts, old_starts, sizeof(UINT32) * lo);
+        memcpy(declaration_starts + lo, starts, sizeof(UINT32) * count);
+        memcpy(declaration_starts + lo + count, old_starts + resume, sizeof(UINT32) * (old_count - resume));
+        starts = declaration_starts;
+    }
+    for (i = lo + count; i < new_count; i++) {
+        starts[i] = (UINT32)(starts[i] + delta);
+    }
+    data->declaration_starts = starts;
+    data->declaration_count = new_count;
+    data->source_length = length;
+    data->reparsed_size += ruyi_mem_arena_size(arena);
+    ruyi_mem_arena_merge(data->arena, arena);
+    return NULL;
+}
+
+ruyi_error* ruyi_reparse_ast(ruyi_ast **ast, const BYTE *source, UINT32 length, const ruyi_source_edit *edits, UINT32 edit_count) {
+    ruyi_ast_root_data *data;
+    UINT32 i, first, end = 0;
+    INT64 delta = 0;
+    assert(ast && *ast && (*ast)->adt_type == Ruyi_adt_arena);
+    data = (ruyi_ast_root_data*)(*ast)->data.ptr_value;
+    if (data->declaration_starts == NULL || data->declaration_count == 0) {
+        // the spans are not known, or there is no declaration to keep
+        return reparse_source(ast, source, length);
+    }
+    for (i = 0; i < edit_count; i++) {
+        if (edits[i].offset < end || edits[i].offset > data->source_length || edits[i].old_length > data->source_length - edits[i].offset) {
+            return ruyi_error_misc("edit %u overlaps the one before it or runs out of the source", i);
+        }
+        end = edits[i].offset + edits[i].old_length;
+        delta += (INT64)edits[i].new_length - edits[i].old_length;
+    }
+    if (data->source_length + delta != length) {
+        return ruyi_error_misc("the edits make a source of %lld bytes, not %u", (long long)(data->source_length + delta), length);
+    }
+    if (edit_count == 0) {
+        return NULL;
+    }
+    // the declaration before the first edit may take its tokens, and the one before that may have peeked them
+    first = lower_bound(data->declaration_starts, data->declaration_count, edits[0].offset);
+    if (first < 2 || data->reparsed_size > data->tree_size) {
+        // the package and imports peek the first declaration, they are parsed with the whole source,
+        // so is a tree with more replaced nodes than live ones
+        return reparse_source(ast, source, length);
+    }
+    return reparse_declarations(*ast, source, length, first - 2, end, delta);
 }
@@ -13,7 +13,90 @@
 #include "ruyi_error.h"
 #include "ruyi_lexer.h"
 
+typedef enum {
+    Ruyi_po_NONE = 0,
+    // bodies of function declarations are kept as their tokens and parsed when first needed, see ruyi_parse_lazy_body.
+    // Only for a reader over a token stream, which must not be destroyed before the ast
+    Ruyi_po_LAZY_BODIES = 1,
+} ruyi_parse_option;
+
 ruyi_error* ruyi_parse_ast(ruyi_lexer_reader *reader, ruyi_ast **out_ast);
 
+/**
+ * Parse an ast with options
+ * params:
+ * reader - source of the tokens
+ * options - ruyi_parse_option flags
+ * out_ast - receives the root, release it by ruyi_ast_destroy
+ */
+ruyi_error* ruyi_parse_ast_with_options(ruyi_lexer_reader *reader, UINT32 options, ruyi_ast **out_ast);
+
+/**
+ * Parse a flat tree, the nodes are parsed into an arena first and flattened
+ * params:
+ * reader - source of the tokens
+ * out_tree - receives the tree, release it by ruyi_ast_tree_destroy
+ * return:
+ * the error, NULL if parsed
+ */
+ruyi_error* ruyi_parse_ast_tree(ruyi_lexer_reader *reader, ruyi_ast_tree **out_tree);
+
+/**
+ * Parse the tokens of a whole file on some threads, the ast and the error are the same as ruyi_parse_ast makes
+ * with a reader of ruyi_lexer_reader_open_stream. The global declarations are cut into runs by a scan of the
+ * brackets, the workers parse the runs each in its own arena, and they are joined in the order of the source.
+ * From the first run with an error the tokens are parsed on this thread, so the error is the one the parse
+ * of the whole file finds first. A small file is parsed on this thread only.
+ * params:
+ * stream - the tokens, e.g. by ruyi_lexer_tokenize_parallel, it must not be destroyed before the ast
+ * threads - count of threads, 0 for one per cpu
+ * out_ast - receives the root, release it by ruyi_ast_destroy
+ * return:
+ * the error, NULL if parsed
+ */
+ruyi_error* ruyi_parse_ast_parallel(const ruyi_token_stream *stream, UINT32 threads, ruyi_ast **out_ast);
+
+/**
+ * Parse a body left by Ruyi_po_LAZY_BODIES in place, the stub takes the statements and is not lazy any more.
+ * The nodes are allocated from the arena of the stub, so the bodies of a tree are not parsed on many threads at once
+ * params:
+ * body - a Ruyi_at_block_statements, nothing is done if it is not lazy
+ * return:
+ * the error of the body, the same as a parse without the option finds. The stub is not changed on an error
+ */
+ruyi_error* ruyi_parse_lazy_body(ruyi_ast *body);
+
+/**
+ * Parse a body left by Ruyi_po_LAZY_BODIES in a flat tree, the tree is not changed
+ * params:
+ * tree - the tree, by ruyi_ast_tree_create of an ast parsed with the option
+ * id - a node of ruyi_ast_tree_lazy_body
+ * out_tree - receives the statements, the root is a Ruyi_at_block_statements, release it by ruyi_ast_tree_destroy
+ * return:
+ * the error, NULL if parsed
+ */
+ruyi_error* ruyi_parse_lazy_body_tree(const ruyi_ast_tree *tree, ruyi_ast_id id, ruyi_ast_tree **out_tree);
+
+// a change of a source, in offsets of the source before it
+typedef struct {
+    UINT32 offset;          // byte offset of the bytes replaced
+    UINT32 old_length;      // count of bytes replaced
+    UINT32 new_length;      // count of bytes replacing them
+} ruyi_source_edit;
+
+/**
+ * Parse a source again after some edits. Only the global declarations the edits touch are parsed, the others are
+ * kept, and the tree is the same as ruyi_parse_ast makes of the new source. The whole source is parsed if the
+ * package or imports are edited, or the bytes of the old source were not kept by the file it was parsed from.
+ * params:
+ * ast - a root made by ruyi_parse_ast or this, it receives the tree of the new source
+ * source - utf-8 bytes of the new source
+ * length - count of bytes
+ * edits - changes from the source of the tree, sorted by offset and not overlapped
+ * edit_count - count of edits
+ * return:
+ * the error, NULL if parsed. The tree is not changed on an error, the next edits are still from its source
+ */
+ruyi_error* ruyi_reparse_ast(ruyi_ast **ast, const BYTE *source, UINT32 length, const ruyi_source_edit *edits, UINT32 edit_count);
 
 #endif /* ruyi_parser_h */
@@ -0,0 +1,199 @@
+//
+//  ruyi_stack.c
+//  ruyi
+//
+
+// for getcontext, makecontext and swapcontext, which -std=c99 does not declare
+#if !defined(_WIN32) && !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE 700
+#endif
+
+#include "ruyi_stack.h"
+#include "ruyi_mem.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <ucontext.h>
+#endif
+
+typedef struct _ruyi_stack_segment {
+    // the next free segment
+    struct _ruyi_stack_segment *next;
+#if defined(_WIN32)
+    // a fiber runs the calls of the segment in a loop, so it is made once
+    LPVOID fiber;
+#else
+    BYTE *memory;
+    ucontext_t context;
+#endif
+} ruyi_stack_segment;
+
+struct _ruyi_stack {
+    UINT32 max_bytes;
+    UINT32 size;
+    // a call made below this address runs on a new segment, 0 before the first call
+    uintptr_t limit;
+    // the segments not running a call, kept for the next ones
+    ruyi_stack_segment *free_segments;
+    // the call being moved to a segment
+    ruyi_stack_func func;
+    void *arg;
+#if defined(_WIN32)
+    LPVOID caller;
+#endif
+};
+
+ruyi_stack* ruyi_stack_create(UINT32 max_bytes) {
+    ruyi_stack *stack = (ruyi_stack*)ruyi_mem_alloc(sizeof(ruyi_stack));
+    stack->max_bytes = max_bytes;
+    stack->size = 0;
+    stack->limit = 0;
+    stack->free_segments = NULL;
+    stack->func = NULL;
+    stack->arg = NULL;
+    return stack;
+}
+
+void ruyi_stack_destroy(ruyi_stack *stack) {
+    ruyi_stack_segment *segment;
+    if (!stack) {
+        return;
+    }
+    while (stack->free_segments) {
+        segment = stack->free_segments;
+        stack->free_segments = segment->next;
+#if defined(_WIN32)
+        if (segment->fiber) {
+            DeleteFiber(segment->fiber);
+        }
+#else
+        ruyi_mem_free(segment->memory);
+#endif
+        ruyi_mem_free(segment);
+    }
+    ruyi_mem_free(stack);
+}
+
+UINT32 ruyi_stack_size(const ruyi_stack *stack) {
+    return stack->size;
+}
+
+static ruyi_stack_segment* ruyi_stack_segment_get(ruyi_stack *stack) {
+    ruyi_stack_segment *segment = stack->free_segments;
+    if (segment) {
+        stack->free_segments = segment->next;
+        return segment;
+    }
+    if (stack->size > stack->max_bytes || stack->max_bytes - stack->size < RUYI_STACK_SEGMENT_SIZE) {
+        return NULL;
+    }
+    segment = (ruyi_stack_segment*)ruyi_mem_alloc(sizeof(ruyi_stack_segment));
+#if defined(_WIN32)
+    segment->fiber = NULL;
+#else
+    segment->memory = (BYTE*)ruyi_mem_alloc(RUYI_STACK_SEGMENT_SIZE);
+#endif
+    stack->size += RUYI_STACK_SEGMENT_SIZE;
+    return segment;
+}
+
+// the calls made on a segment may go down to the red zone of it, here is at the top of the segment
+static void ruyi_stack_enter_segment(ruyi_stack *stack, const BYTE *here) {
+    stack->limit = (uintptr_t)here - (RUYI_STACK_SEGMENT_SIZE - RUYI_STACK_RED_ZONE);
+}
+
+#if defined(_WIN32)
+
+static VOID CALLBACK ruyi_stack_fiber_entry(LPVOID param) {
+    ruyi_stack *stack = (ruyi_stack*)param;
+    BYTE here = 0;
+    ruyi_stack_func func;
+    void *arg;
+    LPVOID caller;
+    for (;;) {
+        // the fields are taken before the call, a nested call of the stack changes them
+        func = stack->func;
+        arg = stack->arg;
+        caller = stack->caller;
+        ruyi_stack_enter_segment(stack, &here);
+        func(arg);
+        SwitchToFiber(caller);
+    }
+}
+
+static BOOL ruyi_stack_switch(ruyi_stack *stack, ruyi_stack_segment *segment) {
+    BOOL converted = FALSE;
+    if (!IsThreadAFiber()) {
+        if (ConvertThreadToFiber(NULL) == NULL) {
+            return FALSE;
+        }
+        converted = TRUE;
+    }
+    if (segment->fiber == NULL) {
+        segment->fiber = CreateFiber(RUYI_STACK_SEGMENT_SIZE, ruyi_stack_fiber_entry, stack);
+        if (segment->fiber == NULL) {
+            if (converted) {
+                ConvertFiberToThread();
+            }
+            return FALSE;
+        }
+    }
+    stack->caller = GetCurrentFiber();
+    SwitchToFiber(segment->fiber);
+    if (converted) {
+        ConvertFiberToThread();
+    }
+    return TRUE;
+}
+
+#else
+
+// makecontext passes ints only, so the stack is passed as two halves
+static void ruyi_stack_entry(unsigned int high, unsigned int low) {
+    ruyi_stack *stack = (ruyi_stack*)(uintptr_t)(((UINT64)high << 32) | (UINT64)low);
+    BYTE here = 0;
+    ruyi_stack_enter_segment(stack, &here);
+    stack->func(stack->arg);
+    // returns to the caller by uc_link
+}
+
+static BOOL ruyi_stack_switch(ruyi_stack *stack, ruyi_stack_segment *segment) {
+    ucontext_t caller;
+    UINT64 address = (UINT64)(uintptr_t)stack;
+    if (getcontext(&segment->context) != 0) {
+        return FALSE;
+    }
+    segment->context.uc_stack.ss_sp = segment->memory;
+    segment->context.uc_stack.ss_size = RUYI_STACK_SEGMENT_SIZE;
+    segment->context.uc_link = &caller;
+    makecontext(&segment->context, (void (*)(void))ruyi_stack_entry, 2, (unsigned int)(address >> 32), (unsigned int)address);
+    return swapcontext(&caller, &segment->context) == 0;
+}
+
+#endif
+
+BOOL ruyi_stack_call(ruyi_stack *stack, ruyi_stack_func func, void *arg) {
+    BYTE here = 0;
+    uintptr_t limit;
+    ruyi_stack_segment *segment;
+    BOOL called;
+    if (stack->limit == 0) {
+        // the first call runs on the stack of the thread, which is used down to the budget
+        stack->limit = (uintptr_t)&here - RUYI_STACK_FIRST_BUDGET;
+    }
+    if ((uintptr_t)&here > stack->limit) {
+        func(arg);
+        return TRUE;
+    }
+    if ((segment = ruyi_stack_segment_get(stack)) == NULL) {
+        return FALSE;
+    }
+    limit = stack->limit;
+    stack->func = func;
+    stack->arg = arg;
+    called = ruyi_stack_switch(stack, segment);
+    stack->limit = limit;
+    segment->next = stack->free_segments;
+    stack->free_segments = segment;
+    return called;
+}
@@ -0,0 +1,53 @@
+//
+//  ruyi_stack.h
+//  ruyi
+//
+
+#ifndef ruyi_stack_h
+#define ruyi_stack_h
+
+#include "ruyi_basics.h"
+
+/*
+ A stack of segments on the heap for a deep recursion, e.g. of the rules of the parser. A function called by
+ ruyi_stack_call runs on the stack of its caller while there is room on it, and on a segment of the heap when the
+ room is about to be used up. So the depth of the recursion is bounded by the memory given to the stack instead of
+ the stack of the thread, and a deep input is an error instead of a crash.
+ */
+
+// the room left on a stack when a call is moved to a new segment, more than the frames between two calls take
+#define RUYI_STACK_RED_ZONE (64 * 1024)
+// size of a segment of the heap
+#define RUYI_STACK_SEGMENT_SIZE (1024 * 1024)
+// the stack of the thread used by the calls before the first segment, the thread of a job may have only 512k
+#define RUYI_STACK_FIRST_BUDGET (256 * 1024)
+
+typedef struct _ruyi_stack ruyi_stack;
+
+typedef void (*ruyi_stack_func)(void *arg);
+
+/**
+ * Create a stack, the calls of it must be made by one thread
+ * params:
+ * max_bytes - the memory of the segments at most
+ */
+ruyi_stack* ruyi_stack_create(UINT32 max_bytes);
+
+// the segments are released, no call of the stack may be running
+void ruyi_stack_destroy(ruyi_stack *stack);
+
+/**
+ * Call a function, on a new segment if the stack of the caller is about to be used up
+ * params:
+ * stack - target object
+ * func - the function
+ * arg - the argument of func
+ * return:
+ * FALSE if a new segment is needed but would be over max_bytes, func is not called then
+ */
+BOOL ruyi_stack_call(ruyi_stack *stack, ruyi_stack_func func, void *arg);
+
+// bytes of the segments made so far
+UINT32 ruyi_stack_size(const ruyi_stack *stack);
+
+#endif /* ruyi_stack_h */
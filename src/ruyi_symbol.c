@@ -0,0 +1,176 @@
+//
+//  ruyi_symbol.c
+//  ruyi
+//
+
+#include "ruyi_symbol.h"
+#include "ruyi_mem.h"
+#include <string.h> // for memcpy, memcmp, memset
+
+// must be a power of 2
+#define SYMBOL_SLOTS_INIT_SIZE 1024
+#define SYMBOL_PAGE_BITS 10
+#define SYMBOL_PAGE_SIZE (1 << SYMBOL_PAGE_BITS)
+#define SYMBOL_MAX_PAGES 4096
+#define SYMBOL_ARENA_BLOCK_SIZE (64 * 1024)
+
+typedef struct {
+    /*
+     open addressing hash table:
+     slots: symbol id of each slot, RUYI_SYMBOL_NONE means empty
+     slot_hashes: hash of the name in each slot, so most mismatches need no string compare
+     */
+    ruyi_symbol *slots;
+    UINT32 *slot_hashes;
+    UINT32 slots_capacity;
+    UINT32 count;
+    // canonical strings indexed by symbol id, pages never move once created
+    const ruyi_unicode_string **pages[SYMBOL_MAX_PAGES];
+    // memory of canonical strings
+    ruyi_mem_arena *arena;
+} ruyi_symbol_table;
+
+static ruyi_symbol_table g_ruyi_symbol_table;
+static char g_ruyi_symbol_table_lock = 0;
+
+static void ruyi_symbol_table_lock(void) {
+#if defined(__GNUC__) || defined(__clang__)
+    while (__atomic_test_and_set(&g_ruyi_symbol_table_lock, __ATOMIC_ACQUIRE)) {
+    }
+#endif
+}
+
+static void ruyi_symbol_table_unlock(void) {
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_clear(&g_ruyi_symbol_table_lock, __ATOMIC_RELEASE);
+#endif
+}
+
+static UINT32 ruyi_symbol_hash(const WIDE_CHAR *data, UINT32 length) {
+    // FNV-1a
+    UINT32 hash = 2166136261u;
+    UINT32 i;
+    for (i = 0; i < length; i++) {
+        hash ^= (UINT32)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void ruyi_symbol_table_alloc_slots(ruyi_symbol_table *table, UINT32 capacity) {
+    table->slots = (ruyi_symbol*)ruyi_mem_alloc(sizeof(ruyi_symbol) * capacity);
+    table->slot_hashes = (UINT32*)ruyi_mem_alloc(sizeof(UINT32) * capacity);
+    memset(table->slots, 0, sizeof(ruyi_symbol) * capacity);
+    table->slots_capacity = capacity;
+}
+
+static void ruyi_symbol_table_grow(ruyi_symbol_table *table) {
+    ruyi_symbol *old_slots = table->slots;
+    UINT32 *old_slot_hashes = table->slot_hashes;
+    UINT32 old_capacity = table->slots_capacity;
+    UINT32 mask;
+    UINT32 i, pos;
+    ruyi_symbol_table_alloc_slots(table, old_capacity * 2);
+    mask = table->slots_capacity - 1;
+    for (i = 0; i < old_capacity; i++) {
+        if (old_slots[i] == RUYI_SYMBOL_NONE) {
+            continue;
+        }
+        pos = old_slot_hashes[i] & mask;
+        while (table->slots[pos] != RUYI_SYMBOL_NONE) {
+            pos = (pos + 1) & mask;
+        }
+        table->slots[pos] = old_slots[i];
+        table->slot_hashes[pos] = old_slot_hashes[i];
+    }
+    ruyi_mem_free(old_slots);
+    ruyi_mem_free(old_slot_hashes);
+}
+
+static const ruyi_unicode_string* ruyi_symbol_table_get(const ruyi_symbol_table *table, ruyi_symbol symbol) {
+    return table->pages[symbol >> SYMBOL_PAGE_BITS][symbol & (SYMBOL_PAGE_SIZE - 1)];
+}
+
+static ruyi_symbol ruyi_symbol_table_add(ruyi_symbol_table *table, const WIDE_CHAR *data, UINT32 length) {
+    ruyi_symbol symbol = table->count + 1;
+    UINT32 page = symbol >> SYMBOL_PAGE_BITS;
+    ruyi_unicode_string *str;
+    assert(page < SYMBOL_MAX_PAGES);
+    if (table->pages[page] == NULL) {
+        table->pages[page] = (const ruyi_unicode_string**)ruyi_mem_alloc(sizeof(ruyi_unicode_string*) * SYMBOL_PAGE_SIZE);
+    }
+    str = (ruyi_unicode_string*)ruyi_mem_arena_alloc(table->arena, sizeof(ruyi_unicode_string) + sizeof(WIDE_CHAR) * length);
+    str->data = (WIDE_CHAR*)(str + 1);
+    str->length = length;
+    str->capacity = length;
+    memcpy(str->data, data, sizeof(WIDE_CHAR) * length);
+    table->pages[page][symbol & (SYMBOL_PAGE_SIZE - 1)] = str;
+    // publish the string before the count, see ruyi_symbol_count()
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(&table->count, symbol, __ATOMIC_RELEASE);
+#else
+    table->count = symbol;
+#endif
+    return symbol;
+}
+
+ruyi_symbol ruyi_symbol_intern(const WIDE_CHAR *data, UINT32 length) {
+    ruyi_symbol_table *table = &g_ruyi_symbol_table;
+    UINT32 hash = ruyi_symbol_hash(data, length);
+    UINT32 mask, pos;
+    ruyi_symbol symbol;
+    const ruyi_unicode_string *str;
+    ruyi_symbol_table_lock();
+    if (table->slots == NULL) {
+        ruyi_symbol_table_alloc_slots(table, SYMBOL_SLOTS_INIT_SIZE);
+        table->arena = ruyi_mem_arena_create(SYMBOL_ARENA_BLOCK_SIZE);
+    }
+    mask = table->slots_capacity - 1;
+    pos = hash & mask;
+    for (;;) {
+        symbol = table->slots[pos];
+        if (symbol == RUYI_SYMBOL_NONE) {
+            break;
+        }
+        if (table->slot_hashes[pos] == hash) {
+            str = ruyi_symbol_table_get(table, symbol);
+            if (str->length == length && memcmp(str->data, data, sizeof(WIDE_CHAR) * length) == 0) {
+                ruyi_symbol_table_unlock();
+                return symbol;
+            }
+        }
+        pos = (pos + 1) & mask;
+    }
+    symbol = ruyi_symbol_table_add(table, data, length);
+    table->slots[pos] = symbol;
+    table->slot_hashes[pos] = hash;
+    // keep the load factor under 0.5
+    if (table->count * 2 >= table->slots_capacity) {
+        ruyi_symbol_table_grow(table);
+    }
+    ruyi_symbol_table_unlock();
+    return symbol;
+}
+
+ruyi_symbol ruyi_symbol_intern_unicode(const ruyi_unicode_string *str) {
+    if (str == NULL) {
+        return RUYI_SYMBOL_NONE;
+    }
+    return ruyi_symbol_intern(str->data, str->length);
+}
+
+const ruyi_unicode_string* ruyi_symbol_str(ruyi_symbol symbol) {
+    if (symbol == RUYI_SYMBOL_NONE) {
+        return NULL;
+    }
+    assert(symbol <= ruyi_symbol_count());
+    return ruyi_symbol_table_get(&g_ruyi_symbol_table, symbol);
+}
+
+UINT32 ruyi_symbol_count(void) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(&g_ruyi_symbol_table.count, __ATOMIC_ACQUIRE);
+#else
+    return g_ruyi_symbol_table.count;
+#endif
+}
@@ -0,0 +1,55 @@
+//
+//  ruyi_symbol.h
+//  ruyi
+//
+
+#ifndef ruyi_symbol_h
+#define ruyi_symbol_h
+
+#include "ruyi_basics.h"
+#include "ruyi_unicode.h"
+
+/**
+ * Identifiers are interned into one global table, each distinct name gets a
+ * symbol id, so the same name always has the same id.
+ * Ids start from 1, RUYI_SYMBOL_NONE means no name (e.g. anonymous function).
+ */
+typedef UINT32 ruyi_symbol;
+
+#define RUYI_SYMBOL_NONE 0
+
+/**
+ * Intern an identifier
+ * params:
+ * data - chars of the identifier
+ * length - count of chars
+ * return:
+ * the symbol id of the identifier
+ */
+ruyi_symbol ruyi_symbol_intern(const WIDE_CHAR *data, UINT32 length);
+
+/**
+ * Intern an identifier
+ * params:
+ * str - the identifier, NULL means no name
+ * return:
+ * the symbol id of the identifier, RUYI_SYMBOL_NONE if str is NULL
+ */
+ruyi_symbol ruyi_symbol_intern_unicode(const ruyi_unicode_string *str);
+
+/**
+ * Get the canonical string of a symbol,
+ * it is owned by the symbol table and lives until the process exits, please DO NOT modify or release it.
+ * params:
+ * symbol - the symbol id
+ * return:
+ * the canonical string, NULL for RUYI_SYMBOL_NONE
+ */
+const ruyi_unicode_string* ruyi_symbol_str(ruyi_symbol symbol);
+
+/**
+ * Get how many symbols have been interned
+ */
+UINT32 ruyi_symbol_count(void);
+
+#endif /* ruyi_symbol_h */
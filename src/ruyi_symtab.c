@@ -19,7 +19,7 @@ static
 ruyi_symtab_index_hashtable* index_hashtable_create(ruyi_function_scope *func_scope) {
     ruyi_symtab_index_hashtable *table = (ruyi_symtab_index_hashtable*)ruyi_mem_alloc(sizeof(ruyi_symtab_index_hashtable));
     table->type = func_scope->type;
-    table->name2index = ruyi_hashtable_create();    // key: unicode, value: index
+    table->name2index = ruyi_hashtable_create();    // key: symbol, value: index
     table->ref_of_index2value_ptr = func_scope->index_vars;
     return table;
 }
@@ -37,7 +37,6 @@ void index_hashtable_destroy(ruyi_symtab_index_hashtable *table) {
     }
     if (table->name2index) {
         ruyi_hashtable_destroy(table->name2index);
-        // the unicode string will be free with vector destroy
     }
    
     ruyi_mem_free(table);
@@ -49,20 +48,20 @@ ruyi_error* index_hashtable_add_variable(ruyi_symtab_index_hashtable *table, con
     ruyi_value value;
     ruyi_symtab_variable *var_copied;
     assert(table->type == Ruyi_sid_Var);
-    if (ruyi_hashtable_get(table->name2index, ruyi_value_unicode_str(var->name), &value)) {
-        return ruyi_error_misc_unicode_name("duplicated var define: %s", var->name);
+    if (ruyi_hashtable_get(table->name2index, ruyi_value_uint32(var->name), &value)) {
+        return ruyi_error_misc_unicode_name("duplicated var define: %s", ruyi_symbol_str(var->name));
     }
     
     index = ruyi_vector_length(table->ref_of_index2value_ptr);
 
     var_copied = (ruyi_symtab_variable*)ruyi_mem_alloc(sizeof(ruyi_symtab_variable));
     var_copied->type = var->type;
-    var_copied->name = ruyi_unicode_string_copy_from(var->name);
+    var_copied->name = var->name;
     var_copied->index = index;
     var_copied->scope_type = var->scope_type;
     
     ruyi_vector_add(table->ref_of_index2value_ptr, ruyi_value_ptr(var_copied));
-    ruyi_hashtable_put(table->name2index, ruyi_value_unicode_str(var_copied->name), ruyi_value_uint32(index));
+    ruyi_hashtable_put(table->name2index, ruyi_value_uint32(var_copied->name), ruyi_value_uint32(index));
     if (out_index) {
         *out_index = index;
     }
@@ -70,26 +69,26 @@ ruyi_error* index_hashtable_add_variable(ruyi_symtab_index_hashtable *table, con
 }
 
 static
-ruyi_error* index_hashtable_add_function(ruyi_symtab_index_hashtable *table, const ruyi_unicode_string *func_name, const ruyi_symtab_function *func, UINT32 *out_index) {
+ruyi_error* index_hashtable_add_function(ruyi_symtab_index_hashtable *table, ruyi_symbol func_name, const ruyi_symtab_function *func, UINT32 *out_index) {
     UINT32 index = 0;
     ruyi_value value;
     ruyi_symtab_function *func_copied;
     assert(table->type == Ruyi_sid_Func);
-    if (ruyi_hashtable_get(table->name2index, ruyi_value_unicode_str(func_name), &value)) {
-        return ruyi_error_misc_unicode_name("duplicated function define: %s", func_name);
+    if (ruyi_hashtable_get(table->name2index, ruyi_value_uint32(func_name), &value)) {
+        return ruyi_error_misc_unicode_name("duplicated function define: %s", ruyi_symbol_str(func_name));
     }
     
     index = ruyi_vector_length(table->ref_of_index2value_ptr);
     
     func_copied = (ruyi_symtab_function*)ruyi_mem_alloc(sizeof(ruyi_symtab_function));
     func_copied->index = index;
-    func_copied->name = ruyi_unicode_string_copy_from(func_name);
+    func_copied->name = func_name;
     func_copied->parameter_count = func->parameter_count;
     func_copied->return_count = func->return_count;
     memcpy(func_copied->parameter_types, func->parameter_types, sizeof(func_copied->parameter_types[0]) * func->parameter_count);
     memcpy(func_copied->return_types, func->return_types, sizeof(func_copied->return_types[0]) * func->return_count);
     ruyi_vector_add(table->ref_of_index2value_ptr, ruyi_value_ptr(func_copied));
-    ruyi_hashtable_put(table->name2index, ruyi_value_unicode_str(func_copied->name), ruyi_value_uint32(index));
+    ruyi_hashtable_put(table->name2index, ruyi_value_uint32(func_copied->name), ruyi_value_uint32(index));
     if (out_index) {
         *out_index = index;
     }
@@ -97,12 +96,12 @@ ruyi_error* index_hashtable_add_function(ruyi_symtab_index_hashtable *table, con
 }
 
 static
-BOOL index_hashtable_get_function_by_name(const ruyi_symtab_index_hashtable *table, const ruyi_unicode_string* name, ruyi_symtab_function *out_func) {
+BOOL index_hashtable_get_function_by_name(const ruyi_symtab_index_hashtable *table, ruyi_symbol name, ruyi_symtab_function *out_func) {
     ruyi_value index_value;
     ruyi_value item_value;
     const ruyi_symtab_function* func;
     assert(table->type == Ruyi_sid_Func);
-    if (!ruyi_hashtable_get(table->name2index, ruyi_value_unicode_str((ruyi_unicode_string*)name), &index_value)) {
+    if (!ruyi_hashtable_get(table->name2index, ruyi_value_uint32(name), &index_value)) {
         return FALSE;
     }
     if (!ruyi_vector_get(table->ref_of_index2value_ptr, index_value.data.uint32_value, &item_value)) {
@@ -123,13 +122,13 @@ BOOL index_hashtable_get_function_by_name(const ruyi_symtab_index_hashtable *tab
 }
 
 static
-BOOL index_hashtable_get_variable_by_name(const ruyi_symtab_index_hashtable *table, const ruyi_unicode_string* name, ruyi_symtab_variable *out_var) {
+BOOL index_hashtable_get_variable_by_name(const ruyi_symtab_index_hashtable *table, ruyi_symbol name, ruyi_symtab_variable *out_var) {
     ruyi_value index_value;
     ruyi_value item_value;
     const ruyi_symtab_variable* var;
     assert(out_var);
     assert(table->type == Ruyi_sid_Var);
-    if (!ruyi_hashtable_get(table->name2index, ruyi_value_unicode_str((ruyi_unicode_string*)name), &index_value)) {
+    if (!ruyi_hashtable_get(table->name2index, ruyi_value_uint32(name), &index_value)) {
         return FALSE;
     }
     if (!ruyi_vector_get(table->ref_of_index2value_ptr, index_value.data.uint32_value, &item_value)) {
@@ -185,7 +184,7 @@ ruyi_error* ruyi_symtab_add_global_var(ruyi_symtab *symtab, const ruyi_symtab_va
     return index_hashtable_add_variable(symtab->global_variables, var, out_index);
 }
 
-BOOL ruyi_symtab_get_global_var_by_name(const ruyi_symtab *symtab, const ruyi_unicode_string *name, ruyi_symtab_variable *out_var) {
+BOOL ruyi_symtab_get_global_var_by_name(const ruyi_symtab *symtab, ruyi_symbol name, ruyi_symtab_variable *out_var) {
     assert(symtab);
     return index_hashtable_get_variable_by_name(symtab->global_variables, name, out_var);
 }
@@ -221,25 +220,19 @@ BOOL ruyi_symtab_function_update_return_types(ruyi_symtab *symtab, UINT32 index,
 }
 
 
-ruyi_error* ruyi_symtab_function_create(ruyi_symtab *symtab, const ruyi_unicode_string *name, ruyi_symtab_function_define** out_func) {
+ruyi_error* ruyi_symtab_function_create(ruyi_symtab *symtab, ruyi_symbol name, ruyi_symtab_function_define** out_func) {
     ruyi_error *err;
     ruyi_symtab_function_define *func = NULL;
     ruyi_symtab_function simple_func;
     if (index_hashtable_get_function_by_name(symtab->functions, name, &simple_func)) {
-        if ((err = ruyi_error_misc_unicode_name("function %s has been exist!", name)) != NULL) {
+        if ((err = ruyi_error_misc_unicode_name("function %s has been exist!", ruyi_symbol_str(name))) != NULL) {
             goto ruyi_symtab_function_create_on_error;
         }
     }
     
     func = (ruyi_symtab_function_define*)ruyi_mem_alloc(sizeof(ruyi_symtab_function_define));
-    if (name) {
-        func->anonymous = FALSE;
-        func->name = ruyi_unicode_string_copy_from(name);
-    } else {
-        func->anonymous = TRUE;
-        func->name = NULL;
-
-    }
+    func->name = name;
+    func->anonymous = (name == RUYI_SYMBOL_NONE);
     func->symtab = symtab;
     func->func_symtab_scope = ruyi_symtab_function_scope_create(Ruyi_sid_Var);
     func->return_types = NULL;
@@ -262,14 +255,14 @@ ruyi_symtab_function_create_on_error:
     if (func) {
         ruyi_symtab_function_destroy(func);
     }
-    return NULL;
+    return err;
 }
 
-ruyi_error* ruyi_symtab_add_function(const ruyi_symtab *symtab, const ruyi_unicode_string *name, const ruyi_symtab_function *func, UINT32 *out_index) {
+ruyi_error* ruyi_symtab_add_function(const ruyi_symtab *symtab, ruyi_symbol name, const ruyi_symtab_function *func, UINT32 *out_index) {
     return index_hashtable_add_function(symtab->functions, name, func, out_index);
 }
 
-BOOL ruyi_symtab_get_function_by_name(const ruyi_symtab *symtab, const ruyi_unicode_string *name, ruyi_symtab_function *out_func) {
+BOOL ruyi_symtab_get_function_by_name(const ruyi_symtab *symtab, ruyi_symbol name, ruyi_symtab_function *out_func) {
     return index_hashtable_get_function_by_name(symtab->functions, name, out_func);
 }
 
@@ -278,7 +271,6 @@ void ruyi_symtab_function_destroy(ruyi_symtab_function_define* func) {
     UINT32 i, len;
     ruyi_value temp;
     ruyi_symtab_type type;
-    ruyi_unicode_string *name;
     if (!func) {
         return;
     }
@@ -299,10 +291,6 @@ void ruyi_symtab_function_destroy(ruyi_symtab_function_define* func) {
     if (func->args_types) {
         len = ruyi_vector_length(func->args_types);
         for (i = 0; i < len; i += 3) {
-            ruyi_vector_get(func->args_types, i, &temp);
-            name = (ruyi_unicode_string *)temp.data.unicode_str;
-            ruyi_unicode_string_destroy(name);
-
             ruyi_vector_get(func->args_types, i+1, &temp);
             type.ir_type = temp.data.int32_value;
             ruyi_vector_get(func->args_types, i+2, &temp);
@@ -325,7 +313,7 @@ ruyi_error* ruyi_symtab_function_add_arg(ruyi_symtab_function_define* func, cons
         func->args_types = ruyi_vector_create();
     }
     // name
-    ruyi_vector_add(func->args_types, ruyi_value_unicode_str(ruyi_unicode_string_copy_from(var->name)));
+    ruyi_vector_add(func->args_types, ruyi_value_uint32(var->name));
     // ir_type
     ruyi_vector_add(func->args_types, ruyi_value_int32(var->type.ir_type));
     // detail
@@ -370,9 +358,6 @@ void ruyi_symtab_type_destroy(ruyi_symtab_type type) {
             break;
         case Ruyi_ir_type_Function:
             if (type.detail.func) {
-                if (type.detail.func->name) {
-                    ruyi_unicode_string_destroy((ruyi_unicode_string*)type.detail.func->name);
-                }
                 ruyi_mem_free(type.detail.func);
             }
             break;
@@ -475,13 +460,11 @@ void ruyi_symtab_function_scope_destroy(ruyi_function_scope *function_scope) {
                 case Ruyi_sid_Var:
                     var = (ruyi_symtab_variable *)value.data.ptr;
                     assert(var);
-                    ruyi_unicode_string_destroy((ruyi_unicode_string*)var->name);
                     ruyi_mem_free(var);
                     break;
                 case Ruyi_sid_Func:
                     func = (ruyi_symtab_function *)value.data.ptr;
                     assert(func);
-                    ruyi_unicode_string_destroy((ruyi_unicode_string*)func->name);
                     ruyi_mem_free(func);
                     break;
                 default:
@@ -534,13 +517,11 @@ void ruyi_symtab_function_scope_leave(ruyi_function_scope* scope) {
             case Ruyi_sid_Var:
                 var = (ruyi_symtab_variable *)value.data.ptr;
                 assert(var);
-                ruyi_unicode_string_destroy((ruyi_unicode_string*)var->name);
                 ruyi_mem_free(var);
                 break;
             case Ruyi_sid_Func:
                 func = (ruyi_symtab_function *)value.data.ptr;
                 assert(func);
-                ruyi_unicode_string_destroy((ruyi_unicode_string*)func->name);
                 ruyi_mem_free(func);
                 break;
             default:
@@ -567,7 +548,7 @@ ruyi_error* ruyi_symtab_function_scope_add_var(ruyi_function_scope* scope, const
     return index_hashtable_add_variable(table, var, out_index);
 }
 
-BOOL ruyi_symtab_function_scope_get(ruyi_function_scope* scope, const ruyi_unicode_string *name, ruyi_symtab_variable *out_var) {
+BOOL ruyi_symtab_function_scope_get(ruyi_function_scope* scope, ruyi_symbol name, ruyi_symtab_variable *out_var) {
     ruyi_symtab_index_hashtable *table;
     ruyi_list_item *item;
     assert(scope);
@@ -15,6 +15,7 @@
 #include "ruyi_unicode.h"
 #include "ruyi_error.h"
 #include "ruyi_ir.h"
+#include "ruyi_symbol.h"
 
 typedef enum {
     Ruyi_sst_Local,
@@ -89,14 +90,14 @@ typedef struct ruyi_symtab_type_func_ {
     ruyi_symtab_type            parameter_types[RUYI_FUNC_MAX_PARAMETER_COUNT];
     UINT32                      return_count;
     ruyi_symtab_type            return_types[RUYI_FUNC_MAX_RETURN_COUNT];
-    const ruyi_unicode_string   *name;
+    ruyi_symbol                 name;
 } ruyi_symtab_function;
 
 typedef struct {
     UINT32                  index;
     ruyi_symtab_type        type;
     ruyi_symtab_scope_type  scope_type;
-    const ruyi_unicode_string *name;
+    ruyi_symbol             name;
 } ruyi_symtab_variable;
 
 typedef enum {
@@ -121,13 +122,13 @@ typedef struct {
 
 typedef struct {
     ruyi_symtab_index_data_type type;
-    ruyi_hashtable              *name2index;
+    ruyi_hashtable              *name2index;  // key: symbol of the name, value: index
     ruyi_vector                 *ref_of_index2value_ptr; // value of ruyi_symtab_type_func* or ruyi_symtab_variable*
 } ruyi_symtab_index_hashtable;
 
 
 typedef struct {
-    ruyi_unicode_string *name;
+    ruyi_symbol         name;
     ruyi_symtab_type    type;
 } ruyi_symtab_name_and_type;
 
@@ -182,10 +183,10 @@ typedef struct {
 typedef struct {
     UINT32              index;
     BOOL                anonymous;
-    const ruyi_unicode_string *name;
+    ruyi_symbol         name;
     ruyi_symtab         *symtab;        // reference of global ruyi_symtab
     ruyi_function_scope *func_symtab_scope;
-    ruyi_vector         *args_types; /* type of ruyi_symtab_name_and_type: (ruyi_unicode_string*, ruyi_ir_type, void*) */
+    ruyi_vector         *args_types; /* type of ruyi_symtab_name_and_type: (ruyi_symbol, ruyi_ir_type, void*) */
     ruyi_vector         *return_types; /* type of ruyi_symtab_type: (ruyi_ir_type, void*) */
     UINT32              codes_size;
     UINT32              *codes;
@@ -204,7 +205,7 @@ void ruyi_symtab_destroy(ruyi_symtab *symtab);
 
 ruyi_error* ruyi_symtab_add_global_var(ruyi_symtab *symtab, const ruyi_symtab_variable *var, UINT32 *out_index);
 
-BOOL ruyi_symtab_get_global_var_by_name(const ruyi_symtab *symtab, const ruyi_unicode_string *name, ruyi_symtab_variable *out_var);
+BOOL ruyi_symtab_get_global_var_by_name(const ruyi_symtab *symtab, ruyi_symbol name, ruyi_symtab_variable *out_var);
 
 UINT32 ruyi_symtab_add_constant_int64(ruyi_symtab *symtab, INT64 value, UINT32 *out_index);
 
@@ -212,9 +213,9 @@ UINT32 ruyi_symtab_add_constant_float64(ruyi_symtab *symtab, FLOAT64 value, UINT
 
 UINT32 ruyi_symtab_add_constant_unicode(ruyi_symtab *symtab, const ruyi_unicode_string *value, UINT32 *out_index);
 
-ruyi_error* ruyi_symtab_add_function(const ruyi_symtab *symtab, const ruyi_unicode_string *name, const ruyi_symtab_function *func, UINT32 *out_index);
+ruyi_error* ruyi_symtab_add_function(const ruyi_symtab *symtab, ruyi_symbol name, const ruyi_symtab_function *func, UINT32 *out_index);
 
-BOOL ruyi_symtab_get_function_by_name(const ruyi_symtab *symtab, const ruyi_unicode_string *name, ruyi_symtab_function *out_func);
+BOOL ruyi_symtab_get_function_by_name(const ruyi_symtab *symtab, ruyi_symbol name, ruyi_symtab_function *out_func);
 
 BOOL ruyi_symtab_function_update_parameter_types(ruyi_symtab *symtab, UINT32 index, UINT32 type_count, const ruyi_symtab_type *types);
 
@@ -223,7 +224,8 @@ BOOL ruyi_symtab_function_update_return_types(ruyi_symtab *symtab, UINT32 index,
 
 // ================================================================
 
-ruyi_error* ruyi_symtab_function_create(ruyi_symtab *symtab, const ruyi_unicode_string *name, ruyi_symtab_function_define** out_func);
+// name - RUYI_SYMBOL_NONE for an anonymous function
+ruyi_error* ruyi_symtab_function_create(ruyi_symtab *symtab, ruyi_symbol name, ruyi_symtab_function_define** out_func);
 
 void ruyi_symtab_function_destroy(ruyi_symtab_function_define* func);
 
@@ -276,7 +278,7 @@ void ruyi_symtab_function_scope_leave(ruyi_function_scope* scope);
 
 ruyi_error* ruyi_symtab_function_scope_add_var(ruyi_function_scope* scope, const ruyi_symtab_variable *var, UINT32 *out_index);
 
-BOOL ruyi_symtab_function_scope_get(ruyi_function_scope* scope, const ruyi_unicode_string *name, ruyi_symtab_variable *out_var);
+BOOL ruyi_symtab_function_scope_get(ruyi_function_scope* scope, ruyi_symbol name, ruyi_symtab_variable *out_var);
 
 // get the Pointer reference from scope, please DO NOT release the return value
 ruyi_symtab_variable* ruyi_symtab_function_scope_get_var(ruyi_function_scope* scope, UINT32 index);
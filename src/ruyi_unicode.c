@@ -11,6 +11,12 @@
 #include <string.h>
 #include "ruyi_mem.h"
 
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define RUYI_UNICODE_SIMD_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
 
 static INT32 ruyi_unicode_decode_single_utf8(const BYTE* src, UINT32 src_pos, UINT32 src_len, WIDE_CHAR *out_utf8_char) {
     WIDE_CHAR b0, b1, b2, b3, b4, b5;
@@ -160,11 +166,102 @@ static INT32 ruyi_unicode_decode_single_utf8(const BYTE* src, UINT32 src_pos, UI
     return 0;
 }
 
+#if defined(RUYI_UNICODE_SIMD_X86)
+
+// widen 16 ascii bytes to 16 wide chars
+static inline void ruyi_unicode_widen_sse2(__m128i v, WIDE_CHAR *out) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo16 = _mm_unpacklo_epi8(v, zero);
+    __m128i hi16 = _mm_unpackhi_epi8(v, zero);
+    _mm_storeu_si128((__m128i*)(out + 0), _mm_unpacklo_epi16(lo16, zero));
+    _mm_storeu_si128((__m128i*)(out + 4), _mm_unpackhi_epi16(lo16, zero));
+    _mm_storeu_si128((__m128i*)(out + 8), _mm_unpacklo_epi16(hi16, zero));
+    _mm_storeu_si128((__m128i*)(out + 12), _mm_unpackhi_epi16(hi16, zero));
+}
+
+static UINT32 ruyi_unicode_decode_ascii_sse2(const BYTE* src, UINT32 len, WIDE_CHAR *out) {
+    UINT32 pos = 0;
+    __m128i v;
+    int mask;
+    while (pos + 16 <= len) {
+        v = _mm_loadu_si128((const __m128i*)(src + pos));
+        mask = _mm_movemask_epi8(v);
+        if (mask != 0) {
+            return pos;
+        }
+        ruyi_unicode_widen_sse2(v, out + pos);
+        pos += 16;
+    }
+    return pos;
+}
+
+__attribute__((target("avx2")))
+static UINT32 ruyi_unicode_decode_ascii_avx2(const BYTE* src, UINT32 len, WIDE_CHAR *out) {
+    UINT32 pos = 0;
+    __m256i v;
+    __m128i lo, hi;
+    while (pos + 32 <= len) {
+        v = _mm256_loadu_si256((const __m256i*)(src + pos));
+        if (_mm256_movemask_epi8(v) != 0) {
+            return pos;
+        }
+        lo = _mm256_castsi256_si128(v);
+        hi = _mm256_extracti128_si256(v, 1);
+        _mm256_storeu_si256((__m256i*)(out + pos + 0), _mm256_cvtepu8_epi32(lo));
+        _mm256_storeu_si256((__m256i*)(out + pos + 8), _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+        _mm256_storeu_si256((__m256i*)(out + pos + 16), _mm256_cvtepu8_epi32(hi));
+        _mm256_storeu_si256((__m256i*)(out + pos + 24), _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+        pos += 32;
+    }
+    return pos;
+}
+
+static BOOL ruyi_unicode_has_avx2(void) {
+    static int has_avx2 = -1;
+    if (has_avx2 < 0) {
+        __builtin_cpu_init();
+        has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return has_avx2 == 1;
+}
+
+#endif
+
+/*
+ * Decode the run of ascii bytes at the head of src, and stop at the first
+ * multibyte lead byte. Returns the count decoded, each takes one byte.
+ */
+static UINT32 ruyi_unicode_decode_ascii(const BYTE* src, UINT32 len, WIDE_CHAR *out) {
+    UINT32 pos = 0;
+#if defined(RUYI_UNICODE_SIMD_X86)
+    if (len >= 32 && ruyi_unicode_has_avx2()) {
+        pos = ruyi_unicode_decode_ascii_avx2(src, len, out);
+    }
+    pos += ruyi_unicode_decode_ascii_sse2(src + pos, len - pos, out + pos);
+#endif
+    while (pos < len && src[pos] < 0x80) {
+        out[pos] = src[pos];
+        pos++;
+    }
+    return pos;
+}
+
 UINT32 ruyi_unicode_decode_utf8(const BYTE* src_utf8, UINT32 src_len, UINT32 *src_used_count, WIDE_CHAR *out_buf, UINT32 buf_length) {
     UINT32 src_pos = 0;
     UINT32 dest_pos = 0;
     UINT32 use_bytes_count = 0;
+    UINT32 max_ascii;
     while (src_pos < src_len && dest_pos < buf_length) {
+        if (src_utf8[src_pos] < 0x80) {
+            max_ascii = src_len - src_pos;
+            if (max_ascii > buf_length - dest_pos) {
+                max_ascii = buf_length - dest_pos;
+            }
+            use_bytes_count = ruyi_unicode_decode_ascii(src_utf8 + src_pos, max_ascii, out_buf + dest_pos);
+            src_pos += use_bytes_count;
+            dest_pos += use_bytes_count;
+            continue;
+        }
         use_bytes_count = ruyi_unicode_decode_single_utf8(src_utf8, src_pos, src_len, out_buf+dest_pos);
         if (use_bytes_count == 0) {
             break;
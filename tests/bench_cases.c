@@ -0,0 +1,956 @@
+//
+//  bench_cases.c
+//  ruyi
+//
+
+#include "bench_cases.h"
+#include "bench_corpus.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>         // for fork
+#include <sys/resource.h>   // for getrusage
+#include <sys/wait.h>       // for waitpid
+#include "../src/ruyi_mem.h"
+#include "../src/ruyi_io.h"
+#include "../src/ruyi_lexer.h"
+#include "../src/ruyi_jobs.h"
+#include "../src/ruyi_unicode.h"
+#include "../src/ruyi_parser.h"
+#include "../src/ruyi_error.h"
+#include "../src/ruyi_ast_cache.h"
+#include "../src/ruyi_ast_walker.h"
+
+#define BENCH_LEXER_SOURCE_SIZE (8 * 1024 * 1024)
+#define BENCH_UTF8_SOURCE_SIZE (32 * 1024 * 1024)
+#define BENCH_UTF8_ROUNDS 4
+#define BENCH_CORPUS_SEED 20191102
+#define BENCH_PARSER_SOURCE_SIZE (4 * 1024 * 1024)
+#define BENCH_REPARSE_LINES 100000
+#define BENCH_REPARSE_ROUNDS 500
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* bench_make_source(UINT32 size) {
+    return bench_corpus_make(Bench_corpus_MIXED, size, BENCH_CORPUS_SEED, NULL);
+}
+
+typedef struct {
+    UINT64 token_count;
+    UINT64 alloc_count;
+    double seconds;
+    BOOL ok;
+} bench_lex_result;
+
+// read tokens until the end of the file, the file is closed at last
+static bench_lex_result bench_lex_to_end(ruyi_file *file, UINT32 lexer_options) {
+    bench_lex_result result;
+    ruyi_lexer_reader* reader = ruyi_lexer_reader_open_with_options(file, lexer_options);
+    ruyi_token *token;
+    double begin;
+    result.token_count = 0;
+    result.alloc_count = ruyi_mem_alloc_count();
+    result.ok = TRUE;
+    begin = bench_now();
+    for (;;) {
+        token = ruyi_lexer_reader_next_token(reader);
+        if (!token) {
+            result.ok = FALSE;
+            break;
+        }
+        result.token_count++;
+        if (token->type == Ruyi_tt_END) {
+            ruyi_lexer_token_destroy(token);
+            break;
+        }
+        ruyi_lexer_token_destroy(token);
+    }
+    result.seconds = bench_now() - begin;
+    result.alloc_count = ruyi_mem_alloc_count() - result.alloc_count;
+    ruyi_lexer_reader_close(reader);
+    return result;
+}
+
+// tokenize the whole file by some threads, the file is closed at last
+static bench_lex_result bench_tokenize_parallel(ruyi_file *file, UINT32 lexer_options, UINT32 threads) {
+    bench_lex_result result;
+    ruyi_token_stream *stream;
+    double begin;
+    result.alloc_count = ruyi_mem_alloc_count();
+    begin = bench_now();
+    stream = ruyi_lexer_tokenize_parallel(file, lexer_options, threads);
+    result.seconds = bench_now() - begin;
+    result.alloc_count = ruyi_mem_alloc_count() - result.alloc_count;
+    result.ok = (stream != NULL);
+    result.token_count = stream ? stream->count : 0;
+    ruyi_token_stream_destroy(stream);
+    return result;
+}
+
+static void bench_lex_all(const char *name, ruyi_file *file, UINT32 src_len) {
+    bench_lex_result result = bench_lex_to_end(file, Ruyi_lo_NONE);
+    if (!result.ok) {
+        printf("read next token error\n");
+    }
+    printf("%s: %.2f MB, %llu tokens, %.3f s, %.2f MB/s, %.1f allocs/1k tokens\n", name, src_len / (1024.0 * 1024.0),
+           (unsigned long long)result.token_count, result.seconds, src_len / (1024.0 * 1024.0) / result.seconds,
+           result.alloc_count * 1000.0 / result.token_count);
+}
+
+/*
+ * The way the parser reads: peek first, then take the token or match it.
+ */
+static void bench_lex_all_by_peek(const char *name, ruyi_file *file, UINT32 src_len) {
+    ruyi_lexer_reader* reader = ruyi_lexer_reader_open(file);
+    ruyi_token *token;
+    ruyi_token matched;
+    ruyi_token_type type;
+    UINT64 token_count = 0;
+    UINT64 alloc_count = ruyi_mem_alloc_count();
+    double begin, seconds;
+    begin = bench_now();
+    for (;;) {
+        type = ruyi_lexer_reader_peek_token_type(reader);
+        token_count++;
+        if (type == Ruyi_tt_END) {
+            break;
+        }
+        if (type == Ruyi_tt_IDENTITY || type == Ruyi_tt_STRING) {
+            token = ruyi_lexer_reader_next_token(reader);
+            ruyi_lexer_token_destroy(token);
+        } else if (!ruyi_lexer_reader_consume_token_if_match(reader, type, &matched)) {
+            printf("read next token error\n");
+            break;
+        }
+    }
+    seconds = bench_now() - begin;
+    alloc_count = ruyi_mem_alloc_count() - alloc_count;
+    ruyi_lexer_reader_close(reader);
+    printf("%s: %.2f MB, %llu tokens, %.3f s, %.2f MB/s, %.1f allocs/1k tokens\n", name, src_len / (1024.0 * 1024.0),
+           (unsigned long long)token_count, seconds, src_len / (1024.0 * 1024.0) / seconds,
+           alloc_count * 1000.0 / token_count);
+}
+
+void bench_lexer_throughput(void) {
+    char *src = bench_make_source(BENCH_LEXER_SOURCE_SIZE);
+    UINT32 src_len = (UINT32)strlen(src);
+    bench_lex_all("lexer", ruyi_file_init_by_data(src, src_len), src_len);
+    bench_lex_all_by_peek("lexer peek", ruyi_file_init_by_data(src, src_len), src_len);
+    ruyi_mem_free(src);
+}
+
+void bench_lexer_numbers(void) {
+    char *src = bench_corpus_make(Bench_corpus_NUMBER, BENCH_LEXER_SOURCE_SIZE, BENCH_CORPUS_SEED, NULL);
+    UINT32 src_len = (UINT32)strlen(src);
+    bench_lex_all("lexer numbers", ruyi_file_init_by_data(src, src_len), src_len);
+    ruyi_mem_free(src);
+}
+
+void bench_lexer_file_inputs(void) {
+    const char* file_name = "/tmp/ruyi_bench_lexer.ry";
+    char *src = bench_make_source(BENCH_LEXER_SOURCE_SIZE);
+    UINT32 src_len = (UINT32)strlen(src);
+    FILE *fp = fopen(file_name, "wb");
+    if (fp == NULL) {
+        ruyi_mem_free(src);
+        return;
+    }
+    fwrite(src, 1, src_len, fp);
+    fclose(fp);
+    ruyi_mem_free(src);
+    fp = fopen(file_name, "rb");
+    bench_lex_all("lexer file", ruyi_file_open_by_file(fp), src_len);
+    bench_lex_all("lexer mmap", ruyi_file_open_by_mmap(file_name), src_len);
+    remove(file_name);
+}
+
+// functions the parser accepts, repeated after a package line
+static char* bench_make_parser_source(UINT32 size, UINT32 *out_length) {
+    const char *head = "package bench\nimport fmt\nvar count int = 100\n";
+    const char *unit =
+    "func add(a int, b int) int {\n"
+    "    // adds two numbers\n"
+    "    c := a + b * 2 - (a % 3)\n"
+    "    if (c >= 10 && c != 0x1F) {\n"
+    "        return c << 1\n"
+    "    } else {\n"
+    "        name := \"hello, world\"\n"
+    "        return c\n"
+    "    }\n"
+    "}\n"
+    "/* loop */\n"
+    "func sum(n int) double {\n"
+    "    var s double = 0.5\n"
+    "    for (i := 0; i < n; i++) {\n"
+    "        s = s + i * 3.1415926\n"
+    "    }\n"
+    "    while (s > 100) { s = s / 2 }\n"
+    "    return s\n"
+    "}\n";
+    UINT32 head_length = (UINT32)strlen(head);
+    UINT32 unit_length = (UINT32)strlen(unit);
+    UINT32 length = head_length;
+    char *src = (char*)ruyi_mem_alloc(size + 1);
+    memcpy(src, head, head_length);
+    while (length + unit_length <= size) {
+        memcpy(src + length, unit, unit_length);
+        length += unit_length;
+    }
+    src[length] = '\0';
+    *out_length = length;
+    return src;
+}
+
+static double bench_parse_with_options(ruyi_lexer_reader *reader, UINT32 options) {
+    ruyi_ast *ast = NULL;
+    ruyi_error *err;
+    double begin = bench_now();
+    double seconds;
+    err = ruyi_parse_ast_with_options(reader, options, &ast);
+    seconds = bench_now() - begin;
+    ruyi_lexer_reader_close(reader);
+    if (err) {
+        printf("parse error: %s at line: %d, column: %d\n", err->message, err->line, err->column);
+        ruyi_error_destroy(err);
+        return 0;
+    }
+    ruyi_ast_destroy(ast);
+    return seconds;
+}
+
+static double bench_parse(ruyi_lexer_reader *reader) {
+    return bench_parse_with_options(reader, Ruyi_po_NONE);
+}
+
+/*
+ * Lexing and parsing timed apart: the whole file is tokenized first, then parsed from the token stream.
+ */
+void bench_parser_token_stream(void) {
+    UINT32 src_len;
+    char *src = bench_make_parser_source(BENCH_PARSER_SOURCE_SIZE, &src_len);
+    double mb = src_len / (1024.0 * 1024.0);
+    double begin, lex_seconds, walk_seconds, parse_seconds, reader_seconds;
+    ruyi_token_stream *stream;
+    ruyi_token_cursor cursor;
+    ruyi_token token;
+    UINT64 stream_bytes;
+    UINT32 i, lookahead = 0;
+    reader_seconds = bench_parse(ruyi_lexer_reader_open_with_options(ruyi_file_init_by_data(src, src_len), Ruyi_lo_SKIP_COMMENTS));
+    begin = bench_now();
+    stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, src_len), Ruyi_lo_SKIP_COMMENTS);
+    lex_seconds = bench_now() - begin;
+    ruyi_mem_free(src);
+    if (stream == NULL) {
+        printf("tokenize error\n");
+        return;
+    }
+    // the way a parser looks ahead: two types, then the token
+    begin = bench_now();
+    ruyi_token_cursor_init(&cursor, stream);
+    for (i = 0; i < stream->count; i++) {
+        lookahead += ruyi_token_cursor_peek(&cursor, 1) + ruyi_token_cursor_peek(&cursor, 2);
+        ruyi_token_cursor_get(&cursor, 0, &token);
+        ruyi_token_cursor_advance(&cursor, 1);
+    }
+    walk_seconds = bench_now() - begin;
+    parse_seconds = bench_parse(ruyi_lexer_reader_open_stream(stream));
+    stream_bytes = (UINT64)stream->count * (sizeof(BYTE) + 3 * sizeof(UINT32)) +
+        (UINT64)stream->literal_count * sizeof(ruyi_token_literal) + (UINT64)stream->lines->count * sizeof(UINT32);
+    printf("parser reader: %.2f MB, %.3f s, %.2f MB/s\n", mb, reader_seconds, mb / reader_seconds);
+    printf("lexer tokenize_all: %.2f MB, %u tokens, %.1f bytes/token, %.3f s, %.2f MB/s\n", mb, stream->count,
+           (double)stream_bytes / stream->count, lex_seconds, mb / lex_seconds);
+    printf("token cursor: %u tokens, %.3f s, %.1f M tokens/s (%u)\n", stream->count, walk_seconds,
+           stream->count / walk_seconds / 1e6, lookahead & 1);
+    printf("parser token stream: %.2f MB, %.3f s, %.2f MB/s, lex + parse %.3f s\n", mb, parse_seconds, mb / parse_seconds,
+           lex_seconds + parse_seconds);
+    ruyi_token_stream_destroy(stream);
+}
+
+// functions of long expressions mixing all levels of binary operators
+static char* bench_make_expression_source(UINT32 size, UINT32 *out_length) {
+    const char *head = "package bench\n";
+    const char *unit =
+    "func calc(a int, b int, c int) int {\n"
+    "    x := (a + b * c - a / 3 % b << 2) >> 1 + (a - b) * (c + 1)\n"
+    "    y := a < b && b <= c || a == c && b != 0 || (a & b | c) > 7 && -a >= !b\n"
+    "    z := x * y + a * b * c - x - y - 1 | a & b & c | x == y\n"
+    "    return x > y ? x + y * 2 : a * b + c / 2 - (x | y & z)\n"
+    "}\n";
+    UINT32 head_length = (UINT32)strlen(head);
+    UINT32 unit_length = (UINT32)strlen(unit);
+    UINT32 length = head_length;
+    char *src = (char*)ruyi_mem_alloc(size + 1);
+    memcpy(src, head, head_length);
+    while (length + unit_length <= size) {
+        memcpy(src + length, unit, unit_length);
+        length += unit_length;
+    }
+    src[length] = '\0';
+    *out_length = length;
+    return src;
+}
+
+/*
+ * Binary expressions of every level of operators, parsed from a token stream.
+ */
+void bench_parser_expressions(void) {
+    UINT32 src_len;
+    char *src = bench_make_expression_source(BENCH_PARSER_SOURCE_SIZE, &src_len);
+    double mb = src_len / (1024.0 * 1024.0);
+    double seconds;
+    ruyi_token_stream *stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, src_len), Ruyi_lo_SKIP_COMMENTS);
+    ruyi_mem_free(src);
+    if (stream == NULL) {
+        printf("tokenize error\n");
+        return;
+    }
+    seconds = bench_parse_with_options(ruyi_lexer_reader_open_stream(stream), Ruyi_po_NONE);
+    printf("parser expressions: %.2f MB, %u tokens, %.3f s (%.1f ns a token)\n", mb, stream->count,
+           seconds, seconds * 1e9 / stream->count);
+    ruyi_token_stream_destroy(stream);
+}
+
+static int bench_compare_double(const void *a, const void *b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/*
+ * Single char edits in the bodies of a file of 100k lines, each reparsed from the tree of the edit before.
+ * Each round replaces a digit, inserts a space and deletes it again, in random functions.
+ */
+void bench_parser_reparse(void) {
+    UINT32 src_len, lines = 0, unit_lines = 0, head_length, unit_length, units, i, k = 0;
+    char *src = bench_make_parser_source(BENCH_PARSER_SOURCE_SIZE, &src_len);
+    char *unit = strstr(src, "func add");
+    UINT32 digit = (UINT32)(strstr(unit, "b * 2") - unit) + 4;
+    double samples[BENCH_REPARSE_ROUNDS * 3];
+    double begin, parse_seconds, total = 0;
+    UINT64 seed = BENCH_CORPUS_SEED;
+    ruyi_source_edit edit;
+    ruyi_error *err = NULL;
+    ruyi_ast *ast = NULL;
+    ruyi_lexer_reader *reader;
+    char *edited;
+    head_length = (UINT32)(unit - src);
+    unit_length = (UINT32)(strstr(unit + 1, "func add") - unit);
+    for (i = 0; i < head_length; i++) {
+        lines += src[i] == '\n';
+    }
+    for (i = 0; i < unit_length; i++) {
+        unit_lines += unit[i] == '\n';
+    }
+    // the source is cut after the unit reaching the lines
+    units = (BENCH_REPARSE_LINES - lines + unit_lines - 1) / unit_lines;
+    assert(head_length + units * unit_length <= src_len);
+    src_len = head_length + units * unit_length;
+    lines += units * unit_lines;
+    // room for the inserted space
+    edited = (char*)ruyi_mem_alloc(src_len + 1);
+    memcpy(edited, src, src_len);
+    ruyi_mem_free(src);
+    begin = bench_now();
+    reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_view(edited, src_len), Ruyi_lo_SKIP_COMMENTS);
+    err = ruyi_parse_ast(reader, &ast);
+    ruyi_lexer_reader_close(reader);
+    parse_seconds = bench_now() - begin;
+    for (i = 0; i < BENCH_REPARSE_ROUNDS * 3 && err == NULL; i++) {
+        if (i % 3 != 2) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            k = head_length + (UINT32)((seed >> 33) % units) * unit_length + digit;
+        }
+        edit.offset = k;
+        switch (i % 3) {
+            case 0:
+                edited[k] = (char)('0' + i % 10);
+                edit.old_length = 1;
+                edit.new_length = 1;
+                break;
+            case 1:
+                memmove(edited + k + 1, edited + k, src_len - k);
+                edited[k] = ' ';
+                src_len++;
+                edit.old_length = 0;
+                edit.new_length = 1;
+                break;
+            default:
+                memmove(edited + k, edited + k + 1, src_len - k - 1);
+                src_len--;
+                edit.old_length = 1;
+                edit.new_length = 0;
+                break;
+        }
+        begin = bench_now();
+        err = ruyi_reparse_ast(&ast, (const BYTE*)edited, src_len, &edit, 1);
+        samples[i] = bench_now() - begin;
+        total += samples[i];
+    }
+    if (err) {
+        printf("parse error: %s at line: %d, column: %d\n", err->message, err->line, err->column);
+        ruyi_error_destroy(err);
+        ruyi_ast_destroy(ast);
+        ruyi_mem_free(edited);
+        return;
+    }
+    qsort(samples, i, sizeof(double), bench_compare_double);
+    printf("parser reparse: %u lines, %u declarations, whole parse %.3f s, %u single char edits, "
+           "mean %.1f us, median %.1f us, p99 %.1f us, max %.1f us\n", lines,
+           ruyi_ast_child_length(ruyi_ast_get_child(ast, 2)), parse_seconds, i, total / i * 1e6, samples[i / 2] * 1e6,
+           samples[i * 99 / 100] * 1e6, samples[i - 1] * 1e6);
+    ruyi_ast_destroy(ast);
+    ruyi_mem_free(edited);
+}
+
+/*
+ * A source found in the ast cache against the parse of it, a large file of functions.
+ * A hit is the key of the source and the mapped file, the tree is read in place.
+ */
+void bench_ast_cache(void) {
+    const char *dir = "/tmp";
+    UINT32 src_len;
+    char *src = bench_make_parser_source(BENCH_PARSER_SOURCE_SIZE, &src_len);
+    double mb = src_len / (1024.0 * 1024.0);
+    double begin, parse_seconds, miss_seconds, key_seconds, hit_seconds;
+    UINT64 key;
+    char path[64];
+    long file_size = 0;
+    ruyi_ast_tree *tree = NULL, *cached = NULL;
+    ruyi_lexer_reader *reader;
+    ruyi_error *err;
+    FILE *fp;
+    begin = bench_now();
+    key = ruyi_ast_cache_key((const BYTE*)src, src_len);
+    key_seconds = bench_now() - begin;
+    sprintf(path, "%s/%016llx.ast", dir, (unsigned long long)key);
+    remove(path);
+    begin = bench_now();
+    reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_view(src, src_len), Ruyi_lo_SKIP_COMMENTS);
+    err = ruyi_parse_ast_tree(reader, &tree);
+    ruyi_lexer_reader_close(reader);
+    parse_seconds = bench_now() - begin;
+    if (err == NULL) {
+        ruyi_ast_tree_destroy(tree);
+        begin = bench_now();
+        err = ruyi_ast_cache_parse(dir, (const BYTE*)src, src_len, &tree);
+        miss_seconds = bench_now() - begin;
+    }
+    if (err) {
+        printf("parse error: %s at line: %d, column: %d\n", err->message, err->line, err->column);
+        ruyi_error_destroy(err);
+        ruyi_mem_free(src);
+        return;
+    }
+    begin = bench_now();
+    err = ruyi_ast_cache_parse(dir, (const BYTE*)src, src_len, &cached);
+    hit_seconds = bench_now() - begin;
+    if (err == NULL && cached->image == NULL) {
+        printf("ast cache: %s is not saved\n", path);
+    }
+    if ((fp = fopen(path, "rb")) != NULL) {
+        fseek(fp, 0, SEEK_END);
+        file_size = ftell(fp);
+        fclose(fp);
+    }
+    printf("ast cache: %.2f MB, %u nodes, file %.2f MB, parse %.3f s, miss %.3f s, hit %.4f s (key %.4f s), %.1fx\n", mb,
+           tree->node_count, file_size / (1024.0 * 1024.0), parse_seconds, miss_seconds, hit_seconds, key_seconds,
+           parse_seconds / hit_seconds);
+    ruyi_ast_tree_destroy(tree);
+    ruyi_ast_tree_destroy(cached);
+    remove(path);
+    ruyi_mem_free(src);
+}
+
+/*
+ * The global declarations parsed on some threads against one, from the same token stream.
+ * The threads past the count of cpus show the cost of the runs, not a speedup.
+ */
+void bench_parser_parallel(void) {
+    static const UINT32 thread_counts[] = {2, 4, 8, 16};
+    UINT32 src_len;
+    char *src = bench_make_parser_source(BENCH_PARSER_SOURCE_SIZE, &src_len);
+    double mb = src_len / (1024.0 * 1024.0);
+    double begin, seconds, one_seconds;
+    ruyi_token_stream *stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, src_len), Ruyi_lo_SKIP_COMMENTS);
+    ruyi_ast *ast = NULL;
+    ruyi_error *err;
+    UINT32 i;
+    ruyi_mem_free(src);
+    if (stream == NULL) {
+        printf("tokenize error\n");
+        return;
+    }
+    one_seconds = bench_parse(ruyi_lexer_reader_open_stream(stream));
+    printf("parser parallel: %.2f MB, %u tokens, %u cpus, 1 thread %.3f s\n", mb, stream->count, ruyi_jobs_cpu_count(),
+           one_seconds);
+    for (i = 0; i < sizeof(thread_counts) / sizeof(*thread_counts); i++) {
+        begin = bench_now();
+        err = ruyi_parse_ast_parallel(stream, thread_counts[i], &ast);
+        seconds = bench_now() - begin;
+        if (err) {
+            printf("parse error: %s at line: %d, column: %d\n", err->message, err->line, err->column);
+            ruyi_error_destroy(err);
+            break;
+        }
+        ruyi_ast_destroy(ast);
+        printf("parser parallel: %u threads %.3f s, %.1fx\n", thread_counts[i], seconds, one_seconds / seconds);
+    }
+    ruyi_token_stream_destroy(stream);
+}
+
+// parse each step-th lazy body of an ast in place, counted from *seen
+static UINT32 bench_expand_lazy_bodies(ruyi_ast *ast, UINT32 step, UINT32 *seen) {
+    UINT32 expanded = 0;
+    UINT32 i;
+    if (ast == NULL) {
+        return 0;
+    }
+    if (ast->adt_type == Ruyi_adt_lazy_body) {
+        if ((*seen)++ % step == 0 && ruyi_parse_lazy_body(ast) == NULL) {
+            expanded++;
+        }
+        return expanded;
+    }
+    for (i = 0; i < ast->child_count; i++) {
+        expanded += bench_expand_lazy_bodies(ast->children[i], step, seen);
+    }
+    return expanded;
+}
+
+/*
+ * Function bodies kept as token spans: the parse of the whole file, then the bodies a slice of the file needs.
+ */
+void bench_parser_lazy_bodies(void) {
+    static const UINT32 steps[] = {100, 10, 1};
+    UINT32 src_len;
+    char *src = bench_make_parser_source(BENCH_PARSER_SOURCE_SIZE, &src_len);
+    double begin, eager_seconds, lazy_seconds, seconds;
+    ruyi_token_stream *stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, src_len), Ruyi_lo_SKIP_COMMENTS);
+    ruyi_lexer_reader *reader;
+    ruyi_ast *ast = NULL;
+    ruyi_error *err;
+    UINT64 eager_size, lazy_size;
+    UINT32 seen, expanded, i;
+    ruyi_mem_free(src);
+    if (stream == NULL) {
+        printf("tokenize error\n");
+        return;
+    }
+    reader = ruyi_lexer_reader_open_stream(stream);
+    begin = bench_now();
+    err = ruyi_parse_ast(reader, &ast);
+    eager_seconds = bench_now() - begin;
+    ruyi_lexer_reader_close(reader);
+    if (err) {
+        printf("parse error: %s at line: %d, column: %d\n", err->message, err->line, err->column);
+        ruyi_error_destroy(err);
+        ruyi_token_stream_destroy(stream);
+        return;
+    }
+    eager_size = ((ruyi_ast_root_data*)ast->data.ptr_value)->tree_size;
+    ruyi_ast_destroy(ast);
+    printf("parser lazy bodies: %.2f MB, eager %.3f s, %.2f MB of nodes\n", src_len / (1024.0 * 1024.0), eager_seconds,
+           eager_size / (1024.0 * 1024.0));
+    for (i = 0; i < sizeof(steps) / sizeof(*steps); i++) {
+        reader = ruyi_lexer_reader_open_stream(stream);
+        begin = bench_now();
+        err = ruyi_parse_ast_with_options(reader, Ruyi_po_LAZY_BODIES, &ast);
+        lazy_seconds = bench_now() - begin;
+        ruyi_lexer_reader_close(reader);
+        if (err) {
+            printf("parse error: %s at line: %d, column: %d\n", err->message, err->line, err->column);
+            ruyi_error_destroy(err);
+            break;
+        }
+        lazy_size = ((ruyi_ast_root_data*)ast->data.ptr_value)->tree_size;
+        seen = 0;
+        begin = bench_now();
+        expanded = bench_expand_lazy_bodies(ast, steps[i], &seen);
+        seconds = bench_now() - begin;
+        printf("parser lazy bodies: lazy %.3f s, %.2f MB of nodes, %u of %u bodies parsed %.3f s, total %.1fx of eager\n",
+               lazy_seconds, lazy_size / (1024.0 * 1024.0), expanded, seen, seconds, (lazy_seconds + seconds) / eager_seconds);
+        ruyi_ast_destroy(ast);
+    }
+    ruyi_token_stream_destroy(stream);
+}
+
+static UINT32 bench_count_nodes(const ruyi_ast_tree *tree, ruyi_ast_id id) {
+    UINT32 count = 1;
+    UINT32 i, length = ruyi_ast_tree_child_length(tree, id);
+    ruyi_ast_id child;
+    for (i = 0; i < length; i++) {
+        if ((child = ruyi_ast_tree_get_child(tree, id, i)) != RUYI_AST_NONE) {
+            count += bench_count_nodes(tree, child);
+        }
+    }
+    return count;
+}
+
+static ruyi_error* bench_count_node(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    (*(UINT32*)ruyi_ast_walker_context(walker))++;
+    return NULL;
+}
+
+/*
+ * The walker against recursion on the same flat tree, and the ruyi_ast passes made by it.
+ */
+void bench_ast_walker(void) {
+    static const ruyi_ast_visitor visitor = {.pre_default = bench_count_node};
+    UINT32 src_len;
+    char *src = bench_make_parser_source(BENCH_PARSER_SOURCE_SIZE, &src_len);
+    ruyi_lexer_reader *reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_data(src, src_len), Ruyi_lo_SKIP_COMMENTS);
+    ruyi_ast *ast = NULL;
+    ruyi_ast_tree *tree;
+    ruyi_ast_walker *walker;
+    ruyi_error *err;
+    UINT32 count, walked = 0;
+    double begin, recursive_seconds, walk_seconds, flatten_seconds;
+    err = ruyi_parse_ast(reader, &ast);
+    ruyi_lexer_reader_close(reader);
+    ruyi_mem_free(src);
+    if (err) {
+        printf("parse error: %s at line: %d, column: %d\n", err->message, err->line, err->column);
+        ruyi_error_destroy(err);
+        return;
+    }
+    begin = bench_now();
+    tree = ruyi_ast_tree_create(ast);
+    flatten_seconds = bench_now() - begin;
+    ruyi_ast_destroy(ast);
+    begin = bench_now();
+    count = bench_count_nodes(tree, ruyi_ast_tree_root(tree));
+    recursive_seconds = bench_now() - begin;
+    walker = ruyi_ast_walker_create(&visitor, &walked);
+    begin = bench_now();
+    ruyi_ast_walk_tree(walker, tree, ruyi_ast_tree_root(tree), NULL);
+    walk_seconds = bench_now() - begin;
+    ruyi_ast_walker_destroy(walker);
+    printf("ast walker: %u nodes, flatten %.3f s, count by recursion %.3f s, by walker %.3f s (%u), %.1f ns a node\n",
+           count, flatten_seconds, recursive_seconds, walk_seconds, walked, walk_seconds * 1e9 / walked);
+    ruyi_ast_tree_destroy(tree);
+}
+
+/*
+ * Choices by the first tokens of syntax.txt, a source of every kind of statement parsed from a token stream.
+ */
+void bench_parser_first_tokens(void) {
+    UINT32 src_len;
+    char *src = bench_make_parser_source(BENCH_PARSER_SOURCE_SIZE, &src_len);
+    double mb = src_len / (1024.0 * 1024.0);
+    double seconds;
+    ruyi_token_stream *stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, src_len), Ruyi_lo_SKIP_COMMENTS);
+    ruyi_mem_free(src);
+    if (stream == NULL) {
+        printf("tokenize error\n");
+        return;
+    }
+    seconds = bench_parse_with_options(ruyi_lexer_reader_open_stream(stream), Ruyi_po_NONE);
+    printf("parser first tokens: %.2f MB, %u tokens, %.3f s (%.1f ns a token)\n", mb, stream->count,
+           seconds, seconds * 1e9 / stream->count);
+    ruyi_token_stream_destroy(stream);
+}
+
+static void bench_utf8_decode(const char *name, const BYTE *src, UINT32 src_len) {
+    WIDE_CHAR out[4096];
+    UINT32 pos, used, count, round;
+    UINT64 char_count = 0;
+    UINT64 error_count = 0;
+    double begin, seconds;
+    begin = bench_now();
+    for (round = 0; round < BENCH_UTF8_ROUNDS; round++) {
+        pos = 0;
+        while (pos < src_len) {
+            count = ruyi_unicode_decode_utf8(src + pos, src_len - pos, &used, out, sizeof(out) / sizeof(*out));
+            if (count == 0) {
+                // skip the broken byte
+                error_count++;
+                used = 1;
+            }
+            char_count += count;
+            pos += used;
+        }
+    }
+    seconds = bench_now() - begin;
+    printf("utf8 %s: %.2f MB, %llu chars, %llu errors, %.3f s, %.2f MB/s\n", name, src_len / (1024.0 * 1024.0),
+           (unsigned long long)char_count, (unsigned long long)error_count, seconds,
+           (double)src_len * BENCH_UTF8_ROUNDS / (1024.0 * 1024.0) / seconds);
+}
+
+void bench_unicode_decode(void) {
+    const char* cjk_unit = "func 计算(数值 int) int { return 数值 * 2 } // 中文注释\n";
+    BYTE *src = (BYTE*)bench_make_source(BENCH_UTF8_SOURCE_SIZE);
+    UINT32 src_len = (UINT32)strlen((char*)src);
+    UINT32 unit_len = (UINT32)strlen(cjk_unit);
+    UINT32 pos;
+    bench_utf8_decode("ascii", src, src_len);
+    for (pos = 0; pos + unit_len <= src_len; pos += unit_len) {
+        memcpy(src + pos, cjk_unit, unit_len);
+    }
+    src_len = pos;
+    bench_utf8_decode("cjk", src, src_len);
+    ruyi_mem_free(src);
+    src = (BYTE*)bench_make_source(BENCH_UTF8_SOURCE_SIZE);
+    src_len = (UINT32)strlen((char*)src);
+    for (pos = 0; pos < src_len; pos += 997) {
+        src[pos] = 0xFF;
+    }
+    bench_utf8_decode("invalid", src, src_len);
+    ruyi_mem_free(src);
+}
+
+typedef enum {
+    Bench_input_DATA,   // ruyi_file_init_by_data
+    Bench_input_FILE,   // ruyi_file_open_by_file
+    Bench_input_MMAP,   // ruyi_file_open_by_mmap
+    Bench_input_PIPE,   // ruyi_file_open_by_file of a pipe, fed by a writer process
+    Bench_input_COUNT
+} bench_input;
+
+static const char* g_bench_input_names[Bench_input_COUNT] = {"data", "file", "mmap", "pipe"};
+
+typedef struct {
+    INT32 shape;        // -1 means all shapes
+    INT32 input;        // -1 means all inputs
+    UINT32 size;
+    UINT64 seed;
+    const char *path;   // temp file for file, mmap and pipe inputs
+    UINT32 lexer_options;
+    INT32 threads;      // -1 means the reader, otherwise ruyi_lexer_tokenize_parallel with the threads, 0 is one per cpu
+} bench_lexer_options;
+
+// peak resident set size of this process in KB
+static UINT64 bench_peak_rss_kb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return (UINT64)usage.ru_maxrss / 1024;
+#else
+    return (UINT64)usage.ru_maxrss;
+#endif
+}
+
+// a writer process copying the file at path to a pipe, returns the read end
+static FILE* bench_open_pipe(const char *path, pid_t *writer) {
+    char buf[64 * 1024];
+    int fds[2];
+    FILE *fp;
+    size_t read_count;
+    if (pipe(fds) != 0) {
+        return NULL;
+    }
+    *writer = fork();
+    if (*writer < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return NULL;
+    }
+    if (*writer == 0) {
+        close(fds[0]);
+        fp = fopen(path, "rb");
+        if (fp == NULL) {
+            _exit(1);
+        }
+        while ((read_count = fread(buf, 1, sizeof(buf), fp)) > 0) {
+            if (write(fds[1], buf, read_count) != (ssize_t)read_count) {
+                _exit(1);
+            }
+        }
+        fclose(fp);
+        _exit(0);
+    }
+    close(fds[1]);
+    return fdopen(fds[0], "rb");
+}
+
+/*
+ * Runs one case in a child process, so the peak RSS is of this case only.
+ * src is only needed by the data input, it is NULL for the others.
+ */
+static void bench_lexer_case(const bench_lexer_options *options, bench_corpus_shape shape, bench_input input, const char *src, UINT32 src_len) {
+    bench_lex_result result;
+    ruyi_file *file = NULL;
+    FILE *fp;
+    pid_t pid;
+    pid_t writer = -1;
+    int status;
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0) {
+        return;
+    }
+    if (pid > 0) {
+        waitpid(pid, &status, 0);
+        return;
+    }
+    switch (input) {
+        case Bench_input_DATA:
+            file = ruyi_file_init_by_data(src, src_len);
+            break;
+        case Bench_input_FILE:
+            fp = fopen(options->path, "rb");
+            file = fp ? ruyi_file_open_by_file(fp) : NULL;
+            break;
+        case Bench_input_MMAP:
+            file = ruyi_file_open_by_mmap(options->path);
+            break;
+        case Bench_input_PIPE:
+            fp = bench_open_pipe(options->path, &writer);
+            file = fp ? ruyi_file_open_by_file(fp) : NULL;
+            break;
+        default:
+            break;
+    }
+    if (file == NULL) {
+        _exit(1);
+    }
+    if (options->threads < 0) {
+        result = bench_lex_to_end(file, options->lexer_options);
+    } else {
+        result = bench_tokenize_parallel(file, options->lexer_options, (UINT32)options->threads);
+    }
+    if (writer > 0) {
+        waitpid(writer, NULL, 0);
+    }
+    printf("{\"bench\": \"lexer\", \"shape\": \"%s\", \"input\": \"%s\", \"bytes\": %u, \"tokens\": %llu, "
+           "\"seconds\": %.6f, \"mb_per_s\": %.2f, \"tokens_per_s\": %.0f, \"allocs_per_token\": %.6f, "
+           "\"peak_rss_kb\": %llu, \"skip_comments\": %s, \"threads\": %d, \"ok\": %s}\n",
+           bench_corpus_shape_name(shape), g_bench_input_names[input], src_len, (unsigned long long)result.token_count,
+           result.seconds, src_len / (1024.0 * 1024.0) / result.seconds, result.token_count / result.seconds,
+           result.token_count ? (double)result.alloc_count / result.token_count : 0.0,
+           (unsigned long long)bench_peak_rss_kb(), (options->lexer_options & Ruyi_lo_SKIP_COMMENTS) ? "true" : "false",
+           options->threads, result.ok ? "true" : "false");
+    fflush(stdout);
+    _exit(0);
+}
+
+static void bench_lexer_shape(const bench_lexer_options *options, bench_corpus_shape shape) {
+    UINT32 src_len;
+    char *src = bench_corpus_make(shape, options->size, options->seed, &src_len);
+    FILE *fp;
+    if (options->input < 0 || options->input == Bench_input_DATA) {
+        bench_lexer_case(options, shape, Bench_input_DATA, src, src_len);
+    }
+    if (options->input != Bench_input_DATA) {
+        fp = fopen(options->path, "wb");
+        if (fp == NULL) {
+            ruyi_mem_free(src);
+            return;
+        }
+        fwrite(src, 1, src_len, fp);
+        fclose(fp);
+        // the source is not needed by the children any more, do not count it in their peak RSS
+        ruyi_mem_free(src);
+        src = NULL;
+        if (options->input < 0 || options->input == Bench_input_FILE) {
+            bench_lexer_case(options, shape, Bench_input_FILE, NULL, src_len);
+        }
+        if (options->input < 0 || options->input == Bench_input_MMAP) {
+            bench_lexer_case(options, shape, Bench_input_MMAP, NULL, src_len);
+        }
+        if (options->input < 0 || options->input == Bench_input_PIPE) {
+            bench_lexer_case(options, shape, Bench_input_PIPE, NULL, src_len);
+        }
+        remove(options->path);
+    }
+    if (src) {
+        ruyi_mem_free(src);
+    }
+}
+
+static void bench_lexer_usage(void) {
+    UINT32 i;
+    printf("usage: ruyi_bench [--shape=all");
+    for (i = 0; i < Bench_corpus_COUNT; i++) {
+        printf("|%s", bench_corpus_shape_name((bench_corpus_shape)i));
+    }
+    printf("] [--input=all|data|file|mmap|pipe] [--size=MB] [--seed=N] [--path=TEMP_FILE] [--skip-comments] [--threads=N]\n");
+}
+
+int run_bench_lexer(int argc, const char *argv[]) {
+    bench_lexer_options options;
+    const char *arg;
+    INT32 i;
+    UINT32 shape;
+    options.shape = -1;
+    options.input = -1;
+    options.size = BENCH_LEXER_SOURCE_SIZE;
+    options.seed = BENCH_CORPUS_SEED;
+    options.path = "/tmp/ruyi_bench_lexer.ry";
+    options.lexer_options = Ruyi_lo_NONE;
+    options.threads = -1;
+    for (i = 0; i < argc; i++) {
+        arg = argv[i];
+        if (strncmp(arg, "--shape=", 8) == 0) {
+            if (strcmp(arg + 8, "all") != 0) {
+                options.shape = bench_corpus_shape_by_name(arg + 8);
+                if (options.shape == Bench_corpus_COUNT) {
+                    bench_lexer_usage();
+                    return 1;
+                }
+            }
+        } else if (strncmp(arg, "--input=", 8) == 0) {
+            if (strcmp(arg + 8, "all") != 0) {
+                for (options.input = 0; options.input < Bench_input_COUNT; options.input++) {
+                    if (strcmp(arg + 8, g_bench_input_names[options.input]) == 0) {
+                        break;
+                    }
+                }
+                if (options.input == Bench_input_COUNT) {
+                    bench_lexer_usage();
+                    return 1;
+                }
+            }
+        } else if (strncmp(arg, "--size=", 7) == 0) {
+            // in MB, up to 2 GB so the length fits in UINT32
+            options.size = (UINT32)(atof(arg + 7) * 1024 * 1024);
+            if (options.size == 0 || atof(arg + 7) >= 2048) {
+                bench_lexer_usage();
+                return 1;
+            }
+        } else if (strncmp(arg, "--seed=", 7) == 0) {
+            options.seed = strtoull(arg + 7, NULL, 10);
+        } else if (strncmp(arg, "--path=", 7) == 0) {
+            options.path = arg + 7;
+        } else if (strcmp(arg, "--skip-comments") == 0) {
+            options.lexer_options |= Ruyi_lo_SKIP_COMMENTS;
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            // the whole file is tokenized at once, only data and mmap inputs are cut for the threads
+            options.threads = atoi(arg + 10);
+            if (options.threads < 0) {
+                bench_lexer_usage();
+                return 1;
+            }
+        } else {
+            bench_lexer_usage();
+            return 1;
+        }
+    }
+    for (shape = 0; shape < Bench_corpus_COUNT; shape++) {
+        if (options.shape < 0 || options.shape == (INT32)shape) {
+            bench_lexer_shape(&options, (bench_corpus_shape)shape);
+        }
+    }
+    return 0;
+}
+
+void run_bench_cases(void) {
+    bench_lexer_throughput();
+    bench_lexer_numbers();
+    bench_lexer_file_inputs();
+    bench_unicode_decode();
+    bench_parser_token_stream();
+    bench_parser_expressions();
+    bench_parser_reparse();
+    bench_ast_cache();
+    bench_parser_parallel();
+    bench_parser_lazy_bodies();
+    bench_ast_walker();
+    bench_parser_first_tokens();
+}
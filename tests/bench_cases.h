@@ -0,0 +1,20 @@
+//
+//  bench_cases.h
+//  ruyi
+//
+
+#ifndef bench_cases_h
+#define bench_cases_h
+
+void run_bench_cases(void);
+
+/**
+ * The lexer benchmark over generated sources, one line of JSON for each shape and input.
+ * params:
+ * argc, argv - the options without the program name, see bench_lexer_usage in bench_cases.c
+ * return:
+ * 0 if the options are valid
+ */
+int run_bench_lexer(int argc, const char *argv[]);
+
+#endif /* bench_cases_h */
@@ -0,0 +1,252 @@
+//
+//  bench_corpus.c
+//  ruyi
+//
+
+#include "bench_corpus.h"
+#include <stdio.h>
+#include <string.h>
+#include "../src/ruyi_mem.h"
+
+typedef struct {
+    char *data;
+    UINT32 length;
+    UINT32 size;        // max length of the source
+    UINT32 line_start;  // length before the line being built
+    UINT64 seed;
+} bench_corpus_builder;
+
+static const char* g_bench_corpus_names[Bench_corpus_COUNT] = {
+    "mixed", "identifier", "operator", "string", "comment", "cjk", "number",
+};
+
+static const char* g_bench_corpus_mixed_unit =
+"package bench.lexer\n"
+"import fmt\n"
+"var count int = 100\n"
+"var ratio double = 3.1415926\n"
+"/* multi lines\n   comments */\n"
+"func add(a int, b int) int {\n"
+"    // adds two numbers\n"
+"    c := a + b * 2 - (a % 3)\n"
+"    if c >= 10 && c != 0x1F {\n"
+"        return c << 1\n"
+"    } else {\n"
+"        name := \"hello, world\"\n"
+"        return c\n"
+"    }\n"
+"}\n";
+
+static const char* g_bench_corpus_keywords[] = {
+    "if", "else", "while", "for", "return", "func", "var", "int", "long", "float", "double", "new", "this", "true",
+    "false", "null", "break", "continue", "switch", "case", "default", "class", "static", "const", "import",
+};
+
+static const char* g_bench_corpus_operators[] = {
+    "+", "-", "*", "/", "%", "++", "--", "+=", "-=", "*=", "/=", "%=", "==", "!=", "<", "<=", ">", ">=", "<<",
+    ">>", "<<=", ">>=", "&&", "||", "!", "~", "^", "&", "|", "&=", "|=", "^=", "(", ")", "[", "]", "{", "}", ",",
+    ";", ":", ":=", "?", ".", "...", "=",
+};
+
+static const char* g_bench_corpus_words[] = {
+    "the", "lexer", "reads", "tokens", "from", "source", "each", "line", "is", "a", "comment", "about", "nothing",
+    "special", "just", "words", "to", "skip", "over", "quickly",
+};
+
+static const char* g_bench_corpus_escapes[] = {"\\n", "\\t", "\\\"", "\\\\", "\\'", "\\r"};
+
+static const char* g_bench_corpus_cjk_words[] = {
+    "数值", "计算", "结果", "名字", "列表", "索引", "长度", "总和", "函数", "变量", "中文注释", "你好世界",
+};
+
+static const char* g_bench_corpus_numbers[] = {
+    "0", "7", "42", "65535", "9223372036854775807", "0x7F", "0xDEADBEEF", "0b1011", "0777", "12e3", "0.5",
+    "3.1415926", "2.718281828459045", ".125", "1.", "6.02214076e23", "1.602176634e-19", "4.9e-324",
+    "1.7976931348623157e308", "0.1", "0.30000000000000004", "123456789.987654321", "5e-3", "1e-7",
+    "9007199254740993", "2.2250738585072014e-308", "1234567890123456789012.5",
+};
+
+#define BENCH_CORPUS_COUNT_OF(array) (sizeof(array) / sizeof(*(array)))
+
+static UINT32 bench_corpus_random(bench_corpus_builder *builder, UINT32 n) {
+    // PCG style LCG, the high bits are good enough for picking words
+    builder->seed = builder->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (UINT32)((builder->seed >> 33) % n);
+}
+
+// FALSE if the source is full, the line being built is dropped then
+static BOOL bench_corpus_append(bench_corpus_builder *builder, const char *text) {
+    UINT32 length = (UINT32)strlen(text);
+    if (builder->length + length > builder->size) {
+        builder->length = builder->line_start;
+        return FALSE;
+    }
+    memcpy(builder->data + builder->length, text, length);
+    builder->length += length;
+    return TRUE;
+}
+
+static BOOL bench_corpus_end_line(bench_corpus_builder *builder) {
+    if (!bench_corpus_append(builder, "\n")) {
+        return FALSE;
+    }
+    builder->line_start = builder->length;
+    return TRUE;
+}
+
+static BOOL bench_corpus_identifier(bench_corpus_builder *builder) {
+    static const char first_chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+    char name[20];
+    UINT32 length = 1 + bench_corpus_random(builder, 16);
+    UINT32 i;
+    name[0] = first_chars[bench_corpus_random(builder, sizeof(first_chars) - 1)];
+    for (i = 1; i < length; i++) {
+        name[i] = chars[bench_corpus_random(builder, sizeof(chars) - 1)];
+    }
+    name[length] = '\0';
+    return bench_corpus_append(builder, name);
+}
+
+static BOOL bench_corpus_line(bench_corpus_builder *builder, bench_corpus_shape shape) {
+    UINT32 i, count;
+    char buf[8];
+    switch (shape) {
+        case Bench_corpus_MIXED:
+            if (!bench_corpus_append(builder, g_bench_corpus_mixed_unit)) {
+                return FALSE;
+            }
+            builder->line_start = builder->length;
+            return TRUE;
+        case Bench_corpus_IDENTIFIER:
+            count = 4 + bench_corpus_random(builder, 8);
+            for (i = 0; i < count; i++) {
+                if (bench_corpus_random(builder, 4) == 0) {
+                    if (!bench_corpus_append(builder, g_bench_corpus_keywords[bench_corpus_random(builder, BENCH_CORPUS_COUNT_OF(g_bench_corpus_keywords))])) {
+                        return FALSE;
+                    }
+                } else if (!bench_corpus_identifier(builder)) {
+                    return FALSE;
+                }
+                if (!bench_corpus_append(builder, " ")) {
+                    return FALSE;
+                }
+            }
+            return bench_corpus_end_line(builder);
+        case Bench_corpus_OPERATOR:
+            count = 8 + bench_corpus_random(builder, 16);
+            for (i = 0; i < count; i++) {
+                if (!bench_corpus_append(builder, g_bench_corpus_operators[bench_corpus_random(builder, BENCH_CORPUS_COUNT_OF(g_bench_corpus_operators))])) {
+                    return FALSE;
+                }
+                // a space keeps the operators apart, otherwise they would join into longer ones
+                if (!bench_corpus_append(builder, bench_corpus_random(builder, 3) == 0 ? " a " : " ")) {
+                    return FALSE;
+                }
+            }
+            return bench_corpus_end_line(builder);
+        case Bench_corpus_STRING:
+            if (!bench_corpus_append(builder, "s := \"")) {
+                return FALSE;
+            }
+            count = 4 + bench_corpus_random(builder, 24);
+            for (i = 0; i < count; i++) {
+                if (bench_corpus_random(builder, 6) == 0) {
+                    if (!bench_corpus_append(builder, g_bench_corpus_escapes[bench_corpus_random(builder, BENCH_CORPUS_COUNT_OF(g_bench_corpus_escapes))])) {
+                        return FALSE;
+                    }
+                } else if (!bench_corpus_append(builder, g_bench_corpus_words[bench_corpus_random(builder, BENCH_CORPUS_COUNT_OF(g_bench_corpus_words))]) ||
+                           !bench_corpus_append(builder, " ")) {
+                    return FALSE;
+                }
+            }
+            buf[0] = '\'';
+            buf[1] = (char)('a' + bench_corpus_random(builder, 26));
+            buf[2] = '\'';
+            buf[3] = '\0';
+            return bench_corpus_append(builder, "\" + ") && bench_corpus_append(builder, buf) &&
+                bench_corpus_append(builder, " + '\\n'") && bench_corpus_end_line(builder);
+        case Bench_corpus_COMMENT:
+            if (bench_corpus_random(builder, 3) == 0) {
+                if (!bench_corpus_append(builder, "/*")) {
+                    return FALSE;
+                }
+                count = 8 + bench_corpus_random(builder, 32);
+                for (i = 0; i < count; i++) {
+                    if (!bench_corpus_append(builder, i % 8 == 7 ? "\n * " : " ") ||
+                        !bench_corpus_append(builder, g_bench_corpus_words[bench_corpus_random(builder, BENCH_CORPUS_COUNT_OF(g_bench_corpus_words))])) {
+                        return FALSE;
+                    }
+                }
+                return bench_corpus_append(builder, " */") && bench_corpus_end_line(builder);
+            }
+            if (!bench_corpus_append(builder, "x := 1 //")) {
+                return FALSE;
+            }
+            count = 4 + bench_corpus_random(builder, 12);
+            for (i = 0; i < count; i++) {
+                if (!bench_corpus_append(builder, " ") ||
+                    !bench_corpus_append(builder, g_bench_corpus_words[bench_corpus_random(builder, BENCH_CORPUS_COUNT_OF(g_bench_corpus_words))])) {
+                    return FALSE;
+                }
+            }
+            return bench_corpus_end_line(builder);
+        case Bench_corpus_CJK:
+            return bench_corpus_append(builder, "func ") &&
+                bench_corpus_append(builder, g_bench_corpus_cjk_words[bench_corpus_random(builder, BENCH_CORPUS_COUNT_OF(g_bench_corpus_cjk_words))]) &&
+                bench_corpus_append(builder, "(") &&
+                bench_corpus_append(builder, g_bench_corpus_cjk_words[bench_corpus_random(builder, BENCH_CORPUS_COUNT_OF(g_bench_corpus_cjk_words))]) &&
+                bench_corpus_append(builder, " int) int { return \"") &&
+                bench_corpus_append(builder, g_bench_corpus_cjk_words[bench_corpus_random(builder, BENCH_CORPUS_COUNT_OF(g_bench_corpus_cjk_words))]) &&
+                bench_corpus_append(builder, "\" } // ") &&
+                bench_corpus_append(builder, g_bench_corpus_cjk_words[bench_corpus_random(builder, BENCH_CORPUS_COUNT_OF(g_bench_corpus_cjk_words))]) &&
+                bench_corpus_end_line(builder);
+        case Bench_corpus_NUMBER:
+            if (!bench_corpus_append(builder, "var a = [")) {
+                return FALSE;
+            }
+            count = 4 + bench_corpus_random(builder, 8);
+            for (i = 0; i < count; i++) {
+                if (!bench_corpus_append(builder, i == 0 ? "" : ", ") ||
+                    !bench_corpus_append(builder, g_bench_corpus_numbers[bench_corpus_random(builder, BENCH_CORPUS_COUNT_OF(g_bench_corpus_numbers))])) {
+                    return FALSE;
+                }
+            }
+            return bench_corpus_append(builder, "]") && bench_corpus_end_line(builder);
+        default:
+            return FALSE;
+    }
+}
+
+const char* bench_corpus_shape_name(bench_corpus_shape shape) {
+    if (shape >= Bench_corpus_COUNT) {
+        return NULL;
+    }
+    return g_bench_corpus_names[shape];
+}
+
+bench_corpus_shape bench_corpus_shape_by_name(const char *name) {
+    UINT32 i;
+    for (i = 0; i < Bench_corpus_COUNT; i++) {
+        if (strcmp(name, g_bench_corpus_names[i]) == 0) {
+            return (bench_corpus_shape)i;
+        }
+    }
+    return Bench_corpus_COUNT;
+}
+
+char* bench_corpus_make(bench_corpus_shape shape, UINT32 size, UINT64 seed, UINT32 *out_length) {
+    bench_corpus_builder builder;
+    builder.data = (char*)ruyi_mem_alloc(size + 1);
+    builder.length = 0;
+    builder.size = size;
+    builder.line_start = 0;
+    builder.seed = seed;
+    while (bench_corpus_line(&builder, shape)) {
+    }
+    builder.data[builder.length] = '\0';
+    if (out_length) {
+        *out_length = builder.length;
+    }
+    return builder.data;
+}
@@ -0,0 +1,46 @@
+//
+//  bench_corpus.h
+//  ruyi
+//
+
+#ifndef bench_corpus_h
+#define bench_corpus_h
+
+#include "../src/ruyi_basics.h"
+
+typedef enum {
+    Bench_corpus_MIXED,         // a small function repeated, the default shape since the first benchmark
+    Bench_corpus_IDENTIFIER,    // mostly identifiers and keywords
+    Bench_corpus_OPERATOR,      // mostly operators and delimiters
+    Bench_corpus_STRING,        // string and char literals with escapes
+    Bench_corpus_COMMENT,       // line and block comments
+    Bench_corpus_CJK,           // CJK identifiers, strings and comments
+    Bench_corpus_NUMBER,        // every shape of number literal
+    Bench_corpus_COUNT
+} bench_corpus_shape;
+
+/**
+ * Get the name of a shape, e.g. "identifier"
+ */
+const char* bench_corpus_shape_name(bench_corpus_shape shape);
+
+/**
+ * Find a shape by name
+ * return:
+ * the shape, Bench_corpus_COUNT if no shape has the name
+ */
+bench_corpus_shape bench_corpus_shape_by_name(const char *name);
+
+/**
+ * Generate a ruyi source, the same shape, size and seed always give the same source.
+ * params:
+ * shape - shape of the source
+ * size - max bytes of the source, it always ends with a whole line
+ * seed - seed of the random choices
+ * out_length - bytes of the source
+ * return:
+ * the source ending with '\0', release it by ruyi_mem_free
+ */
+char* bench_corpus_make(bench_corpus_shape shape, UINT32 size, UINT64 seed, UINT32 *out_length);
+
+#endif /* bench_corpus_h */
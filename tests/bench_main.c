@@ -0,0 +1,15 @@
+//
+//  bench_main.c
+//  ruyi
+//
+//  The standalone lexer benchmark, it is built without src/main.c:
+//  cc -O2 src/ruyi_*.c tests/bench_*.c -o ruyi_bench -lpthread -lm
+//  ./ruyi_bench --shape=identifier --input=data --size=16
+//  ./ruyi_bench --shape=mixed --input=mmap --size=256 --threads=8
+//
+
+#include "bench_cases.h"
+
+int main(int argc, const char * argv[]) {
+    return run_bench_lexer(argc - 1, argv + 1);
+}
@@ -9,6 +9,12 @@
 #include "test_cases.h"
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <float.h>
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 #include "../src/ruyi_list.h"
 #include "../src/ruyi_vector.h"
 #include "../src/ruyi_value.h"
@@ -16,10 +22,16 @@
 #include "../src/ruyi_unicode.h"
 #include "../src/ruyi_bytes.h"
 #include "../src/ruyi_io.h"
+#include "../src/ruyi_mem.h"
+#include "../src/ruyi_symbol.h"
+#include "../src/ruyi_number.h"
 #include "../src/ruyi_lexer.h"
 #include "../src/ruyi_parser.h"
 #include "../src/ruyi_ir.h"
 #include "../src/ruyi_code_generator.h"
+#include "../src/ruyi_ast_cache.h"
+#include "../src/ruyi_ast_walker.h"
+#include "../src/ruyi_stack.h"
 
 
 
@@ -338,6 +350,215 @@ void test_unicode_file() {
     fclose(fout);
 }
 
+static void assert_decode_utf8_by_chars(const BYTE *src, UINT32 src_len, UINT32 buf_length) {
+    WIDE_CHAR out[256];
+    WIDE_CHAR c;
+    UINT32 used = 0, count;
+    UINT32 pos = 0, char_pos = 0, char_used;
+    count = ruyi_unicode_decode_utf8(src, src_len, &used, out, buf_length);
+    // decode one by one as the reference
+    while (pos < src_len && char_pos < buf_length) {
+        if (ruyi_unicode_decode_utf8(src + pos, src_len - pos, &char_used, &c, 1) == 0) {
+            break;
+        }
+        assert(char_pos < count);
+        assert(out[char_pos] == c);
+        pos += char_used;
+        char_pos++;
+    }
+    assert(char_pos == count);
+    assert(pos == used);
+}
+
+void test_unicode_decode_utf8(void) {
+    BYTE src[200];
+    const char *cjk = "中文";
+    UINT32 i, len, pos;
+    for (i = 0; i < sizeof(src); i++) {
+        src[i] = 'a' + i % 26;
+    }
+    assert_decode_utf8_by_chars(src, sizeof(src), 256);
+    assert_decode_utf8_by_chars(src, sizeof(src), 37);
+    // multibyte and broken chars at every position of the simd blocks
+    len = (UINT32)strlen(cjk);
+    for (pos = 0; pos + len < 80; pos++) {
+        for (i = 0; i < sizeof(src); i++) {
+            src[i] = 'a' + i % 26;
+        }
+        memcpy(src + pos, cjk, len);
+        assert_decode_utf8_by_chars(src, sizeof(src), 256);
+        assert_decode_utf8_by_chars(src, pos + 1, 256);
+        assert_decode_utf8_by_chars(src, sizeof(src), pos + 1);
+        src[pos + len + 20] = 0xFF;
+        assert_decode_utf8_by_chars(src, sizeof(src), 256);
+    }
+}
+
+static BOOL parse_double_from_ascii(const char *text, double *out) {
+    WIDE_CHAR buf[1024];
+    UINT32 i, length = (UINT32)strlen(text);
+    assert(length < sizeof(buf) / sizeof(buf[0]));
+    for (i = 0; i < length; i++) {
+        buf[i] = (BYTE)text[i];
+    }
+    return ruyi_number_parse_double(buf, length, out);
+}
+
+static BOOL parse_uint64_from_ascii(const char *text, UINT32 radix, UINT64 *out) {
+    WIDE_CHAR buf[128];
+    UINT32 i, length = (UINT32)strlen(text);
+    assert(length < sizeof(buf) / sizeof(buf[0]));
+    for (i = 0; i < length; i++) {
+        buf[i] = (BYTE)text[i];
+    }
+    return ruyi_number_parse_uint64(buf, length, radix, out);
+}
+
+void test_number_parse(void) {
+    const char* doubles[] = {
+        "0", "0.0", "000.000", "1", "1.", ".5", "0.1", "0.3", "3.1415926", "123456.789e3", "1e23", "8.533e-7",
+        "9007199254740992", "9007199254740993", "9007199254740995", "9007199254740993.00000000000000000001",
+        "123456789012345678901234567890", "0.000000000000000000000000000000000000001",
+        "7.2057594037927933e16", "1448997445238699", "4.35679716365127E-10",
+        "1.7976931348623157e308", "1.7976931348623158e308",
+        "2.2250738585072011e-308", "2.2250738585072014e-308", "2.225073858507201136057409796709131975934819546351645648e-308",
+        "4.9406564584124654e-324", "2.4703282292062328e-324", "2.4703282292062327e-324", "1e-400", "1e-99999999999",
+        "3.0000000000000004440892098500626161694526672363281250001",
+        "0.30000000000000001665334536938156", "1.00000000000000011102230246251565404236316680908203125",
+        "1.00000000000000011102230246251565404236316680908203124",
+        "1.00000000000000011102230246251565404236316680908203126",
+    };
+    const char* bad_doubles[] = {"", ".", "1e", "1e-", "1x", "1.2.3", "1e309", "1.8e308", "1e99999999999"};
+    UINT64 seed = 20191122;
+    char buf[64];
+    double value;
+    UINT64 u;
+    UINT32 i, j, digits;
+    for (i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+        assert(parse_double_from_ascii(doubles[i], &value));
+        assert(value == strtod(doubles[i], NULL));
+    }
+    for (i = 0; i < sizeof(bad_doubles) / sizeof(bad_doubles[0]); i++) {
+        assert(!parse_double_from_ascii(bad_doubles[i], &value));
+    }
+    // random numbers must be the same as strtod
+    for (i = 0; i < 100000; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        digits = 1 + (UINT32)(seed >> 59);
+        for (j = 0; j < digits; j++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            buf[j] = '0' + (char)((seed >> 33) % 10);
+        }
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        sprintf(buf + digits, "e%d", (int)((seed >> 33) % 700) - 350);
+        assert(parse_double_from_ascii(buf, &value) == (strtod(buf, NULL) <= DBL_MAX));
+        if (strtod(buf, NULL) <= DBL_MAX) {
+            assert(value == strtod(buf, NULL));
+        }
+    }
+
+    assert(parse_uint64_from_ascii("", 10, &u) && u == 0);
+    assert(parse_uint64_from_ascii("18446744073709551615", 10, &u) && u == UINT64_MAX);
+    assert(!parse_uint64_from_ascii("18446744073709551616", 10, &u));
+    assert(parse_uint64_from_ascii("FFFFFFFFffffffff", 16, &u) && u == UINT64_MAX);
+    assert(!parse_uint64_from_ascii("10000000000000000", 16, &u));
+    assert(parse_uint64_from_ascii("1777777777777777777777", 8, &u) && u == UINT64_MAX);
+    assert(!parse_uint64_from_ascii("2000000000000000000000", 8, &u));
+    assert(parse_uint64_from_ascii("1111111111111111111111111111111111111111111111111111111111111111", 2, &u) && u == UINT64_MAX);
+    assert(!parse_uint64_from_ascii("10000000000000000000000000000000000000000000000000000000000000000", 2, &u));
+    assert(!parse_uint64_from_ascii("12", 2, &u));
+    assert(!parse_uint64_from_ascii("19", 8, &u));
+    assert(!parse_uint64_from_ascii("1a", 10, &u));
+}
+
+void test_symbol_intern(void) {
+    ruyi_unicode_string *name1 = ruyi_unicode_string_init_from_utf8("name1", 0);
+    ruyi_unicode_string *name2 = ruyi_unicode_string_init_from_utf8("name2", 0);
+    ruyi_unicode_string *temp;
+    ruyi_symbol s1 = ruyi_symbol_intern_unicode(name1);
+    ruyi_symbol s2 = ruyi_symbol_intern_unicode(name2);
+    ruyi_symbol symbols[5000];
+    char buf[32];
+    UINT32 i;
+    assert(s1 != RUYI_SYMBOL_NONE);
+    assert(s2 != RUYI_SYMBOL_NONE);
+    assert(s1 != s2);
+    assert(s1 == ruyi_symbol_intern(name1->data, name1->length));
+    assert(ruyi_unicode_string_equals(name1, ruyi_symbol_str(s1)));
+    assert(ruyi_unicode_string_equals(name2, ruyi_symbol_str(s2)));
+    assert(RUYI_SYMBOL_NONE == ruyi_symbol_intern_unicode(NULL));
+    assert(NULL == ruyi_symbol_str(RUYI_SYMBOL_NONE));
+    // enough names to grow the table
+    for (i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++) {
+        sprintf(buf, "sym_%u", i);
+        temp = ruyi_unicode_string_init_from_utf8(buf, 0);
+        symbols[i] = ruyi_symbol_intern_unicode(temp);
+        ruyi_unicode_string_destroy(temp);
+    }
+    for (i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++) {
+        sprintf(buf, "sym_%u", i);
+        temp = ruyi_unicode_string_init_from_utf8(buf, 0);
+        assert(symbols[i] == ruyi_symbol_intern_unicode(temp));
+        assert(ruyi_unicode_string_equals(temp, ruyi_symbol_str(symbols[i])));
+        ruyi_unicode_string_destroy(temp);
+    }
+    assert(s1 == ruyi_symbol_intern_unicode(name1));
+    assert(ruyi_symbol_count() >= sizeof(symbols) / sizeof(symbols[0]) + 2);
+    ruyi_unicode_string_destroy(name1);
+    ruyi_unicode_string_destroy(name2);
+}
+
+// a recursion by ruyi_stack_call, each level takes 1k of the stack like a rule of the parser
+typedef struct {
+    ruyi_stack *stack;
+    UINT32 depth;
+    UINT32 max_depth;
+    BOOL failed;
+} stack_recursion;
+
+static void stack_recurse(void *arg) {
+    stack_recursion *recursion = (stack_recursion*)arg;
+    volatile char frame[1024];
+    UINT32 depth = recursion->depth;
+    memset((char*)frame, (int)(depth & 0x7f), sizeof(frame));
+    if (depth == recursion->max_depth) {
+        return;
+    }
+    recursion->depth++;
+    if (!ruyi_stack_call(recursion->stack, stack_recurse, recursion)) {
+        recursion->failed = TRUE;
+    }
+    // the frame is still there after the calls nested on other segments
+    assert(frame[0] == (char)(depth & 0x7f) && frame[sizeof(frame) - 1] == (char)(depth & 0x7f));
+}
+
+void test_stack(void) {
+    stack_recursion recursion;
+    UINT32 i;
+    // 20000 levels take 20M, far more than the stack of the thread is used for, the segments are reused the second time
+    recursion.stack = ruyi_stack_create(64 * 1024 * 1024);
+    for (i = 0; i < 2; i++) {
+        recursion.depth = 0;
+        recursion.max_depth = 20000;
+        recursion.failed = FALSE;
+        assert(ruyi_stack_call(recursion.stack, stack_recurse, &recursion));
+        assert(!recursion.failed);
+        assert(20000 == recursion.depth);
+        assert(ruyi_stack_size(recursion.stack) > 0 && ruyi_stack_size(recursion.stack) <= 64 * 1024 * 1024);
+    }
+    ruyi_stack_destroy(recursion.stack);
+    // the memory of the stack is limited to 4 segments, a deeper call fails instead of running out of memory
+    recursion.stack = ruyi_stack_create(4 * RUYI_STACK_SEGMENT_SIZE);
+    recursion.depth = 0;
+    recursion.max_depth = 20000;
+    recursion.failed = FALSE;
+    assert(ruyi_stack_call(recursion.stack, stack_recurse, &recursion));
+    assert(recursion.failed);
+    assert(recursion.depth < 20000);
+    assert(4 * RUYI_STACK_SEGMENT_SIZE == ruyi_stack_size(recursion.stack));
+    ruyi_stack_destroy(recursion.stack);
+}
+
 void test_file() {
     const char * data1 = "abcd5";
     char buf[16];
@@ -442,7 +663,6 @@ void test_lexer_id_number(void) {
             break;
         }
     }
-    ruyi_lexer_reader_close(reader);
     assert(20 == ruyi_vector_length(vector));
     assert_lexer_token(vector, 0, Ruyi_tt_IDENTITY, "hello", 0, 0);
     assert_lexer_token(vector, 1, Ruyi_tt_INTEGER, NULL, 124, 0);
@@ -470,6 +690,7 @@ void test_lexer_id_number(void) {
         ruyi_lexer_token_destroy(token);
     }
     
+    ruyi_lexer_reader_close(reader);
     ruyi_vector_destroy(vector);
 }
 
@@ -493,7 +714,6 @@ void test_lexer_id_number_string_char_comments(void) {
             break;
         }
     }
-    ruyi_lexer_reader_close(reader);
     i = 0;
     assert_lexer_token(vector, i++, Ruyi_tt_IDENTITY, "hello", 0, 0);
     assert_lexer_token(vector, i++, Ruyi_tt_INTEGER, NULL, 124, 0);
@@ -528,6 +748,7 @@ void test_lexer_id_number_string_char_comments(void) {
         ruyi_lexer_token_destroy(token);
     }
     
+    ruyi_lexer_reader_close(reader);
     ruyi_vector_destroy(vector);
 }
 
@@ -550,7 +771,6 @@ void test_lexer_symbols(void) {
             break;
         }
     }
-    ruyi_lexer_reader_close(reader);
     i = 0;
     assert_lexer_token(vector, i++, Ruyi_tt_ASSIGN, NULL, 0, 0);
     assert_lexer_token(vector, i++, Ruyi_tt_LBRACE, NULL, 0, 0);
@@ -609,6 +829,7 @@ void test_lexer_symbols(void) {
         ruyi_lexer_token_destroy(token);
     }
     
+    ruyi_lexer_reader_close(reader);
     ruyi_vector_destroy(vector);
 }
 
@@ -632,7 +853,6 @@ void test_lexer_keywords(void) {
             break;
         }
     }
-    ruyi_lexer_reader_close(reader);
     i = 0;
     assert_lexer_token(vector, i++, Ruyi_tt_IDENTITY, "hello", 0, 0);
     assert_lexer_token(vector, i++, Ruyi_tt_STRING, "abc", 0, 0);
@@ -645,9 +865,1047 @@ void test_lexer_keywords(void) {
         token = (ruyi_token *)val.data.ptr;
         ruyi_lexer_token_destroy(token);
     }
-    ruyi_vector_destroy(vector);
+    ruyi_lexer_reader_close(reader);
+    ruyi_vector_destroy(vector);
+}
+
+void test_lexer_peek_match_no_alloc(void) {
+    const char* src = "if (a >= 10) { return \"abc\" }";
+    ruyi_file *file = ruyi_file_init_by_data(src, (UINT32)strlen(src));
+    ruyi_lexer_reader* reader = ruyi_lexer_reader_open(file);
+    ruyi_token token;
+    ruyi_token *id_token;
+    UINT64 alloc_count;
+    static const WIDE_CHAR a_chars[] = {'a'};
+    // warm up, the first token needs an arena block, and 'a' is interned the first time it is read
+    ruyi_symbol_intern(a_chars, 1);
+    id_token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_KW_IF == id_token->type);
+    ruyi_lexer_reader_push_front(reader, id_token);
+    alloc_count = ruyi_mem_alloc_count();
+    assert(Ruyi_tt_KW_IF == ruyi_lexer_reader_peek_token_type(reader));
+    assert(!ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_FOR, &token));
+    assert(Ruyi_tt_KW_IF == token.type);
+    assert(ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_IF, NULL));
+    assert(ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LPAREN, NULL));
+    assert(Ruyi_tt_IDENTITY == ruyi_lexer_reader_peek_token_type(reader));
+    assert(ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_IDENTITY, &token));
+    assert(1 == token.value.str_value->length && 'a' == token.value.str_value->data[0]);
+    assert(ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_GTE, NULL));
+    ruyi_lexer_reader_consume_token(reader);
+    assert(alloc_count == ruyi_mem_alloc_count());
+    // pushed back tokens are read again in order
+    id_token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_RPAREN == id_token->type);
+    ruyi_lexer_reader_push_front(reader, id_token);
+    assert(ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RPAREN, NULL));
+    assert(ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_LBRACE, NULL));
+    assert(ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_KW_RETURN, NULL));
+    assert(ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_STRING, NULL));
+    assert(ruyi_lexer_reader_consume_token_if_match(reader, Ruyi_tt_RBRACE, NULL));
+    assert(Ruyi_tt_END == ruyi_lexer_reader_peek_token_type(reader));
+    ruyi_lexer_reader_close(reader);
+}
+
+void test_lexer_identifier_symbols(void) {
+    const char* src = "abc xyz abc if";
+    ruyi_file *file = ruyi_file_init_by_data(src, (UINT32)strlen(src));
+    ruyi_lexer_reader* reader = ruyi_lexer_reader_open(file);
+    ruyi_token *t1 = ruyi_lexer_reader_next_token(reader);
+    ruyi_token *t2 = ruyi_lexer_reader_next_token(reader);
+    ruyi_token *t3 = ruyi_lexer_reader_next_token(reader);
+    ruyi_token *t4 = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_IDENTITY == t1->type);
+    assert(t1->symbol != RUYI_SYMBOL_NONE);
+    assert(t1->symbol != t2->symbol);
+    assert(t1->symbol == t3->symbol);
+    // the same canonical string
+    assert(t1->value.str_value == t3->value.str_value);
+    assert(t1->value.str_value == ruyi_symbol_str(t1->symbol));
+    assert(Ruyi_tt_KW_IF == t4->type);
+    assert(RUYI_SYMBOL_NONE == t4->symbol);
+    ruyi_lexer_reader_close(reader);
+}
+
+void test_lexer_dfa_tokens(void) {
+    const char* src = "a+=b++ - -- -= * *= / /= % %= . .. ... 1..2 .5 0x 0b 1. 1e3 a/=b // c\n/* 中 */ x 07 ~= /* open";
+    const char* errors[] = {"08", "079", "0b12", "0x1.5", "1e", "2.5E-"};
+    UINT32 line, column;
+    ruyi_file *file = ruyi_file_init_by_data(src, (UINT32)strlen(src));
+    ruyi_lexer_reader* reader = ruyi_lexer_reader_open(file);
+    ruyi_token *token;
+    UINT32 i;
+    ruyi_value val;
+    ruyi_vector * vector = ruyi_vector_create();
+    for (;;) {
+        token = ruyi_lexer_reader_next_token(reader);
+        assert(token);
+        ruyi_vector_add(vector, ruyi_value_ptr(token));
+        if (token->type == Ruyi_tt_END) {
+            break;
+        }
+    }
+    i = 0;
+    assert_lexer_token(vector, i++, Ruyi_tt_IDENTITY, "a", 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_ADD_ASS, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_IDENTITY, "b", 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_INC, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_SUB, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_DEC, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_SUB_ASS, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_MUL, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_MUL_ASS, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_DIV, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_DIV_ASS, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_MOD, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_MOD_ASS, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_DOT, NULL, 0, 0);
+    // ".." is not a token, it falls back to "." and "."
+    assert_lexer_token(vector, i++, Ruyi_tt_DOT, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_DOT, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_DOT3, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_FLOAT, NULL, 0, 1.0);
+    assert_lexer_token(vector, i++, Ruyi_tt_FLOAT, NULL, 0, 0.2);
+    assert_lexer_token(vector, i++, Ruyi_tt_FLOAT, NULL, 0, 0.5);
+    assert_lexer_token(vector, i++, Ruyi_tt_INTEGER, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_INTEGER, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_FLOAT, NULL, 0, 1.0);
+    assert_lexer_token(vector, i++, Ruyi_tt_INTEGER, NULL, 1000, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_IDENTITY, "a", 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_DIV_ASS, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_IDENTITY, "b", 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_LINE_COMMENTS, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_MLINES_COMMENTS, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_IDENTITY, "x", 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_INTEGER, NULL, 7, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_BIT_INVERSE_ASS, NULL, 0, 0);
+    // a comment without end runs to the end of file
+    assert_lexer_token(vector, i++, Ruyi_tt_MLINES_COMMENTS, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_END, NULL, 0, 0);
+    assert(i == ruyi_vector_length(vector));
+
+    // the size is the count of chars of the token
+    ruyi_vector_get(vector, 1, &val);
+    assert(2 == ((ruyi_token *)val.data.ptr)->size);
+    ruyi_vector_get(vector, 16, &val);
+    assert(3 == ((ruyi_token *)val.data.ptr)->size);
+    ruyi_vector_get(vector, 28, &val);
+    assert(7 == ((ruyi_token *)val.data.ptr)->size);
+    ruyi_lexer_reader_position(reader, ((ruyi_token *)val.data.ptr)->offset, &line, &column);
+    assert(2 == line);
+    ruyi_lexer_reader_close(reader);
+    ruyi_vector_destroy(vector);
+
+    for (i = 0; i < sizeof(errors) / sizeof(*errors); i++) {
+        file = ruyi_file_init_by_data(errors[i], (UINT32)strlen(errors[i]));
+        reader = ruyi_lexer_reader_open(file);
+        assert(NULL == ruyi_lexer_reader_next_token(reader));
+        ruyi_lexer_reader_close(reader);
+    }
+}
+
+void test_lexer_number_values(void) {
+    const char* src = "9223372036854775807 0x7fffffffffffffff 0xFFFFFFFFFFFFFFFF 0b101 017 12e3 5e-3 0.1 1.0e308 .3 2.2250738585072014e-308";
+    const char* errors[] = {"9223372036854775808", "0x10000000000000000", "1e19", "1e400", "1.0e400", "0b10000000000000000000000000000000000000000000000000000000000000000"};
+    ruyi_file *file = ruyi_file_init_by_data(src, (UINT32)strlen(src));
+    ruyi_lexer_reader* reader = ruyi_lexer_reader_open(file);
+    ruyi_token *token;
+    UINT32 i;
+    token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_INTEGER == token->type && INT64_MAX == token->value.int_value);
+    token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_INTEGER == token->type && INT64_MAX == token->value.int_value);
+    token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_INTEGER == token->type && -1 == token->value.int_value);
+    token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_INTEGER == token->type && 5 == token->value.int_value);
+    token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_INTEGER == token->type && 15 == token->value.int_value);
+    token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_INTEGER == token->type && 12000 == token->value.int_value);
+    // exact values, no tolerance
+    token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_FLOAT == token->type && 5e-3 == token->value.float_value);
+    token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_FLOAT == token->type && 0.1 == token->value.float_value);
+    token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_FLOAT == token->type && 1e308 == token->value.float_value);
+    token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_FLOAT == token->type && 0.3 == token->value.float_value);
+    token = ruyi_lexer_reader_next_token(reader);
+    assert(Ruyi_tt_FLOAT == token->type && 2.2250738585072014e-308 == token->value.float_value);
+    assert(Ruyi_tt_END == ruyi_lexer_reader_next_token(reader)->type);
+    ruyi_lexer_reader_close(reader);
+
+    for (i = 0; i < sizeof(errors) / sizeof(*errors); i++) {
+        file = ruyi_file_init_by_data(errors[i], (UINT32)strlen(errors[i]));
+        reader = ruyi_lexer_reader_open(file);
+        assert(NULL == ruyi_lexer_reader_next_token(reader));
+        ruyi_lexer_reader_close(reader);
+    }
+}
+
+void test_lexer_keywords_table(void) {
+    const char* not_keywords[] = {"iff", "i", "fo", "If", "elsee", "els", "instanceoff", "intx", "nul", "中", "<EO"};
+    const ruyi_unicode_string *keyword;
+    ruyi_unicode_string *temp;
+    char buf[16];
+    UINT32 type, i, count = 0;
+    for (type = Ruyi_tt_IDENTITY; type <= Ruyi_tt_KW_IMPORT; type++) {
+        keyword = ruyi_lexer_keywords_get_str((ruyi_token_type)type);
+        if (keyword == NULL) {
+            assert(NULL == ruyi_lexer_keywords_get_bytes_str((ruyi_token_type)type, buf, sizeof(buf)));
+            continue;
+        }
+        count++;
+        assert(type == ruyi_lexer_keywords_get_type((ruyi_unicode_string*)keyword));
+        assert(buf == ruyi_lexer_keywords_get_bytes_str((ruyi_token_type)type, buf, sizeof(buf)));
+        temp = ruyi_unicode_string_init_from_utf8(buf, 0);
+        assert(ruyi_unicode_string_equals(keyword, temp));
+        ruyi_unicode_string_destroy(temp);
+    }
+    assert(43 == count);
+    for (i = 0; i < sizeof(not_keywords) / sizeof(*not_keywords); i++) {
+        temp = ruyi_unicode_string_init_from_utf8(not_keywords[i], 0);
+        assert(Ruyi_tt_IDENTITY == ruyi_lexer_keywords_get_type(temp));
+        ruyi_unicode_string_destroy(temp);
+    }
+    assert(0 == strcmp("func", ruyi_lexer_keywords_get_bytes_str(Ruyi_tt_KW_FUNC, buf, sizeof(buf))));
+    assert(0 == strcmp("ins", ruyi_lexer_keywords_get_bytes_str(Ruyi_tt_KW_INSTANCEOF, buf, 4)));
+    assert(NULL == ruyi_lexer_keywords_get_str(Ruyi_tt_IDENTITY));
+    assert(NULL == ruyi_lexer_keywords_get_str(Ruyi_tt_ADD));
+}
+
+void test_lexer_mmap_file(void) {
+    const char* src = "var name = \"你好\" // mmap\nx := 0x1F";
+    const char* file_name = "/tmp/ruyi_test_lexer_mmap.ry";
+    FILE *fp = fopen(file_name, "wb");
+    ruyi_file *file;
+    ruyi_lexer_reader* reader;
+    ruyi_token *token;
+    UINT32 i;
+    ruyi_value val;
+    ruyi_vector * vector = ruyi_vector_create();
+    assert(fp);
+    fwrite(src, 1, strlen(src), fp);
+    fclose(fp);
+    file = ruyi_file_open_by_mmap(file_name);
+    assert(file);
+    assert(strlen(src) == file->write_pos);
+    reader = ruyi_lexer_reader_open(file);
+    for (;;) {
+        token = ruyi_lexer_reader_next_token(reader);
+        if (!token) {
+            printf("read next token error\n");
+            break;
+        }
+        ruyi_vector_add(vector, ruyi_value_ptr(token));
+        if (token->type == Ruyi_tt_END) {
+            break;
+        }
+    }
+    remove(file_name);
+    i = 0;
+    assert_lexer_token(vector, i++, Ruyi_tt_KW_VAR, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_IDENTITY, "name", 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_ASSIGN, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_STRING, "你好", 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_LINE_COMMENTS, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_IDENTITY, "x", 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_COLON_ASSIGN, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_INTEGER, NULL, 0x1F, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_END, NULL, 0, 0);
+    assert(i == ruyi_vector_length(vector));
+    for (i = 0; i < ruyi_vector_length(vector); i++) {
+        ruyi_vector_get(vector, i, &val);
+        token = (ruyi_token *)val.data.ptr;
+        ruyi_lexer_token_destroy(token);
+    }
+    ruyi_lexer_reader_close(reader);
+    ruyi_vector_destroy(vector);
+}
+
+// a comment which puts a 3 bytes char across the first block boundary of a streamed file
+static char* make_stream_source(UINT32 *out_length) {
+    const char *head = "var n = 1 // ";
+    const char *tail = "中 end\nx := 0x1F\n";
+    UINT32 boundary = 256 * 1024;
+    UINT32 head_length = (UINT32)strlen(head);
+    UINT32 tail_length = (UINT32)strlen(tail);
+    UINT32 length = boundary - 1 + tail_length;
+    char *src = (char*)ruyi_mem_alloc(length + 1);
+    memcpy(src, head, head_length);
+    memset(src + head_length, 'a', boundary - 1 - head_length);
+    memcpy(src + boundary - 1, tail, tail_length + 1);
+    *out_length = length;
+    return src;
+}
+
+static void assert_stream_tokens(ruyi_file *file) {
+    ruyi_lexer_reader* reader = ruyi_lexer_reader_open(file);
+    ruyi_vector * vector = ruyi_vector_create();
+    ruyi_token *token;
+    ruyi_value val;
+    UINT32 i, line, column;
+    for (;;) {
+        token = ruyi_lexer_reader_next_token(reader);
+        assert(token);
+        ruyi_vector_add(vector, ruyi_value_ptr(token));
+        if (token->type == Ruyi_tt_END) {
+            break;
+        }
+    }
+    i = 0;
+    assert_lexer_token(vector, i++, Ruyi_tt_KW_VAR, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_IDENTITY, "n", 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_ASSIGN, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_INTEGER, NULL, 1, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_LINE_COMMENTS, NULL, 0, 0);
+    ruyi_vector_get(vector, i - 1, &val);
+    token = (ruyi_token *)val.data.ptr;
+    // "// " + a...a + "中 end\n", the 3 bytes char is one char
+    assert(token->size == 256 * 1024 - 1 - 10 + 6);
+    assert_lexer_token(vector, i++, Ruyi_tt_IDENTITY, "x", 0, 0);
+    ruyi_vector_get(vector, i - 1, &val);
+    ruyi_lexer_reader_position(reader, ((ruyi_token *)val.data.ptr)->offset, &line, &column);
+    assert(line == 2 && column == 1);
+    assert_lexer_token(vector, i++, Ruyi_tt_COLON_ASSIGN, NULL, 0, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_INTEGER, NULL, 0x1F, 0);
+    assert_lexer_token(vector, i++, Ruyi_tt_END, NULL, 0, 0);
+    assert(i == ruyi_vector_length(vector));
+    for (i = 0; i < ruyi_vector_length(vector); i++) {
+        ruyi_vector_get(vector, i, &val);
+        ruyi_lexer_token_destroy((ruyi_token *)val.data.ptr);
+    }
+    ruyi_lexer_reader_close(reader);
+    ruyi_vector_destroy(vector);
+}
+
+void test_lexer_stream_file(void) {
+    const char* file_name = "/tmp/ruyi_test_lexer_stream.ry";
+    UINT32 length;
+    char *src = make_stream_source(&length);
+    FILE *fp = fopen(file_name, "wb");
+    assert(fp);
+    fwrite(src, 1, length, fp);
+    fclose(fp);
+    // a regular file is read by blocks on demand
+    fp = fopen(file_name, "rb");
+    assert(fp);
+    assert_stream_tokens(ruyi_file_open_by_file(fp));
+    remove(file_name);
+#if !defined(_WIN32)
+    {
+        // a pipe is read ahead by the stream thread
+        int fds[2];
+        pid_t pid;
+        ssize_t written;
+        UINT32 pos = 0;
+        assert(pipe(fds) == 0);
+        pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            close(fds[0]);
+            while (pos < length) {
+                written = write(fds[1], src + pos, length - pos);
+                if (written <= 0) {
+                    _exit(1);
+                }
+                pos += (UINT32)written;
+            }
+            _exit(0);
+        }
+        close(fds[1]);
+        fp = fdopen(fds[0], "rb");
+        assert(fp);
+        assert_stream_tokens(ruyi_file_open_by_file(fp));
+        waitpid(pid, NULL, 0);
+    }
+    {
+        // the thread waits for a pipe nobody writes, closing the reader stops it
+        int fds[2];
+        ruyi_lexer_reader *reader;
+        assert(pipe(fds) == 0);
+        fp = fdopen(fds[0], "rb");
+        assert(fp);
+        reader = ruyi_lexer_reader_open(ruyi_file_open_by_file(fp));
+        ruyi_lexer_reader_close(reader);
+        close(fds[1]);
+    }
+    {
+        // a directory is not a regular file, reading it fails and the lexer reports it instead of an end
+        ruyi_lexer_reader *reader;
+        fp = fopen("/tmp", "rb");
+        if (fp != NULL) {
+            reader = ruyi_lexer_reader_open_with_options(ruyi_file_open_by_file(fp), Ruyi_lo_QUIET);
+            assert(NULL == ruyi_lexer_reader_next_token(reader));
+            assert(strcmp("read error of the source file", reader->error_message) == 0);
+            ruyi_lexer_reader_close(reader);
+        }
+    }
+#endif
+    ruyi_mem_free(src);
+}
+
+typedef struct {
+    ruyi_token token;
+    UINT32 line;
+    UINT32 column;
+} lexed_token;
+
+// lex to the end and keep the tokens which are not comments with their positions, returns the count
+static UINT32 lex_without_comments(ruyi_file *file, UINT32 options, lexed_token *tokens, UINT32 max_count) {
+    ruyi_lexer_reader* reader = ruyi_lexer_reader_open_with_options(file, options);
+    ruyi_token *token;
+    UINT32 count = 0;
+    for (;;) {
+        token = ruyi_lexer_reader_next_token(reader);
+        assert(token);
+        if (token->type != Ruyi_tt_LINE_COMMENTS && token->type != Ruyi_tt_MLINES_COMMENTS) {
+            assert(count < max_count);
+            tokens[count].token = *token;
+            ruyi_lexer_reader_position(reader, token->offset, &tokens[count].line, &tokens[count].column);
+            count++;
+        }
+        if (token->type == Ruyi_tt_END) {
+            break;
+        }
+    }
+    ruyi_lexer_reader_close(reader);
+    return count;
+}
+
+static void assert_skip_comments_same(const char *src, UINT32 length) {
+    lexed_token expected[64];
+    lexed_token skipped[64];
+    UINT32 expected_count = lex_without_comments(ruyi_file_init_by_data(src, length), Ruyi_lo_NONE, expected, 64);
+    UINT32 skipped_count = lex_without_comments(ruyi_file_init_by_data(src, length), Ruyi_lo_SKIP_COMMENTS, skipped, 64);
+    UINT32 i;
+    assert(expected_count == skipped_count);
+    for (i = 0; i < expected_count; i++) {
+        assert(expected[i].token.type == skipped[i].token.type);
+        assert(expected[i].token.offset == skipped[i].token.offset);
+        assert(expected[i].line == skipped[i].line);
+        assert(expected[i].column == skipped[i].column);
+        assert(expected[i].token.size == skipped[i].token.size);
+    }
+}
+
+void test_lexer_skip_comments(void) {
+    const char *head = "a /* 中\n 文 **/ b // c\r\n  d / e /*/ x */ f/**/g\n/*";
+    const char *tail = "*/ h // 尾\ni /* 没有结束 \n *";
+    char src[4096];
+    UINT32 length, i;
+    ruyi_file *file;
+    ruyi_lexer_reader *reader;
+    lexed_token tokens[64];
+    UINT64 alloc_count;
+    // short comments are skipped in the decoded chars
+    assert_skip_comments_same(head, (UINT32)strlen(head) - 2);
+    assert(lex_without_comments(ruyi_file_init_by_data(head, (UINT32)strlen(head) - 2), Ruyi_lo_SKIP_COMMENTS, tokens, 64) == 8);
+    assert(tokens[1].token.type == Ruyi_tt_IDENTITY && tokens[1].line == 2 && tokens[1].column == 8);
+    assert(tokens[2].token.type == Ruyi_tt_IDENTITY && tokens[2].line == 3 && tokens[2].column == 3);
+    assert(tokens[3].token.type == Ruyi_tt_DIV);
+    // long comments are skipped in the bytes, the stars and lines are across the decoded chars and the bytes
+    strcpy(src, head);
+    for (i = 0; i < 40; i++) {
+        strcat(src, i % 3 == 0 ? " * 许可证 license line\n" : " ** provenance: generated by tool *\r\n");
+    }
+    strcat(src, tail);
+    length = (UINT32)strlen(src);
+    assert_skip_comments_same(src, length);
+    for (i = 0; i < 5; i++) {
+        // the file ends in the last comment, "\n *" cut at every char
+        assert_skip_comments_same(src, length - i);
+    }
+    assert_skip_comments_same(src, length - 7);
+    // a long line comment at the end of file
+    memset(src, ' ', 600);
+    memcpy(src, "x //", 4);
+    src[600] = '\0';
+    assert_skip_comments_same(src, 600);
+    // skipping comments allocates nothing
+    file = ruyi_file_init_by_data(src, 600);
+    reader = ruyi_lexer_reader_open_with_options(file, Ruyi_lo_SKIP_COMMENTS);
+    assert(Ruyi_tt_IDENTITY == ruyi_lexer_reader_peek_token_type(reader));
+    ruyi_lexer_reader_consume_token(reader);
+    alloc_count = ruyi_mem_alloc_count();
+    assert(Ruyi_tt_END == ruyi_lexer_reader_peek_token_type(reader));
+    assert(alloc_count == ruyi_mem_alloc_count());
+    ruyi_lexer_reader_close(reader);
+}
+
+void test_lexer_skip_comments_stream(void) {
+    const char* file_name = "/tmp/ruyi_test_lexer_skip.ry";
+    lexed_token tokens[64];
+    UINT32 length;
+    char *src = make_stream_source(&length);
+    FILE *fp = fopen(file_name, "wb");
+    assert(fp);
+    fwrite(src, 1, length, fp);
+    fclose(fp);
+    ruyi_mem_free(src);
+    // the comment goes across the first block of the stream
+    fp = fopen(file_name, "rb");
+    assert(fp);
+    assert(lex_without_comments(ruyi_file_open_by_file(fp), Ruyi_lo_SKIP_COMMENTS, tokens, 64) == 8);
+    remove(file_name);
+    assert(tokens[3].token.type == Ruyi_tt_INTEGER && tokens[3].token.value.int_value == 1);
+    assert(tokens[4].token.type == Ruyi_tt_IDENTITY && tokens[4].line == 2 && tokens[4].column == 1);
+    assert(tokens[6].token.type == Ruyi_tt_INTEGER && tokens[6].token.value.int_value == 0x1F);
+    assert(tokens[7].token.type == Ruyi_tt_END && tokens[7].line == 3 && tokens[7].column == 1);
+}
+
+static void assert_stream_same_as_reader(const char *src, UINT32 options) {
+    UINT32 length = (UINT32)strlen(src);
+    ruyi_token_stream *stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, length), options);
+    ruyi_lexer_reader *reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_data(src, length), options);
+    ruyi_token_cursor cursor;
+    ruyi_token *token;
+    ruyi_token made;
+    UINT32 i = 0;
+    UINT32 line, column, made_line, made_column;
+    assert(stream);
+    ruyi_token_cursor_init(&cursor, stream);
+    for (;;) {
+        token = ruyi_lexer_reader_next_token(reader);
+        assert(token);
+        assert(i < stream->count);
+        assert(token->type == ruyi_token_cursor_peek(&cursor, 0));
+        ruyi_token_cursor_get(&cursor, 0, &made);
+        assert(token->type == made.type);
+        assert(token->size == made.size);
+        assert(token->offset == made.offset);
+        ruyi_lexer_reader_position(reader, token->offset, &line, &column);
+        ruyi_line_table_position(stream->lines, made.offset, &made_line, &made_column);
+        assert(line == made_line && column == made_column);
+        assert(token->symbol == made.symbol);
+        switch (token->type) {
+            case Ruyi_tt_IDENTITY:
+            case Ruyi_tt_STRING:
+                assert(ruyi_unicode_string_equals(token->value.str_value, made.value.str_value));
+                break;
+            case Ruyi_tt_INTEGER:
+            case Ruyi_tt_CHAR:
+                assert(token->value.int_value == made.value.int_value);
+                break;
+            case Ruyi_tt_FLOAT:
+                assert(token->value.float_value == made.value.float_value);
+                break;
+            default:
+                break;
+        }
+        ruyi_token_cursor_advance(&cursor, 1);
+        i++;
+        if (token->type == Ruyi_tt_END) {
+            break;
+        }
+    }
+    assert(i == stream->count);
+    // looking far ahead costs the same, past the end is END
+    ruyi_token_cursor_init(&cursor, stream);
+    for (i = 0; i < stream->count + 3; i += 3) {
+        assert(ruyi_token_cursor_peek(&cursor, i) == (i < stream->count ? stream->types[i] : Ruyi_tt_END));
+    }
+    ruyi_token_cursor_advance(&cursor, stream->count + 10);
+    assert(Ruyi_tt_END == ruyi_token_cursor_peek(&cursor, 0));
+    ruyi_lexer_reader_close(reader);
+    ruyi_token_stream_destroy(stream);
+}
+
+// names of the ast types for the dumps of the asts expected by the tests
+static const char *g_ast_type_names[Ruyi_at_COUNT] = {
+    [Ruyi_at_root]                            = "root",
+    [Ruyi_at_package_declaration]             = "package_declaration",
+    [Ruyi_at_import_declarations]             = "import_declarations",
+    [Ruyi_at_import_declaration]              = "import_declaration",
+    [Ruyi_at_global_declarations]             = "global_declarations",
+    [Ruyi_at_global_declaration]              = "global_declaration",
+    [Ruyi_at_var_declaration]                 = "var_declaration",
+    [Ruyi_at_var_declaration_auto_type]       = "var_declaration_auto_type",
+    [Ruyi_at_assignment]                      = "assignment",
+    [Ruyi_at_assign_operator]                 = "assign_operator",
+    [Ruyi_at_name]                            = "name",
+    [Ruyi_at_name_part]                       = "name_part",
+    [Ruyi_at_integer]                         = "integer",
+    [Ruyi_at_float]                           = "float",
+    [Ruyi_at_bool]                            = "bool",
+    [Ruyi_at_null]                            = "null",
+    [Ruyi_at_rune]                            = "rune",
+    [Ruyi_at_string]                          = "string",
+    [Ruyi_at_field_access]                    = "field_access",
+    [Ruyi_at_array_variable_access]           = "array_variable_access",
+    [Ruyi_at_array_primary_access]            = "array_primary_access",
+    [Ruyi_at_array_creation_with_init]        = "array_creation_with_init",
+    [Ruyi_at_array_creation_with_cap]         = "array_creation_with_cap",
+    [Ruyi_at_map_creation]                    = "map_creation",
+    [Ruyi_at_this]                            = "this",
+    [Ruyi_at_property]                        = "property",
+    [Ruyi_at_instance_creation]               = "instance_creation",
+    [Ruyi_at_type_array]                      = "type_array",
+    [Ruyi_at_type_map]                        = "type_map",
+    [Ruyi_at_type_func]                       = "type_func",
+    [Ruyi_at_type_bool]                       = "type_bool",
+    [Ruyi_at_type_byte]                       = "type_byte",
+    [Ruyi_at_type_short]                      = "type_short",
+    [Ruyi_at_type_int]                        = "type_int",
+    [Ruyi_at_type_long]                       = "type_long",
+    [Ruyi_at_type_rune]                       = "type_rune",
+    [Ruyi_at_type_float]                      = "type_float",
+    [Ruyi_at_type_double]                     = "type_double",
+    [Ruyi_at_function_invocation]             = "function_invocation",
+    [Ruyi_at_function_invocation_tail]        = "function_invocation_tail",
+    [Ruyi_at_argument_list]                   = "argument_list",
+    [Ruyi_at_conditional_expression]          = "conditional_expression",
+    [Ruyi_at_conditional_or_expression]       = "conditional_or_expression",
+    [Ruyi_at_conditional_and_expression]      = "conditional_and_expression",
+    [Ruyi_at_bit_or_expression]               = "bit_or_expression",
+    [Ruyi_at_bit_and_expression]              = "bit_and_expression",
+    [Ruyi_at_equality_expression]             = "equality_expression",
+    [Ruyi_at_op_equals]                       = "op_equals",
+    [Ruyi_at_op_not_equals]                   = "op_not_equals",
+    [Ruyi_at_relational_expression]           = "relational_expression",
+    [Ruyi_at_op_instanceof]                   = "op_instanceof",
+    [Ruyi_at_op_lt]                           = "op_lt",
+    [Ruyi_at_op_gt]                           = "op_gt",
+    [Ruyi_at_op_lte]                          = "op_lte",
+    [Ruyi_at_op_gte]                          = "op_gte",
+    [Ruyi_at_shift_expression]                = "shift_expression",
+    [Ruyi_at_op_shift_left]                   = "op_shift_left",
+    [Ruyi_at_op_shift_right]                  = "op_shift_right",
+    [Ruyi_at_additive_expression]             = "additive_expression",
+    [Ruyi_at_op_add]                          = "op_add",
+    [Ruyi_at_op_sub]                          = "op_sub",
+    [Ruyi_at_multiplicative_expression]       = "multiplicative_expression",
+    [Ruyi_at_op_mul]                          = "op_mul",
+    [Ruyi_at_op_div]                          = "op_div",
+    [Ruyi_at_op_mod]                          = "op_mod",
+    [Ruyi_at_unary_expression]                = "unary_expression",
+    [Ruyi_at_bit_inverse_expression]          = "bit_inverse_expression",
+    [Ruyi_at_logic_not_expression]            = "logic_not_expression",
+    [Ruyi_at_primary_cast_expression]         = "primary_cast_expression",
+    [Ruyi_at_postfix_dec_expression]          = "postfix_dec_expression",
+    [Ruyi_at_postfix_inc_expression]          = "postfix_inc_expression",
+    [Ruyi_at_type_cast_expression]            = "type_cast_expression",
+    [Ruyi_at_field_dot_access_expression]     = "field_dot_access_expression",
+    [Ruyi_at_field_bracket_access_expression] = "field_bracket_access_expression",
+    [Ruyi_at_function_declaration]            = "function_declaration",
+    [Ruyi_at_anonymous_function_declaration]  = "anonymous_function_declaration",
+    [Ruyi_at_formal_parameter_list]           = "formal_parameter_list",
+    [Ruyi_at_formal_parameter]                = "formal_parameter",
+    [Ruyi_at_var_args_type]                   = "var_args_type",
+    [Ruyi_at_block_statements]                = "block_statements",
+    [Ruyi_at_if_statement]                    = "if_statement",
+    [Ruyi_at_elseif_statement]                = "elseif_statement",
+    [Ruyi_at_else_statement]                  = "else_statement",
+    [Ruyi_at_return_statement]                = "return_statement",
+    [Ruyi_at_while_statement]                 = "while_statement",
+    [Ruyi_at_left_hand_side_expression]       = "left_hand_side_expression",
+    [Ruyi_at_assign_statement]                = "assign_statement",
+    [Ruyi_at_inc_statement]                   = "inc_statement",
+    [Ruyi_at_dec_statement]                   = "dec_statement",
+    [Ruyi_at_function_invocation_statement]   = "function_invocation_statement",
+    [Ruyi_at_for_in_statement]                = "for_in_statement",
+    [Ruyi_at_for_in_header]                   = "for_in_header",
+    [Ruyi_at_for_3_parts_statement]           = "for_3_parts_statement",
+    [Ruyi_at_for_3_parts_header]              = "for_3_parts_header",
+    [Ruyi_at_var_list]                        = "var_list",
+    [Ruyi_at_expr_statement_list]             = "expr_statement_list",
+    [Ruyi_at_stmt_expr_list]                  = "stmt_expr_list",
+    [Ruyi_at_switch_statement]                = "switch_statement",
+    [Ruyi_at_switch_statement_body]           = "switch_statement_body",
+    [Ruyi_at_switch_case_statement]           = "switch_case_statement",
+    [Ruyi_at_switch_case_statement_list]      = "switch_case_statement_list",
+    [Ruyi_at_switch_default_case_statement]   = "switch_default_case_statement",
+    [Ruyi_at_constant_expression]             = "constant_expression",
+    [Ruyi_at_const_list]                      = "const_list",
+    [Ruyi_at_break_statement]                 = "break_statement",
+    [Ruyi_at_continue_statement]              = "continue_statement",
+    [Ruyi_at_labeled_statement]               = "labeled_statement",
+    [Ruyi_at_sub_block_statement]             = "sub_block_statement",
+    [Ruyi_at_parameter_type_list]             = "parameter_type_list",
+    [Ruyi_at_type_list]                       = "type_list",
+    [Ruyi_at_expr_list]                       = "expr_list",
+};
+
+static void ast_dump_append(char *buf, UINT32 size, UINT32 *length, const char *text) {
+    UINT32 n = (UINT32)strlen(text);
+    assert(*length + n < size);
+    memcpy(buf + *length, text, n + 1);
+    *length += n;
+}
+
+// a node as its type, its value and its children: name 'a' for a symbol, integer=1, and '-' for an optional part left out
+static void ast_dump_node(const ruyi_ast *ast, char *buf, UINT32 size, UINT32 *length) {
+    char text[64];
+    const ruyi_unicode_string *str;
+    UINT32 i;
+    if (ast == NULL) {
+        ast_dump_append(buf, size, length, "-");
+        return;
+    }
+    ast_dump_append(buf, size, length, g_ast_type_names[ast->type]);
+    switch (ast->adt_type) {
+        case Ruyi_adt_symbol:
+        case Ruyi_adt_unicode_str:
+            str = (const ruyi_unicode_string*)ast->data.ptr_value;
+            ast_dump_append(buf, size, length, " '");
+            for (i = 0; str && i < str->length && i + 1 < sizeof(text); i++) {
+                text[i] = str->data[i] < 128 ? (char)str->data[i] : '?';
+            }
+            text[i] = '\0';
+            ast_dump_append(buf, size, length, text);
+            ast_dump_append(buf, size, length, "'");
+            break;
+        case Ruyi_adt_value:
+            if (ast->type == Ruyi_at_float) {
+                sprintf(text, "=%g", ast->data.float_value);
+                ast_dump_append(buf, size, length, text);
+            } else if (ast->data.int64_value != 0 || ast->type == Ruyi_at_integer || ast->type == Ruyi_at_bool) {
+                sprintf(text, "=%lld", (long long)ast->data.int64_value);
+                ast_dump_append(buf, size, length, text);
+            }
+            break;
+        default:
+            break;
+    }
+    if (ast->child_count == 0) {
+        return;
+    }
+    ast_dump_append(buf, size, length, "(");
+    for (i = 0; i < ast->child_count; i++) {
+        if (i > 0) {
+            ast_dump_append(buf, size, length, " ");
+        }
+        ast_dump_node(ast->children[i], buf, size, length);
+    }
+    ast_dump_append(buf, size, length, ")");
+}
+
+// the dump of an ast, in buf of size bytes
+static const char* ast_dump(const ruyi_ast *ast, char *buf, UINT32 size) {
+    UINT32 length = 0;
+    buf[0] = '\0';
+    ast_dump_node(ast, buf, size, &length);
+    return buf;
+}
+
+static void assert_ast_equals(const ruyi_ast *a, const ruyi_ast *b) {
+    UINT32 i;
+    // optional parts are NULL children
+    if (a == NULL || b == NULL) {
+        assert(a == b);
+        return;
+    }
+    assert(a->type == b->type);
+    assert(a->adt_type == b->adt_type);
+    switch (a->adt_type) {
+        case Ruyi_adt_value:
+            assert(a->data.int64_value == b->data.int64_value);
+            break;
+        case Ruyi_adt_unicode_str:
+            assert(ruyi_unicode_string_equals((ruyi_unicode_string*)a->data.ptr_value, (ruyi_unicode_string*)b->data.ptr_value));
+            break;
+        case Ruyi_adt_char_ptr:
+            assert(strcmp((const char*)a->data.ptr_value, (const char*)b->data.ptr_value) == 0);
+            break;
+        case Ruyi_adt_symbol:
+            assert(a->symbol == b->symbol);
+            break;
+        default:
+            break;
+    }
+    assert(ruyi_ast_child_length(a) == ruyi_ast_child_length(b));
+    for (i = 0; i < ruyi_ast_child_length(a); i++) {
+        assert_ast_equals(ruyi_ast_get_child(a, i), ruyi_ast_get_child(b, i));
+    }
+}
+
+void test_lexer_tokenize_all(void) {
+    const char* program = "package bb; import a1\n import a2; \n c1 := 10; var c2 long = 20;\n"
+    "// add\nfunc add1(a int, b long) long { return a*10 + b;}\n"
+    "/* if\n else */ func if1(a int, b long) long { if (a > 100.0) {return 100;} elseif (a > 50) {return 50;} elseif (a > b) {return a;}  else { return b;} }\n"
+    "func switch1(v int) {var b int; switch(v) {case 1,2,3: b=10;\n case 12+5: b = 20;\n default: b = 100} }";
+    const char* broken = "func f(a int) { return a + ; }";
+    ruyi_token_stream *stream;
+    ruyi_lexer_reader *reader;
+    ruyi_ast *ast = NULL;
+    ruyi_ast *stream_ast = NULL;
+    ruyi_error *err, *stream_err;
+    assert_stream_same_as_reader("var name = \"你好\\n\" // 注释\nx := 0x1F + 'c' * 1.5e3 /* a\r\n b */ y\r z", Ruyi_lo_NONE);
+    assert_stream_same_as_reader("a \r b \r\r c\n\n\n  d 中 e", Ruyi_lo_NONE);
+    assert_stream_same_as_reader(program, Ruyi_lo_NONE);
+    assert_stream_same_as_reader(program, Ruyi_lo_SKIP_COMMENTS);
+    assert_stream_same_as_reader("", Ruyi_lo_NONE);
+    // lexer errors
+    assert(NULL == ruyi_lexer_tokenize_all(ruyi_file_init_by_data("a = 99999999999999999999", 24), Ruyi_lo_NONE));
+    // the parser reads a stream the same as a file
+    reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_data(program, (UINT32)strlen(program)), Ruyi_lo_SKIP_COMMENTS);
+    err = ruyi_parse_ast(reader, &ast);
+    ruyi_lexer_reader_close(reader);
+    assert(err == NULL);
+    stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(program, (UINT32)strlen(program)), Ruyi_lo_SKIP_COMMENTS);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    err = ruyi_parse_ast(reader, &stream_ast);
+    ruyi_lexer_reader_close(reader);
+    ruyi_token_stream_destroy(stream);
+    assert(err == NULL);
+    assert_ast_equals(ast, stream_ast);
+    ruyi_ast_destroy(ast);
+    ruyi_ast_destroy(stream_ast);
+    // and reports the same errors
+    reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(broken, (UINT32)strlen(broken)));
+    err = ruyi_parse_ast(reader, &ast);
+    ruyi_lexer_reader_close(reader);
+    stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(broken, (UINT32)strlen(broken)), Ruyi_lo_NONE);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    stream_err = ruyi_parse_ast(reader, &stream_ast);
+    ruyi_lexer_reader_close(reader);
+    ruyi_token_stream_destroy(stream);
+    assert(err && stream_err);
+    assert(err->line == stream_err->line && err->column == stream_err->column);
+    assert(strcmp(err->message, stream_err->message) == 0);
+    ruyi_error_destroy(err);
+    ruyi_error_destroy(stream_err);
+}
+
+// lex the source and check the positions of the tokens with the ones counted char by char
+static void assert_token_positions(const char *src, UINT32 length, UINT32 options) {
+    UINT32 *lines = (UINT32*)ruyi_mem_alloc(sizeof(UINT32) * (length + 1));
+    UINT32 *columns = (UINT32*)ruyi_mem_alloc(sizeof(UINT32) * (length + 1));
+    ruyi_lexer_reader *reader;
+    ruyi_token *token;
+    UINT32 chars = 0;
+    UINT32 line = 1, column = 1;
+    UINT32 i;
+    for (i = 0; i < length; i++) {
+        if (((BYTE)src[i] & 0xC0) == 0x80) {
+            continue;
+        }
+        lines[chars] = line;
+        columns[chars] = column;
+        chars++;
+        if (src[i] == '\n') {
+            line++;
+            column = 1;
+        } else if (src[i] != '\r') {
+            column++;
+        }
+    }
+    lines[chars] = line;
+    columns[chars] = column;
+    reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_data(src, length), options);
+    for (;;) {
+        token = ruyi_lexer_reader_next_token(reader);
+        assert(token);
+        assert(token->offset <= chars);
+        ruyi_lexer_reader_position(reader, token->offset, &line, &column);
+        assert(line == lines[token->offset] && column == columns[token->offset]);
+        if (token->type == Ruyi_tt_END) {
+            assert(token->offset == chars);
+            break;
+        }
+    }
+    ruyi_lexer_reader_close(reader);
+    ruyi_mem_free(lines);
+    ruyi_mem_free(columns);
+}
+
+void test_lexer_token_positions(void) {
+    const char *pieces[] = {"a", " b1", "\n", "\r\n", "\r", " 中", " \"文\\n\"", " // 注释 x\r\n", " /* a\r\n b\r c */ d",
+        " /* long ", "* ", " 0x1F", "\t+= ", "'c'"};
+    const char *comment_chars[] = {"x", "\r", "\n", "中", "*"};
+    char *src = (char*)ruyi_mem_alloc(64 * 1024);
+    UINT64 seed = 7;
+    UINT32 length = 0;
+    UINT32 i, n;
+    ruyi_lexer_reader *reader;
+    ruyi_ast *ast = NULL;
+    ruyi_error *err;
+    // the '\r' and '\n' fall on every place of the chars decoded at a time, and of the bytes skipped
+    while (length < 60 * 1024) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        n = (UINT32)((seed >> 33) % (sizeof(pieces) / sizeof(pieces[0])));
+        if (n == 9) {
+            // a comment longer than the chars decoded at a time, so it is skipped in the bytes
+            memcpy(src + length, " /* ", 4);
+            length += 4;
+            for (i = 0; i < 300; i++) {
+                n = (UINT32)((seed >> (i % 32)) % 5);
+                memcpy(src + length, comment_chars[n], strlen(comment_chars[n]));
+                length += (UINT32)strlen(comment_chars[n]);
+            }
+            memcpy(src + length, "*/ y", 4);
+            length += 4;
+            continue;
+        }
+        memcpy(src + length, pieces[n], strlen(pieces[n]));
+        length += (UINT32)strlen(pieces[n]);
+    }
+    assert_token_positions(src, length, Ruyi_lo_NONE);
+    assert_token_positions(src, length, Ruyi_lo_SKIP_COMMENTS);
+    assert_token_positions("", 0, Ruyi_lo_NONE);
+    assert_token_positions("\r\r\n\r", 4, Ruyi_lo_NONE);
+    ruyi_mem_free(src);
+    // errors find the position of the token only when they are made
+    reader = ruyi_lexer_reader_open(ruyi_file_init_by_data("var a int\r\n\r\n \r\t= ;", 19));
+    err = ruyi_parse_ast(reader, &ast);
+    ruyi_lexer_reader_close(reader);
+    assert(err);
+    assert(err->line == 3 && err->column == 3);
+    ruyi_error_destroy(err);
+}
+
+// the streams must have the same tokens at the same positions
+static void assert_streams_equal(const ruyi_token_stream *a, const ruyi_token_stream *b) {
+    ruyi_token_cursor cursor_a, cursor_b;
+    ruyi_token token_a, token_b;
+    UINT32 i;
+    UINT32 line_a, column_a, line_b, column_b;
+    assert(a->count == b->count);
+    assert(a->literal_count == b->literal_count);
+    assert(a->lines->count == b->lines->count);
+    assert(memcmp(a->lines->starts, b->lines->starts, sizeof(UINT32) * a->lines->count) == 0);
+    ruyi_token_cursor_init(&cursor_a, a);
+    ruyi_token_cursor_init(&cursor_b, b);
+    for (i = 0; i < a->count; i++) {
+        ruyi_token_cursor_get(&cursor_a, 0, &token_a);
+        ruyi_token_cursor_get(&cursor_b, 0, &token_b);
+        assert(token_a.type == token_b.type);
+        assert(token_a.offset == token_b.offset);
+        assert(token_a.size == token_b.size);
+        assert(token_a.symbol == token_b.symbol);
+        switch (token_a.type) {
+            case Ruyi_tt_IDENTITY:
+            case Ruyi_tt_STRING:
+                assert(ruyi_unicode_string_equals(token_a.value.str_value, token_b.value.str_value));
+                break;
+            case Ruyi_tt_INTEGER:
+            case Ruyi_tt_CHAR:
+                assert(token_a.value.int_value == token_b.value.int_value);
+                break;
+            case Ruyi_tt_FLOAT:
+                assert(token_a.value.float_value == token_b.value.float_value);
+                break;
+            default:
+                break;
+        }
+        ruyi_line_table_position(a->lines, token_a.offset, &line_a, &column_a);
+        ruyi_line_table_position(b->lines, token_b.offset, &line_b, &column_b);
+        assert(line_a == line_b && column_a == column_b);
+        ruyi_token_cursor_advance(&cursor_a, 1);
+        ruyi_token_cursor_advance(&cursor_b, 1);
+    }
+}
+
+static void assert_parallel_same_as_all(const char *src, UINT32 length, UINT32 options, UINT32 threads) {
+    ruyi_token_stream *all = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, length), options);
+    ruyi_token_stream *parallel = ruyi_lexer_tokenize_parallel(ruyi_file_init_by_data(src, length), options, threads);
+    assert(all && parallel);
+    assert_streams_equal(all, parallel);
+    ruyi_token_stream_destroy(all);
+    ruyi_token_stream_destroy(parallel);
+}
+
+void test_lexer_tokenize_parallel(void) {
+    // the multiline strings and comments have what looks like the start of other tokens,
+    // so a chunk starting in them is lexed wrong and has to be lexed again
+    const char *pieces[] = {"a", " b1", "\n", "\r\n", " 中", " \"文\\n\"", " // 注释 /* x\r\n", " /* a\r\n \" b\r c */ d",
+        " \"line\n// not a comment\n/* nor this\n'\n\"", " '\n'", " 0x1F", "\t+= ", "'c'", " 1.5e3", " /* long "};
+    const char *comment_lines[] = {"x \" y\n", "'\n", "// z\n", "中 \"\n", "* a\r\n"};
+    UINT32 size = 3 * 1024 * 1024;
+    char *src = (char*)ruyi_mem_alloc(size + 1024);
+    UINT64 seed = 11;
+    UINT32 length = 0;
+    UINT32 i, n;
+    while (length < size) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        n = (UINT32)((seed >> 33) % (sizeof(pieces) / sizeof(pieces[0])));
+        if (n == 14) {
+            // a comment of many lines, the chunks are cut in them
+            memcpy(src + length, " /* ", 4);
+            length += 4;
+            for (i = 0; i < 60; i++) {
+                n = (UINT32)((seed >> (i % 32)) % 5);
+                memcpy(src + length, comment_lines[n], strlen(comment_lines[n]));
+                length += (UINT32)strlen(comment_lines[n]);
+            }
+            memcpy(src + length, "*/ y", 4);
+            length += 4;
+            continue;
+        }
+        memcpy(src + length, pieces[n], strlen(pieces[n]));
+        length += (UINT32)strlen(pieces[n]);
+    }
+    assert_parallel_same_as_all(src, length, Ruyi_lo_NONE, 4);
+    assert_parallel_same_as_all(src, length, Ruyi_lo_SKIP_COMMENTS, 3);
+    assert_parallel_same_as_all(src, length, Ruyi_lo_NONE, 0);
+    // too small to be cut
+    assert_parallel_same_as_all("x := 1 /* a\n b */ y", 19, Ruyi_lo_NONE, 4);
+    // the source ends in an unclosed comment
+    memcpy(src + length, " /* a\n b", 8);
+    assert_parallel_same_as_all(src, length + 8, Ruyi_lo_NONE, 4);
+    // a lexer error in a later chunk fails the whole stream, as when it is lexed by one reader
+    memcpy(src + length, " 99999999999999999999", 21);
+    assert(NULL == ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, length + 21), Ruyi_lo_NONE));
+    assert(NULL == ruyi_lexer_tokenize_parallel(ruyi_file_init_by_data(src, length + 21), Ruyi_lo_NONE, 4));
+    ruyi_mem_free(src);
+}
+
+
+// the text of the token of an error is found in the source only when the error is made
+static void assert_error_text(ruyi_lexer_reader *reader, const char *text) {
+    ruyi_ast *ast = NULL;
+    ruyi_error *err = ruyi_parse_ast(reader, &ast);
+    ruyi_lexer_reader_close(reader);
+    assert(err);
+    if (text) {
+        assert(err->text && strcmp(err->text, text) == 0);
+    } else {
+        assert(err->text == NULL);
+    }
+    ruyi_error_destroy(err);
 }
 
+void test_lexer_error_token_text(void) {
+    const char *cjk = "var a = \"中文\"\nvar b int = ]";
+    const char *head = "var a int\r\n\r\n \r\t= ;";
+    char src[1024];
+    char text[LEXER_TOKEN_TEXT_SIZE * 4 + 1];
+    char small[8];
+    UINT32 length;
+    ruyi_token_stream *stream;
+    ruyi_lexer_reader *reader;
+    assert_error_text(ruyi_lexer_reader_open(ruyi_file_init_by_data(head, (UINT32)strlen(head))), "=");
+    assert_error_text(ruyi_lexer_reader_open(ruyi_file_init_by_data(cjk, (UINT32)strlen(cjk))), "=");
+    assert_error_text(ruyi_lexer_reader_open(ruyi_file_init_by_data("var 名字 int = )", 18)), "int");
+    // no text at the end of file
+    assert_error_text(ruyi_lexer_reader_open(ruyi_file_init_by_data("var a int = 1 +", 15)), NULL);
+    // a token stream keeps no source
+    stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(head, (UINT32)strlen(head)), Ruyi_lo_NONE);
+    assert_error_text(ruyi_lexer_reader_open_stream(stream), NULL);
+    ruyi_token_stream_destroy(stream);
+    // the text is cut at LEXER_TOKEN_TEXT_SIZE chars, and a small buffer never cuts a char
+    memcpy(src, "s = \"", 5);
+    length = 5;
+    while (length < 5 + 200 * 3) {
+        memcpy(src + length, "变", 3);
+        length += 3;
+    }
+    src[length++] = '"';
+    reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(src, length));
+    assert(Ruyi_tt_IDENTITY == ruyi_lexer_reader_peek_token_type(reader));
+    ruyi_lexer_reader_consume_token(reader);
+    assert(Ruyi_tt_ASSIGN == ruyi_lexer_reader_peek_token_type(reader));
+    ruyi_lexer_reader_consume_token(reader);
+    assert(Ruyi_tt_STRING == ruyi_lexer_reader_peek_token_type(reader));
+    assert(202 == reader->token_snapshot.size);
+    assert(1 + (LEXER_TOKEN_TEXT_SIZE - 1) * 3 == ruyi_lexer_reader_token_text(reader, reader->token_snapshot.offset, reader->token_snapshot.size, text, sizeof(text)));
+    assert(memcmp(text, src + 4, 1 + (LEXER_TOKEN_TEXT_SIZE - 1) * 3) == 0);
+    assert(7 == ruyi_lexer_reader_token_text(reader, reader->token_snapshot.offset, reader->token_snapshot.size, small, sizeof(small)));
+    assert(strcmp(small, "\"变变") == 0);
+    ruyi_lexer_reader_close(reader);
+}
 
 void test_unicode_string(void) {
     ruyi_value v2, v3;
@@ -744,12 +2002,12 @@ void test_parser_expression() {
     //assign_ast->data.ptr_value
     v1 = ruyi_unicode_string_init_from_utf8("bb", 0);
     assert(ruyi_unicode_string_equals(v1, (ruyi_unicode_string*)assign_ast->data.ptr_value));
-    assert(2 == assign_ast->child_asts->len);
+    assert(2 == ruyi_ast_child_length(assign_ast));
     type_ast = ruyi_ast_get_child(assign_ast, 0);
     expr_ast = ruyi_ast_get_child(assign_ast, 1);
     assert(type_ast->type = Ruyi_at_var_declaration_auto_type);
     assert(expr_ast->type = Ruyi_at_additive_expression);
-    assert(3 == expr_ast->child_asts->len);
+    assert(3 == ruyi_ast_child_length(expr_ast));
 
     var_aa_ast = ruyi_ast_get_child(expr_ast, 0);
     op_ast = ruyi_ast_get_child(expr_ast, 1);
@@ -807,6 +2065,8 @@ void test_parser_package_import_vars() {
     temp_ast = ruyi_ast_get_child(package_declaration, 0);
     name = ruyi_unicode_string_init_from_utf8("bb", 0);
     assert(ruyi_unicode_string_equals(name, (ruyi_unicode_string*)temp_ast->data.ptr_value));
+    assert(Ruyi_adt_symbol == temp_ast->adt_type);
+    assert(ruyi_symbol_intern_unicode(name) == temp_ast->symbol);
     ruyi_unicode_string_destroy(name);
     
     // import a1\n import a2; \n
@@ -1937,6 +3197,78 @@ void test_parser_function_func_type(void) {
     ruyi_ast_destroy(ast);
 }
 
+static UINT32 count_ast_nodes(const ruyi_ast *ast) {
+    UINT32 i, count = 1;
+    for (i = 0; i < ruyi_ast_child_length(ast); i++) {
+        if (ruyi_ast_get_child(ast, i)) {
+            count += count_ast_nodes(ruyi_ast_get_child(ast, i));
+        }
+    }
+    return count;
+}
+
+void test_parser_ast_arena(void) {
+    const char *func = "func f%u(a int, b int) int {\n s := \"name\"\n for (x in []int[1, 2, 4]) { a = a + x * b; }\n return a\n}\n";
+    char *src = (char*)ruyi_mem_alloc(64 * 1024);
+    UINT32 length = (UINT32)sprintf(src, "package bb.cc;\n");
+    UINT32 i, nodes;
+    UINT64 allocs;
+    ruyi_token_stream *stream;
+    ruyi_lexer_reader *reader;
+    ruyi_error *err;
+    ruyi_ast *ast = NULL, *other = NULL, *heap_ast;
+    ruyi_unicode_string *name;
+    for (i = 0; i < 200; i++) {
+        length += (UINT32)sprintf(src + length, func, i);
+    }
+    // lexed before, so only the parser allocates while parsing
+    stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, length), Ruyi_lo_NONE);
+    assert(stream);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    allocs = ruyi_mem_alloc_count();
+    err = ruyi_parse_ast(reader, &ast);
+    allocs = ruyi_mem_alloc_count() - allocs;
+    ruyi_lexer_reader_close(reader);
+    ruyi_token_stream_destroy(stream);
+    assert(err == NULL);
+    assert(Ruyi_at_root == ast->type);
+    assert(Ruyi_adt_arena == ast->adt_type);
+    nodes = count_ast_nodes(ast);
+    assert(nodes > 200 * 20);
+    // nodes, children and strings come from a few arena blocks, the parser allocates nothing else
+    assert(allocs < nodes / 256);
+    // a node of the tree is released with the root only
+    ruyi_ast_destroy(ruyi_ast_get_child(ast, 2));
+    ruyi_ast_destroy_without_child(ruyi_ast_get_child(ast, 2));
+    reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(src, length));
+    err = ruyi_parse_ast(reader, &other);
+    ruyi_lexer_reader_close(reader);
+    assert(err == NULL);
+    assert_ast_equals(ast, other);
+    ruyi_ast_destroy(ast);
+    ruyi_ast_destroy(other);
+    // the nodes made before an error are released with the arena
+    reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(src, length - 3));
+    ast = NULL;
+    err = ruyi_parse_ast(reader, &ast);
+    ruyi_lexer_reader_close(reader);
+    assert(err != NULL);
+    assert(ast == NULL);
+    ruyi_error_destroy(err);
+    ruyi_mem_free(src);
+    // nodes out of any arena are released one by one
+    heap_ast = ruyi_ast_create(NULL, Ruyi_at_root);
+    name = ruyi_unicode_string_init_from_utf8("name", 0);
+    for (i = 0; i < 9; i++) {
+        ruyi_ast_add_child(heap_ast, ruyi_ast_create_with_unicode(NULL, Ruyi_at_string, name));
+    }
+    assert(9 == ruyi_ast_child_length(heap_ast));
+    assert(NULL == ruyi_ast_get_child(heap_ast, 9));
+    assert(ruyi_unicode_string_equals(name, (ruyi_unicode_string*)ruyi_ast_get_child(heap_ast, 8)->data.ptr_value));
+    ruyi_unicode_string_destroy(name);
+    ruyi_ast_destroy(heap_ast);
+}
+
 void test_ruyi_function_scope() {
     ruyi_error *err;
     ruyi_function_scope *scope = ruyi_symtab_function_scope_create(Ruyi_sid_Var);
@@ -1945,10 +3277,10 @@ void test_ruyi_function_scope() {
     ruyi_symtab_variable output_var;
     UINT32 index_create;
     input_var.type.ir_type = Ruyi_ir_type_Int64;
-    input_var.name = name;
+    input_var.name = ruyi_symbol_intern_unicode(name);
     err = ruyi_symtab_function_scope_add_var(scope, &input_var, &index_create);
     assert(err == NULL);
-    BOOL found = ruyi_symtab_function_scope_get(scope, name, &output_var);
+    BOOL found = ruyi_symtab_function_scope_get(scope, ruyi_symbol_intern_unicode(name), &output_var);
     assert(found);
     assert(index_create == output_var.index);
     ruyi_symtab_function_scope_destroy(scope);
@@ -2015,6 +3347,40 @@ void test_cg_package_import_global_vars() {
     ruyi_cg_file_destroy(ir_file);
 }
 
+void test_cg_names(void) {
+    // the names are copied with their lengths, the encoded string is released after them
+    const char* src = "package bb.cc\n a_global_variable := 10\n func a_function_name(a int) int { return a }\n";
+    ruyi_lexer_reader* reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(src, (UINT32)strlen(src)));
+    ruyi_ast *ast = NULL;
+    ruyi_cg_file *ir_file = NULL;
+    assert(NULL == ruyi_parse_ast(reader, &ast));
+    ruyi_lexer_reader_close(reader);
+    assert(NULL == ruyi_cg_generate(ast, &ir_file));
+    ruyi_ast_destroy(ast);
+    assert(1 == ir_file->gv_count);
+    assert(17 == ir_file->gv[0]->name_size);
+    assert(0 == memcmp("a_global_variable", ir_file->gv[0]->name, 17));
+    assert(1 == ir_file->func_count);
+    assert(15 == ir_file->func[0]->name_size);
+    assert(0 == memcmp("a_function_name", ir_file->func[0]->name, 15));
+    ruyi_cg_file_destroy(ir_file);
+}
+
+void test_cg_duplicate_function(void) {
+    // the error of the symbol table, not a function missing
+    const char* src = "package bb.cc\n func f1(a int) int { return a }\n func f1(b int) int { return b }\n";
+    ruyi_lexer_reader* reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(src, (UINT32)strlen(src)));
+    ruyi_ast *ast = NULL;
+    ruyi_cg_file *ir_file = NULL;
+    ruyi_error *err;
+    assert(NULL == ruyi_parse_ast(reader, &ast));
+    ruyi_lexer_reader_close(reader);
+    assert(NULL != (err = ruyi_cg_generate(ast, &ir_file)));
+    assert(NULL != strstr(err->message, "f1"));
+    ruyi_error_destroy(err);
+    ruyi_ast_destroy(ast);
+}
+
 void test_cg_funcs() {
     const char* src = "package bb.cc; import a2; \n c2 := 10; func f1(a1 int, a2 long) (int, int) { return a1*2 + a2, 12; } \n"
                         "func f2(arg1 int, arg2 long) (long, int) { c := arg2 *2; return arg1 + c, 20; }";
@@ -2351,6 +3717,192 @@ void test_cg_funcs6_array() {
     ruyi_cg_file_destroy(ir_file);
 }
 
+static void assert_ast_tree_equals(const ruyi_ast_tree *tree, ruyi_ast_id id, const ruyi_ast *ast) {
+    UINT32 i;
+    if (ast == NULL) {
+        assert(id == RUYI_AST_NONE);
+        return;
+    }
+    assert(ruyi_ast_tree_type(tree, id) == ast->type);
+    switch (ast->adt_type) {
+        case Ruyi_adt_symbol:
+            assert(ruyi_ast_tree_data_type(tree, id) == Ruyi_adt_symbol);
+            assert(ruyi_ast_tree_symbol(tree, id) == ast->symbol);
+            break;
+        case Ruyi_adt_unicode_str:
+            assert(ruyi_ast_tree_data_type(tree, id) == Ruyi_adt_unicode_str);
+            assert(ruyi_unicode_string_equals(ruyi_ast_tree_string(tree, id), (ruyi_unicode_string*)ast->data.ptr_value));
+            break;
+        case Ruyi_adt_arena:
+            // the root keeps no data in the flat tree
+            assert(ruyi_ast_tree_int_value(tree, id) == 0);
+            break;
+        default:
+            assert(ruyi_ast_tree_data_type(tree, id) == ast->adt_type);
+            assert(ruyi_ast_tree_int_value(tree, id) == ast->data.int64_value);
+            break;
+    }
+    assert(ruyi_ast_tree_child_length(tree, id) == ruyi_ast_child_length(ast));
+    for (i = 0; i < ruyi_ast_child_length(ast); i++) {
+        assert_ast_tree_equals(tree, ruyi_ast_tree_get_child(tree, id, i), ruyi_ast_get_child(ast, i));
+    }
+    assert(RUYI_AST_NONE == ruyi_ast_tree_get_child(tree, id, ruyi_ast_child_length(ast)));
+}
+
+void test_cg_ast_tree() {
+    const char* src = "package bb.cc; import a2; \n c2 := 10; var f double = 2.5\n"
+    "func f1(a1 int, a2 long) (int, int) { s := \"中文\"; return a1*2 + a2, 12; } \n"
+    "func f2(arg1 int, arg2 long) (long, int) { c := arg2 *2; while (c > 10) { c = c - 1; if c == 3 { break; } } return arg1 + c, 20; }";
+    ruyi_lexer_reader *reader;
+    ruyi_error *err;
+    ruyi_ast *ast = NULL;
+    ruyi_ast_tree *tree = NULL;
+    ruyi_cg_file *ir_file, *tree_ir_file;
+    UINT32 i;
+    reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(src, (UINT32)strlen(src)));
+    err = ruyi_parse_ast(reader, &ast);
+    ruyi_lexer_reader_close(reader);
+    assert(err == NULL);
+    reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(src, (UINT32)strlen(src)));
+    err = ruyi_parse_ast_tree(reader, &tree);
+    ruyi_lexer_reader_close(reader);
+    assert(err == NULL);
+    // nodes[0] is left for RUYI_AST_NONE, the root is the first in pre-order
+    assert(1 == ruyi_ast_tree_root(tree));
+    assert_ast_tree_equals(tree, ruyi_ast_tree_root(tree), ast);
+    assert(1 == tree->string_count);
+    assert(2 == tree->char_count);
+    assert(2.5 == ruyi_ast_tree_float_value(tree, ruyi_ast_tree_get_child(tree, ruyi_ast_tree_get_child(tree, ruyi_ast_tree_get_child(tree, 1, 2), 1), 1)));
+    // the same ir from both trees
+    err = ruyi_cg_generate(ast, &ir_file);
+    assert(err == NULL);
+    err = ruyi_cg_generate_tree(tree, &tree_ir_file);
+    assert(err == NULL);
+    assert(2 == ir_file->func_count);
+    assert(ir_file->func_count == tree_ir_file->func_count);
+    for (i = 0; i < ir_file->func_count; i++) {
+        assert(ir_file->func[i]->codes_size == tree_ir_file->func[i]->codes_size);
+        assert(0 == memcmp(ir_file->func[i]->codes, tree_ir_file->func[i]->codes, sizeof(UINT32) * ir_file->func[i]->codes_size));
+    }
+    assert(ir_file->cp_count == tree_ir_file->cp_count);
+    ruyi_cg_file_destroy(ir_file);
+    ruyi_cg_file_destroy(tree_ir_file);
+    ruyi_ast_tree_destroy(tree);
+    ruyi_ast_destroy(ast);
+}
+
+static void assert_same_ir(const ruyi_ast_tree *tree, const ruyi_ast_tree *other) {
+    ruyi_cg_file *ir_file, *other_ir_file;
+    UINT32 i;
+    assert(NULL == ruyi_cg_generate_tree(tree, &ir_file));
+    assert(NULL == ruyi_cg_generate_tree(other, &other_ir_file));
+    assert(ir_file->func_count == other_ir_file->func_count);
+    for (i = 0; i < ir_file->func_count; i++) {
+        assert(ir_file->func[i]->codes_size == other_ir_file->func[i]->codes_size);
+        assert(0 == memcmp(ir_file->func[i]->codes, other_ir_file->func[i]->codes, sizeof(UINT32) * ir_file->func[i]->codes_size));
+    }
+    assert(ir_file->cp_count == other_ir_file->cp_count);
+    ruyi_cg_file_destroy(ir_file);
+    ruyi_cg_file_destroy(other_ir_file);
+}
+
+void test_cg_ast_cache() {
+    const char* src = "package bb.cc; import a2; \n c2 := 10; var f double = 2.5\n"
+    "func f1(a1 int, a2 long) (int, int) { s := \"中文\"; t := \"\"; return a1*2 + a2, 12; } \n"
+    "func f2(arg1 int, arg2 long) (long, int) { c := arg2 *2; while (c > 10) { c = c - 1; if c == 3 { break; } } return arg1 + c, 20; }";
+    UINT32 length = (UINT32)strlen(src);
+    UINT64 key = ruyi_ast_cache_key((const BYTE*)src, length);
+    char path[64];
+    ruyi_lexer_reader *reader;
+    ruyi_ast *ast = NULL;
+    ruyi_ast_tree *tree = NULL, *cached = NULL;
+    FILE *fp;
+    BYTE *image;
+    UINT32 size;
+    UINT16 saved;
+#if !defined(_WIN32)
+    pid_t writers[2];
+    int status;
+    UINT32 i, k;
+#endif
+    // the key is of all bytes and the length
+    assert(key != ruyi_ast_cache_key((const BYTE*)src, length - 1));
+    assert(key != ruyi_ast_cache_key((const BYTE*)"package bb.cd", 13));
+    assert(ruyi_ast_cache_key((const BYTE*)"package bb.cc", 13) != ruyi_ast_cache_key((const BYTE*)"package bb.cd", 13));
+    sprintf(path, "/tmp/%016llx.ast", (unsigned long long)key);
+    remove(path);
+    reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(src, length));
+    assert(NULL == ruyi_parse_ast(reader, &ast));
+    ruyi_lexer_reader_close(reader);
+
+    // a miss parses and saves the file, a hit maps it
+    assert(NULL == ruyi_ast_cache_parse("/tmp", (const BYTE*)src, length, &tree));
+    assert(NULL == tree->image);
+    assert(NULL == ruyi_ast_cache_parse("/tmp", (const BYTE*)src, length, &cached));
+    assert(NULL != cached->image);
+    assert_ast_tree_equals(cached, ruyi_ast_tree_root(cached), ast);
+    assert(2 == cached->string_count);
+    assert(2.5 == ruyi_ast_tree_float_value(cached, ruyi_ast_tree_get_child(cached, ruyi_ast_tree_get_child(cached, ruyi_ast_tree_get_child(cached, 1, 2), 1), 1)));
+    assert_same_ir(tree, cached);
+    ruyi_ast_tree_destroy(cached);
+    // of another source
+    assert(NULL == ruyi_ast_cache_load(path, key + 1));
+
+    // a broken file is missed
+    fp = fopen(path, "rb");
+    fseek(fp, 0, SEEK_END);
+    size = (UINT32)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    image = (BYTE*)ruyi_mem_alloc(size);
+    assert(size == fread(image, 1, size, fp));
+    fclose(fp);
+    fp = fopen(path, "wb");
+    fwrite(image, 1, size - 1, fp);
+    fclose(fp);
+    assert(NULL == ruyi_ast_cache_load(path, key));
+    ruyi_mem_free(image);
+#if !defined(_WIN32)
+    // writers of one file at once, each writes a temp file of its own, so a reader always maps a whole file
+    assert(NULL == ruyi_ast_cache_save(tree, key, path));
+    for (i = 0; i < 2; i++) {
+        if ((writers[i] = fork()) == 0) {
+            for (k = 0; k < 50; k++) {
+                assert(NULL == ruyi_ast_cache_save(tree, key, path));
+            }
+            _exit(0);
+        }
+    }
+    for (k = 0; k < 200; k++) {
+        assert(NULL != (cached = ruyi_ast_cache_load(path, key)));
+        ruyi_ast_tree_destroy(cached);
+    }
+    for (i = 0; i < 2; i++) {
+        assert(writers[i] == waitpid(writers[i], &status, 0) && WIFEXITED(status) && 0 == WEXITSTATUS(status));
+    }
+#endif
+    // a type or a data type out of range
+    saved = tree->nodes[2].type;
+    tree->nodes[2].type = Ruyi_at_COUNT;
+    assert(NULL == ruyi_ast_cache_save(tree, key, path));
+    assert(NULL == ruyi_ast_cache_load(path, key));
+    tree->nodes[2].type = saved;
+    saved = tree->nodes[2].adt_type;
+    tree->nodes[2].adt_type = Ruyi_adt_lazy_body + 1;
+    assert(NULL == ruyi_ast_cache_save(tree, key, path));
+    assert(NULL == ruyi_ast_cache_load(path, key));
+    tree->nodes[2].adt_type = saved;
+    assert(NULL == ruyi_ast_cache_save(tree, key, path));
+    assert(NULL != (cached = ruyi_ast_cache_load(path, key)));
+    ruyi_ast_tree_destroy(cached);
+    // a child pointing back to the root
+    tree->child_ids[0] = ruyi_ast_tree_root(tree);
+    assert(NULL == ruyi_ast_cache_save(tree, key, path));
+    assert(NULL == ruyi_ast_cache_load(path, key));
+    remove(path);
+    ruyi_ast_tree_destroy(tree);
+    ruyi_ast_destroy(ast);
+}
+
 void run_test_cases_bytes() {
     UINT16 v16 = 0x1234, bv16;
     UINT32 v32 = 0x12345678, bv32;
@@ -2402,17 +3954,1170 @@ void run_test_cases_basic(void) {
     test_hashtable_unicode_str();
     test_unicode();
     test_unicode_string();
+    test_unicode_decode_utf8();
+    test_symbol_intern();
+    test_number_parse();
+    test_stack();
     //  test_file();
     //  test_unicode_file();
     run_test_cases_bytes();
 
 }
 
+static void assert_peek_nth_same_as_read(ruyi_lexer_reader *reader, UINT32 count) {
+    ruyi_token_type types[64];
+    UINT32 i, j;
+    // far past the first ring, and again after the head has moved so the window wraps
+    for (j = 0; j < 2; j++) {
+        for (i = 0; i < 64; i++) {
+            types[i] = ruyi_lexer_reader_peek_nth_token_type(reader, i);
+        }
+        assert(types[0] == ruyi_lexer_reader_peek_token_type(reader));
+        for (i = 0; i < 64; i++) {
+            if (types[i] == Ruyi_tt_END) {
+                assert(Ruyi_tt_END == ruyi_lexer_reader_peek_token_type(reader));
+            } else {
+                assert(ruyi_lexer_reader_consume_token_if_match(reader, types[i], NULL));
+            }
+        }
+        count = count > 64 ? count - 64 : 0;
+        assert((types[63] == Ruyi_tt_END) == (count == 0));
+    }
+}
+
+void test_lexer_peek_nth(void) {
+    char src[1024];
+    UINT32 length = 0;
+    UINT32 i;
+    ruyi_lexer_reader *reader;
+    ruyi_token_stream *stream;
+    for (i = 0; i < 30; i++) {
+        length += (UINT32)sprintf(src + length, "a%u := %u;\n", i, i);
+    }
+    // 120 tokens
+    reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(src, length));
+    assert(Ruyi_tt_COLON_ASSIGN == ruyi_lexer_reader_peek_nth_token_type(reader, 1));
+    assert(Ruyi_tt_END == ruyi_lexer_reader_peek_nth_token_type(reader, 120));
+    assert(Ruyi_tt_IDENTITY == ruyi_lexer_reader_peek_token_type(reader));
+    assert_peek_nth_same_as_read(reader, 120);
+    ruyi_lexer_reader_close(reader);
+    stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, length), Ruyi_lo_NONE);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    assert_peek_nth_same_as_read(reader, 120);
+    ruyi_lexer_reader_close(reader);
+    ruyi_token_stream_destroy(stream);
+}
+
 void run_test_cases_lexer(void) {
     test_lexer_id_number();
     test_lexer_id_number_string_char_comments();
     test_lexer_symbols();
     test_lexer_keywords();
+    test_lexer_keywords_table();
+    test_lexer_identifier_symbols();
+    test_lexer_dfa_tokens();
+    test_lexer_number_values();
+    test_lexer_mmap_file();
+    test_lexer_stream_file();
+    test_lexer_skip_comments();
+    test_lexer_skip_comments_stream();
+    test_lexer_tokenize_all();
+    test_lexer_token_positions();
+    test_lexer_tokenize_parallel();
+    test_lexer_error_token_text();
+    test_lexer_peek_match_no_alloc();
+    test_lexer_peek_nth();
+}
+
+typedef struct {
+    char *data;
+    UINT32 length;
+    UINT64 seed;
+} expression_builder;
+
+static UINT32 expression_random(expression_builder *builder, UINT32 n) {
+    builder->seed = builder->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (UINT32)((builder->seed >> 33) % n);
+}
+
+static void expression_append(expression_builder *builder, const char *text) {
+    UINT32 length = (UINT32)strlen(text);
+    memcpy(builder->data + builder->length, text, length);
+    builder->length += length;
+}
+
+// a source and the dump of the ast it is parsed to, or its error
+typedef struct {
+    const char *source;
+    const char *expected;
+} parse_golden;
+
+// the dump of the node at path, a child index for each char from the root, or the error as "error: message @line:column"
+static const char* parse_dump(const char *src, const char *path, char *buf, UINT32 size) {
+    ruyi_lexer_reader *reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(src, (UINT32)strlen(src)));
+    ruyi_ast *ast = NULL;
+    const ruyi_ast *node;
+    ruyi_error *err = ruyi_parse_ast(reader, &ast);
+    ruyi_lexer_reader_close(reader);
+    if (err != NULL) {
+        snprintf(buf, size, "error: %s @%u:%u", err->message, err->line, err->column);
+        ruyi_error_destroy(err);
+        return buf;
+    }
+    for (node = ast; *path; path++) {
+        node = ruyi_ast_get_child(node, (UINT32)(*path - '0'));
+    }
+    ast_dump(node, buf, size);
+    ruyi_ast_destroy(ast);
+    return buf;
+}
+
+// each source put in the format is parsed to the ast or error expected
+static void assert_parse_goldens(const parse_golden *goldens, UINT32 count, const char *format, const char *path) {
+    char src[1024];
+    char buf[4096];
+    UINT32 i;
+    for (i = 0; i < count; i++) {
+        snprintf(src, sizeof(src), format, goldens[i].source);
+        parse_dump(src, path, buf, sizeof(buf));
+        if (strcmp(buf, goldens[i].expected) != 0) {
+            printf("%s\n  expected: %s\n  parsed:   %s\n", goldens[i].source, goldens[i].expected, buf);
+            assert(0);
+        }
+    }
+}
+
+void test_parser_binary_expression(void) {
+    // every level of the binary operators, the shapes of their asts and the ways they nest, as the initializer of 'x'
+    static const parse_golden goldens[] = {
+        {"a",
+         "name 'a'"},
+        {"a || b",
+         "conditional_or_expression(name 'a' name 'b')"},
+        {"a || b || c",
+         "conditional_or_expression(name 'a' name 'b' name 'c')"},
+        {"a && b",
+         "conditional_and_expression(name 'a' name 'b')"},
+        {"a && b && c",
+         "conditional_and_expression(name 'a' conditional_and_expression(name 'b' name 'c'))"},
+        {"a | b | c",
+         "bit_or_expression(name 'a' name 'b' name 'c')"},
+        {"a & b & c",
+         "bit_and_expression(name 'a' name 'b' name 'c')"},
+        {"a == b",
+         "equality_expression(name 'a' op_equals name 'b')"},
+        {"a != b",
+         "equality_expression(name 'a' op_not_equals name 'b')"},
+        {"a < b",
+         "relational_expression(name 'a' op_lt name 'b')"},
+        {"a >= b",
+         "relational_expression(name 'a' op_gte name 'b')"},
+        {"a << b",
+         "shift_expression(name 'a' op_shift_left name 'b')"},
+        {"a >> 1",
+         "shift_expression(name 'a' op_shift_right integer=1)"},
+        {"a + b",
+         "additive_expression(name 'a' op_add name 'b')"},
+        {"a + b - c",
+         "additive_expression(additive_expression(name 'a' op_add name 'b') op_sub name 'c')"},
+        {"a * b",
+         "multiplicative_expression(name 'a' op_mul name 'b')"},
+        {"a * b / c % d",
+         "multiplicative_expression(name 'a' op_mul multiplicative_expression(name 'b' op_div "
+         "multiplicative_expression(name 'c' op_mod name 'd')))"},
+        {"a + b * c",
+         "additive_expression(name 'a' op_add multiplicative_expression(name 'b' op_mul name 'c'))"},
+        {"a * b + c",
+         "additive_expression(multiplicative_expression(name 'a' op_mul name 'b') op_add name 'c')"},
+        {"a - b - c * d",
+         "additive_expression(additive_expression(name 'a' op_sub name 'b') op_sub multiplicative_expression("
+         "name 'c' op_mul name 'd'))"},
+        {"a || b && c",
+         "conditional_or_expression(name 'a' conditional_and_expression(name 'b' name 'c'))"},
+        {"a && b || c",
+         "conditional_or_expression(conditional_and_expression(name 'a' name 'b') name 'c')"},
+        {"a | b & c == d",
+         "bit_or_expression(name 'a' bit_and_expression(name 'b' equality_expression(name 'c' op_equals name "
+         "'d')))"},
+        {"a == b < c",
+         "equality_expression(name 'a' op_equals relational_expression(name 'b' op_lt name 'c'))"},
+        {"a < b << c",
+         "relational_expression(name 'a' op_lt shift_expression(name 'b' op_shift_left name 'c'))"},
+        {"a << b + c",
+         "shift_expression(name 'a' op_shift_left additive_expression(name 'b' op_add name 'c'))"},
+        {"a < b == c",
+         "equality_expression(relational_expression(name 'a' op_lt name 'b') op_equals name 'c')"},
+        {"a instanceof []int",
+         "relational_expression(name 'a' op_instanceof type_array(type_int))"},
+        {"a instanceof []int == b",
+         "equality_expression(relational_expression(name 'a' op_instanceof type_array(type_int)) op_equals "
+         "name 'b')"},
+        {"(a + b) * c",
+         "multiplicative_expression(additive_expression(name 'a' op_add name 'b') op_mul name 'c')"},
+        {"-a * !b",
+         "multiplicative_expression(unary_expression(op_sub name 'a') op_mul logic_not_expression(name 'b'))"},
+        {"f(a, b) + 1 * 2.5",
+         "additive_expression(function_invocation(name 'f' function_invocation_tail(argument_list(name 'a' "
+         "name 'b'))) op_add multiplicative_expression(integer=1 op_mul float=2.5))"},
+        {"a || b && c | d & e == f < g << h + i * j",
+         "conditional_or_expression(name 'a' conditional_and_expression(name 'b' bit_or_expression(name 'c' "
+         "bit_and_expression(name 'd' equality_expression(name 'e' op_equals relational_expression(name 'f' "
+         "op_lt shift_expression(name 'g' op_shift_left additive_expression(name 'h' op_add "
+         "multiplicative_expression(name 'i' op_mul name 'j')))))))))"},
+        {"j * i + h << g < f == e & d | c && b || a",
+         "conditional_or_expression(conditional_and_expression(bit_or_expression(bit_and_expression("
+         "equality_expression(relational_expression(shift_expression(additive_expression("
+         "multiplicative_expression(name 'j' op_mul name 'i') op_add name 'h') op_shift_left name 'g') op_lt "
+         "name 'f') op_equals name 'e') name 'd') name 'c') name 'b') name 'a')"},
+        {"a == b ? 1 : 2",
+         "conditional_expression(equality_expression(name 'a' op_equals name 'b') integer=1 integer=2)"},
+        {"a ? 1 : b ? 2 : c ? 3 : 4",
+         "conditional_expression(name 'a' integer=1 conditional_expression(name 'b' integer=2 "
+         "conditional_expression(name 'c' integer=3 integer=4)))"},
+        {"a ? b ? 1 : 2 : c || d",
+         "error: miss ':' in conditional expression @1:12"},
+        {"'c' + \"s\"",
+         "additive_expression(rune=99 op_add string 's')"},
+        {"true && null",
+         "conditional_and_expression(bool=1 null)"},
+        {"a == b == c",
+         "error: unexpected token @1:13"},
+        {"a < b < c",
+         "error: unexpected token @1:12"},
+        {"a << b << c",
+         "error: unexpected token @1:13"},
+        {"a ||",
+         "error: miss expression after '||' @2:1"},
+        {"a && ",
+         "error: miss expression after '&&' @2:1"},
+        {"a | ",
+         "error: miss expression after '|' @2:1"},
+        {"a & ",
+         "error: miss expression after '&' @2:1"},
+        {"a == ",
+         "error: miss expression after '==' @2:1"},
+        {"a < ",
+         "error: need expression after compare operator @2:1"},
+        {"a << ",
+         "error: need expression after shift operator @2:1"},
+        {"a + ",
+         "error: need expression after '+' or '-' @2:1"},
+        {"a * ",
+         "error: need expression after '*', '/' or '%' @2:1"},
+        {"a instanceof ",
+         "error: miss type-name after 'instanceof' @2:1"},
+        {"a ? b",
+         "error: miss ':' in conditional expression @2:1"},
+        {"a * (b + )",
+         "error: need expression after '+' or '-' @1:15"},
+    };
+    assert_parse_goldens(goldens, sizeof(goldens) / sizeof(*goldens), "x := %s\n", "201");
+}
+
+static ruyi_error* parse_source_skip_comments(const char *src, UINT32 length, ruyi_ast **out_ast) {
+    ruyi_lexer_reader *reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_data(src, length), Ruyi_lo_SKIP_COMMENTS | Ruyi_lo_QUIET);
+    ruyi_error *err = ruyi_parse_ast(reader, out_ast);
+    ruyi_lexer_reader_close(reader);
+    return err;
+}
+
+// reparse a source after an edit, and check it against the parse of the whole source
+static ruyi_error* reparse_and_check(ruyi_ast **ast, const char *src, UINT32 length, const ruyi_source_edit *edits, UINT32 edit_count) {
+    ruyi_ast *whole_ast = NULL;
+    ruyi_error *err = ruyi_reparse_ast(ast, (const BYTE*)src, length, edits, edit_count);
+    ruyi_error *whole_err = parse_source_skip_comments(src, length, &whole_ast);
+    if (err != NULL || whole_err != NULL) {
+        assert(err && whole_err);
+        assert(strcmp(err->message, whole_err->message) == 0);
+        assert(err->line == whole_err->line && err->column == whole_err->column);
+        ruyi_error_destroy(whole_err);
+        return err;
+    }
+    assert_ast_equals(*ast, whole_ast);
+    ruyi_ast_destroy(whole_ast);
+    return NULL;
+}
+
+void test_parser_reparse(void) {
+    static const char *src =
+    "package test.reparse\n"
+    "import fmt\n"
+    "var count int = 10\n"
+    "// 注释 comment\n"
+    "var ratio double = 1.5\n"
+    "func add(a int, b int) int {\n"
+    "    c := a + b * 2\n"
+    "    if c > 10 {\n"
+    "        return c\n"
+    "    }\n"
+    "    return a\n"
+    "}\n"
+    "var 名字 string = \"中文\"\n"
+    "func sub(a int, b int) int { return a - b }; var list []int\n"
+    "/* block\n   comment */\n"
+    "func loop(n int) int {\n"
+    "    s := 0\n"
+    "    while s < n {\n"
+    "        s = s + 1\n"
+    "    }\n"
+    "    return s\n"
+    "}\n";
+    static const char *texts[] = {
+        "", "1", "a", " ", "\n", ";", "+ b", "(", ")", "{", "}", "\"", "数", "return 0\n", "var z int\n",
+        "func g() {}\n", "x := 2\n",
+    };
+    expression_builder builder;
+    ruyi_source_edit edits[2];
+    ruyi_ast *ast = NULL, *globals;
+    ruyi_ast *kept[3];
+    ruyi_error *err;
+    char *source = (char*)ruyi_mem_alloc(64 * 1024);
+    UINT32 length = (UINT32)strlen(src);
+    UINT32 i, offset, second, old_length, errors = 0;
+    const char *text;
+    builder.data = (char*)ruyi_mem_alloc(64 * 1024);
+    builder.seed = 20191201;
+    memcpy(source, src, length);
+    assert(NULL == parse_source_skip_comments(source, length, &ast));
+
+    // a body edited, the declarations far from it are kept
+    globals = ruyi_ast_get_child(ast, 2);
+    assert(7 == ruyi_ast_child_length(globals));
+    kept[0] = ruyi_ast_get_child(globals, 0);
+    kept[1] = ruyi_ast_get_child(globals, 4);
+    kept[2] = ruyi_ast_get_child(globals, 6);
+    offset = (UINT32)(strstr(source, "c > 10") - source) + 5;
+    source[offset] = '2';
+    edits[0].offset = offset;
+    edits[0].old_length = 1;
+    edits[0].new_length = 1;
+    assert(NULL == reparse_and_check(&ast, source, length, edits, 1));
+    globals = ruyi_ast_get_child(ast, 2);
+    assert(kept[0] == ruyi_ast_get_child(globals, 0));
+    assert(kept[1] == ruyi_ast_get_child(globals, 4));
+    assert(kept[2] == ruyi_ast_get_child(globals, 6));
+
+    // two edits at once, one adds a declaration
+    offset = (UINT32)(strstr(source, "var ratio") - source);
+    second = (UINT32)(strstr(source, "s < n") - source) + 3;
+    builder.length = 0;
+    memcpy(builder.data, source, offset);
+    builder.length = offset;
+    expression_append(&builder, "var x int\n");
+    memcpy(builder.data + builder.length, source + offset, second - offset);
+    builder.length += second - offset;
+    expression_append(&builder, "=");
+    memcpy(builder.data + builder.length, source + second, length - second);
+    builder.length += length - second;
+    edits[0].offset = offset;
+    edits[0].old_length = 0;
+    edits[0].new_length = 10;
+    edits[1].offset = second;
+    edits[1].old_length = 0;
+    edits[1].new_length = 1;
+    assert(NULL == reparse_and_check(&ast, builder.data, builder.length, edits, 2));
+    assert(8 == ruyi_ast_child_length(ruyi_ast_get_child(ast, 2)));
+    memcpy(source, builder.data, builder.length);
+    length = builder.length;
+
+    // random edits, an edit making an error is dropped, the next ones are from the source of the tree
+    for (i = 0; i < 2000; i++) {
+        offset = expression_random(&builder, length + 1);
+        while (offset < length && (source[offset] & 0xC0) == 0x80) {
+            offset++;
+        }
+        old_length = expression_random(&builder, 4);
+        old_length = old_length > length - offset ? length - offset : old_length;
+        while (offset + old_length < length && (source[offset + old_length] & 0xC0) == 0x80) {
+            old_length++;
+        }
+        text = texts[expression_random(&builder, sizeof(texts) / sizeof(*texts))];
+        builder.length = 0;
+        memcpy(builder.data, source, offset);
+        builder.length = offset;
+        expression_append(&builder, text);
+        memcpy(builder.data + builder.length, source + offset + old_length, length - offset - old_length);
+        builder.length += length - offset - old_length;
+        assert(builder.length < 60 * 1024);
+        edits[0].offset = offset;
+        edits[0].old_length = old_length;
+        edits[0].new_length = (UINT32)strlen(text);
+        if ((err = reparse_and_check(&ast, builder.data, builder.length, edits, 1)) != NULL) {
+            ruyi_error_destroy(err);
+            errors++;
+            continue;
+        }
+        memcpy(source, builder.data, builder.length);
+        length = builder.length;
+    }
+    // both kinds are met
+    assert(errors > 100 && errors < 1900);
+    ruyi_ast_destroy(ast);
+    ruyi_mem_free(builder.data);
+    ruyi_mem_free(source);
+}
+
+// parse a source on some threads, and check it against the parse of one thread, returns if it has an error
+static BOOL assert_parallel_same_as_parse(const char *src, UINT32 length, UINT32 threads) {
+    ruyi_token_stream *stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, length), Ruyi_lo_SKIP_COMMENTS);
+    ruyi_lexer_reader *reader = ruyi_lexer_reader_open_stream(stream);
+    ruyi_ast *ast = NULL, *parallel_ast = NULL;
+    ruyi_error *err = ruyi_parse_ast(reader, &ast);
+    ruyi_error *parallel_err = ruyi_parse_ast_parallel(stream, threads, &parallel_ast);
+    BOOL failed = (err != NULL);
+    ruyi_lexer_reader_close(reader);
+    if (err != NULL || parallel_err != NULL) {
+        assert(err && parallel_err);
+        assert(strcmp(err->message, parallel_err->message) == 0);
+        assert(err->line == parallel_err->line && err->column == parallel_err->column);
+        ruyi_error_destroy(err);
+        ruyi_error_destroy(parallel_err);
+    } else {
+        assert_ast_equals(ast, parallel_ast);
+        ruyi_ast_destroy(ast);
+        ruyi_ast_destroy(parallel_ast);
+    }
+    ruyi_token_stream_destroy(stream);
+    return failed;
+}
+
+void test_parser_parallel(void) {
+    static const char *pieces[] = {
+        "var a int = 1\n",
+        "func add(a int, b int) int {\n    c := a + b * 2\n    if c > 10 {\n        return c\n    }\n    return a\n}\n",
+        "x := 2\n",
+        "var f func(int) int = func(a int) int { var y int = a\n return y }\n",
+        "var m [string]int\n",
+        "func loop(n int) int { s := 0; while s < n { s = s + 1 }; return s }; ",
+        "var s string = \"中文 func var {\"\n",
+        "// func g() {\n",
+        "var h func(int); func r() {}\n",
+    };
+    // each is put in the middle of the source, an optional type before a 'func' takes it as in 'var q func'
+    static const char *middles[] = {
+        "var q\nfunc r() {}\n",
+        "var h func(int)\nfunc r() {}\n",
+        "func bad( {\n",
+        "}\n",
+        "var q; func r() {}\n",
+        "var h func(int) int\n",
+    };
+    expression_builder builder;
+    UINT32 size = 256 * 1024;
+    UINT32 length, middle, i;
+    char *src = (char*)ruyi_mem_alloc(size + 1024);
+    char *edited = (char*)ruyi_mem_alloc(size + 2048);
+    builder.data = src;
+    builder.length = 0;
+    builder.seed = 20191202;
+    expression_append(&builder, "package test.parallel\nimport fmt\n");
+    while (builder.length < size) {
+        expression_append(&builder, pieces[expression_random(&builder, sizeof(pieces) / sizeof(*pieces))]);
+    }
+    assert(!assert_parallel_same_as_parse(src, builder.length, 4));
+    assert(!assert_parallel_same_as_parse(src, builder.length, 3));
+    assert(!assert_parallel_same_as_parse(src, builder.length, 0));
+    // too small to be cut
+    assert(!assert_parallel_same_as_parse(src, 200, 4));
+    assert(assert_parallel_same_as_parse("var a int\n}", 11, 4));
+    // after a line in the middle, a run ends or starts near it
+    length = builder.length;
+    middle = length / 2;
+    while (src[middle - 1] != '\n') {
+        middle++;
+    }
+    builder.data = edited;
+    for (i = 0; i < sizeof(middles) / sizeof(*middles); i++) {
+        memcpy(edited, src, middle);
+        builder.length = middle;
+        expression_append(&builder, middles[i]);
+        memcpy(edited + builder.length, src + middle, length - middle);
+        assert(assert_parallel_same_as_parse(edited, builder.length + length - middle, 4) == (i < 4));
+    }
+    // functions of 6 tokens, the first run is cut at a 'func' near AST_PARALLEL_RUN_MIN_TOKENS tokens, a declaration
+    // before each of the functions around it meets the cut once, where the 'func' after it must not be cut
+    builder.data = src;
+    for (i = 0; i < 2 * 160; i++) {
+        builder.length = 0;
+        for (middle = 0; middle < 1600; middle++) {
+            if (middle == 600 + i / 2) {
+                expression_append(&builder, (i & 1) ? "var h func(int)\n" : "var q\n");
+            }
+            expression_append(&builder, "func f() {}\n");
+        }
+        assert(assert_parallel_same_as_parse(src, builder.length, 4));
+    }
+    ruyi_mem_free(edited);
+    ruyi_mem_free(src);
+}
+
+// parse all lazy bodies of an ast in place, returns the count of them
+static UINT32 expand_lazy_bodies(ruyi_ast *ast) {
+    UINT32 count = 0;
+    UINT32 i;
+    if (ast == NULL) {
+        return 0;
+    }
+    if (ast->adt_type == Ruyi_adt_lazy_body) {
+        assert(ast->type == Ruyi_at_block_statements && ast->child_count == 0);
+        assert(NULL == ruyi_parse_lazy_body(ast));
+        assert(ast->adt_type == Ruyi_adt_value);
+        count++;
+    }
+    for (i = 0; i < ast->child_count; i++) {
+        count += expand_lazy_bodies(ast->children[i]);
+    }
+    return count;
+}
+
+// the bodies of the function declarations of an ast in pre-order
+static UINT32 collect_function_bodies(const ruyi_ast *ast, const ruyi_ast **bodies, UINT32 count) {
+    UINT32 i;
+    if (ast == NULL) {
+        return count;
+    }
+    if (ast->type == Ruyi_at_function_declaration) {
+        bodies[count++] = ruyi_ast_get_child(ast, 3);
+    }
+    for (i = 0; i < ast->child_count; i++) {
+        count = collect_function_bodies(ast->children[i], bodies, count);
+    }
+    return count;
+}
+
+static void assert_same_error(ruyi_error *err, ruyi_error *other) {
+    assert(err && other);
+    assert(strcmp(err->message, other->message) == 0);
+    assert(err->line == other->line && err->column == other->column);
+    ruyi_error_destroy(err);
+    ruyi_error_destroy(other);
+}
+
+void test_parser_lazy_bodies(void) {
+    const char *src = "package test.lazy\nimport fmt\n"
+    "var a int = 1\n"
+    "var f func(int) int = func(a int) int { return a + 1 }\n"
+    "func add(a int, b int) int {\n    c := a + b * 2\n    if c > 10 {\n        return c\n    }\n    return a\n}\n"
+    "func loop(n int) int { s := 0; while s < n { s = s + 1 }; g := func(x int) int { return x * 2 }; return g(s) }\n"
+    "func maps(v int) { m := map([string]int); var b int; switch(v) {case 1,2,3: b = 10;\n default: b = 100} }\n"
+    "func empty() {}\n"
+    "var s string = \"{ func\"\n";
+    const char *broken = "func a() int { return 1 }\nfunc b() {\n    x := ;\n}\nfunc c() {}\n";
+    const char *unbalanced = "func a() int { return 1 }\nfunc b() { if a() > 0 { return }\n";
+    const ruyi_ast *bodies[8];
+    ruyi_token_stream *stream;
+    ruyi_lexer_reader *reader;
+    ruyi_ast *ast = NULL, *lazy_ast = NULL;
+    ruyi_ast_tree *tree, *body_tree;
+    ruyi_error *err;
+    UINT32 count, i, lazy_count;
+    stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, (UINT32)strlen(src)), Ruyi_lo_SKIP_COMMENTS);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    assert(NULL == ruyi_parse_ast(reader, &ast));
+    ruyi_lexer_reader_close(reader);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    assert(NULL == ruyi_parse_ast_with_options(reader, Ruyi_po_LAZY_BODIES, &lazy_ast));
+    ruyi_lexer_reader_close(reader);
+    // only the stubs of the bodies are made
+    assert(((ruyi_ast_root_data*)lazy_ast->data.ptr_value)->tree_size < ((ruyi_ast_root_data*)ast->data.ptr_value)->tree_size);
+    count = collect_function_bodies(ast, bodies, 0);
+    assert(count == 4);
+    // a flat tree keeps the tokens of the stubs, each is parsed to the body of the parse without the option
+    tree = ruyi_ast_tree_create(lazy_ast);
+    assert(tree->lazy_body_count == count);
+    lazy_count = 0;
+    for (i = 1; i < tree->node_count; i++) {
+        if (ruyi_ast_tree_lazy_body(tree, i) == NULL) {
+            continue;
+        }
+        assert(0 == ruyi_ast_tree_child_length(tree, i));
+        assert(NULL == ruyi_parse_lazy_body_tree(tree, i, &body_tree));
+        assert_ast_tree_equals(body_tree, ruyi_ast_tree_root(body_tree), bodies[lazy_count++]);
+        ruyi_ast_tree_destroy(body_tree);
+    }
+    assert(lazy_count == count);
+    assert(NULL != (err = ruyi_parse_lazy_body_tree(tree, ruyi_ast_tree_root(tree), &body_tree)));
+    ruyi_error_destroy(err);
+    // the tokens of the bodies are not in a cache file
+    assert(NULL != (err = ruyi_ast_cache_save(tree, 0, "/tmp/lazy_bodies.ast")));
+    ruyi_error_destroy(err);
+    ruyi_ast_tree_destroy(tree);
+    // in place, the tree is then the same
+    assert(count == expand_lazy_bodies(lazy_ast));
+    assert(0 == expand_lazy_bodies(lazy_ast));
+    assert_ast_equals(ast, lazy_ast);
+    ruyi_ast_destroy(lazy_ast);
+    ruyi_ast_destroy(ast);
+    ruyi_token_stream_destroy(stream);
+
+    // without a token stream the bodies are parsed
+    reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_data(src, (UINT32)strlen(src)), Ruyi_lo_SKIP_COMMENTS);
+    assert(NULL == ruyi_parse_ast_with_options(reader, Ruyi_po_LAZY_BODIES, &lazy_ast));
+    ruyi_lexer_reader_close(reader);
+    assert(0 == expand_lazy_bodies(lazy_ast));
+    ruyi_ast_destroy(lazy_ast);
+
+    // an error in a body is found when it is parsed, the same as the parse of the whole file finds
+    stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(broken, (UINT32)strlen(broken)), Ruyi_lo_SKIP_COMMENTS);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    err = ruyi_parse_ast(reader, &ast);
+    ruyi_lexer_reader_close(reader);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    assert(NULL == ruyi_parse_ast_with_options(reader, Ruyi_po_LAZY_BODIES, &lazy_ast));
+    ruyi_lexer_reader_close(reader);
+    tree = ruyi_ast_tree_create(lazy_ast);
+    for (i = 1; i < tree->node_count && ruyi_ast_tree_lazy_body(tree, i) == NULL; i++);
+    // the first body is good, the second is not
+    assert(NULL == ruyi_parse_lazy_body_tree(tree, i, &body_tree));
+    ruyi_ast_tree_destroy(body_tree);
+    for (i++; i < tree->node_count && ruyi_ast_tree_lazy_body(tree, i) == NULL; i++);
+    assert_same_error(err, ruyi_parse_lazy_body_tree(tree, i, &body_tree));
+    assert(body_tree == NULL);
+    ruyi_ast_tree_destroy(tree);
+    ruyi_ast_destroy(lazy_ast);
+    ruyi_token_stream_destroy(stream);
+
+    // a body without its '}' is an error of the parse
+    stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(unbalanced, (UINT32)strlen(unbalanced)), Ruyi_lo_SKIP_COMMENTS);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    err = ruyi_parse_ast(reader, &ast);
+    ruyi_lexer_reader_close(reader);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    assert_same_error(err, ruyi_parse_ast_with_options(reader, Ruyi_po_LAZY_BODIES, &lazy_ast));
+    ruyi_lexer_reader_close(reader);
+    ruyi_token_stream_destroy(stream);
+}
+
+void test_parser_first_tokens(void) {
+    // the choices by the first tokens of syntax.txt, each statement as the body of a function
+    static const parse_golden statements[] = {
+        {"x := a + 1",
+         "block_statements(var_declaration 'x'(var_declaration_auto_type additive_expression(name 'a' op_add "
+         "integer=1)))"},
+        {"var y int = 2",
+         "block_statements(var_declaration 'y'(type_int integer=2))"},
+        {"var z []int",
+         "block_statements(var_declaration 'z'(type_array(type_int)))"},
+        {"a = b",
+         "block_statements(left_hand_side_expression(name 'a' assign_statement(name 'b')))"},
+        {"a.b.c = 1",
+         "block_statements(left_hand_side_expression(name 'a'(name_part 'b' name_part 'c') assign_statement("
+         "integer=1)))"},
+        {"a[1] = 2",
+         "error: only variable access can not be a statement @2:6"},
+        {"f(1, 2)",
+         "block_statements(left_hand_side_expression(name 'f' function_invocation_statement("
+         "function_invocation_tail(argument_list(integer=1 integer=2)))))"},
+        {"a.f()",
+         "block_statements(left_hand_side_expression(name 'a'(name_part 'f') function_invocation_statement("
+         "function_invocation_tail(argument_list))))"},
+        {"a++",
+         "block_statements(left_hand_side_expression(name 'a' inc_statement))"},
+        {"a--",
+         "block_statements(left_hand_side_expression(name 'a' dec_statement))"},
+        {"if a > b { c = 1 } elseif a < b { c = 2 } else { c = 3 }",
+         "block_statements(if_statement(relational_expression(name 'a' op_gt name 'b') block_statements("
+         "left_hand_side_expression(name 'c' assign_statement(integer=1))) elseif_statement("
+         "relational_expression(name 'a' op_lt name 'b') block_statements(left_hand_side_expression(name 'c' "
+         "assign_statement(integer=2)))) else_statement(block_statements(left_hand_side_expression(name 'c' "
+         "assign_statement(integer=3))))))"},
+        {"while (a < 10) { a++ }",
+         "block_statements(while_statement(relational_expression(name 'a' op_lt integer=10) block_statements("
+         "left_hand_side_expression(name 'a' inc_statement))))"},
+        {"for i := 0; i < 10; i++ { s = s + i }",
+         "block_statements(for_3_parts_statement(for_3_parts_header(expr_statement_list(var_declaration 'i'("
+         "var_declaration_auto_type integer=0)) relational_expression(name 'i' op_lt integer=10) "
+         "stmt_expr_list(left_hand_side_expression(name 'i' inc_statement))) block_statements("
+         "left_hand_side_expression(name 's' assign_statement(additive_expression(name 's' op_add name "
+         "'i'))))))"},
+        {"for k, v in m { s = k }",
+         "block_statements(for_in_statement(for_in_header(var_list(name 'k' name 'v') name 'm') "
+         "block_statements(left_hand_side_expression(name 's' assign_statement(name 'k')))))"},
+        {"switch a { case 1, 2: b = 1\n default: b = 2 }",
+         "block_statements(switch_statement(name 'a' switch_statement_body(switch_case_statement_list("
+         "switch_case_statement(const_list(constant_expression(integer=1) constant_expression(integer=2)) "
+         "block_statements(left_hand_side_expression(name 'b' assign_statement(integer=1))))) "
+         "switch_default_case_statement(block_statements(left_hand_side_expression(name 'b' assign_statement("
+         "integer=2)))))))"},
+        {"return",
+         "block_statements(return_statement)"},
+        {"return a, b",
+         "block_statements(return_statement(expr_list(name 'a' name 'b')))"},
+        {"break",
+         "block_statements(break_statement)"},
+        {"continue",
+         "block_statements(continue_statement)"},
+        {"outer: while a { break outer }",
+         "block_statements(labeled_statement 'outer'(while_statement(name 'a' block_statements("
+         "break_statement 'outer'))))"},
+        {"{ a = 1 }",
+         "block_statements(sub_block_statement(block_statements(left_hand_side_expression(name 'a' "
+         "assign_statement(integer=1)))))"},
+        {"m := map([string]int)",
+         "block_statements(var_declaration 'm'(var_declaration_auto_type map_creation(type_map(name 'string' "
+         "type_int))))"},
+        {"c := array([]int, 10)",
+         "block_statements(var_declaration 'c'(var_declaration_auto_type array_creation_with_cap(type_array("
+         "type_int) integer=10)))"},
+        {"d := []int[1, 2, 3]",
+         "block_statements(var_declaration 'd'(var_declaration_auto_type array_creation_with_init(type_array("
+         "type_int) integer=1 integer=2 integer=3)))"},
+        {"g := func(x int) int { return x }",
+         "block_statements(var_declaration 'g'(var_declaration_auto_type anonymous_function_declaration("
+         "formal_parameter_list(formal_parameter(name 'x' type_int)) type_list(type_int) block_statements("
+         "return_statement(expr_list(name 'x'))))))"},
+        {"p := P{x: 1, y: 2}",
+         "error: only variable access can not be a statement @2:16"},
+        {"this.a = 1",
+         "error: miss '}' @2:5"},
+        {"1",
+         "error: only variable access can not be a statement @3:1"},
+        {"\"s\"",
+         "error: only variable access can not be a statement @3:1"},
+        {"(a)",
+         "error: only variable access can not be a statement @3:1"},
+        {"a",
+         "error: only variable access can not be a statement @3:1"},
+        {"true",
+         "error: miss '}' @2:5"},
+        {"null",
+         "error: miss '}' @2:5"},
+        {"+ a",
+         "error: miss '}' @2:5"},
+        {")",
+         "error: miss '}' @2:5"},
+        {"else { }",
+         "error: miss '}' @2:5"},
+        {"case 1:",
+         "error: miss '}' @2:5"},
+        {"[]",
+         "error: miss type after ']' @3:1"},
+        {"map",
+         "error: miss '(' after keyword 'map' @3:1"},
+        {"array",
+         "error: miss '(' after keyword 'array' @3:1"},
+        {"func",
+         "error: miss '}' @2:5"},
+        {"var",
+         "error: miss (array or map) identifier after 'var' @3:1"},
+        {"x :=",
+         "error: need initialize expression after ':=' @3:1"},
+        {"'c'",
+         "error: only variable access can not be a statement @3:1"},
+        {"1.5",
+         "error: only variable access can not be a statement @3:1"},
+        {"in",
+         "error: miss '}' @2:5"},
+        {"this",
+         "error: miss '}' @2:5"},
+    };
+    // and each global declaration after a package
+    static const parse_golden globals[] = {
+        {"var g int = 1\n",
+         "root(package_declaration(name 'test'(name_part 'first')) - global_declarations(var_declaration 'g'("
+         "type_int integer=1)))"},
+        {"h := 2\n",
+         "root(package_declaration(name 'test'(name_part 'first')) - global_declarations(var_declaration 'h'("
+         "var_declaration_auto_type integer=2)))"},
+        {"func f(a int) int { return a }\n",
+         "root(package_declaration(name 'test'(name_part 'first')) - global_declarations(function_declaration("
+         "name 'f' formal_parameter_list(formal_parameter(name 'a' type_int)) type_list(type_int) "
+         "block_statements(return_statement(expr_list(name 'a'))))))"},
+        {"var k func(int) int = func(a int) int { return a }\n",
+         "root(package_declaration(name 'test'(name_part 'first')) - global_declarations(var_declaration 'k'("
+         "type_func(parameter_type_list(type_int) type_list(type_int)) anonymous_function_declaration("
+         "formal_parameter_list(formal_parameter(name 'a' type_int)) type_list(type_int) block_statements("
+         "return_statement(expr_list(name 'a')))))))"},
+        {"class C {}\n",
+         "error: unexpected token: class @2:1"},
+        {"1\n",
+         "error: unexpected token @2:1"},
+        {"if a {}\n",
+         "error: unexpected token: if @2:1"},
+        {"import b\n",
+         "root(package_declaration(name 'test'(name_part 'first')) import_declarations(import_declaration("
+         "name 'b')) global_declarations)"},
+    };
+    assert_parse_goldens(statements, sizeof(statements) / sizeof(*statements), "func main(a int, b int) {\n    %s\n}\n", "203");
+    assert_parse_goldens(globals, sizeof(globals) / sizeof(*globals), "package test.first\n%s", "");
+}
+
+// parses the head, count times of open, the middle, count times of close and the tail
+static ruyi_error* parse_repeated(const char *head, const char *open, const char *middle, const char *close, const char *tail,
+                                  UINT32 count, ruyi_ast **out_ast) {
+    UINT32 size = (UINT32)(strlen(head) + (strlen(open) + strlen(close)) * count + strlen(middle) + strlen(tail) + 1);
+    char *src = (char*)ruyi_mem_alloc(size);
+    UINT32 length = (UINT32)sprintf(src, "%s", head);
+    ruyi_lexer_reader *reader;
+    ruyi_error *err;
+    UINT32 i;
+    for (i = 0; i < count; i++) {
+        length += (UINT32)sprintf(src + length, "%s", open);
+    }
+    length += (UINT32)sprintf(src + length, "%s", middle);
+    for (i = 0; i < count; i++) {
+        length += (UINT32)sprintf(src + length, "%s", close);
+    }
+    length += (UINT32)sprintf(src + length, "%s", tail);
+    reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_data(src, length), Ruyi_lo_SKIP_COMMENTS);
+    err = ruyi_parse_ast(reader, out_ast);
+    ruyi_lexer_reader_close(reader);
+    ruyi_mem_free(src);
+    return err;
+}
+
+void test_parser_long_chains(void) {
+    // the operators of a level are parsed by a loop, a chain of any length does not run out of the stack
+    UINT32 count = 200000;
+    ruyi_ast *ast;
+    const ruyi_ast *node;
+    UINT32 i;
+    // a * b * ... * b is mul(a, *, mul(b, *, ... mul(b, *, b)))
+    assert(NULL == parse_repeated("x := a", " * b", "", "", "\n", count, &ast));
+    node = ruyi_ast_get_child(ruyi_ast_get_child(ruyi_ast_get_child(ast, 2), 0), 1);
+    for (i = 0; i < count; i++) {
+        assert(Ruyi_at_multiplicative_expression == node->type);
+        assert(3 == node->child_count);
+        assert(Ruyi_at_name == node->children[0]->type);
+        assert(Ruyi_at_op_mul == node->children[1]->type);
+        node = node->children[2];
+    }
+    assert(Ruyi_at_name == node->type);
+    ruyi_ast_destroy(ast);
+    // a && b && ... && b is and(a, and(b, ... and(b, b)))
+    assert(NULL == parse_repeated("x := a", " && b", "", "", "\n", count, &ast));
+    node = ruyi_ast_get_child(ruyi_ast_get_child(ruyi_ast_get_child(ast, 2), 0), 1);
+    for (i = 0; i < count; i++) {
+        assert(Ruyi_at_conditional_and_expression == node->type);
+        assert(2 == node->child_count);
+        node = node->children[1];
+    }
+    assert(Ruyi_at_name == node->type);
+    ruyi_ast_destroy(ast);
+    // a ? 1 : a ? 1 : ... : 2, the false expression of one is the next
+    assert(NULL == parse_repeated("x := ", "a ? 1 : ", "2", "", "\n", count, &ast));
+    node = ruyi_ast_get_child(ruyi_ast_get_child(ruyi_ast_get_child(ast, 2), 0), 1);
+    for (i = 0; i < count; i++) {
+        assert(Ruyi_at_conditional_expression == node->type);
+        assert(3 == node->child_count);
+        node = node->children[2];
+    }
+    assert(Ruyi_at_integer == node->type);
+    ruyi_ast_destroy(ast);
+    // the sum of the long chains, 'a + b * c + ...'
+    assert(NULL == parse_repeated("x := a", " + b * c - d / e", "", "", "\n", count, &ast));
+    ruyi_ast_destroy(ast);
+}
+
+void test_parser_deep_nesting(void) {
+    // each row is nested a little and very deep, the deep one is parsed on the segments of the stack of the parser
+    static const struct {
+        const char *head;
+        const char *open;
+        const char *middle;
+        const char *close;
+        UINT32 deep;
+    } nestings[] = {
+        {"x := ", "(", "a", ")", 100000},
+        {"x := ", "- ", "a", "", 100000},
+        {"x := ", "!", "a", "", 100000},
+        {"x := ", "~", "a", "", 100000},
+        {"var x ", "[]", "int", "", 100000},
+        {"var x ", "[string]", "int", "", 100000},
+        {"x := ", "func() int {\n return ", "1", "\n}", 50000},
+        {"func main(a int) {\n", "if a {\n", "a = 1\n", "}\n", 50000},
+        {"func main(a int) {\n", "while a {\n", "a = 1\n", "}\n", 50000},
+        {"func main(a int) {\n", "for i := 0; i < a; i++ {\n", "a = 1\n", "}\n", 50000},
+        {"func main(a int) {\n", "{\n", "a = 1\n", "}\n", 100000},
+        {"func main(a int) {\n", "l: ", "a = 1\n", "", 100000},
+    };
+    ruyi_ast *ast;
+    UINT32 i;
+    for (i = 0; i < sizeof(nestings) / sizeof(*nestings); i++) {
+        assert(NULL == parse_repeated(nestings[i].head, nestings[i].open, nestings[i].middle, nestings[i].close,
+                                      nestings[i].head[0] == 'f' ? "}\n" : "\n", 100, &ast));
+        ruyi_ast_destroy(ast);
+        assert(NULL == parse_repeated(nestings[i].head, nestings[i].open, nestings[i].middle, nestings[i].close,
+                                      nestings[i].head[0] == 'f' ? "}\n" : "\n", nestings[i].deep, &ast));
+        assert(NULL != ast);
+        ruyi_ast_destroy(ast);
+    }
+}
+
+// the events of a walk, written to the context of the walker
+typedef struct {
+    char trace[256];
+    UINT32 length;
+    UINT32 max_depth;
+    ruyi_ast_type fail_type;
+    ruyi_ast_type skip_type;
+    ruyi_ast_type nested_type;
+} walk_trace;
+
+static void walk_trace_add(ruyi_ast_walker *walker, char event, ruyi_ast_walk_frame *frame) {
+    walk_trace *trace = (walk_trace*)ruyi_ast_walker_context(walker);
+    if (trace->length + 3 < sizeof(trace->trace)) {
+        trace->length += sprintf(trace->trace + trace->length, "%c%d", event, frame->type);
+    }
+}
+
+static ruyi_error* walk_trace_pre(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    walk_trace *trace = (walk_trace*)ruyi_ast_walker_context(walker);
+    ruyi_ast_walk_frame *parent = ruyi_ast_walker_frame(walker, 1);
+    ruyi_error *err;
+    UINT32 depth;
+    (void)child_frame;
+    // the data of the root is given, the one of a child is its depth
+    *(UINT32*)frame->data = parent ? *(UINT32*)parent->data + 1 : *(UINT32*)frame->data;
+    depth = *(UINT32*)frame->data;
+    if (depth > trace->max_depth) {
+        trace->max_depth = depth;
+    }
+    walk_trace_add(walker, '(', frame);
+    if (frame->type == trace->fail_type) {
+        return ruyi_error_misc("fail at %d", frame->type);
+    }
+    if (frame->type == trace->skip_type) {
+        ruyi_ast_walker_skip_children(frame);
+    }
+    if (frame->type == trace->nested_type && frame->ast) {
+        // a walk by the same walker in a function, its root has no parent
+        depth = 100;
+        trace->nested_type = Ruyi_at_COUNT;
+        if ((err = ruyi_ast_walk(walker, frame->ast->children[0], &depth)) != NULL) {
+            return err;
+        }
+        assert(ruyi_ast_walker_frame(walker, 0) == frame);
+    }
+    return NULL;
+}
+
+static ruyi_error* walk_trace_child(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    assert(ruyi_ast_walker_frame(walker, 0) == child_frame && ruyi_ast_walker_frame(walker, 1) == frame);
+    walk_trace_add(walker, ',', frame);
+    return NULL;
+}
+
+static ruyi_error* walk_trace_post(ruyi_ast_walker *walker, ruyi_ast_walk_frame *frame, ruyi_ast_walk_frame *child_frame) {
+    (void)child_frame;
+    assert(frame->child == frame->child_count);
+    walk_trace_add(walker, ')', frame);
+    return NULL;
+}
+
+static const ruyi_ast_visitor walk_trace_visitor = {
+    .pre_default = walk_trace_pre,
+    .child_default = walk_trace_child,
+    .post_default = walk_trace_post,
+    .data_size = sizeof(UINT32),
+};
+
+// functions for some types only, the others are walked without them
+static const ruyi_ast_visitor walk_trace_typed_visitor = {
+    .child = {[Ruyi_at_root] = walk_trace_child},
+    .post = {[Ruyi_at_name] = walk_trace_post},
+    .data_size = sizeof(UINT32),
+};
+
+void test_ast_walker(void) {
+    ruyi_ast *root = ruyi_ast_create(NULL, Ruyi_at_root);
+    ruyi_ast *list = ruyi_ast_create(NULL, Ruyi_at_expr_list);
+    ruyi_ast *ast, *deep;
+    ruyi_ast_tree *tree;
+    ruyi_ast_walker *walker;
+    walk_trace trace;
+    ruyi_error *err;
+    UINT32 depth, i;
+    char expected[256];
+    // root(expr_list(name, NULL, integer), bool)
+    ruyi_ast_add_child(root, list);
+    ruyi_ast_add_child(list, ruyi_ast_create(NULL, Ruyi_at_name));
+    ruyi_ast_add_child(list, NULL);
+    ruyi_ast_add_child(list, ruyi_ast_create(NULL, Ruyi_at_integer));
+    ruyi_ast_add_child(root, ruyi_ast_create(NULL, Ruyi_at_bool));
+    sprintf(expected, "(%d,%d(%d,%d(%d)%d,%d(%d)%d)%d,%d(%d)%d)%d", Ruyi_at_root, Ruyi_at_root, Ruyi_at_expr_list,
+            Ruyi_at_expr_list, Ruyi_at_name, Ruyi_at_name, Ruyi_at_expr_list, Ruyi_at_integer, Ruyi_at_integer,
+            Ruyi_at_expr_list, Ruyi_at_root, Ruyi_at_bool, Ruyi_at_bool, Ruyi_at_root);
+    memset(&trace, 0, sizeof(trace));
+    trace.fail_type = trace.skip_type = trace.nested_type = Ruyi_at_COUNT;
+    walker = ruyi_ast_walker_create(&walk_trace_visitor, &trace);
+    // pre, child and post in order, a missing child is not visited
+    assert(NULL == ruyi_ast_walk(walker, root, NULL));
+    assert(strcmp(trace.trace, expected) == 0);
+    assert(2 == trace.max_depth);
+    // the same of the flat tree
+    tree = ruyi_ast_tree_create(root);
+    trace.length = 0;
+    assert(NULL == ruyi_ast_walk_tree(walker, tree, ruyi_ast_tree_root(tree), NULL));
+    assert(strcmp(trace.trace, expected) == 0);
+    assert(NULL == ruyi_ast_walk_tree(walker, tree, RUYI_AST_NONE, NULL));
+    ruyi_ast_tree_destroy(tree);
+    // the children skipped, the post is still called
+    trace.length = 0;
+    trace.skip_type = Ruyi_at_expr_list;
+    assert(NULL == ruyi_ast_walk(walker, root, NULL));
+    sprintf(expected, "(%d,%d(%d)%d,%d(%d)%d)%d", Ruyi_at_root, Ruyi_at_root, Ruyi_at_expr_list, Ruyi_at_expr_list,
+            Ruyi_at_root, Ruyi_at_bool, Ruyi_at_bool, Ruyi_at_root);
+    assert(strcmp(trace.trace, expected) == 0);
+    trace.skip_type = Ruyi_at_COUNT;
+    // an error stops the walk, the walker is used again after it
+    trace.length = 0;
+    trace.fail_type = Ruyi_at_integer;
+    assert(NULL != (err = ruyi_ast_walk(walker, root, NULL)));
+    ruyi_error_destroy(err);
+    assert(NULL == ruyi_ast_walker_frame(walker, 0));
+    trace.fail_type = Ruyi_at_COUNT;
+    trace.length = 0;
+    trace.nested_type = Ruyi_at_root;
+    trace.max_depth = 0;
+    depth = 10;
+    assert(NULL == ruyi_ast_walk(walker, root, &depth));
+    assert(101 == trace.max_depth);
+    ruyi_ast_walker_destroy(walker);
+    // by the tables of the types
+    memset(&trace, 0, sizeof(trace));
+    walker = ruyi_ast_walker_create(&walk_trace_typed_visitor, &trace);
+    assert(NULL == ruyi_ast_walk(walker, root, NULL));
+    sprintf(expected, ",%d)%d,%d", Ruyi_at_root, Ruyi_at_name, Ruyi_at_root);
+    assert(strcmp(trace.trace, expected) == 0);
+    ruyi_ast_walker_destroy(walker);
+    ruyi_ast_destroy(root);
+
+    // far deeper than the C stack could recurse, flattened and released by walks
+    deep = ruyi_ast_create(NULL, Ruyi_at_additive_expression);
+    ast = deep;
+    for (i = 0; i < 1000000; i++) {
+        ruyi_ast_add_child(ast, ruyi_ast_create(NULL, Ruyi_at_additive_expression));
+        ruyi_ast_add_child(ast, ruyi_ast_create(NULL, Ruyi_at_op_add));
+        ast = ast->children[0];
+    }
+    tree = ruyi_ast_tree_create(deep);
+    assert(tree->node_count == 2000002);
+    memset(&trace, 0, sizeof(trace));
+    trace.fail_type = trace.skip_type = trace.nested_type = Ruyi_at_COUNT;
+    walker = ruyi_ast_walker_create(&walk_trace_visitor, &trace);
+    assert(NULL == ruyi_ast_walk_tree(walker, tree, ruyi_ast_tree_root(tree), NULL));
+    assert(1000000 == trace.max_depth);
+    ruyi_ast_walker_destroy(walker);
+    ruyi_ast_tree_destroy(tree);
+    ruyi_ast_destroy(deep);
+}
+
+// an expression of many operands, nested as deep as the count of them
+void test_cg_deep_expression(void) {
+    const char *head = "package bb.cc\nfunc f(a int, b int) int {\n    return a";
+    UINT32 counts[] = {2, 200000};
+    UINT32 sizes[2];
+    UINT32 length, i, j;
+    char *src;
+    ruyi_lexer_reader *reader;
+    ruyi_ast_tree *tree;
+    ruyi_cg_file *ir_file;
+    for (i = 0; i < 2; i++) {
+        src = (char*)ruyi_mem_alloc(counts[i] * 8 + 64);
+        length = (UINT32)sprintf(src, "%s", head);
+        for (j = 1; j < counts[i]; j++) {
+            length += (UINT32)sprintf(src + length, j % 2 ? " + b" : " * a");
+        }
+        length += (UINT32)sprintf(src + length, "\n}\n");
+        reader = ruyi_lexer_reader_open_with_options(ruyi_file_init_by_data(src, length), Ruyi_lo_SKIP_COMMENTS);
+        assert(NULL == ruyi_parse_ast_tree(reader, &tree));
+        ruyi_lexer_reader_close(reader);
+        assert(NULL == ruyi_cg_generate_tree(tree, &ir_file));
+        assert(1 == ir_file->func_count);
+        sizes[i] = ir_file->func[0]->codes_size;
+        ruyi_cg_file_destroy(ir_file);
+        ruyi_ast_tree_destroy(tree);
+        ruyi_mem_free(src);
+    }
+    // a load and an operator for each operand after the first
+    assert(sizes[1] == sizes[0] + 2 * (counts[1] - counts[0]));
+}
+
+// the if of 'f' put in count more ifs of the same condition, made in the arena of the parse
+static ruyi_ast* parse_nested_ifs(UINT32 count) {
+    const char *src = "package bb.cc\nfunc f(a int) int {\n    if a > 0 {\n        a = 1\n    }\n    return a\n}\n";
+    ruyi_lexer_reader *reader = ruyi_lexer_reader_open(ruyi_file_init_by_data(src, (UINT32)strlen(src)));
+    ruyi_ast *ast = NULL;
+    ruyi_ast *body, *inner, *outer, *block;
+    UINT32 i;
+    assert(NULL == ruyi_parse_ast(reader, &ast));
+    ruyi_lexer_reader_close(reader);
+    body = ruyi_ast_get_child(ruyi_ast_get_child(ruyi_ast_get_child(ast, 2), 0), 3);
+    inner = ruyi_ast_get_child(body, 0);
+    assert(Ruyi_at_if_statement == inner->type);
+    for (i = 0; i < count; i++) {
+        outer = ruyi_ast_create(inner->arena, Ruyi_at_if_statement);
+        block = ruyi_ast_create(inner->arena, Ruyi_at_block_statements);
+        ruyi_ast_add_child(outer, ruyi_ast_get_child(inner, 0));
+        ruyi_ast_add_child(block, inner);
+        ruyi_ast_add_child(outer, block);
+        inner = outer;
+    }
+    body->children[0] = inner;
+    return ast;
+}
+
+void test_cg_deep_statements(void) {
+    // the parts of statements are walked by the frames of the walker, so a deep tree does not take the C stack
+    UINT32 counts[] = {0, 200, 100000};
+    UINT32 sizes[3];
+    ruyi_ast *ast;
+    ruyi_cg_file *ir_file;
+    UINT32 i;
+    for (i = 0; i < 3; i++) {
+        ast = parse_nested_ifs(counts[i]);
+        assert(NULL == ruyi_cg_generate(ast, &ir_file));
+        sizes[i] = ir_file->func[0]->codes_size;
+        ruyi_cg_file_destroy(ir_file);
+        ruyi_ast_destroy(ast);
+    }
+    // each if loads 'a' and 0, compares them and jumps
+    assert(sizes[1] > sizes[0]);
+    assert((sizes[1] - sizes[0]) % counts[1] == 0);
+    assert(sizes[2] - sizes[0] == (sizes[1] - sizes[0]) / counts[1] * counts[2]);
+}
+
+void test_cg_lazy_bodies(void) {
+    const char* src = "package bb.cc; import a2; \n c2 := 10; var f double = 2.5\n"
+    "func f1(a1 int, a2 long) (int, int) { s := \"中文\"; t := \"\"; return a1*2 + a2, 12; } \n"
+    "func f2(arg1 int, arg2 long) (long, int) { c := arg2 *2; while (c > 10) { c = c - 1; if c == 3 { break; } } return arg1 + c, 20; }";
+    const char* broken = "package bb.cc\nfunc f1(a1 int) int { return a1 }\nfunc f2() { c := ; }";
+    ruyi_token_stream *stream;
+    ruyi_lexer_reader *reader;
+    ruyi_ast *ast = NULL;
+    ruyi_ast_tree *tree, *lazy_tree;
+    ruyi_cg_file *ir_file = NULL;
+    ruyi_error *err;
+    stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(src, (UINT32)strlen(src)), Ruyi_lo_SKIP_COMMENTS);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    assert(NULL == ruyi_parse_ast_tree(reader, &tree));
+    ruyi_lexer_reader_close(reader);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    assert(NULL == ruyi_parse_ast_with_options(reader, Ruyi_po_LAZY_BODIES, &ast));
+    ruyi_lexer_reader_close(reader);
+    lazy_tree = ruyi_ast_tree_create(ast);
+    ruyi_ast_destroy(ast);
+    // the bodies are parsed by the generator
+    assert(2 == lazy_tree->lazy_body_count);
+    assert(lazy_tree->node_count < tree->node_count);
+    assert_same_ir(tree, lazy_tree);
+    ruyi_ast_tree_destroy(lazy_tree);
+    ruyi_ast_tree_destroy(tree);
+    ruyi_token_stream_destroy(stream);
+
+    // the error of a body is the error of the generator
+    stream = ruyi_lexer_tokenize_all(ruyi_file_init_by_data(broken, (UINT32)strlen(broken)), Ruyi_lo_SKIP_COMMENTS);
+    reader = ruyi_lexer_reader_open_stream(stream);
+    assert(NULL == ruyi_parse_ast_with_options(reader, Ruyi_po_LAZY_BODIES, &ast));
+    ruyi_lexer_reader_close(reader);
+    lazy_tree = ruyi_ast_tree_create(ast);
+    ruyi_ast_destroy(ast);
+    assert(NULL != (err = ruyi_cg_generate_tree(lazy_tree, &ir_file)));
+    assert(3 == err->line);
+    ruyi_error_destroy(err);
+    ruyi_ast_tree_destroy(lazy_tree);
+    ruyi_token_stream_destroy(stream);
 }
 
 void run_test_cases_parser() {
@@ -2428,6 +5133,15 @@ void run_test_cases_parser() {
     test_parser_function_label();
     test_parser_function_sub_block();
     test_parser_function_func_type();
+    test_parser_ast_arena();
+    test_parser_binary_expression();
+    test_parser_reparse();
+    test_parser_parallel();
+    test_parser_lazy_bodies();
+    test_parser_first_tokens();
+    test_parser_long_chains();
+    test_parser_deep_nesting();
+    test_ast_walker();
 }
 
 void run_test_cases_cg() {
@@ -2439,7 +5153,14 @@ void run_test_cases_cg() {
     test_cg_funcs3();
     test_cg_funcs4();
     test_cg_funcs5();
+    test_cg_names();
+    test_cg_duplicate_function();
  //   test_cg_funcs6_array();
+    test_cg_ast_tree();
+    test_cg_ast_cache();
+    test_cg_lazy_bodies();
+    test_cg_deep_expression();
+    test_cg_deep_statements();
 }
 
 #include <unistd.h>
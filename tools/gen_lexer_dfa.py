@@ -0,0 +1,402 @@
+#!/usr/bin/env python3
+#
+#  gen_lexer_dfa.py
+#  ruyi
+#
+#  Generates src/ruyi_lexer_dfa.inc, the DFA used by ruyi_lexer_next_token_impl.
+#
+#  The operators are read from the ruyi_token_type enum in src/ruyi_lexer.h:
+#  every token whose comment is made of punctuation only (e.g. "Ruyi_tt_ADD_ASS, // +=")
+#  becomes an operator, so adding an operator to the enum is enough.
+#  Identifiers, numbers, comments and the number errors are described by the
+#  small regular expressions in PATTERNS below.
+#
+#  The char classes are computed from all patterns: chars which no pattern can
+#  tell apart share one class. Chars >= 128 all belong to one class.
+#
+#  usage: python3 tools/gen_lexer_dfa.py
+#
+
+import os
+import re
+import string
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+LEXER_HEADER = os.path.join(ROOT, "src", "ruyi_lexer.h")
+OUTPUT = os.path.join(ROOT, "src", "ruyi_lexer_dfa.inc")
+
+# symbols 0..127 are ascii chars, NON_ASCII stands for every char >= 128
+NON_ASCII = 128
+ALPHABET = range(NON_ASCII + 1)
+
+SKIP = "RUYI_LEXER_DFA_SKIP"
+
+EXP = r"([eE]-?[0-9]+)?"
+
+# (action, pattern), a token type or SKIP or an error message,
+# when two patterns match the same text, the first one wins.
+PATTERNS = [
+    (SKIP, r"[ \t\r\n]+"),
+    ("Ruyi_tt_LINE_COMMENTS", r"//[^\n]*\n?"),
+    # unterminated comments run to the end of the file
+    ("Ruyi_tt_MLINES_COMMENTS", r"/\*([^*]|\*+[^*/])*\**"),
+    ("Ruyi_tt_MLINES_COMMENTS", r"/\*([^*]|\*+[^*/])*\*+/"),
+    ("Ruyi_tt_IDENTITY", r"[A-Za-z_][A-Za-z0-9_]*"),
+    # an integer with a negative exponent is a float, e.g. 5e-3
+    ("Ruyi_tt_INTEGER", r"0|[1-9][0-9]*([eE][0-9]+)?"),
+    ("Ruyi_tt_INTEGER", r"0[0-7]+|0[xX][0-9a-fA-F]*|0[bB][01]*"),
+    ("Ruyi_tt_FLOAT", r"([1-9][0-9]*|0)\.[0-9]*" + EXP),
+    ("Ruyi_tt_FLOAT", r"\.[0-9]+" + EXP),
+    ("Ruyi_tt_FLOAT", r"[1-9][0-9]*[eE]-[0-9]+"),
+    # the rest of string and char is read by ruyi_lexer_handle_string and ruyi_lexer_handle_char
+    ("Ruyi_tt_STRING", r'"'),
+    ("Ruyi_tt_CHAR", r"'"),
+    ("unsupport number, the decimal must start with none-zero", r"0[89]"),
+    ("octal number only support digit 0 to 7", r"0[0-7]+[89]"),
+    ("binary number only support digit 0 and 1", r"0[bB][01]*[2-9]"),
+    ("unsupport float number for explicit radix number", r"0([0-7]+|[xX][0-9a-fA-F]*|[bB][01]*)\."),
+    ("exponent miss digit", r"([1-9][0-9]*(\.[0-9]*)?|0\.[0-9]*|\.[0-9]+)[eE]-?"),
+]
+
+# only the text of these is kept in the reader's text buffer, the others need no value
+TEXT_ACTIONS = {"Ruyi_tt_IDENTITY", "Ruyi_tt_INTEGER", "Ruyi_tt_FLOAT"}
+
+
+def read_tokens():
+    with open(LEXER_HEADER, encoding="utf-8") as f:
+        source = f.read()
+    enum = re.search(r"typedef enum \{(.*?)\} ruyi_token_type;", source, re.S)
+    if not enum:
+        sys.exit("ruyi_token_type not found in " + LEXER_HEADER)
+    return re.findall(r"(Ruyi_tt_\w+)\s*(?:=\s*\d+\s*)?,\s*//[ \t]*(\S*)", enum.group(1))
+
+
+def read_operators(tokens):
+    operators = []
+    for name, comment in tokens:
+        if comment and all(c in string.punctuation for c in comment):
+            operators.append((name, comment))
+    texts = [text for _, text in operators]
+    if len(set(texts)) != len(texts):
+        sys.exit("duplicated operators in ruyi_token_type: %s" % texts)
+    return operators
+
+
+# ---------------- regular expressions to NFA ----------------
+
+class Nfa:
+    def __init__(self):
+        self.edges = []     # state -> list of (symbols or None for epsilon, target)
+        self.accepts = {}   # state -> pattern index
+
+    def state(self):
+        self.edges.append([])
+        return len(self.edges) - 1
+
+    def edge(self, src, symbols, dst):
+        self.edges[src].append((symbols, dst))
+
+
+ESCAPES = {"n": "\n", "t": "\t", "r": "\r"}
+
+
+class RegexParser:
+    def __init__(self, nfa, text):
+        self.nfa = nfa
+        self.text = text
+        self.pos = 0
+
+    def peek(self):
+        return self.text[self.pos] if self.pos < len(self.text) else None
+
+    def take(self):
+        c = self.text[self.pos]
+        self.pos += 1
+        return c
+
+    def parse(self):
+        start, end = self.alternation()
+        if self.pos != len(self.text):
+            sys.exit("bad pattern: " + self.text)
+        return start, end
+
+    def alternation(self):
+        start, end = self.sequence()
+        while self.peek() == "|":
+            self.take()
+            s2, e2 = self.sequence()
+            s, e = self.nfa.state(), self.nfa.state()
+            self.nfa.edge(s, None, start)
+            self.nfa.edge(s, None, s2)
+            self.nfa.edge(end, None, e)
+            self.nfa.edge(e2, None, e)
+            start, end = s, e
+        return start, end
+
+    def sequence(self):
+        start = end = self.nfa.state()
+        while self.peek() is not None and self.peek() not in "|)":
+            s, e = self.repeat()
+            self.nfa.edge(end, None, s)
+            end = e
+        return start, end
+
+    def repeat(self):
+        start, end = self.atom()
+        while self.peek() is not None and self.peek() in "*+?":
+            op = self.take()
+            s, e = self.nfa.state(), self.nfa.state()
+            self.nfa.edge(s, None, start)
+            self.nfa.edge(end, None, e)
+            if op in "*?":
+                self.nfa.edge(s, None, e)
+            if op in "*+":
+                self.nfa.edge(end, None, start)
+            start, end = s, e
+        return start, end
+
+    def atom(self):
+        c = self.take()
+        if c == "(":
+            start, end = self.alternation()
+            if self.take() != ")":
+                sys.exit("miss ) in pattern: " + self.text)
+            return start, end
+        if c == "[":
+            symbols = self.char_set()
+        else:
+            if c == "\\":
+                c = self.escaped()
+            symbols = frozenset([ord(c)])
+        s, e = self.nfa.state(), self.nfa.state()
+        self.nfa.edge(s, symbols, e)
+        return s, e
+
+    def escaped(self):
+        c = self.take()
+        return ESCAPES.get(c, c)
+
+    def char_set(self):
+        negate = False
+        if self.peek() == "^":
+            self.take()
+            negate = True
+        symbols = set()
+        while self.peek() != "]":
+            c = self.take()
+            if c == "\\":
+                c = self.escaped()
+            if self.peek() == "-" and self.text[self.pos + 1] != "]":
+                self.take()
+                last = self.take()
+                if last == "\\":
+                    last = self.escaped()
+                symbols.update(range(ord(c), ord(last) + 1))
+            else:
+                symbols.add(ord(c))
+        self.take()
+        if negate:
+            symbols = set(ALPHABET) - symbols
+        return frozenset(symbols)
+
+
+def escape_regex(text):
+    return "".join("\\" + c if c in "\\[]()|*+?-^" else c for c in text)
+
+
+def build_nfa(rules):
+    nfa = Nfa()
+    start = nfa.state()
+    for index, (_, pattern) in enumerate(rules):
+        s, e = RegexParser(nfa, pattern).parse()
+        nfa.edge(start, None, s)
+        nfa.accepts[e] = index
+    return nfa, start
+
+
+# ---------------- NFA to DFA ----------------
+
+def closure(nfa, states):
+    stack = list(states)
+    result = set(states)
+    while stack:
+        state = stack.pop()
+        for symbols, target in nfa.edges[state]:
+            if symbols is None and target not in result:
+                result.add(target)
+                stack.append(target)
+    return frozenset(result)
+
+
+def char_classes(nfa):
+    # chars with the same signature (the sets they belong to) are never told apart
+    sets = sorted({symbols for edges in nfa.edges for symbols, _ in edges if symbols is not None}, key=sorted)
+    signatures = {}
+    for symbol in ALPHABET:
+        key = tuple(symbol in s for s in sets)
+        signatures.setdefault(key, []).append(symbol)
+    groups = sorted(signatures.values())
+    classes = {}
+    for index, group in enumerate(groups):
+        for symbol in group:
+            classes[symbol] = index
+    return classes, groups
+
+
+def build_dfa(nfa, start, rules, classes, groups):
+    # DFA state 0 is the dead state, 1 is the start state
+    start_set = closure(nfa, [start])
+    dfa_sets = [None, start_set]
+    index_of = {start_set: 1}
+    transitions = [[0] * len(groups), None]
+    pos = 1
+    while pos < len(dfa_sets):
+        row = [0] * len(groups)
+        for class_index, group in enumerate(groups):
+            symbol = group[0]
+            targets = set()
+            for state in dfa_sets[pos]:
+                for symbols, target in nfa.edges[state]:
+                    if symbols is not None and symbol in symbols:
+                        targets.add(target)
+            if not targets:
+                continue
+            target_set = closure(nfa, targets)
+            if target_set not in index_of:
+                index_of[target_set] = len(dfa_sets)
+                dfa_sets.append(target_set)
+                transitions.append(None)
+            row[class_index] = index_of[target_set]
+        transitions[pos] = row
+        pos += 1
+    accepts = ["0"]
+    keep_text = [0]
+    for state_set in dfa_sets[1:]:
+        matched = sorted(nfa.accepts[s] for s in state_set if s in nfa.accepts)
+        accepts.append(action_name(rules, matched[0]) if matched else "0")
+        alive = pattern_of_states(nfa, rules, state_set)
+        keep_text.append(1 if alive & TEXT_ACTIONS else 0)
+    return transitions, accepts, keep_text
+
+
+def pattern_of_states(nfa, rules, state_set):
+    # the actions of the patterns which are still alive in a DFA state
+    alive = set()
+    for state in state_set:
+        owner = STATE_OWNERS.get(state)
+        if owner is not None:
+            alive.add(rules[owner][0])
+    return alive
+
+
+STATE_OWNERS = {}
+
+
+def mark_owners(nfa, start):
+    for index, (_, entry) in enumerate(nfa.edges[start]):
+        stack = [entry]
+        while stack:
+            state = stack.pop()
+            if state in STATE_OWNERS:
+                continue
+            STATE_OWNERS[state] = index
+            stack.extend(target for _, target in nfa.edges[state])
+
+
+ERRORS = []
+
+
+def action_name(rules, index):
+    action = rules[index][0]
+    if action.startswith("Ruyi_tt_") or action == SKIP:
+        return action
+    return "RUYI_LEXER_DFA_ERROR(%d)" % ERRORS.index(action)
+
+
+def c_char(symbol):
+    if symbol == NON_ASCII:
+        return "non-ascii"
+    c = chr(symbol)
+    if c in string.ascii_letters + string.digits + string.punctuation:
+        return c
+    return "\\x%02x" % symbol
+
+
+def main():
+    tokens = read_tokens()
+    names = {name for name, _ in tokens}
+    operators = read_operators(tokens)
+    rules = list(PATTERNS) + [(name, escape_regex(text)) for name, text in operators]
+    for action, _ in rules:
+        if action.startswith("Ruyi_tt_") and action not in names:
+            sys.exit("%s is not in ruyi_token_type" % action)
+        if not action.startswith("Ruyi_tt_") and action != SKIP and action not in ERRORS:
+            ERRORS.append(action)
+
+    nfa, start = build_nfa(rules)
+    mark_owners(nfa, start)
+    classes, groups = char_classes(nfa)
+    transitions, accepts, keep_text = build_dfa(nfa, start, rules, classes, groups)
+    if len(transitions) > 255 or len(groups) > 255:
+        sys.exit("too many states or classes for UINT8 tables")
+
+    out = []
+    out.append("//")
+    out.append("//  ruyi_lexer_dfa.inc")
+    out.append("//  ruyi")
+    out.append("//")
+    out.append("//  Generated by tools/gen_lexer_dfa.py from ruyi_token_type in ruyi_lexer.h, do not edit.")
+    out.append("//")
+    out.append("")
+    out.append("#define RUYI_LEXER_DFA_CLASS_COUNT %d" % len(groups))
+    out.append("#define RUYI_LEXER_DFA_STATE_COUNT %d" % len(transitions))
+    out.append("#define RUYI_LEXER_DFA_START 1")
+    out.append("// class of chars >= 256, chars in 128..255 have the same class in g_ruyi_lexer_char_class")
+    out.append("#define RUYI_LEXER_DFA_CLASS_NON_ASCII %d" % classes[NON_ASCII])
+    out.append("")
+    out.append("// accept actions besides token types: skip the text or report an error")
+    out.append("#define %s (-1)" % SKIP)
+    out.append("#define RUYI_LEXER_DFA_ERROR(n) (-2 - (n))")
+    out.append("#define RUYI_LEXER_DFA_ERROR_INDEX(action) (-2 - (action))")
+    out.append("")
+    out.append("static const char* g_ruyi_lexer_dfa_errors[] = {")
+    for message in ERRORS:
+        out.append('    "%s",' % message)
+    out.append("};")
+    out.append("")
+    out.append("static const UINT8 g_ruyi_lexer_char_class[256] = {")
+    for row in range(0, 256, 16):
+        cells = [str(classes[min(c, NON_ASCII)]) for c in range(row, row + 16)]
+        out.append("    " + ", ".join(cells) + ",")
+    out.append("};")
+    out.append("")
+    out.append("/*")
+    for index, group in enumerate(groups):
+        shown = " ".join(c_char(s) for s in group[:24]) + (" ..." if len(group) > 24 else "")
+        out.append(" class %d: %s" % (index, shown))
+    out.append(" */")
+    out.append("")
+    out.append("// next state by state and char class, 0 means no transition")
+    out.append("static const UINT8 g_ruyi_lexer_dfa_next[RUYI_LEXER_DFA_STATE_COUNT][RUYI_LEXER_DFA_CLASS_COUNT] = {")
+    for row in transitions:
+        out.append("    {" + ", ".join(str(v) for v in row) + "},")
+    out.append("};")
+    out.append("")
+    out.append("// token type (or skip/error action) of the text ending at the state, 0 means not accepted")
+    out.append("static const INT16 g_ruyi_lexer_dfa_accept[RUYI_LEXER_DFA_STATE_COUNT] = {")
+    for index, action in enumerate(accepts):
+        out.append("    %s, // %d" % (action, index))
+    out.append("};")
+    out.append("")
+    out.append("// whether the chars read at the state are kept in the text buffer")
+    out.append("static const UINT8 g_ruyi_lexer_dfa_keep_text[RUYI_LEXER_DFA_STATE_COUNT] = {")
+    for row in range(0, len(keep_text), 16):
+        out.append("    " + ", ".join(str(v) for v in keep_text[row:row + 16]) + ",")
+    out.append("};")
+    with open(OUTPUT, "w", encoding="utf-8") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+#
+#  gen_lexer_keywords.py
+#  ruyi
+#
+#  Generates src/ruyi_lexer_keywords.inc from the g_ruyi_keywords table in
+#  src/ruyi_lexer.c: a minimal perfect hash over the keywords (hash and
+#  displace) and the token type to keyword index table.
+#
+#  usage: python3 tools/gen_lexer_keywords.py
+#
+
+import os
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+LEXER_SOURCE = os.path.join(ROOT, "src", "ruyi_lexer.c")
+OUTPUT = os.path.join(ROOT, "src", "ruyi_lexer_keywords.inc")
+
+# keep in sync with RUYI_KEYWORDS_HASH1/RUYI_KEYWORDS_HASH2 written below
+HASH1_C = "((len) * 31 + (c0) * 7 + (cl))"
+HASH2_C = "((len) + (c0) * 3 + (cl) * 11)"
+
+
+def hash1(len_, c0, cl):
+    return (len_ * 31 + c0 * 7 + cl) & 0xFFFFFFFF
+
+
+def hash2(len_, c0, cl):
+    return (len_ + c0 * 3 + cl * 11) & 0xFFFFFFFF
+
+
+def read_keywords():
+    with open(LEXER_SOURCE, encoding="utf-8") as f:
+        source = f.read()
+    table = re.search(r"g_ruyi_keywords\[\]\s*=\s*\{(.*?)\n\};", source, re.S)
+    if not table:
+        sys.exit("g_ruyi_keywords not found in " + LEXER_SOURCE)
+    return re.findall(r'\{\s*(Ruyi_tt_\w+)\s*,\s*"([^"]*)"\s*\}', table.group(1))
+
+
+def build_displacements(keys, disp_size):
+    n = len(keys)
+    buckets = [[] for _ in range(disp_size)]
+    for index, key in enumerate(keys):
+        buckets[hash1(*key) % disp_size].append(index)
+    slots = [None] * n
+    disp = [0] * disp_size
+    # place the biggest buckets first
+    for bucket in sorted(range(disp_size), key=lambda b: -len(buckets[b])):
+        items = buckets[bucket]
+        if not items:
+            continue
+        for d in range(n):
+            taken = [(hash2(*keys[i]) + d) % n for i in items]
+            if len(set(taken)) == len(taken) and all(slots[t] is None for t in taken):
+                for i, t in zip(items, taken):
+                    slots[t] = i
+                disp[bucket] = d
+                break
+        else:
+            return None
+    return disp, slots
+
+
+def main():
+    keywords = read_keywords()
+    keys = [(len(word), ord(word[0]), ord(word[-1])) for _, word in keywords]
+    if len(set(keys)) != len(keys):
+        sys.exit("keywords are not unique by (length, first char, last char)")
+    for disp_size in range(1, len(keys) + 1):
+        result = build_displacements(keys, disp_size)
+        if result:
+            break
+    disp, slots = result
+    min_len = min(len(word) for _, word in keywords)
+    max_len = max(len(word) for _, word in keywords)
+
+    out = []
+    out.append("//")
+    out.append("//  ruyi_lexer_keywords.inc")
+    out.append("//  ruyi")
+    out.append("//")
+    out.append("//  Generated by tools/gen_lexer_keywords.py from g_ruyi_keywords in ruyi_lexer.c, do not edit.")
+    out.append("//")
+    out.append("")
+    out.append("#define RUYI_KEYWORDS_COUNT %d" % len(keywords))
+    out.append("#define RUYI_KEYWORDS_MIN_LENGTH %d" % min_len)
+    out.append("#define RUYI_KEYWORDS_MAX_LENGTH %d" % max_len)
+    out.append("#define RUYI_KEYWORDS_DISP_SIZE %d" % disp_size)
+    out.append("#define RUYI_KEYWORDS_HASH1(len, c0, cl) %s" % HASH1_C)
+    out.append("#define RUYI_KEYWORDS_HASH2(len, c0, cl) %s" % HASH2_C)
+    out.append("")
+    out.append("static const UINT8 g_ruyi_keywords_disp[RUYI_KEYWORDS_DISP_SIZE] = {")
+    out.append("    " + ", ".join(str(d) for d in disp))
+    out.append("};")
+    out.append("")
+    out.append("// hash slot to index of g_ruyi_keywords")
+    out.append("static const UINT8 g_ruyi_keywords_slots[RUYI_KEYWORDS_COUNT] = {")
+    out.append("    " + ", ".join(str(i) for i in slots))
+    out.append("};")
+    out.append("")
+    out.append("static WIDE_CHAR g_ruyi_keywords_chars[] = {")
+    offsets = []
+    pos = 0
+    for _, word in keywords:
+        offsets.append(pos)
+        out.append("    " + ", ".join("'%s'" % c for c in word) + ",")
+        pos += len(word)
+    out.append("};")
+    out.append("")
+    out.append("static const ruyi_unicode_string g_ruyi_keywords_strs[RUYI_KEYWORDS_COUNT] = {")
+    for (_, word), offset in zip(keywords, offsets):
+        out.append("    {g_ruyi_keywords_chars + %d, %d, %d}," % (offset, len(word), len(word)))
+    out.append("};")
+    out.append("")
+    out.append("// token type to index of g_ruyi_keywords plus 1, 0 for none keyword types")
+    out.append("static const UINT8 g_ruyi_keywords_by_type[] = {")
+    for index, (token_type, _) in enumerate(keywords):
+        out.append("    [%s] = %d," % (token_type, index + 1))
+    out.append("};")
+    with open(OUTPUT, "w", encoding="utf-8") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
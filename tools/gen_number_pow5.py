@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+#
+#  gen_number_pow5.py
+#  ruyi
+#
+#  Generates src/ruyi_number_pow5.inc, the 128-bit approximations of 5^q used by
+#  the Eisel-Lemire algorithm in ruyi_number.c.
+#
+#  For q >= 0 the value is 5^q shifted so the highest bit is bit 127, truncated.
+#  For q < 0 it is the reciprocal 2^b / 5^-q normalized the same way and rounded up,
+#  so the product with a 64-bit mantissa never underestimates the exact value.
+#
+#  usage: python3 tools/gen_number_pow5.py
+#
+
+import os
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+OUTPUT = os.path.join(ROOT, "src", "ruyi_number_pow5.inc")
+
+# smallest and largest decimal exponents which are not simply 0 or infinity for double
+SMALLEST_POWER = -342
+LARGEST_POWER = 308
+
+
+def pow5_128(q):
+    if q >= 0:
+        power5 = 5 ** q
+        while power5 < (1 << 127):
+            power5 *= 2
+        while power5 >= (1 << 128):
+            power5 //= 2
+        return power5
+    power5 = 5 ** -q
+    z = power5.bit_length()
+    if q >= -27:
+        # 5^-q < 2^64, the reciprocal fits in 128 bits without truncation
+        return 2 ** (z + 127) // power5 + 1
+    b = 2 * z + 2 * 64
+    c = 2 ** b // power5 + 1
+    while c >= (1 << 128):
+        c //= 2
+    return c
+
+
+def main():
+    out = []
+    out.append("//")
+    out.append("//  ruyi_number_pow5.inc")
+    out.append("//  ruyi")
+    out.append("//")
+    out.append("//  Generated by tools/gen_number_pow5.py, do not edit.")
+    out.append("//")
+    out.append("")
+    out.append("#define RUYI_NUMBER_SMALLEST_POWER10 (%d)" % SMALLEST_POWER)
+    out.append("#define RUYI_NUMBER_LARGEST_POWER10 %d" % LARGEST_POWER)
+    out.append("")
+    out.append("// high and low 64 bits of 5^q for q in [RUYI_NUMBER_SMALLEST_POWER10, RUYI_NUMBER_LARGEST_POWER10]")
+    out.append("static const UINT64 g_ruyi_number_pow5_128[] = {")
+    for q in range(SMALLEST_POWER, LARGEST_POWER + 1):
+        value = pow5_128(q)
+        out.append("    0x%016xULL, 0x%016xULL, // 5^%d" % (value >> 64, value & ((1 << 64) - 1), q))
+    out.append("};")
+    with open(OUTPUT, "w", encoding="utf-8") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,249 @@
+#!/usr/bin/env python3
+#
+#  gen_parser_tables.py
+#  ruyi
+#
+#  Generates src/ruyi_parser_tables.inc from the grammar in src/syntax.txt: the
+#  LL(1) first tokens of the rules the parser chooses between, so a choice tries
+#  only the alternatives which can start with the next token.
+#
+#  The grammar is read as EBNF: <rule> ::= body, where a body is made of <rules>,
+#  token types of ruyi_token_type in src/ruyi_lexer.h without the Ruyi_tt_ prefix,
+#  groups ( ), choices |, and the suffixes * and ?. Rules which are referred but
+#  not defined (e.g. <try statement>) and words which are not token types
+#  (e.g. KW_INTERFACE) are not implemented by the parser, they never match.
+#
+#  usage: python3 tools/gen_parser_tables.py
+#
+
+import os
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+SYNTAX = os.path.join(ROOT, "src", "syntax.txt")
+LEXER_HEADER = os.path.join(ROOT, "src", "ruyi_lexer.h")
+OUTPUT = os.path.join(ROOT, "src", "ruyi_parser_tables.inc")
+
+# spellings of syntax.txt for the token types named otherwise in ruyi_lexer.h
+TOKEN_ALIASES = {
+    "LPARAN": "LPAREN",
+    "RPARAN": "RPAREN",
+    "RUNE": "CHAR",
+}
+
+# the rules the choices of ruyi_parser.c are made between, each is a bit of g_ruyi_parser_first
+PREDICTED_RULES = [
+    # <statement>
+    "labeled statement",
+    "if statement",
+    "while statement",
+    "expression statement",
+    "for statement",
+    "switch statement",
+    "return statement",
+    "break statement",
+    "continue statement",
+    "sub block statement",
+    # <block statement>
+    "local variable declaration statement",
+    "statement",
+    # <global declaration>
+    "variable declaration",
+    "function declaration",
+    # <primary>
+    "primary no new collection",
+    "array creation",
+    "map creation",
+    "anonymous function declaration",
+]
+
+TOKEN_RE = re.compile(r"\s*(<[^>]+>|::=|[A-Za-z_][A-Za-z0-9_]*|[()|*?])")
+
+
+def read_token_types():
+    with open(LEXER_HEADER, encoding="utf-8") as f:
+        source = f.read()
+    enum = re.search(r"typedef enum \{(.*?)\} ruyi_token_type;", source, re.S)
+    if not enum:
+        sys.exit("ruyi_token_type not found in " + LEXER_HEADER)
+    return re.findall(r"Ruyi_tt_(\w+)", enum.group(1))
+
+
+def tokenize(text, line_no):
+    words = []
+    pos = 0
+    text = text.rstrip()
+    while pos < len(text):
+        m = TOKEN_RE.match(text, pos)
+        if not m:
+            sys.exit("syntax.txt:%d: unknown text '%s'" % (line_no, text[pos:].strip()))
+        words.append(m.group(1))
+        pos = m.end()
+    return words
+
+
+# a body is ("seq", [items]), ("alt", [bodies]), ("rep", body, "*" or "?"), ("rule", name) or ("token", name)
+def parse_body(words, line_no):
+    pos = [0]
+
+    def peek():
+        return words[pos[0]] if pos[0] < len(words) else None
+
+    def alternatives():
+        bodies = [sequence()]
+        while peek() == "|":
+            pos[0] += 1
+            bodies.append(sequence())
+        return bodies[0] if len(bodies) == 1 else ("alt", bodies)
+
+    def sequence():
+        items = []
+        while peek() not in (None, "|", ")"):
+            items.append(item())
+        return ("seq", items)
+
+    def item():
+        word = words[pos[0]]
+        pos[0] += 1
+        if word == "(":
+            body = alternatives()
+            if peek() != ")":
+                sys.exit("syntax.txt:%d: miss ')'" % line_no)
+            pos[0] += 1
+        elif word.startswith("<"):
+            body = ("rule", word[1:-1].strip())
+        elif word in ("*", "?", ")", "::="):
+            sys.exit("syntax.txt:%d: unexpected '%s'" % (line_no, word))
+        else:
+            body = ("token", word)
+        while peek() in ("*", "?"):
+            body = ("rep", body, peek())
+            pos[0] += 1
+        return body
+
+    body = alternatives()
+    if peek() is not None:
+        sys.exit("syntax.txt:%d: unexpected '%s'" % (line_no, peek()))
+    return body
+
+
+def read_grammar():
+    rules = {}
+    with open(SYNTAX, encoding="utf-8") as f:
+        for line_no, line in enumerate(f, 1):
+            if not line.strip() or line.lstrip().startswith("#"):
+                continue
+            words = tokenize(line, line_no)
+            if len(words) < 2 or not words[0].startswith("<") or words[1] != "::=":
+                sys.exit("syntax.txt:%d: a rule must be '<name> ::= body'" % line_no)
+            name = words[0][1:-1].strip()
+            if name in rules:
+                sys.exit("syntax.txt:%d: <%s> is defined again" % (line_no, name))
+            rules[name] = parse_body(words[2:], line_no)
+    return rules
+
+
+def first_sets(rules, token_types):
+    nullable = {name: False for name in rules}
+    first = {name: set() for name in rules}
+    missing = set()
+
+    # first tokens and nullable of a body by the sets known so far
+    def body_first(body):
+        kind = body[0]
+        if kind == "token":
+            token = TOKEN_ALIASES.get(body[1], body[1])
+            if token not in token_types:
+                missing.add(body[1])
+                return set(), False
+            return {token}, False
+        if kind == "rule":
+            if body[1] not in rules:
+                missing.add("<%s>" % body[1])
+                return set(), False
+            return first[body[1]], nullable[body[1]]
+        if kind == "rep":
+            tokens, _ = body_first(body[1])
+            return tokens, True
+        if kind == "alt":
+            tokens, empty = set(), False
+            for sub in body[1]:
+                sub_tokens, sub_empty = body_first(sub)
+                tokens |= sub_tokens
+                empty = empty or sub_empty
+            return tokens, empty
+        tokens = set()
+        for sub in body[1]:
+            sub_tokens, sub_empty = body_first(sub)
+            tokens |= sub_tokens
+            if not sub_empty:
+                return tokens, False
+        return tokens, True
+
+    changed = True
+    while changed:
+        changed = False
+        for name, body in rules.items():
+            tokens, empty = body_first(body)
+            if not tokens <= first[name] or empty != nullable[name]:
+                first[name] = first[name] | tokens
+                nullable[name] = nullable[name] or empty
+                changed = True
+    return first, nullable, missing
+
+
+def macro_name(rule):
+    return "RUYI_FIRST_" + re.sub(r"[^A-Za-z0-9]+", "_", rule).upper()
+
+
+def main():
+    token_types = read_token_types()
+    rules = read_grammar()
+    first, nullable, missing = first_sets(rules, token_types)
+    for name in sorted(missing):
+        print("not implemented by the parser, never matches: %s" % name, file=sys.stderr)
+    for rule in PREDICTED_RULES:
+        if rule not in rules:
+            sys.exit("<%s> is not defined in syntax.txt" % rule)
+        # a choice skips an alternative the next token does not start, an empty one would be skipped wrongly
+        if nullable[rule]:
+            sys.exit("<%s> may be empty, it can not be predicted by its first tokens" % rule)
+    if len(PREDICTED_RULES) > 32:
+        sys.exit("more than 32 predicted rules")
+
+    out = []
+    out.append("//")
+    out.append("//  ruyi_parser_tables.inc")
+    out.append("//  ruyi")
+    out.append("//")
+    out.append("//  Generated by tools/gen_parser_tables.py from syntax.txt, do not edit.")
+    out.append("//")
+    out.append("")
+    out.append("#define RUYI_FIRST_RULE_COUNT %d" % len(PREDICTED_RULES))
+    out.append("#define RUYI_FIRST_TOKEN_TYPE_COUNT (Ruyi_tt_%s + 1)" % token_types[-1])
+    out.append("")
+    out.append("// the rules of syntax.txt, bits of g_ruyi_parser_first")
+    width = max(len(macro_name(rule)) for rule in PREDICTED_RULES)
+    for index, rule in enumerate(PREDICTED_RULES):
+        out.append("#define %s (1u << %d)" % (macro_name(rule).ljust(width), index))
+    out.append("")
+    out.append("/*")
+    out.append(" first tokens of the rules:")
+    for rule in PREDICTED_RULES:
+        out.append(" <%s>: %s" % (rule, " ".join(t for t in token_types if t in first[rule])))
+    out.append(" */")
+    out.append("")
+    out.append("// token type to the rules which can start with it")
+    out.append("static const UINT32 g_ruyi_parser_first[RUYI_FIRST_TOKEN_TYPE_COUNT] = {")
+    for token in token_types:
+        bits = [macro_name(rule) for rule in PREDICTED_RULES if token in first[rule]]
+        if bits:
+            out.append("    [Ruyi_tt_%s] = %s," % (token, " | ".join(bits)))
+    out.append("};")
+    with open(OUTPUT, "w", encoding="utf-8") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()